@@ -0,0 +1,97 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include <CLI/App.hpp>
+#include <fmt/format.h>
+
+#include <csignal>
+
+#include <pthread.h>
+#include <signal.h>
+
+#include "config.hh"
+#include "server.hh"
+
+namespace px = phoenix;
+
+static server* running_server = nullptr;
+
+static void handle_signal(int) {
+	if (running_server != nullptr)
+		running_server->stop();
+}
+
+int main(int argc, char** argv) {
+	px::logging::use_default_logger();
+
+	CLI::App app {"Keep VDFs open and answer requests of zdump, zvdfs and ztex about their contents."};
+
+	bool display_version {false};
+	app.add_flag("-v,--version", display_version, "print version information");
+
+	std::vector<std::string> vdfs {};
+	app.add_option("vdfs", vdfs, "the VDFs to open");
+
+	std::string socket = pstudio::daemon::default_socket_path();
+	app.add_option("-s,--socket", socket, "listen on this socket instead of " + socket);
+
+	std::size_t cache_size {64};
+	app.add_option("-c,--cache", cache_size, "keep this many parsed files in memory (default: 64)");
+
+	unsigned threads {0};
+	app.add_option("-j,--threads",
+	               threads,
+	               "answer requests on this many threads or one per CPU core if 0 (the default)");
+
+	CLI11_PARSE(app, argc, argv);
+
+	if (display_version) {
+		fmt::print("pstudio-daemon v{}\n", PSTUDIO_DAEMON_VERSION);
+		return EXIT_SUCCESS;
+	}
+
+	if (vdfs.empty()) {
+		fmt::print(stderr, "no VDFs specified\n");
+		return EXIT_FAILURE;
+	}
+
+	server srv {cache_size};
+
+	for (const auto& vdf : vdfs) {
+		try {
+			srv.mount(vdf);
+		} catch (const px::error& e) {
+			fmt::print(stderr, "failed to open VDF {}: {}\n", vdf, e.what());
+			return EXIT_FAILURE;
+		}
+	}
+
+	struct sigaction action {};
+	action.sa_handler = handle_signal;
+	sigemptyset(&action.sa_mask);
+	action.sa_flags = 0;
+
+	running_server = &srv;
+	sigaction(SIGINT, &action, nullptr);
+	sigaction(SIGTERM, &action, nullptr);
+	std::signal(SIGPIPE, SIG_IGN);
+
+	bool success;
+	{
+		// the signals are blocked on the pool's threads, which inherit the mask, so the main thread handles them
+		// and its poll() is interrupted. stop() wakes up serve() on any thread anyway.
+		sigset_t signals, previous;
+		sigemptyset(&signals);
+		sigaddset(&signals, SIGINT);
+		sigaddset(&signals, SIGTERM);
+
+		pthread_sigmask(SIG_BLOCK, &signals, &previous);
+		pstudio::thread_pool pool {threads};
+		pthread_sigmask(SIG_SETMASK, &previous, nullptr);
+
+		fmt::print(stderr, "serving {} VDFs on {}\n", vdfs.size(), socket);
+		success = srv.serve(socket, pool);
+	}
+
+	running_server = nullptr;
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
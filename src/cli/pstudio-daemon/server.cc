@@ -0,0 +1,348 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "server.hh"
+
+#include <format.hh>
+#include <serialize.hh>
+#include <writer.hh>
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <set>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+namespace proto = pstudio::daemon;
+
+namespace {
+	/// \brief A connection waiting for its next request and the time it started waiting.
+	struct idle_connection {
+		int fd;
+		std::chrono::steady_clock::time_point since;
+	};
+} // namespace
+
+static void list_entries(const fs::path& self,
+                         const std::set<px::vdf_entry, px::vdf_entry_comparator>& entries,
+                         std::string& out) {
+	for (const auto& entry : entries) {
+		auto path = self / entry.name;
+		out += path.string<char>();
+		out += '\n';
+
+		if (entry.is_directory())
+			list_entries(path, entry.children, out);
+	}
+}
+
+static proto::response make_response(proto::status status, std::string payload) {
+	return {status, std::move(payload)};
+}
+
+server::server(std::size_t cache_size) : _m_cache(cache_size) {
+	// stop() must never block inside of a signal handler, even if the pipe is full, and serve() drains it
+	if (::pipe(_m_wakeup) == 0) {
+		::fcntl(_m_wakeup[0], F_SETFL, ::fcntl(_m_wakeup[0], F_GETFL) | O_NONBLOCK);
+		::fcntl(_m_wakeup[1], F_SETFL, ::fcntl(_m_wakeup[1], F_GETFL) | O_NONBLOCK);
+	} else {
+		_m_wakeup[0] = _m_wakeup[1] = -1;
+	}
+}
+
+server::~server() {
+	if (_m_wakeup[0] >= 0) {
+		::close(_m_wakeup[0]);
+		::close(_m_wakeup[1]);
+	}
+}
+
+void server::mount(const std::string& path) {
+	auto result = std::make_unique<archive>(archive {px::vdf_file::open(path), {}});
+	list_entries("", result->vdf.entries, result->listing);
+	_m_archives.insert_or_assign(proto::archive_path(path), std::move(result));
+}
+
+std::shared_ptr<const parsed_file> server::_parse(const px::vdf_entry& entry) {
+	if (auto cached = _m_cache.find(&entry))
+		return cached;
+
+	auto in = entry.open();
+	auto format = detect_file_format(in);
+
+	// nested VDFs are left to the clients, which mount them themselves
+	if (format == file_format::vdf || format == file_format::unknown)
+		return nullptr;
+
+	std::shared_ptr<const parsed_file> result {};
+	visit_file(format, in, [&result](auto&& obj) {
+		using type = std::decay_t<decltype(obj)>;
+
+		if constexpr (!std::is_same_v<type, px::Vfs>)
+			result = std::make_shared<const parsed_file>(std::in_place_type<type>, std::move(obj));
+	});
+
+	return _m_cache.insert(&entry, std::move(result));
+}
+
+proto::response server::handle(const proto::request& req) {
+	auto it = _m_archives.find(req.archive);
+	if (it == _m_archives.end())
+		return make_response(proto::status::not_found, "archive not mounted: " + req.archive);
+
+	const auto& mounted = *it->second;
+	if (req.type == proto::request_type::list)
+		return make_response(proto::status::ok, mounted.listing);
+
+	const auto* entry = mounted.vdf.find_entry(req.path);
+	if (entry == nullptr || entry->is_directory())
+		return make_response(proto::status::not_found, "file not found: " + req.path);
+
+	try {
+		switch (req.type) {
+		case proto::request_type::extract: {
+			auto in = entry->open();
+			return make_response(proto::status::ok,
+			                     std::string {reinterpret_cast<const char*>(in.array()), in.limit()});
+		}
+		case proto::request_type::dump: {
+			output_options options {};
+			options.bson = req.argument == 1;
+
+			auto parsed = _parse(*entry);
+			if (parsed == nullptr)
+				return make_response(proto::status::unsupported, "format not supported: " + req.path);
+
+			auto out = make_writer(nullptr, options);
+			std::visit([&out](const auto& obj) { serialize(*out, obj); }, *parsed);
+			return make_response(proto::status::ok, out->release());
+		}
+		case proto::request_type::texture: {
+			auto parsed = _parse(*entry);
+			const auto* texture = std::get_if<px::texture>(parsed.get());
+			if (texture == nullptr)
+				return make_response(proto::status::unsupported, "not a texture: " + req.path);
+
+			if (req.argument >= texture->mipmaps())
+				return make_response(proto::status::error,
+				                     fmt::format("mipmap {} not available. mipmaps 0 to {} are available",
+				                                 req.argument,
+				                                 texture->mipmaps() - 1));
+
+			auto pixels = texture->as_rgba8(req.argument);
+
+			std::string payload {};
+			proto::put_u32(payload, texture->mipmap_width(req.argument));
+			proto::put_u32(payload, texture->mipmap_height(req.argument));
+			payload.append(reinterpret_cast<const char*>(pixels.data()), pixels.size());
+			return make_response(proto::status::ok, std::move(payload));
+		}
+		case proto::request_type::list:
+			break;
+		}
+	} catch (const std::exception& e) {
+		return make_response(proto::status::error, e.what());
+	}
+
+	return make_response(proto::status::unsupported, "unknown request");
+}
+
+bool server::serve(const std::string& socket_path, pstudio::thread_pool& pool) {
+	sockaddr_un address;
+	if (!proto::make_address(socket_path, address)) {
+		fmt::print(stderr, "invalid socket path: {}\n", socket_path);
+		return false;
+	}
+
+	if (proto::client::connect(socket_path)) {
+		fmt::print(stderr, "another daemon is already listening on {}\n", socket_path);
+		return false;
+	}
+
+	if (_m_wakeup[0] < 0) {
+		fmt::print(stderr, "cannot create wakeup pipe\n");
+		return false;
+	}
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) {
+		fmt::print(stderr, "cannot create socket: {}\n", std::strerror(errno));
+		return false;
+	}
+
+	// a socket file left behind by a daemon which did not shut down cleanly
+	::unlink(socket_path.c_str());
+
+	if (::bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0 ||
+	    ::chmod(socket_path.c_str(), S_IRUSR | S_IWUSR) != 0 || ::listen(fd, SOMAXCONN) != 0) {
+		fmt::print(stderr, "cannot listen on {}: {}\n", socket_path, std::strerror(errno));
+		::close(fd);
+		return false;
+	}
+
+	// accept() only runs once poll() reported a pending connection, which may be gone by then
+	::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+
+	// connections waiting for their next request are watched here, so they do not occupy any thread
+	std::vector<idle_connection> idle {};
+	std::vector<pollfd> fds {};
+
+	while (!_m_stopped) {
+		fds.clear();
+		fds.push_back({fd, POLLIN, 0});
+		fds.push_back({_m_wakeup[0], POLLIN, 0});
+		for (const auto& connection : idle) {
+			fds.push_back({connection.fd, POLLIN, 0});
+		}
+
+		// wakes up once a second to close the connections which stayed idle for too long
+		if (::poll(fds.data(), static_cast<nfds_t>(fds.size()), 1000) < 0) {
+			if (errno == EINTR)
+				continue;
+
+			fmt::print(stderr, "cannot wait for connections: {}\n", std::strerror(errno));
+			break;
+		}
+
+		auto now = std::chrono::steady_clock::now();
+		std::size_t kept = 0;
+
+		for (std::size_t i = 0; i < idle.size(); ++i) {
+			if (fds[i + 2].revents != 0) {
+				// the request, or the connection being closed, is read on the pool
+				_submit(idle[i].fd, pool);
+			} else if (now - idle[i].since > std::chrono::seconds {CONNECTION_TIMEOUT}) {
+				::close(idle[i].fd);
+			} else {
+				idle[kept++] = idle[i];
+			}
+		}
+
+		idle.resize(kept);
+
+		// woken up by stop() or by a request being answered
+		if (fds[1].revents != 0) {
+			char buffer[64];
+			while (::read(_m_wakeup[0], buffer, sizeof buffer) > 0) {
+			}
+
+			std::lock_guard<std::mutex> lock {_m_connections_lock};
+			for (auto connection : _m_answered) {
+				idle.push_back({connection, now});
+			}
+			_m_answered.clear();
+		}
+
+		if (fds[0].revents == 0)
+			continue;
+
+		int connection = ::accept(fd, nullptr, nullptr);
+		if (connection < 0) {
+			if (errno == EINTR || errno == ECONNABORTED || errno == EAGAIN || errno == EWOULDBLOCK)
+				continue;
+
+			fmt::print(stderr, "cannot accept connections: {}\n", std::strerror(errno));
+			break;
+		}
+
+		// some systems pass the listening socket's flags on to accepted sockets
+		::fcntl(connection, F_SETFL, ::fcntl(connection, F_GETFL) & ~O_NONBLOCK);
+
+		// a client which stops sending or receiving in the middle of a frame only holds up its thread shortly
+		timeval timeout {TRANSFER_TIMEOUT, 0};
+		::setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+		::setsockopt(connection, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+
+		idle.push_back({connection, now});
+	}
+
+	// also set if serve() failed, so requests still being answered close their connection
+	_m_stopped = true;
+
+	for (const auto& connection : idle) {
+		::close(connection.fd);
+	}
+
+	// wakes up the threads still answering requests
+	{
+		std::lock_guard<std::mutex> lock {_m_connections_lock};
+		for (auto connection : _m_answered) {
+			::close(connection);
+		}
+		_m_answered.clear();
+
+		for (auto connection : _m_busy) {
+			::shutdown(connection, SHUT_RDWR);
+		}
+	}
+
+	::close(fd);
+	::unlink(socket_path.c_str());
+	return true;
+}
+
+void server::stop() noexcept {
+	_m_stopped = true;
+
+	if (_m_wakeup[1] >= 0) {
+		char byte = 0;
+		[[maybe_unused]] auto written = ::write(_m_wakeup[1], &byte, 1);
+	}
+}
+
+void server::_submit(int fd, pstudio::thread_pool& pool) {
+	{
+		std::lock_guard<std::mutex> lock {_m_connections_lock};
+		_m_busy.insert(fd);
+	}
+
+	pool.submit([this, fd] { _serve_request(fd); });
+}
+
+void server::_serve_request(int fd) {
+	auto open = false;
+
+	if (auto message = proto::read_frame(fd)) {
+		proto::response res {};
+
+		try {
+			res = handle(proto::decode_request(*message));
+		} catch (const std::exception& e) {
+			res = make_response(proto::status::error, e.what());
+		}
+
+		std::string frame {};
+		frame.reserve(res.payload.size() + 1);
+		frame.push_back(static_cast<char>(res.status));
+		frame += res.payload;
+
+		open = proto::write_frame(fd, frame);
+	}
+
+	// closed while locked so serve() never shuts down a descriptor which was reused in the meantime
+	std::lock_guard<std::mutex> lock {_m_connections_lock};
+	_m_busy.erase(fd);
+
+	if (!open || _m_stopped) {
+		::close(fd);
+		return;
+	}
+
+	// hands the connection back to serve() to wait for its next request
+	_m_answered.push_back(fd);
+
+	char byte = 0;
+	[[maybe_unused]] auto written = ::write(_m_wakeup[1], &byte, 1);
+}
@@ -0,0 +1,123 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/animation.hh>
+#include <phoenix/font.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/messages.hh>
+#include <phoenix/model_hierarchy.hh>
+#include <phoenix/model_mesh.hh>
+#include <phoenix/model_script.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+#include <phoenix/texture.hh>
+#include <phoenix/vdfs.hh>
+#include <phoenix/world.hh>
+
+#include <pstudio/daemon.hh>
+#include <pstudio/lru_cache.hh>
+#include <pstudio/parallel.hh>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief Any of the objects files can be parsed into.
+using parsed_file = std::variant<px::model_hierarchy,
+                                 px::animation,
+                                 px::messages,
+                                 px::font,
+                                 px::mesh,
+                                 px::texture,
+                                 px::model_script,
+                                 px::proto_mesh,
+                                 px::model_mesh,
+                                 px::morph_mesh,
+                                 px::world>;
+
+/// \brief Answers requests about a fixed set of VDFs which are opened once and kept open.
+class server {
+public:
+	/// \param cache_size The number of parsed files to keep in memory.
+	explicit server(std::size_t cache_size);
+	~server();
+
+	server(const server&) = delete;
+	server& operator=(const server&) = delete;
+
+	/// \brief Opens a VDF and adds it to the ones requests are answered for.
+	///
+	/// Must not be called while requests are handled.
+	/// \param path The path of the VDF.
+	/// \throws px::error if the VDF cannot be opened.
+	void mount(const std::string& path);
+
+	/// \brief Answers a single request. May be called from multiple threads at once.
+	pstudio::daemon::response handle(const pstudio::daemon::request& req);
+
+	/// \brief Accepts connections on a Unix domain socket and answers their requests on the given threads.
+	///
+	/// Connections waiting for a request are watched by the calling thread. Each request is read, answered and
+	/// written on the pool, so idle connections never keep other clients from being answered. Connections which do
+	/// not send a request within CONNECTION_TIMEOUT seconds are closed.
+	///
+	/// Returns once stop() is called. All open connections are shut down and the socket file is removed before
+	/// returning, so the pool can be joined right away.
+	/// \param socket_path The path to create the socket at.
+	/// \param pool The threads to answer requests on.
+	/// \return `false` if the socket could not be created.
+	bool serve(const std::string& socket_path, pstudio::thread_pool& pool);
+
+	/// \brief Makes serve() return. Safe to call from a signal handler on any thread.
+	void stop() noexcept;
+
+	/// \brief The number of seconds a connection may stay idle before it is closed.
+	static constexpr long CONNECTION_TIMEOUT = 30;
+
+	/// \brief The number of seconds reading a request or writing a response may stall before the connection is
+	///        closed.
+	static constexpr long TRANSFER_TIMEOUT = 5;
+
+private:
+	struct archive {
+		px::vdf_file vdf;
+
+		/// \brief The paths of all files and directories, one per line, as printed by `zvdfs -l`.
+		std::string listing;
+	};
+
+	/// \return The parsed file or `nullptr` if the daemon does not parse files of its format.
+	/// \throws px::error if the file cannot be parsed.
+	std::shared_ptr<const parsed_file> _parse(const px::vdf_entry& entry);
+	void _submit(int fd, pstudio::thread_pool& pool);
+	void _serve_request(int fd);
+
+private:
+	/// \brief The mounted VDFs by their normalized path.
+	std::unordered_map<std::string, std::unique_ptr<archive>> _m_archives {};
+
+	/// \brief The most recently used files, keyed by their entry in the VDF.
+	pstudio::lru_cache<const px::vdf_entry*, parsed_file> _m_cache;
+
+	std::atomic_bool _m_stopped {false};
+
+	/// \brief A pipe waking up serve() when stop() is called, regardless of which thread received the signal, and
+	///        when a request was answered.
+	int _m_wakeup[2] {-1, -1};
+
+	std::mutex _m_connections_lock {};
+
+	/// \brief The connections whose request is being answered, shut down when serve() returns.
+	std::set<int> _m_busy {};
+
+	/// \brief The connections whose request was answered, to be watched by serve() again.
+	std::vector<int> _m_answered {};
+};
@@ -0,0 +1,350 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "archive.hh"
+#include "format.hh"
+#include "select.hh"
+#include "serialize.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <deque>
+#include <future>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+	/// \brief The encoded document of a single file.
+	struct archive_document {
+		std::string data;
+		file_format format {file_format::unknown};
+		bool failed {false};
+
+		/// \brief The reason the file could not be parsed if it failed.
+		std::string error {};
+	};
+} // namespace
+
+static void collect_files(const std::set<px::vdf_entry, px::vdf_entry_comparator>& entries,
+                          const std::string& prefix,
+                          std::vector<archive_file>& result) {
+	for (const auto& entry : entries) {
+		if (entry.is_directory()) {
+			collect_files(entry.children, prefix + entry.name + "/", result);
+		} else {
+			result.push_back({prefix + entry.name, &entry});
+		}
+	}
+}
+
+std::vector<archive_file> list_files(const px::vdf_file& vdf) {
+	std::vector<archive_file> files {};
+	collect_files(vdf.entries, "", files);
+	return files;
+}
+
+static bool match_pattern(std::string_view pattern, std::string_view path) {
+	while (!pattern.empty()) {
+		if (pattern[0] == '*') {
+			auto any = pattern.size() > 1 && pattern[1] == '*';
+			pattern.remove_prefix(any ? 2 : 1);
+
+			for (std::size_t i = 0;; ++i) {
+				if (match_pattern(pattern, path.substr(i)))
+					return true;
+				if (i == path.size() || (!any && path[i] == '/'))
+					return false;
+			}
+		}
+
+		if (path.empty())
+			return false;
+
+		if (pattern[0] == '?') {
+			if (path[0] == '/')
+				return false;
+		} else if (std::tolower(static_cast<unsigned char>(pattern[0])) !=
+		           std::tolower(static_cast<unsigned char>(path[0]))) {
+			return false;
+		}
+
+		pattern.remove_prefix(1);
+		path.remove_prefix(1);
+	}
+
+	return path.empty();
+}
+
+bool is_pattern(std::string_view name) {
+	return name.find_first_of("*?") != std::string_view::npos;
+}
+
+std::vector<archive_file> find_files(const px::vdf_file& vdf, std::string_view pattern) {
+	auto by_name = pattern.find('/') == std::string_view::npos;
+	auto files = list_files(vdf);
+
+	files.erase(std::remove_if(files.begin(),
+	                           files.end(),
+	                           [pattern, by_name](const archive_file& file) {
+		                           std::string_view path = file.path;
+		                           if (by_name)
+			                           path.remove_prefix(path.rfind('/') + 1);
+
+		                           return !match_pattern(pattern, path);
+	                           }),
+	            files.end());
+	return files;
+}
+
+static px::buffer open_file(const archive_file& file) {
+	return file.entry != nullptr ? file.entry->open() : px::buffer::mmap(file.path);
+}
+
+/// \brief Serializes a parsed file, restricted to the selected paths if there are any.
+template <typename T>
+static void serialize_file(writer& out, const T& obj, const output_options& options, const vob_options& vobs) {
+	if (options.paths == nullptr) {
+		serialize(out, obj, vobs);
+		return;
+	}
+
+	// the selection applies to the contents of the file only
+	selecting_writer data {out, *options.paths};
+	serialize(data, obj, vobs);
+}
+
+/// \brief Parses a single file and encodes it in memory.
+static archive_document dump_file(const archive_file& file, const output_options& options, const vob_options& vobs) {
+	archive_document document {};
+
+	auto begin = [&](writer& out) {
+		out.begin_object();
+		out.key("path");
+		out.string(file.path);
+		out.key("format");
+		out.string(pstudio::format_name(document.format));
+	};
+
+	try {
+		auto in = open_file(file);
+
+		document.format = detect_file_format(in);
+		if (document.format == file_format::unknown)
+			return document;
+
+		auto out = make_writer(nullptr, options);
+		begin(*out);
+		out->key("data");
+		visit_file(document.format, in, [&out, &options, &vobs](const auto& obj) {
+			serialize_file(*out, obj, options, vobs);
+		});
+		out->end_object();
+
+		document.data = out->release();
+	} catch (const std::exception& e) {
+		// the file could not be opened or parsed
+		document.failed = true;
+		document.error = e.what();
+
+		// the partial document is discarded and replaced by one holding the error
+		auto out = make_writer(nullptr, options);
+		begin(*out);
+		out->key("error");
+		out->string(e.what());
+		out->end_object();
+
+		document.data = out->release();
+	}
+
+	return document;
+}
+
+/// \brief Parses a single file and writes it into its own output file.
+static archive_document dump_file_to(const fs::path& path,
+                                     const archive_file& file,
+                                     const output_options& options,
+                                     const vob_options& vobs) {
+	archive_document document {};
+
+	try {
+		auto in = open_file(file);
+
+		document.format = detect_file_format(in);
+		if (document.format == file_format::unknown)
+			return document;
+
+		fs::create_directories(path.parent_path());
+
+		using file_handle = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+		file_handle output {std::fopen(path.string().c_str(), "wb"), &std::fclose};
+		if (output == nullptr)
+			throw std::runtime_error {"cannot open " + path.string()};
+
+		try {
+			auto out = make_writer(output.get(), options);
+			visit_file(document.format, in, [&out, &options, &vobs](const auto& obj) {
+				serialize_file(*out, obj, options, vobs);
+			});
+			out->flush();
+		} catch (...) {
+			// no partial output is left behind
+			output.reset();
+			fs::remove(path);
+			throw;
+		}
+	} catch (const std::exception& e) {
+		// the file could not be opened, parsed or written
+		document.failed = true;
+		document.error = e.what();
+	}
+
+	return document;
+}
+
+/// \brief Runs the given function for each file concurrently and passes the results on in the order of the files.
+template <typename Dump, typename Consume>
+static archive_stats for_each_file(const std::vector<archive_file>& files,
+                                   pstudio::thread_pool& pool,
+                                   Dump&& dump,
+                                   Consume&& consume) {
+	// only a few files are kept in flight at once since each of them is held in memory until it is written
+	std::size_t window = pool.size() * 2, next = 0;
+	std::deque<std::future<archive_document>> pending {};
+
+	auto submit = [&] {
+		const auto* file = &files[next++];
+		pending.push_back(pool.submit([file, &dump] { return dump(*file); }));
+	};
+
+	while (next < files.size() && pending.size() < window) {
+		submit();
+	}
+
+	archive_stats stats {};
+	for (std::size_t index = 0; !pending.empty(); ++index) {
+		auto document = pending.front().get();
+		pending.pop_front();
+
+		if (next < files.size())
+			submit();
+
+		if (document.format == file_format::unknown && !document.failed) {
+			++stats.skipped;
+			continue;
+		}
+
+		if (document.failed) {
+			++stats.failed;
+			stats.failures.emplace_back(files[index].path, std::move(document.error));
+		} else {
+			++stats.dumped;
+		}
+
+		consume(document);
+	}
+
+	return stats;
+}
+
+archive_stats dump_files(std::FILE* out,
+                         const std::vector<archive_file>& files,
+                         const output_options& options,
+                         const vob_options& vobs,
+                         batch_format format,
+                         pstudio::thread_pool& pool) {
+	// offsets into a sidecar file cannot be tracked for documents encoded concurrently
+	auto line_options = options;
+	line_options.indent = -1;
+	line_options.sidecar = nullptr;
+
+	auto array = format == batch_format::array;
+	std::size_t written = 0;
+
+	if (array)
+		std::fputc('[', out);
+
+	auto stats = for_each_file(
+	    files,
+	    pool,
+	    [&line_options, &vobs](const archive_file& file) { return dump_file(file, line_options, vobs); },
+	    [out, array, &options, &written](const archive_document& document) {
+		    if (array)
+			    std::fputs(written == 0 ? "\n" : ",\n", out);
+
+		    std::fwrite(document.data.data(), 1, document.data.size(), out);
+		    ++written;
+
+		    if (!array && !options.bson)
+			    std::fputc('\n', out);
+	    });
+
+	if (array)
+		std::fputs(written == 0 ? "]\n" : "\n]\n", out);
+
+	std::fflush(out);
+	return stats;
+}
+
+/// \brief Determines the path of the output file of a file relative to the output directory.
+static fs::path output_name(const archive_file& file, std::string_view extension) {
+	// absolute paths lose their root, paths leading out of the directory are reduced to the file name
+	auto name = fs::path {file.path}.relative_path().lexically_normal();
+	if (name.empty() || *name.begin() == "..")
+		name = name.filename();
+
+	name += extension;
+	return name;
+}
+
+archive_stats dump_files(const fs::path& directory,
+                         const std::vector<archive_file>& files,
+                         const output_options& options,
+                         const vob_options& vobs,
+                         pstudio::thread_pool& pool) {
+	auto file_options = options;
+	file_options.sidecar = nullptr;
+
+	auto extension = options.bson ? ".bson" : ".json";
+
+	// files sharing an output file would overwrite or delete each other's output concurrently, so all but the
+	// first of them fail right away
+	std::map<fs::path, const archive_file*> outputs {};
+	std::vector<archive_file> unique {};
+	archive_stats collisions {};
+
+	for (const auto& file : files) {
+		auto [it, inserted] = outputs.try_emplace(output_name(file, extension), &file);
+		if (inserted) {
+			unique.push_back(file);
+			continue;
+		}
+
+		++collisions.failed;
+		collisions.failures.emplace_back(
+		    file.path,
+		    fmt::format("{} is written for {} already", (directory / it->first).string(), it->second->path));
+	}
+
+	auto stats = for_each_file(
+	    unique,
+	    pool,
+	    [&directory, &file_options, &vobs, extension](const archive_file& file) {
+		    return dump_file_to(directory / output_name(file, extension), file, file_options, vobs);
+	    },
+	    [](const archive_document&) {});
+
+	stats.failed += collisions.failed;
+	stats.failures.insert(stats.failures.begin(),
+	                      std::make_move_iterator(collisions.failures.begin()),
+	                      std::make_move_iterator(collisions.failures.end()));
+	return stats;
+}
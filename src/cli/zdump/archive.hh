@@ -0,0 +1,105 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/vdfs.hh>
+
+#include <pstudio/parallel.hh>
+
+#include "serialize.hh"
+#include "writer.hh"
+
+#include <cstddef>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A file of a VDF and its path inside of it.
+struct archive_file {
+	std::string path;
+
+	/// \brief The file's entry in the VDF or `nullptr` if the file is read from disk at #path instead.
+	const px::vdf_entry* entry;
+};
+
+/// \brief Lists the files of a VDF, including the ones in sub-directories.
+/// \param vdf The VDF to list the files of.
+/// \return The files in catalog order. Their entries point into \p vdf.
+std::vector<archive_file> list_files(const px::vdf_file& vdf);
+
+/// \return Whether the given name contains any of the wildcards understood by find_files().
+bool is_pattern(std::string_view name);
+
+/// \brief Finds the files of a VDF matching a pattern.
+///
+/// Like the names of VDF entries, patterns are case-insensitive. A `?` matches any single character, a `*` any
+/// number of characters except for `/` and a `**` any number of characters. Patterns without a `/` are matched
+/// against the names of the files, all other patterns against their whole path.
+/// \param vdf The VDF to search.
+/// \param pattern The pattern to match.
+/// \return The matching files in catalog order. Their entries point into \p vdf.
+std::vector<archive_file> find_files(const px::vdf_file& vdf, std::string_view pattern);
+
+/// \brief The number of files written by dump_files().
+struct archive_stats {
+	std::size_t dumped {0};
+	std::size_t failed {0};
+
+	/// \brief The number of files in a format zdump does not support.
+	std::size_t skipped {0};
+
+	/// \brief The path of each file which could not be dumped and the reason, in the order of the files.
+	std::vector<std::pair<std::string, std::string>> failures {};
+};
+
+/// \brief How dump_files() writes the documents of multiple files to a single output.
+enum class batch_format {
+	/// \brief One document per line or, for BSON, one document after the other.
+	lines,
+
+	/// \brief A single JSON array holding all documents.
+	array,
+};
+
+/// \brief Dumps the given files as one document per file.
+///
+/// Files are parsed and serialized concurrently but written in the given order, so the output does not depend on
+/// scheduling. JSON documents are written on a single line each, regardless of the indentation set in the options.
+/// Every document is an object holding the file's `path`, its `format` and either its contents as `data` or the
+/// reason it could not be parsed as `error`. Files which cannot be parsed do not stop the others from being dumped.
+/// \param out The file to write the documents to.
+/// \param files The files to dump.
+/// \param options How to encode the documents. Binary arrays are only supported for BSON.
+/// \param vobs How to write the VOBs of worlds.
+/// \param format How to separate the documents. batch_format::array requires JSON.
+/// \param pool The threads to parse the files on.
+/// \return The number of files dumped, failed and skipped.
+archive_stats dump_files(std::FILE* out,
+                         const std::vector<archive_file>& files,
+                         const output_options& options,
+                         const vob_options& vobs,
+                         batch_format format,
+                         pstudio::thread_pool& pool);
+
+/// \brief Dumps each of the given files into a file of its own.
+///
+/// The output files are named after the path of the file they hold with `.json` or `.bson` appended and are placed
+/// in the given directory. Directories inside of the path are created as necessary. Each output file contains
+/// the same document zdump writes for the file alone. Absolute paths lose their root and paths leading out of the
+/// directory are reduced to their file name. If multiple files end up with the same output file, only the first
+/// one is dumped and the others fail. Their failures are reported before all others.
+/// \param directory The directory to write the output files to.
+/// \param files The files to dump.
+/// \param options How to encode the documents. Binary arrays are only supported for BSON.
+/// \param vobs How to write the VOBs of worlds.
+/// \param pool The threads to parse the files on.
+/// \return The number of files dumped, failed and skipped.
+archive_stats dump_files(const std::filesystem::path& directory,
+                         const std::vector<archive_file>& files,
+                         const output_options& options,
+                         const vob_options& vobs,
+                         pstudio::thread_pool& pool);
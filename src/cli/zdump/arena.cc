@@ -0,0 +1,24 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "arena.hh"
+
+void* arena::_allocate_slow(std::size_t size, std::size_t alignment) {
+	// large allocations get a block of their own so that the rest of the current block is not wasted
+	auto dedicated = size > _m_block_size / 4;
+	auto block_size = dedicated ? size + alignment : _m_block_size;
+
+	auto& block = _m_blocks.emplace_back(new std::byte[block_size]);
+	_m_reserved += block_size;
+
+	auto address = reinterpret_cast<std::uintptr_t>(block.get());
+	auto padding = (alignment - address % alignment) % alignment;
+	auto* result = block.get() + padding;
+	_count(padding + size);
+
+	if (!dedicated) {
+		_m_head = result + size;
+		_m_end = block.get() + block_size;
+	}
+
+	return result;
+}
@@ -0,0 +1,171 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/// \brief A bump allocator which hands out memory from large blocks and frees all of it at once.
+///
+/// Memory given back with deallocate() is only reused if it was the most recent allocation. Everything else stays
+/// allocated until the arena is destroyed, which makes allocating a single pointer increment and freeing a no-op.
+class arena {
+public:
+	/// \brief The default size of the blocks memory is handed out from.
+	static constexpr std::size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+
+	/// \param block_size The size of the blocks memory is handed out from. Allocations larger than a quarter of it
+	///                   get a block of their own.
+	explicit arena(std::size_t block_size = DEFAULT_BLOCK_SIZE) noexcept : _m_block_size(block_size) {}
+
+	arena(const arena&) = delete;
+	arena& operator=(const arena&) = delete;
+
+	void* allocate(std::size_t size, std::size_t alignment) {
+		auto address = reinterpret_cast<std::uintptr_t>(_m_head);
+		auto padding = (alignment - address % alignment) % alignment;
+
+		if (_m_head == nullptr || padding + size > static_cast<std::size_t>(_m_end - _m_head))
+			return _allocate_slow(size, alignment);
+
+		auto* result = _m_head + padding;
+		_m_head = result + size;
+		_count(padding + size);
+		return result;
+	}
+
+	/// \brief Gives memory back to the arena, which only reuses it if it was the most recent allocation.
+	void deallocate(void* data, std::size_t size) noexcept {
+		if (static_cast<std::byte*>(data) + size != _m_head)
+			return;
+
+		_m_head = static_cast<std::byte*>(data);
+		_m_used -= size;
+	}
+
+	/// \brief Creates an object in the arena which is never destroyed.
+	///
+	/// Only use this for objects which allocate all of their memory from the arena, so that nothing is leaked when
+	/// the arena frees its memory.
+	template <typename T, typename... Args>
+	T* make(Args&&... args) {
+		return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+	}
+
+	/// \return The number of bytes currently handed out.
+	[[nodiscard]] std::size_t used() const noexcept {
+		return _m_used;
+	}
+
+	/// \return The largest number of bytes handed out at any time.
+	[[nodiscard]] std::size_t high_water_mark() const noexcept {
+		return _m_high_water_mark;
+	}
+
+	/// \return The number of bytes allocated from the system, including unused space at the ends of blocks.
+	[[nodiscard]] std::size_t reserved() const noexcept {
+		return _m_reserved;
+	}
+
+	[[nodiscard]] std::size_t blocks() const noexcept {
+		return _m_blocks.size();
+	}
+
+	/// \return The arena allocators of the calling thread allocate from or `nullptr` if there is none.
+	[[nodiscard]] static arena*& current() noexcept {
+		static thread_local arena* instance = nullptr;
+		return instance;
+	}
+
+	/// \brief Makes an arena the one arena_allocator allocates from on this thread until the scope ends.
+	class scope {
+	public:
+		explicit scope(arena& target) noexcept : _m_previous(std::exchange(current(), &target)) {}
+
+		scope(const scope&) = delete;
+		scope& operator=(const scope&) = delete;
+
+		~scope() {
+			current() = _m_previous;
+		}
+
+	private:
+		arena* _m_previous;
+	};
+
+private:
+	void* _allocate_slow(std::size_t size, std::size_t alignment);
+
+	void _count(std::size_t size) noexcept {
+		_m_used += size;
+		if (_m_used > _m_high_water_mark)
+			_m_high_water_mark = _m_used;
+	}
+
+private:
+	std::size_t _m_block_size;
+	std::vector<std::unique_ptr<std::byte[]>> _m_blocks {};
+	std::byte* _m_head {nullptr};
+	std::byte* _m_end {nullptr};
+
+	std::size_t _m_used {0};
+	std::size_t _m_high_water_mark {0};
+	std::size_t _m_reserved {0};
+};
+
+/// \brief A stateless allocator handing out memory from the arena of the current arena::scope.
+///
+/// Without an active scope it falls back to `std::allocator`. Memory must be given back under the same scope it was
+/// allocated in, thus containers using this allocator must not outlive the scope they were created in.
+template <typename T>
+class arena_allocator {
+public:
+	using value_type = T;
+	using is_always_equal = std::true_type;
+
+	arena_allocator() noexcept = default;
+
+	template <typename U>
+	arena_allocator(const arena_allocator<U>&) noexcept {}
+
+	T* allocate(std::size_t n) {
+		if (auto* memory = arena::current(); memory != nullptr)
+			return static_cast<T*>(memory->allocate(n * sizeof(T), alignof(T)));
+
+		return std::allocator<T> {}.allocate(n);
+	}
+
+	void deallocate(T* data, std::size_t n) noexcept {
+		if (auto* memory = arena::current(); memory != nullptr)
+			return memory->deallocate(data, n * sizeof(T));
+
+		std::allocator<T> {}.deallocate(data, n);
+	}
+
+	template <typename U>
+	bool operator==(const arena_allocator<U>&) const noexcept {
+		return true;
+	}
+
+	template <typename U>
+	bool operator!=(const arena_allocator<U>&) const noexcept {
+		return false;
+	}
+};
+
+/// \brief A string allocated from the current arena.
+///
+/// It converts implicitly from `std::string` since parts of `nlohmann::basic_json` rely on its string type doing so.
+class arena_string : public std::basic_string<char, std::char_traits<char>, arena_allocator<char>> {
+public:
+	using basic_string::basic_string;
+
+	arena_string(const basic_string& value) : basic_string(value) {}
+	arena_string(basic_string&& value) noexcept : basic_string(std::move(value)) {}
+	arena_string(const std::string& value) : basic_string(value.data(), value.size()) {}
+};
@@ -0,0 +1,717 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "diff.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+
+void document_writer::begin_object() {
+	_m_stack.push_back(&_insert({document::object {}}));
+}
+
+void document_writer::end_object() {
+	_m_stack.pop_back();
+}
+
+void document_writer::begin_array() {
+	_m_stack.push_back(&_insert({document::array {}}));
+}
+
+void document_writer::end_array() {
+	_m_stack.pop_back();
+}
+
+void document_writer::key(std::string_view name) {
+	_m_key = name;
+}
+
+void document_writer::null() {
+	_insert({});
+}
+
+void document_writer::boolean(bool value) {
+	_insert({value});
+}
+
+void document_writer::integer(std::int64_t value) {
+	_insert({value});
+}
+
+void document_writer::unsigned_integer(std::uint64_t value) {
+	_insert({value});
+}
+
+void document_writer::number(float value) {
+	_insert({value});
+}
+
+void document_writer::number(double value) {
+	_insert({value});
+}
+
+void document_writer::string(std::string_view value) {
+	_insert({std::string {value}});
+}
+
+bool document_writer::binary_array(const typed_array& array) {
+	auto result = std::make_unique<document::numbers>();
+	result->layout = array;
+	result->bytes.resize(array.count * array.components * array_type_size(array.type));
+
+	if (!result->bytes.empty())
+		std::memcpy(result->bytes.data(), array.data, result->bytes.size());
+
+	result->layout.data = result->bytes.data();
+	_insert({std::move(result)});
+	return true;
+}
+
+void document_writer::flush() {}
+
+std::string document_writer::release() {
+	return {};
+}
+
+document document_writer::take() {
+	auto result = std::move(_m_document);
+	_m_document = {};
+	_m_stack.clear();
+	return result;
+}
+
+document::value& document_writer::_insert(document::value&& value) {
+	if (_m_stack.empty()) {
+		_m_document.root = std::move(value);
+		return _m_document.root;
+	}
+
+	auto& parent = _m_stack.back()->data;
+	if (auto* elements = std::get_if<document::array>(&parent))
+		return elements->emplace_back(std::move(value));
+
+	return std::get<document::object>(parent).emplace_back(std::move(_m_key), std::move(value)).second;
+}
+
+namespace {
+	/// \brief An array of objects which are matched by the value of one of their members instead of their index.
+	struct keyed_array {
+		/// \brief The path of the array, in which `*` matches any single segment.
+		std::string_view path;
+
+		/// \brief The member holding a string which identifies each element.
+		std::string_view key;
+	};
+
+	constexpr keyed_array KEYED_ARRAYS[] = {
+	    // messages
+	    {"/blocks", "name"},
+
+	    // meshes and the meshes of worlds, model meshes and models
+	    {"/materials", "name"},
+	    {"/mesh/materials", "name"},
+	    {"/meshes/*/materials", "name"},
+	    {"/attachments/*/materials", "name"},
+	    {"/mesh/meshes/*/materials", "name"},
+	    {"/mesh/attachments/*/materials", "name"},
+
+	    // model scripts
+	    {"/animations", "name"},
+	    {"/aliases", "name"},
+	    {"/blends", "name"},
+	    {"/combinations", "name"},
+
+	    // way nets
+	    {"/wayNet/waypoints", "name"},
+	};
+
+	/// \brief The number of numbers of typed arrays which are compared at once.
+	constexpr std::size_t CHUNK_SIZE = 1024;
+
+	constexpr std::size_t NONE = std::numeric_limits<std::size_t>::max();
+
+	/// \brief Removes the first segment from a JSON pointer.
+	std::string_view next_segment(std::string_view& path) {
+		path.remove_prefix(1);
+
+		auto end = std::min(path.find('/'), path.size());
+		auto segment = path.substr(0, end);
+		path.remove_prefix(end);
+		return segment;
+	}
+
+	bool matches(std::string_view pattern, std::string_view path) {
+		while (!pattern.empty() && !path.empty()) {
+			auto expected = next_segment(pattern);
+			auto actual = next_segment(path);
+
+			if (expected != "*" && expected != actual)
+				return false;
+		}
+
+		return pattern.empty() && path.empty();
+	}
+
+	bool is_index(std::string_view segment) {
+		auto digit = [](char c) { return c >= '0' && c <= '9'; };
+		return !segment.empty() && std::all_of(segment.begin(), segment.end(), digit);
+	}
+
+	template <typename T>
+	T read(const std::byte* data) {
+		T value;
+		std::memcpy(&value, data, sizeof value);
+		return value;
+	}
+
+	void write_number(writer& w, array_type type, const std::byte* data) {
+		switch (type) {
+		case array_type::uint8:
+			return w.unsigned_integer(read<std::uint8_t>(data));
+		case array_type::uint16:
+			return w.unsigned_integer(read<std::uint16_t>(data));
+		case array_type::int32:
+			return w.integer(read<std::int32_t>(data));
+		case array_type::uint32:
+			return w.unsigned_integer(read<std::uint32_t>(data));
+		case array_type::uint64:
+			return w.unsigned_integer(read<std::uint64_t>(data));
+		case array_type::float32:
+			return w.number(read<float>(data));
+		}
+	}
+
+	/// \brief Writes a row of a typed array the way the serializers write it if the writer has no binary arrays.
+	void write_row(writer& w, const typed_array& array, std::size_t row) {
+		auto size = array_type_size(array.type);
+		const auto* data = static_cast<const std::byte*>(array.data) + row * array.components * size;
+
+		if (array.fields == nullptr) {
+			if (array.components == 1)
+				return write_number(w, array.type, data);
+
+			w.begin_array();
+			for (std::size_t i = 0; i < array.components; ++i) {
+				write_number(w, array.type, data + i * size);
+			}
+			w.end_array();
+			return;
+		}
+
+		// the segments leading from the row to the innermost open container and whether each open one is an array
+		std::vector<std::string_view> open {};
+		std::vector<bool> arrays {};
+
+		auto close = [&w, &arrays] {
+			if (arrays.back()) {
+				w.end_array();
+			} else {
+				w.end_object();
+			}
+
+			arrays.pop_back();
+		};
+
+		auto begin = [&w, &arrays](bool array) {
+			if (array) {
+				w.begin_array();
+			} else {
+				w.begin_object();
+			}
+
+			arrays.push_back(array);
+		};
+
+		for (std::size_t i = 0; i < array.components; ++i) {
+			std::vector<std::string_view> segments {};
+			for (auto field = array.fields[i]; !field.empty();) {
+				segments.push_back(next_segment(field));
+			}
+
+			std::size_t common = 0;
+			while (common < open.size() && common + 1 < segments.size() && open[common] == segments[common]) {
+				++common;
+			}
+
+			while (open.size() > common) {
+				close();
+				open.pop_back();
+			}
+
+			if (arrays.empty())
+				begin(is_index(segments[0]));
+
+			for (auto j = open.size(); j + 1 < segments.size(); ++j) {
+				if (!arrays.back())
+					w.key(segments[j]);
+
+				begin(is_index(segments[j + 1]));
+				open.push_back(segments[j]);
+			}
+
+			if (!arrays.back())
+				w.key(segments.back());
+
+			write_number(w, array.type, data + i * size);
+		}
+
+		while (!arrays.empty()) {
+			close();
+		}
+	}
+
+	void write_value(writer& w, const document::value& value) {
+		std::visit(
+		    [&w](const auto& data) {
+			    using type = std::decay_t<decltype(data)>;
+
+			    if constexpr (std::is_same_v<type, std::monostate>) {
+				    w.null();
+			    } else if constexpr (std::is_same_v<type, bool>) {
+				    w.boolean(data);
+			    } else if constexpr (std::is_same_v<type, std::int64_t>) {
+				    w.integer(data);
+			    } else if constexpr (std::is_same_v<type, std::uint64_t>) {
+				    w.unsigned_integer(data);
+			    } else if constexpr (std::is_same_v<type, float> || std::is_same_v<type, double>) {
+				    w.number(data);
+			    } else if constexpr (std::is_same_v<type, std::string>) {
+				    w.string(data);
+			    } else if constexpr (std::is_same_v<type, document::array>) {
+				    w.begin_array();
+				    for (const auto& element : data) {
+					    write_value(w, element);
+				    }
+				    w.end_array();
+			    } else if constexpr (std::is_same_v<type, document::object>) {
+				    w.begin_object();
+				    for (const auto& [name, member] : data) {
+					    w.key(name);
+					    write_value(w, member);
+				    }
+				    w.end_object();
+			    } else {
+				    w.begin_array();
+				    for (std::size_t row = 0; row < data->layout.count; ++row) {
+					    write_row(w, data->layout, row);
+				    }
+				    w.end_array();
+			    }
+		    },
+		    value.data);
+	}
+
+	std::optional<double> as_number(const document::value& value) {
+		return std::visit(
+		    [](const auto& data) -> std::optional<double> {
+			    using type = std::decay_t<decltype(data)>;
+
+			    if constexpr (std::is_arithmetic_v<type> && !std::is_same_v<type, bool>) {
+				    return static_cast<double>(data);
+			    } else {
+				    return std::nullopt;
+			    }
+		    },
+		    value.data);
+	}
+
+	/// \brief Indexes the elements of an array by the value of one of their members.
+	/// \return The index or `std::nullopt` if any element is not an object or does not have a unique string as the
+	///         value of the given member.
+	std::optional<std::unordered_map<std::string_view, std::size_t>> index_by(const document::array& elements,
+	                                                                          std::string_view key) {
+		std::unordered_map<std::string_view, std::size_t> result {};
+
+		for (std::size_t i = 0; i < elements.size(); ++i) {
+			const auto* members = std::get_if<document::object>(&elements[i].data);
+			if (members == nullptr)
+				return std::nullopt;
+
+			auto it = std::find_if(members->begin(), members->end(), [key](const auto& m) { return m.first == key; });
+			if (it == members->end())
+				return std::nullopt;
+
+			const auto* name = std::get_if<std::string>(&it->second.data);
+			if (name == nullptr || !result.emplace(*name, i).second)
+				return std::nullopt;
+		}
+
+		return result;
+	}
+
+	/// \brief Finds a member of an object, expecting it at the given index first.
+	std::size_t find_member(const document::object& members, std::string_view name, std::size_t hint) {
+		if (hint < members.size() && members[hint].first == name)
+			return hint;
+
+		for (std::size_t i = 0; i < members.size(); ++i) {
+			if (members[i].first == name)
+				return i;
+		}
+
+		return NONE;
+	}
+
+	class differ {
+	public:
+		differ(writer& out, const diff_options& options) : _m_out(out), _m_options(options) {}
+
+		void compare(const document::value& a, const document::value& b) {
+			if (a.data.index() == b.data.index()) {
+				if (const auto* members = std::get_if<document::object>(&a.data))
+					return _objects(*members, std::get<document::object>(b.data));
+
+				if (const auto* elements = std::get_if<document::array>(&a.data))
+					return _arrays(*elements, std::get<document::array>(b.data));
+
+				const auto* numbers = std::get_if<std::unique_ptr<document::numbers>>(&a.data);
+				if (numbers != nullptr &&
+				    _numbers((*numbers)->layout, std::get<std::unique_ptr<document::numbers>>(b.data)->layout))
+					return;
+			}
+
+			if (!_equal(a, b))
+				_operation("replace", &b);
+		}
+
+		[[nodiscard]] std::size_t count() const noexcept {
+			return _m_count;
+		}
+
+	private:
+		/// \brief Appends a segment to the current path.
+		/// \return The size of the path before the segment was appended.
+		std::size_t _push(std::string_view segment) {
+			auto size = _m_path.size();
+			_m_path.push_back('/');
+
+			for (auto c : segment) {
+				if (c == '~') {
+					_m_path += "~0";
+				} else if (c == '/') {
+					_m_path += "~1";
+				} else {
+					_m_path.push_back(c);
+				}
+			}
+
+			return size;
+		}
+
+		std::size_t _push(std::size_t index) {
+			return _push(std::to_string(index));
+		}
+
+		/// \brief Starts an operation on the current path. The caller has to end the object.
+		void _begin(std::string_view op) {
+			++_m_count;
+			_m_out.begin_object();
+			_m_out.key("op");
+			_m_out.string(op);
+			_m_out.key("path");
+			_m_out.string(_m_path);
+		}
+
+		/// \brief Writes an operation on the current path with the given value, if any.
+		void _operation(std::string_view op, const document::value* value = nullptr) {
+			_begin(op);
+
+			if (value != nullptr) {
+				_m_out.key("value");
+				write_value(_m_out, *value);
+			}
+
+			_m_out.end_object();
+		}
+
+		[[nodiscard]] bool _equal(double a, double b) const {
+			return a == b || std::fabs(a - b) <= _m_options.epsilon || (std::isnan(a) && std::isnan(b));
+		}
+
+		[[nodiscard]] bool _equal(const document::value& a, const document::value& b) const {
+			const auto* x = std::get_if<std::int64_t>(&a.data);
+			const auto* y = std::get_if<std::uint64_t>(&b.data);
+			if (x == nullptr || y == nullptr) {
+				x = std::get_if<std::int64_t>(&b.data);
+				y = std::get_if<std::uint64_t>(&a.data);
+			}
+
+			// integers are compared exactly, which converting them to double would not do
+			if (x != nullptr && y != nullptr)
+				return *x >= 0 && static_cast<std::uint64_t>(*x) == *y;
+
+			if (a.data.index() == b.data.index()) {
+				if (const auto* value = std::get_if<std::int64_t>(&a.data))
+					return *value == std::get<std::int64_t>(b.data);
+				if (const auto* value = std::get_if<std::uint64_t>(&a.data))
+					return *value == std::get<std::uint64_t>(b.data);
+				if (const auto* value = std::get_if<bool>(&a.data))
+					return *value == std::get<bool>(b.data);
+				if (const auto* value = std::get_if<std::string>(&a.data))
+					return *value == std::get<std::string>(b.data);
+				if (std::holds_alternative<std::monostate>(a.data))
+					return true;
+			}
+
+			auto p = as_number(a);
+			auto q = as_number(b);
+			return p && q && _equal(*p, *q);
+		}
+
+		void _objects(const document::object& a, const document::object& b) {
+			std::vector<bool> found(b.size(), false);
+
+			for (std::size_t i = 0; i < a.size(); ++i) {
+				auto j = find_member(b, a[i].first, i);
+				auto size = _push(a[i].first);
+
+				if (j == NONE) {
+					_operation("remove");
+				} else {
+					found[j] = true;
+					compare(a[i].second, b[j].second);
+				}
+
+				_m_path.resize(size);
+			}
+
+			for (std::size_t j = 0; j < b.size(); ++j) {
+				if (found[j])
+					continue;
+
+				auto size = _push(b[j].first);
+				_operation("add", &b[j].second);
+				_m_path.resize(size);
+			}
+		}
+
+		void _arrays(const document::array& a, const document::array& b) {
+			for (const auto& keyed : KEYED_ARRAYS) {
+				if (matches(keyed.path, _m_path) && _keyed(a, b, keyed.key))
+					return;
+			}
+
+			auto common = std::min(a.size(), b.size());
+			for (std::size_t i = 0; i < common; ++i) {
+				auto size = _push(i);
+				compare(a[i], b[i]);
+				_m_path.resize(size);
+			}
+
+			// removing elements from the back keeps the indices of the others intact
+			for (auto i = a.size(); i > common; --i) {
+				auto size = _push(i - 1);
+				_operation("remove");
+				_m_path.resize(size);
+			}
+
+			for (auto i = common; i < b.size(); ++i) {
+				auto size = _push(i);
+				_operation("add", &b[i]);
+				_m_path.resize(size);
+			}
+		}
+
+		/// \brief Compares arrays whose elements are identified by the value of the given member.
+		///
+		/// The patch first changes the elements found in both arrays at their original position, then removes the
+		/// elements missing in \p b and finally moves the remaining elements into their new order and adds the new
+		/// ones in between.
+		/// \return `false` if the elements cannot be identified by the member and nothing was written.
+		bool _keyed(const document::array& a, const document::array& b, std::string_view key) {
+			auto index_a = index_by(a, key);
+			auto index_b = index_by(b, key);
+			if (!index_a || !index_b)
+				return false;
+
+			// the index in b of each element of a
+			std::vector<std::size_t> targets(a.size(), NONE);
+			std::vector<bool> found(b.size(), false);
+
+			for (const auto& [name, i] : *index_a) {
+				if (auto it = index_b->find(name); it != index_b->end()) {
+					targets[i] = it->second;
+					found[it->second] = true;
+				}
+			}
+
+			for (std::size_t i = 0; i < a.size(); ++i) {
+				if (targets[i] == NONE)
+					continue;
+
+				auto size = _push(i);
+				compare(a[i], b[targets[i]]);
+				_m_path.resize(size);
+			}
+
+			for (auto i = a.size(); i > 0; --i) {
+				if (targets[i - 1] != NONE)
+					continue;
+
+				auto size = _push(i - 1);
+				_operation("remove");
+				_m_path.resize(size);
+			}
+
+			// the index in b of each element currently in the array
+			std::vector<std::size_t> current {};
+			std::copy_if(targets.begin(), targets.end(), std::back_inserter(current), [](auto t) { return t != NONE; });
+
+			for (std::size_t j = 0; j < b.size(); ++j) {
+				if (!found[j]) {
+					auto size = _push(j);
+					_operation("add", &b[j]);
+					_m_path.resize(size);
+
+					current.insert(current.begin() + static_cast<std::ptrdiff_t>(j), j);
+					continue;
+				}
+
+				if (current[j] == j)
+					continue;
+
+				auto from = std::find(current.begin() + static_cast<std::ptrdiff_t>(j), current.end(), j);
+				auto from_index = static_cast<std::size_t>(from - current.begin());
+
+				auto size = _push(from_index);
+				auto from_path = _m_path;
+				_m_path.resize(size);
+
+				_push(j);
+				_begin("move");
+				_m_out.key("from");
+				_m_out.string(from_path);
+				_m_out.end_object();
+				_m_path.resize(size);
+
+				std::rotate(current.begin() + static_cast<std::ptrdiff_t>(j), from, from + 1);
+			}
+
+			return true;
+		}
+
+		/// \brief Compares two typed arrays row by row.
+		/// \return `false` if the arrays hold different types of rows and nothing was written.
+		bool _numbers(const typed_array& a, const typed_array& b) {
+			if (a.type != b.type || a.components != b.components)
+				return false;
+
+			auto size = array_type_size(a.type);
+			const auto* x = static_cast<const std::byte*>(a.data);
+			const auto* y = static_cast<const std::byte*>(b.data);
+
+			auto common = std::min(a.count, b.count);
+			auto chunk_rows = std::max<std::size_t>(CHUNK_SIZE / a.components, 1);
+
+			for (std::size_t begin = 0; begin < common; begin += chunk_rows) {
+				auto end = std::min(begin + chunk_rows, common);
+				auto offset = begin * a.components * size;
+
+				if (!_differ(a.type, x + offset, y + offset, (end - begin) * a.components))
+					continue;
+
+				for (auto row = begin; row < end; ++row) {
+					for (std::size_t i = 0; i < a.components; ++i) {
+						auto position = (row * a.components + i) * size;
+						if (!_differ(a.type, x + position, y + position, 1))
+							continue;
+
+						auto path_size = _push(row);
+						if (a.fields != nullptr) {
+							_m_path += a.fields[i];
+						} else if (a.components != 1) {
+							_push(i);
+						}
+
+						_begin("replace");
+						_m_out.key("value");
+						write_number(_m_out, b.type, y + position);
+						_m_out.end_object();
+						_m_path.resize(path_size);
+					}
+				}
+			}
+
+			for (auto row = a.count; row > common; --row) {
+				auto path_size = _push(row - 1);
+				_operation("remove");
+				_m_path.resize(path_size);
+			}
+
+			for (auto row = common; row < b.count; ++row) {
+				auto path_size = _push(row);
+				_begin("add");
+				_m_out.key("value");
+				write_row(_m_out, b, row);
+				_m_out.end_object();
+				_m_path.resize(path_size);
+			}
+
+			return true;
+		}
+
+		/// \brief Checks whether any of the given numbers differ.
+		[[nodiscard]] bool _differ(array_type type, const std::byte* a, const std::byte* b, std::size_t count) const {
+			auto size = count * array_type_size(type);
+			if (std::memcmp(a, b, size) == 0)
+				return false;
+
+			if (type != array_type::float32)
+				return true;
+
+			if (count == 1)
+				return !_equal(read<float>(a), read<float>(b));
+
+			auto epsilon = static_cast<float>(_m_options.epsilon);
+			float x[CHUNK_SIZE];
+			float y[CHUNK_SIZE];
+
+			for (std::size_t begin = 0; begin < count; begin += CHUNK_SIZE) {
+				auto n = std::min(CHUNK_SIZE, count - begin);
+
+				// copied out so the loop below works on properly typed and aligned numbers and can be vectorized
+				std::memcpy(x, a + begin * sizeof(float), n * sizeof(float));
+				std::memcpy(y, b + begin * sizeof(float), n * sizeof(float));
+
+				// NaNs and infinities are reported here and checked one by one
+				int differ = 0;
+				for (std::size_t i = 0; i < n; ++i) {
+					differ |= std::fabs(x[i] - y[i]) <= epsilon ? 0 : 1;
+				}
+
+				if (differ == 0)
+					continue;
+
+				for (std::size_t i = 0; i < n; ++i) {
+					if (!_equal(x[i], y[i]))
+						return true;
+				}
+			}
+
+			return false;
+		}
+
+	private:
+		writer& _m_out;
+		const diff_options& _m_options;
+
+		/// \brief The JSON pointer to the values currently being compared.
+		std::string _m_path {};
+		std::size_t _m_count {0};
+	};
+} // namespace
+
+std::size_t diff(writer& out, const document& from, const document& to, const diff_options& options) {
+	differ patch {out, options};
+
+	out.begin_array();
+	patch.compare(from.root, to.root);
+	out.end_array();
+
+	return patch.count();
+}
@@ -0,0 +1,104 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "writer.hh"
+
+/// \brief A document kept in memory in a compact form so that it can be compared with another one.
+///
+/// Arrays passed to writer::binary_array() are kept as a single block of numbers instead of one value per element,
+/// so the large arrays of meshes and animations cost no more memory than they do in the parsed file.
+struct document {
+	struct value;
+
+	using array = std::vector<value>;
+	using object = std::vector<std::pair<std::string, value>>;
+
+	/// \brief A copy of an array passed to writer::binary_array().
+	struct numbers {
+		/// \brief The layout of the array. Its data points into #bytes.
+		typed_array layout;
+		std::vector<std::byte> bytes;
+	};
+
+	struct value {
+		std::variant<std::monostate,
+		             bool,
+		             std::int64_t,
+		             std::uint64_t,
+		             float,
+		             double,
+		             std::string,
+		             array,
+		             object,
+		             std::unique_ptr<numbers>>
+		    data {};
+	};
+
+	value root {};
+};
+
+/// \brief Builds a document in memory.
+class document_writer final : public writer {
+public:
+	void begin_object() override;
+	void end_object() override;
+	void begin_array() override;
+	void end_array() override;
+	void key(std::string_view name) override;
+
+	void null() override;
+	void boolean(bool value) override;
+	void integer(std::int64_t value) override;
+	void unsigned_integer(std::uint64_t value) override;
+	void number(float value) override;
+	void number(double value) override;
+	void string(std::string_view value) override;
+	bool binary_array(const typed_array& array) override;
+
+	void flush() override;
+
+	/// \brief Always returns an empty string. Use take() to get the document instead.
+	[[nodiscard]] std::string release() override;
+
+	/// \brief Takes the document written so far.
+	[[nodiscard]] document take();
+
+private:
+	document::value& _insert(document::value&& value);
+
+private:
+	document _m_document {};
+	std::string _m_key {};
+
+	/// \brief The open objects and arrays. Only the innermost one grows, so pointers to the others stay valid.
+	std::vector<document::value*> _m_stack {};
+};
+
+/// \brief Options for comparing documents.
+struct diff_options {
+	/// \brief The largest absolute difference between two numbers which are considered equal.
+	double epsilon {1e-5};
+};
+
+/// \brief Writes a JSON Patch (RFC 6902) which turns one document into another.
+///
+/// Objects are compared member by member and arrays element by element, except for arrays of named objects like the
+/// materials of meshes, the animations of model scripts, the blocks of messages and the waypoints of way nets. Their
+/// elements are matched by name, so reordering them results in `move` operations instead of changes to every element.
+/// Arrays of numbers are compared row by row and only the numbers which differ are replaced.
+///
+/// The patch applies to the JSON documents written without typed arrays.
+/// \param out The writer to write the patch to.
+/// \param from The original document.
+/// \param to The changed document.
+/// \param options Options for comparing the documents.
+/// \return The number of operations in the patch.
+std::size_t diff(writer& out, const document& from, const document& to, const diff_options& options);
@@ -1,8 +1,11 @@
 // Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
 // SPDX-License-Identifier: MIT
 #include "dump.hh"
+#include "serialize.hh"
 
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 static const std::unordered_map<px::vob_type, std::string> vob_type_map = {
     {px::vob_type::zCVob, "zCVob"},
@@ -52,37 +55,127 @@ static const std::unordered_map<px::vob_type, std::string> vob_type_map = {
     {px::vob_type::ignored, "\xA7"}, // some sort of padding object, probably. seems to be always empty
 };
 
+const std::string& vob_type_name(px::vob_type type) {
+	return vob_type_map.at(type);
+}
+
+namespace {
+	/// \brief Builds an `arena_json` document from the values written to it.
+	///
+	/// It lets the `to_json` functions reuse the serializers for objects with many fields, like VOBs, instead of
+	/// repeating every field here.
+	class dom_writer final : public writer {
+	public:
+		explicit dom_writer(arena_json& root) noexcept : _m_root(root) {}
+
+		void begin_object() override {
+			_m_stack.push_back(&_insert(arena_json::object()));
+		}
+
+		void end_object() override {
+			_m_stack.pop_back();
+		}
+
+		void begin_array() override {
+			_m_stack.push_back(&_insert(arena_json::array()));
+		}
+
+		void end_array() override {
+			_m_stack.pop_back();
+		}
+
+		void key(std::string_view name) override {
+			_m_key.assign(name.data(), name.size());
+		}
+
+		void null() override {
+			_insert(nullptr);
+		}
+
+		void boolean(bool value) override {
+			_insert(value);
+		}
+
+		void integer(std::int64_t value) override {
+			_insert(value);
+		}
+
+		void unsigned_integer(std::uint64_t value) override {
+			_insert(value);
+		}
+
+		void number(float value) override {
+			_insert(value);
+		}
+
+		void number(double value) override {
+			_insert(value);
+		}
+
+		void string(std::string_view value) override {
+			_insert(arena_string {value.data(), value.size()});
+		}
+
+		void flush() override {}
+
+		[[nodiscard]] std::string release() override {
+			return {};
+		}
+
+	private:
+		arena_json& _insert(arena_json&& value) {
+			if (_m_stack.empty())
+				return _m_root = std::move(value);
+
+			auto& parent = *_m_stack.back();
+			if (parent.is_array()) {
+				parent.push_back(std::move(value));
+				return parent.back();
+			}
+
+			return parent[_m_key] = std::move(value);
+		}
+
+	private:
+		arena_json& _m_root;
+		arena_string _m_key {};
+
+		/// \brief The open objects and arrays. Only the innermost one grows, so pointers to the others stay valid.
+		std::vector<arena_json*> _m_stack {};
+	};
+} // namespace
+
 namespace glm {
-	void to_json(nlohmann::json& j, const glm::vec2& obj) {
+	void to_json(arena_json& j, const glm::vec2& obj) {
 		j["x"] = obj.x;
 		j["y"] = obj.y;
 	}
 
-	void to_json(nlohmann::json& j, const glm::vec3& obj) {
+	void to_json(arena_json& j, const glm::vec3& obj) {
 		j["x"] = obj.x;
 		j["y"] = obj.y;
 		j["z"] = obj.z;
 	}
 
-	void to_json(nlohmann::json& j, const glm::vec4& obj) {
+	void to_json(arena_json& j, const glm::vec4& obj) {
 		j["x"] = obj.x;
 		j["y"] = obj.y;
 		j["z"] = obj.z;
 		j["w"] = obj.w;
 	}
 
-	void to_json(nlohmann::json& j, const glm::quat& obj) {
+	void to_json(arena_json& j, const glm::quat& obj) {
 		j["x"] = obj.x;
 		j["y"] = obj.y;
 		j["z"] = obj.z;
 		j["w"] = obj.w;
 	}
 
-	void to_json(nlohmann::json& j, const glm::mat4x4& obj) {
+	void to_json(arena_json& j, const glm::mat4x4& obj) {
 		j = {obj[0], obj[1], obj[2], obj[3]};
 	}
 
-	void to_json(nlohmann::json& j, const glm::u8vec4& obj) {
+	void to_json(arena_json& j, const glm::u8vec4& obj) {
 		j["r"] = obj.r;
 		j["g"] = obj.g;
 		j["b"] = obj.b;
@@ -91,16 +184,16 @@ namespace glm {
 } // namespace glm
 
 namespace phoenix {
-	void to_json(nlohmann::json& j, const px::glyph& obj) {
+	void to_json(arena_json& j, const px::glyph& obj) {
 		j["width"] = obj.width;
 		j["uv"] = {obj.uv[0], obj.uv[1]};
 	}
 
-	void to_json(nlohmann::json& j, const px::font& obj) {
-		j = nlohmann::json {{"type", "font"}, {"name", obj.name}, {"height", obj.height}, {"glyphs", obj.glyphs}};
+	void to_json(arena_json& j, const px::font& obj) {
+		j = arena_json {{"type", "font"}, {"name", obj.name}, {"height", obj.height}, {"glyphs", obj.glyphs}};
 	}
 
-	void to_json(nlohmann::json& j, const px::message_block& obj) {
+	void to_json(arena_json& j, const px::message_block& obj) {
 		j["name"] = obj.name;
 		j["message"] = {
 		    {"type", obj.message.type},
@@ -109,17 +202,17 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::messages& obj) {
+	void to_json(arena_json& j, const px::messages& obj) {
 		j["type"] = "messages";
 		j["blocks"] = obj.blocks;
 	}
 
-	void to_json(nlohmann::json& j, const px::bounding_box& obj) {
+	void to_json(arena_json& j, const px::bounding_box& obj) {
 		j["min"] = obj.min;
 		j["max"] = obj.max;
 	}
 
-	void to_json(nlohmann::json& j, const px::obb& obj) {
+	void to_json(arena_json& j, const px::obb& obj) {
 		j = {
 		    {"center", obj.center},
 		    {"axes", {obj.axes[0], obj.axes[1], obj.axes[2]}},
@@ -128,7 +221,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::date& obj) {
+	void to_json(arena_json& j, const px::date& obj) {
 		j = {
 		    {"year", obj.year},
 		    {"month", obj.month},
@@ -139,12 +232,12 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::animation_sample& obj) {
+	void to_json(arena_json& j, const px::animation_sample& obj) {
 		j["position"] = obj.position;
 		j["rotation"] = obj.rotation;
 	}
 
-	void to_json(nlohmann::json& j, const px::animation_event& obj) {
+	void to_json(arena_json& j, const px::animation_event& obj) {
 		j["type"] = obj.type;
 		j["no"] = obj.no;
 		j["tag"] = obj.tag;
@@ -153,7 +246,7 @@ namespace phoenix {
 		j["probability"] = obj.probability;
 	}
 
-	void to_json(nlohmann::json& j, const px::animation& obj) {
+	void to_json(arena_json& j, const px::animation& obj) {
 		j = {
 		    {"type", "animation"},
 		    {"name", obj.name},
@@ -175,13 +268,13 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::model_hierarchy_node& obj) {
+	void to_json(arena_json& j, const px::model_hierarchy_node& obj) {
 		j["parentIndex"] = obj.parent_index;
 		j["name"] = obj.name;
 		j["transform"] = obj.transform;
 	}
 
-	void to_json(nlohmann::json& j, const px::model_hierarchy& obj) {
+	void to_json(arena_json& j, const px::model_hierarchy& obj) {
 		j = {
 		    {"type", "hierarchy"},
 		    {"nodes", obj.nodes},
@@ -191,7 +284,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::texture& obj) {
+	void to_json(arena_json& j, const px::texture& obj) {
 		j = {
 		    {"format", obj.format()},
 		    {"width", obj.width()},
@@ -203,7 +296,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::material_group& obj) {
+	void to_json(arena_json& j, const px::material_group& obj) {
 		switch (obj) {
 
 		case material_group::undefined:
@@ -233,7 +326,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::animation_mapping_mode& obj) {
+	void to_json(arena_json& j, const px::animation_mapping_mode& obj) {
 		switch (obj) {
 		case animation_mapping_mode::none:
 			j = "none";
@@ -244,7 +337,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::wave_mode_type& obj) {
+	void to_json(arena_json& j, const px::wave_mode_type& obj) {
 		switch (obj) {
 		case wave_mode_type::none:
 			j = "none";
@@ -273,7 +366,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::wave_speed_type& obj) {
+	void to_json(arena_json& j, const px::wave_speed_type& obj) {
 		switch (obj) {
 		case wave_speed_type::none:
 			j = "none";
@@ -290,7 +383,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::alpha_function& obj) {
+	void to_json(arena_json& j, const px::alpha_function& obj) {
 		switch (obj) {
 		case alpha_function::default_:
 			j = "default";
@@ -316,7 +409,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::material& obj) {
+	void to_json(arena_json& j, const px::material& obj) {
 		j = {
 		    {"name", obj.name},
 		    {"group", obj.group},
@@ -345,7 +438,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::vertex_feature& obj) {
+	void to_json(arena_json& j, const px::vertex_feature& obj) {
 		j = {
 		    {"texture", obj.texture},
 		    {"light", obj.light},
@@ -353,7 +446,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::light_map& obj) {
+	void to_json(arena_json& j, const px::light_map& obj) {
 		j = {
 		    {"image", *obj.image},
 		    {"normals", {obj.normals[0], obj.normals[1]}},
@@ -361,7 +454,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::polygon_flags& obj) {
+	void to_json(arena_json& j, const px::polygon_flags& obj) {
 		j = {
 		    {"isPortal", obj.is_portal},
 		    {"isOcclude", obj.is_occluder},
@@ -376,7 +469,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::polygon_list& obj) {
+	void to_json(arena_json& j, const px::polygon_list& obj) {
 		j = {
 		    {"materialIndices", obj.material_indices},
 		    {"lightmapIndices", obj.lightmap_indices},
@@ -386,7 +479,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::mesh& obj) {
+	void to_json(arena_json& j, const px::mesh& obj) {
 		j = {{"date", obj.date},
 		     {"name", obj.name},
 		     {"bbox", obj.bbox},
@@ -398,7 +491,7 @@ namespace phoenix {
 		     {"polygons", obj.polygons}};
 	}
 
-	void to_json(nlohmann::json& j, const px::way_point& obj) {
+	void to_json(arena_json& j, const px::way_point& obj) {
 		j = {
 		    {"name", obj.name},
 		    {"waterDepth", obj.water_depth},
@@ -409,21 +502,21 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::way_edge& obj) {
+	void to_json(arena_json& j, const px::way_edge& obj) {
 		j = {
 		    {"a", obj.a},
 		    {"b", obj.b},
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::way_net& obj) {
+	void to_json(arena_json& j, const px::way_net& obj) {
 		j = {
 		    {"waypoints", obj.waypoints},
 		    {"edges", obj.edges},
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::bsp_sector& obj) {
+	void to_json(arena_json& j, const px::bsp_sector& obj) {
 		j = {
 		    {"name", obj.name},
 		    {"nodeIndices", obj.node_indices},
@@ -431,7 +524,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::bsp_node& obj) {
+	void to_json(arena_json& j, const px::bsp_node& obj) {
 		j = {
 		    {"plane", obj.plane},
 		    {"bbox", obj.bbox},
@@ -443,7 +536,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::bsp_tree& obj) {
+	void to_json(arena_json& j, const px::bsp_tree& obj) {
 		j = {
 		    {"mode", obj.mode == bsp_tree_mode::indoor ? "indoor" : "outdoor"},
 		    {"leafPolygons", obj.leaf_polygons},
@@ -455,23 +548,20 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, px::vob_type obj) {
-		j = vob_type_map.at(obj);
+	void to_json(arena_json& j, px::vob_type obj) {
+		j = vob_type_name(obj);
 	}
 
-	void to_json(nlohmann::json& j, const px::vob& obj) {
-		// TODO
-		j = {
-		    {"type", obj.type},
-		};
+	void to_json(arena_json& j, const px::vob& obj) {
+		dom_writer w {j};
+		serialize(w, obj);
 	}
 
-	void to_json(nlohmann::json& j, const std::unique_ptr<px::vob>& obj) {
-		// TODO
+	void to_json(arena_json& j, const std::unique_ptr<px::vob>& obj) {
 		to_json(j, *obj);
 	}
 
-	void to_json(nlohmann::json& j, const px::world& obj) {
+	void to_json(arena_json& j, const px::world& obj) {
 		j = {
 		    {"vobTree", obj.world_vobs},
 		    {"mesh", obj.world_mesh},
@@ -480,19 +570,19 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::edge& obj) {
+	void to_json(arena_json& j, const px::edge& obj) {
 		j = {{"edges", obj.edges}};
 	}
 
-	void to_json(nlohmann::json& j, const px::triangle_edge& obj) {
+	void to_json(arena_json& j, const px::triangle_edge& obj) {
 		j = {{"edges", obj.edges}};
 	}
 
-	void to_json(nlohmann::json& j, const px::triangle& obj) {
+	void to_json(arena_json& j, const px::triangle& obj) {
 		j = {{"wedges", obj.wedges}};
 	}
 
-	void to_json(nlohmann::json& j, const px::wedge& obj) {
+	void to_json(arena_json& j, const px::wedge& obj) {
 		j = {
 		    {"index", obj.index},
 		    {"normal", obj.normal},
@@ -500,7 +590,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::sub_mesh& obj) {
+	void to_json(arena_json& j, const px::sub_mesh& obj) {
 		j = {
 		    {"colors", obj.colors},
 		    {"edgeScores", obj.edge_scores},
@@ -514,7 +604,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::proto_mesh& obj) {
+	void to_json(arena_json& j, const px::proto_mesh& obj) {
 		j = {
 		    {"materials", obj.materials},
 		    {"normals", obj.normals},
@@ -526,13 +616,13 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::wedge_normal& obj) {
+	void to_json(arena_json& j, const px::wedge_normal& obj) {
 		j = {
 		    {"index", obj.index},
 		    {"normal", obj.normal},
 		};
 	}
-	void to_json(nlohmann::json& j, const px::weight_entry& obj) {
+	void to_json(arena_json& j, const px::weight_entry& obj) {
 		j = {
 		    {"position", obj.position},
 		    {"nodeIndex", obj.node_index},
@@ -540,7 +630,7 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::softskin_mesh& obj) {
+	void to_json(arena_json& j, const px::softskin_mesh& obj) {
 		j = {
 		    {"bboxes", obj.bboxes},
 		    {"mesh", obj.mesh},
@@ -550,11 +640,11 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::model_mesh& obj) {
+	void to_json(arena_json& j, const px::model_mesh& obj) {
 		j = {{"checksum", obj.checksum}, {"meshes", obj.meshes}, {"attachments", obj.attachments}};
 	}
 
-	void to_json(nlohmann::json& j, const px::morph_animation& obj) {
+	void to_json(arena_json& j, const px::morph_animation& obj) {
 		j = {
 		    {"samples", obj.samples},
 		    {"name", obj.name},
@@ -569,14 +659,14 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::morph_source& obj) {
+	void to_json(arena_json& j, const px::morph_source& obj) {
 		j = {
 		    {"fileDate", obj.file_date},
 		    {"fileName", obj.file_name},
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::morph_mesh& obj) {
+	void to_json(arena_json& j, const px::morph_mesh& obj) {
 		j = {
 		    {"name", obj.name},
 		    {"mesh", obj.mesh},
@@ -586,14 +676,14 @@ namespace phoenix {
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::model& obj) {
+	void to_json(arena_json& j, const px::model& obj) {
 		j = {
 		    {"mesh", obj.mesh},
 		    {"hierarchy", obj.hierarchy},
 		};
 	}
 
-	void to_json(nlohmann::json& j, const px::VfsNodeType& obj) {
+	void to_json(arena_json& j, const px::VfsNodeType& obj) {
 		switch (obj) {
 		case VfsNodeType::DIRECTORY:
 			j = "DIRECTORY";
@@ -604,7 +694,7 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::VfsNode& obj) {
+	void to_json(arena_json& j, const px::VfsNode& obj) {
 		if (obj.type() == VfsNodeType::FILE) {
 			j = {
 			    {"name", obj.name()},
@@ -621,18 +711,18 @@ namespace phoenix {
 		}
 	}
 
-	void to_json(nlohmann::json& j, const px::Vfs& obj) {
+	void to_json(arena_json& j, const px::Vfs& obj) {
 		j = {
 		    {"root", obj.root()},
 		};
 	}
 
 	namespace mds {
-		void to_json(nlohmann::json& j, const px::mds::skeleton& obj) {
+		void to_json(arena_json& j, const px::mds::skeleton& obj) {
 			j = {{"name", obj.name}, {"disableMesh", obj.disable_mesh}};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::animation_combination& obj) {
+		void to_json(arena_json& j, const px::mds::animation_combination& obj) {
 			j = {
 			    {"name", obj.name},
 			    {"layer", obj.layer},
@@ -645,7 +735,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_tag& obj) {
+		void to_json(arena_json& j, const px::mds::event_tag& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"type", obj.type},
@@ -658,7 +748,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_pfx& obj) {
+		void to_json(arena_json& j, const px::mds::event_pfx& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"index", obj.index},
@@ -668,14 +758,14 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_pfx_stop& obj) {
+		void to_json(arena_json& j, const px::mds::event_pfx_stop& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"index", obj.index},
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_sfx& obj) {
+		void to_json(arena_json& j, const px::mds::event_sfx& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"name", obj.name},
@@ -684,7 +774,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_sfx_ground& obj) {
+		void to_json(arena_json& j, const px::mds::event_sfx_ground& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"name", obj.name},
@@ -693,7 +783,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_morph_animate& obj) {
+		void to_json(arena_json& j, const px::mds::event_morph_animate& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"animation", obj.animation},
@@ -701,7 +791,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::event_camera_tremor& obj) {
+		void to_json(arena_json& j, const px::mds::event_camera_tremor& obj) {
 			j = {
 			    {"frame", obj.frame},
 			    {"field1", obj.field1},
@@ -711,7 +801,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::animation& obj) {
+		void to_json(arena_json& j, const px::mds::animation& obj) {
 			j = {
 			    {"name", obj.name},
 			    {"layer", obj.layer},
@@ -737,7 +827,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::animation_blending& obj) {
+		void to_json(arena_json& j, const px::mds::animation_blending& obj) {
 			j = {
 			    {"name", obj.name},
 			    {"next", obj.next},
@@ -746,7 +836,7 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::animation_alias& obj) {
+		void to_json(arena_json& j, const px::mds::animation_alias& obj) {
 			j = {
 			    {"name", obj.name},
 			    {"layer", obj.layer},
@@ -759,14 +849,14 @@ namespace phoenix {
 			};
 		}
 
-		void to_json(nlohmann::json& j, const px::mds::model_tag& obj) {
+		void to_json(arena_json& j, const px::mds::model_tag& obj) {
 			j = {
 			    {"bone", obj.bone},
 			};
 		}
 	} // namespace mds
 
-	void to_json(nlohmann::json& j, const px::model_script& obj) {
+	void to_json(arena_json& j, const px::model_script& obj) {
 		j = {
 		    {"skeleton", obj.skeleton},
 		    {"meshes", obj.meshes},
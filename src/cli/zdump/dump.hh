@@ -17,58 +17,82 @@
 
 #include <nlohmann/json.hpp>
 
+#include "arena.hh"
+
+#include <cstdint>
+#include <map>
+#include <vector>
+
 namespace px = phoenix;
 
+/// \brief The document type built by `zdump --dom`.
+///
+/// All of its memory, including the memory of strings, is allocated from the arena of the current arena::scope. Thus
+/// a whole document can be created with arena::make() and freed at once by destroying the arena.
+using arena_json = nlohmann::basic_json<std::map,
+                                        std::vector,
+                                        arena_string,
+                                        bool,
+                                        std::int64_t,
+                                        std::uint64_t,
+                                        double,
+                                        arena_allocator>;
+
+/// \brief Returns the class name of the given VOB type as stored in ZenGin archives.
+/// \param type The type to get the class name of.
+/// \return The class name including the names of its base classes.
+const std::string& vob_type_name(px::vob_type type);
+
 namespace phoenix {
-	void to_json(nlohmann::json& j, const px::font& obj);
+	void to_json(arena_json& j, const px::font& obj);
 
-	void to_json(nlohmann::json& j, const px::messages& obj);
+	void to_json(arena_json& j, const px::messages& obj);
 
-	void to_json(nlohmann::json& j, const px::animation& obj);
+	void to_json(arena_json& j, const px::animation& obj);
 
-	void to_json(nlohmann::json& j, const px::model_hierarchy& obj);
+	void to_json(arena_json& j, const px::model_hierarchy& obj);
 
-	void to_json(nlohmann::json& j, const px::texture& obj);
+	void to_json(arena_json& j, const px::texture& obj);
 
-	void to_json(nlohmann::json& j, const px::mesh& obj);
+	void to_json(arena_json& j, const px::mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::model_script& obj);
+	void to_json(arena_json& j, const px::model_script& obj);
 
-	void to_json(nlohmann::json& j, const px::proto_mesh& obj);
+	void to_json(arena_json& j, const px::proto_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::world& obj);
+	void to_json(arena_json& j, const px::world& obj);
 
-	void to_json(nlohmann::json& j, const px::model_mesh& obj);
+	void to_json(arena_json& j, const px::model_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::proto_mesh& obj);
+	void to_json(arena_json& j, const px::proto_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::sub_mesh& obj);
+	void to_json(arena_json& j, const px::sub_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::edge& obj);
+	void to_json(arena_json& j, const px::edge& obj);
 
-	void to_json(nlohmann::json& j, const px::triangle_edge& obj);
+	void to_json(arena_json& j, const px::triangle_edge& obj);
 
-	void to_json(nlohmann::json& j, const px::triangle& obj);
+	void to_json(arena_json& j, const px::triangle& obj);
 
-	void to_json(nlohmann::json& j, const px::wedge& obj);
+	void to_json(arena_json& j, const px::wedge& obj);
 
-	void to_json(nlohmann::json& j, const px::softskin_mesh& obj);
+	void to_json(arena_json& j, const px::softskin_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::wedge_normal& obj);
+	void to_json(arena_json& j, const px::wedge_normal& obj);
 
-	void to_json(nlohmann::json& j, const px::weight_entry& obj);
+	void to_json(arena_json& j, const px::weight_entry& obj);
 
-	void to_json(nlohmann::json& j, const px::morph_mesh& obj);
+	void to_json(arena_json& j, const px::morph_mesh& obj);
 
-	void to_json(nlohmann::json& j, const px::morph_animation& obj);
+	void to_json(arena_json& j, const px::morph_animation& obj);
 
-	void to_json(nlohmann::json& j, const px::morph_source& obj);
+	void to_json(arena_json& j, const px::morph_source& obj);
 
-	void to_json(nlohmann::json& j, const px::model& obj);
+	void to_json(arena_json& j, const px::model& obj);
 
-	void to_json(nlohmann::json& j, const px::Vfs& obj);
+	void to_json(arena_json& j, const px::Vfs& obj);
 
-	void to_json(nlohmann::json& j, const px::VfsNode& obj);
+	void to_json(arena_json& j, const px::VfsNode& obj);
 
-	void to_json(nlohmann::json& j, const px::VfsNodeType& obj);
+	void to_json(arena_json& j, const px::VfsNodeType& obj);
 } // namespace phoenix
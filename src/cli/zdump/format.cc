@@ -0,0 +1,11 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "format.hh"
+
+#include <algorithm>
+
+file_format detect_file_format(const px::buffer& buf) {
+	// only the header is looked at, straight from the buffer's memory
+	auto size = std::min<std::uint64_t>(buf.remaining(), pstudio::FORMAT_HEADER_SIZE);
+	return pstudio::detect_file_format(buf.array() + buf.position(), static_cast<std::size_t>(size));
+}
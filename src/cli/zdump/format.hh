@@ -0,0 +1,69 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/animation.hh>
+#include <phoenix/buffer.hh>
+#include <phoenix/font.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/messages.hh>
+#include <phoenix/model_hierarchy.hh>
+#include <phoenix/model_mesh.hh>
+#include <phoenix/model_script.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+#include <phoenix/texture.hh>
+#include <phoenix/world.hh>
+#include <phoenix/Vfs.hh>
+
+#include <pstudio/file_format.hh>
+
+namespace px = phoenix;
+
+using pstudio::file_format;
+
+/// \brief Guesses the format of a file from its first few bytes.
+/// \param buf The contents of the file. Its position is not changed.
+/// \return The format of the file or file_format::unknown if it is not supported.
+file_format detect_file_format(const px::buffer& buf);
+
+/// \brief Parses a file and passes the parsed object to the given function.
+/// \param fmt The format of the file.
+/// \param in The contents of the file.
+/// \param fn A function accepting any of the parsed phoenix types.
+/// \return `false` if the format is not supported and `true` otherwise.
+template <typename F>
+bool visit_file(file_format fmt, px::buffer& in, F&& fn) {
+	if (fmt == file_format::mdh) {
+		fn(px::model_hierarchy::parse(in));
+	} else if (fmt == file_format::man) {
+		fn(px::animation::parse(in));
+	} else if (fmt == file_format::csl) {
+		fn(px::messages::parse(in));
+	} else if (fmt == file_format::fnt) {
+		fn(px::font::parse(in));
+	} else if (fmt == file_format::msh) {
+		fn(px::mesh::parse(in, {}));
+	} else if (fmt == file_format::tex) {
+		fn(px::texture::parse(in));
+	} else if (fmt == file_format::mds) {
+		fn(px::model_script::parse(in));
+	} else if (fmt == file_format::msb) {
+		fn(px::model_script::parse(in));
+	} else if (fmt == file_format::mrm) {
+		fn(px::proto_mesh::parse(in));
+	} else if (fmt == file_format::mdm) {
+		fn(px::model_mesh::parse(in));
+	} else if (fmt == file_format::mmb) {
+		fn(px::morph_mesh::parse(in));
+	} else if (fmt == file_format::zen) {
+		fn(px::world::parse(in));
+	} else if (fmt == file_format::vdf) {
+		px::Vfs vfs;
+		vfs.mount_disk(in);
+		fn(vfs);
+	} else {
+		return false;
+	}
+
+	return true;
+}
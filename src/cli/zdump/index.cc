@@ -0,0 +1,812 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "index.hh"
+#include "archive.hh"
+#include "format.hh"
+
+#include <phoenix/messages.hh>
+#include <phoenix/vdfs.hh>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <memory>
+#include <optional>
+#include <regex>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+namespace {
+	/// \brief A message block converted to UTF-8, as it is stored in the index.
+	struct message_entry {
+		std::string file;
+		std::string name;
+		std::string text;
+	};
+
+	/// \brief A source of an index being written.
+	struct source_entry {
+		std::string path;
+		std::uint64_t size {0};
+		std::int64_t modified {0};
+		std::uint32_t codepage {0};
+		std::vector<message_entry> messages {};
+
+		/// \brief Whether the source was part of the previous index.
+		bool known {false};
+	};
+
+	/// \brief A source being parsed again and its size, modification time and code page before parsing.
+	struct pending_source {
+		std::future<std::vector<message_entry>> messages;
+		std::uint64_t size;
+		std::int64_t modified;
+		std::uint32_t codepage;
+	};
+} // namespace
+
+// The index file consists of a header followed by the tables of sources, messages and trigrams, the posting lists of
+// the trigrams and the strings the tables refer to. All numbers are little-endian. Strings are referred to by their
+// offset and size in the string section.
+static constexpr char INDEX_MAGIC[4] = {'Z', 'M', 'I', 'X'};
+static constexpr std::uint32_t INDEX_VERSION = 2;
+
+// magic, version, code page of new sources, number of sources, messages and trigrams, size of postings and strings
+static constexpr std::size_t HEADER_SIZE = 4 + 4 * 5 + 8 * 2;
+
+// path, size, modification time, first message, number of messages, code page
+static constexpr std::size_t SOURCE_SIZE = 8 + 8 + 8 + 4 + 4 + 4;
+
+/// \brief The code page of the sources of new indices unless another one is given.
+static constexpr std::uint32_t DEFAULT_CODEPAGE = 1252;
+
+// source, file, name, text
+static constexpr std::size_t MESSAGE_SIZE = 4 + 8 * 3;
+
+// trigram, number of messages, offset of the posting list
+static constexpr std::size_t TRIGRAM_SIZE = 4 + 4 + 8;
+
+// the upper halves of the supported Windows code pages, undefined characters map to U+FFFD
+static constexpr std::uint16_t CP1250[128] = {
+    0x20AC, 0xFFFD, 0x201A, 0xFFFD, 0x201E, 0x2026, 0x2020, 0x2021,
+    0xFFFD, 0x2030, 0x0160, 0x2039, 0x015A, 0x0164, 0x017D, 0x0179,
+    0xFFFD, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0xFFFD, 0x2122, 0x0161, 0x203A, 0x015B, 0x0165, 0x017E, 0x017A,
+    0x00A0, 0x02C7, 0x02D8, 0x0141, 0x00A4, 0x0104, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x015E, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x017B,
+    0x00B0, 0x00B1, 0x02DB, 0x0142, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x0105, 0x015F, 0x00BB, 0x013D, 0x02DD, 0x013E, 0x017C,
+    0x0154, 0x00C1, 0x00C2, 0x0102, 0x00C4, 0x0139, 0x0106, 0x00C7,
+    0x010C, 0x00C9, 0x0118, 0x00CB, 0x011A, 0x00CD, 0x00CE, 0x010E,
+    0x0110, 0x0143, 0x0147, 0x00D3, 0x00D4, 0x0150, 0x00D6, 0x00D7,
+    0x0158, 0x016E, 0x00DA, 0x0170, 0x00DC, 0x00DD, 0x0162, 0x00DF,
+    0x0155, 0x00E1, 0x00E2, 0x0103, 0x00E4, 0x013A, 0x0107, 0x00E7,
+    0x010D, 0x00E9, 0x0119, 0x00EB, 0x011B, 0x00ED, 0x00EE, 0x010F,
+    0x0111, 0x0144, 0x0148, 0x00F3, 0x00F4, 0x0151, 0x00F6, 0x00F7,
+    0x0159, 0x016F, 0x00FA, 0x0171, 0x00FC, 0x00FD, 0x0163, 0x02D9,
+};
+
+static constexpr std::uint16_t CP1251[128] = {
+    0x0402, 0x0403, 0x201A, 0x0453, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x20AC, 0x2030, 0x0409, 0x2039, 0x040A, 0x040C, 0x040B, 0x040F,
+    0x0452, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0xFFFD, 0x2122, 0x0459, 0x203A, 0x045A, 0x045C, 0x045B, 0x045F,
+    0x00A0, 0x040E, 0x045E, 0x0408, 0x00A4, 0x0490, 0x00A6, 0x00A7,
+    0x0401, 0x00A9, 0x0404, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x0407,
+    0x00B0, 0x00B1, 0x0406, 0x0456, 0x0491, 0x00B5, 0x00B6, 0x00B7,
+    0x0451, 0x2116, 0x0454, 0x00BB, 0x0458, 0x0405, 0x0455, 0x0457,
+    0x0410, 0x0411, 0x0412, 0x0413, 0x0414, 0x0415, 0x0416, 0x0417,
+    0x0418, 0x0419, 0x041A, 0x041B, 0x041C, 0x041D, 0x041E, 0x041F,
+    0x0420, 0x0421, 0x0422, 0x0423, 0x0424, 0x0425, 0x0426, 0x0427,
+    0x0428, 0x0429, 0x042A, 0x042B, 0x042C, 0x042D, 0x042E, 0x042F,
+    0x0430, 0x0431, 0x0432, 0x0433, 0x0434, 0x0435, 0x0436, 0x0437,
+    0x0438, 0x0439, 0x043A, 0x043B, 0x043C, 0x043D, 0x043E, 0x043F,
+    0x0440, 0x0441, 0x0442, 0x0443, 0x0444, 0x0445, 0x0446, 0x0447,
+    0x0448, 0x0449, 0x044A, 0x044B, 0x044C, 0x044D, 0x044E, 0x044F,
+};
+
+static constexpr std::uint16_t CP1252[128] = {
+    0x20AC, 0xFFFD, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+    0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0xFFFD, 0x017D, 0xFFFD,
+    0xFFFD, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+    0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0xFFFD, 0x017E, 0x0178,
+    0x00A0, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+    0x00A8, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x00AD, 0x00AE, 0x00AF,
+    0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+    0x00B8, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+    0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+    0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+    0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+    0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+    0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+    0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+    0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+    0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF,
+};
+
+static const std::uint16_t* codepage_table(std::uint32_t codepage) {
+	switch (codepage) {
+	case 1250:
+		return CP1250;
+	case 1251:
+		return CP1251;
+	case 1252:
+		return CP1252;
+	default:
+		return nullptr;
+	}
+}
+
+bool is_supported_codepage(std::uint32_t codepage) {
+	return codepage_table(codepage) != nullptr;
+}
+
+/// \brief Converts a string to UTF-8 unless it already is valid UTF-8.
+static std::string to_utf8(std::string_view text, const std::uint16_t* table) {
+	auto valid = true;
+	for (std::size_t i = 0; i < text.size() && valid;) {
+		auto length = static_cast<unsigned char>(text[i]) < 0x80 ? 1 : utf8_sequence_length(text.substr(i));
+		valid = length != 0;
+		i += length;
+	}
+
+	if (valid)
+		return std::string {text};
+
+	std::string result {};
+	result.reserve(text.size() * 2);
+
+	for (auto c : text) {
+		auto byte = static_cast<unsigned char>(c);
+		if (byte < 0x80) {
+			result.push_back(c);
+			continue;
+		}
+
+		// all characters of the upper halves are at least U+0080
+		auto code = table[byte - 0x80];
+		if (code < 0x800) {
+			result.push_back(static_cast<char>(0xC0 | (code >> 6)));
+		} else {
+			result.push_back(static_cast<char>(0xE0 | (code >> 12)));
+			result.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+		}
+
+		result.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+	}
+
+	return result;
+}
+
+static unsigned char fold(char c) {
+	auto byte = static_cast<unsigned char>(c);
+	return byte >= 'A' && byte <= 'Z' ? static_cast<unsigned char>(byte - 'A' + 'a') : byte;
+}
+
+/// \return The trigram made of the first three characters of \p text with ASCII letters in lower case.
+static std::uint32_t make_trigram(const char* text) {
+	return std::uint32_t {fold(text[0])} << 16 | std::uint32_t {fold(text[1])} << 8 | std::uint32_t {fold(text[2])};
+}
+
+static void collect_trigrams(std::string_view text, std::vector<std::uint32_t>& trigrams) {
+	for (std::size_t i = 0; i + 3 <= text.size(); ++i) {
+		trigrams.push_back(make_trigram(text.data() + i));
+	}
+}
+
+template <typename T>
+static T load(const std::byte* data) {
+	T value = 0;
+	for (std::size_t i = 0; i < sizeof(T); ++i) {
+		value |= static_cast<T>(std::to_integer<T>(data[i]) << (8 * i));
+	}
+	return value;
+}
+
+template <typename T>
+static void store(std::string& out, T value) {
+	for (std::size_t i = 0; i < sizeof(T); ++i) {
+		out.push_back(static_cast<char>((value >> (8 * i)) & 0xFF));
+	}
+}
+
+static void store_varint(std::string& out, std::uint32_t value) {
+	while (value >= 0x80) {
+		out.push_back(static_cast<char>((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+
+	out.push_back(static_cast<char>(value));
+}
+
+static std::uint32_t to_uint32(std::size_t value) {
+	if (value > UINT32_MAX)
+		throw std::runtime_error {"the index is too large"};
+	return static_cast<std::uint32_t>(value);
+}
+
+message_index message_index::open(const std::filesystem::path& path) {
+	message_index index {px::buffer::mmap(path)};
+	auto size = index._m_buffer.limit();
+	auto* data = index._m_buffer.array();
+
+	if (size < HEADER_SIZE || std::memcmp(data, INDEX_MAGIC, sizeof INDEX_MAGIC) != 0)
+		throw std::runtime_error {"not a message index: " + path.string()};
+	if (load<std::uint32_t>(data + 4) != INDEX_VERSION)
+		throw std::runtime_error {"the message index was written by another version of zdump: " + path.string()};
+
+	index._m_codepage = load<std::uint32_t>(data + 8);
+	index._m_source_count = load<std::uint32_t>(data + 12);
+	index._m_message_count = load<std::uint32_t>(data + 16);
+	index._m_trigram_count = load<std::uint32_t>(data + 20);
+	index._m_postings_size = load<std::uint64_t>(data + 24);
+	index._m_strings_size = load<std::uint64_t>(data + 32);
+
+	index._m_sources = data + HEADER_SIZE;
+	index._m_messages = index._m_sources + std::size_t {index._m_source_count} * SOURCE_SIZE;
+	index._m_trigrams = index._m_messages + std::size_t {index._m_message_count} * MESSAGE_SIZE;
+	index._m_postings = index._m_trigrams + std::size_t {index._m_trigram_count} * TRIGRAM_SIZE;
+	index._m_strings = index._m_postings + index._m_postings_size;
+
+	if (static_cast<std::uint64_t>(index._m_strings - data) + index._m_strings_size != size)
+		throw std::runtime_error {"the message index is corrupt: " + path.string()};
+
+	return index;
+}
+
+std::string_view message_index::_string(const std::byte* ref) const {
+	auto offset = load<std::uint32_t>(ref);
+	auto size = load<std::uint32_t>(ref + 4);
+
+	if (std::uint64_t {offset} + size > _m_strings_size)
+		throw std::runtime_error {"the message index is corrupt"};
+	return {reinterpret_cast<const char*>(_m_strings + offset), size};
+}
+
+indexed_source message_index::source(std::uint32_t index) const {
+	auto* record = _m_sources + std::size_t {index} * SOURCE_SIZE;
+
+	indexed_source source {};
+	source.path = _string(record);
+	source.size = load<std::uint64_t>(record + 8);
+	source.modified = static_cast<std::int64_t>(load<std::uint64_t>(record + 16));
+	source.first_message = load<std::uint32_t>(record + 24);
+	source.message_count = load<std::uint32_t>(record + 28);
+	source.codepage = load<std::uint32_t>(record + 32);
+	return source;
+}
+
+indexed_message message_index::message(std::uint32_t index) const {
+	auto* record = _m_messages + std::size_t {index} * MESSAGE_SIZE;
+	return {load<std::uint32_t>(record), _string(record + 4), _string(record + 12), _string(record + 20)};
+}
+
+std::vector<std::uint32_t> message_index::_postings(std::uint32_t trigram) const {
+	// binary search in the sorted trigram table
+	std::size_t low = 0, high = _m_trigram_count;
+	while (low < high) {
+		auto middle = low + (high - low) / 2;
+		if (load<std::uint32_t>(_m_trigrams + middle * TRIGRAM_SIZE) < trigram) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+
+	auto* record = _m_trigrams + low * TRIGRAM_SIZE;
+	if (low == _m_trigram_count || load<std::uint32_t>(record) != trigram)
+		return {};
+
+	auto count = load<std::uint32_t>(record + 4);
+	auto offset = load<std::uint64_t>(record + 8);
+
+	std::vector<std::uint32_t> messages {};
+	messages.reserve(count);
+
+	std::uint32_t previous = 0;
+	for (std::uint32_t i = 0; i < count; ++i) {
+		std::uint32_t delta = 0;
+
+		for (unsigned shift = 0;; shift += 7) {
+			if (offset >= _m_postings_size || shift > 28)
+				throw std::runtime_error {"the message index is corrupt"};
+
+			auto byte = std::to_integer<std::uint32_t>(_m_postings[offset++]);
+			delta |= (byte & 0x7F) << shift;
+
+			if ((byte & 0x80) == 0)
+				break;
+		}
+
+		previous += delta;
+		messages.push_back(previous);
+	}
+
+	return messages;
+}
+
+/// \return The index after the character class starting at \p i.
+static std::size_t skip_class(std::string_view pattern, std::size_t i) {
+	++i;
+	if (i < pattern.size() && pattern[i] == '^')
+		++i;
+	if (i < pattern.size() && pattern[i] == ']')
+		++i;
+
+	for (; i < pattern.size() && pattern[i] != ']'; ++i) {
+		if (pattern[i] == '\\')
+			++i;
+	}
+
+	return std::min(i + 1, pattern.size());
+}
+
+/// \return The index after the group starting at \p i.
+static std::size_t skip_group(std::string_view pattern, std::size_t i) {
+	std::size_t depth = 0;
+
+	while (i < pattern.size()) {
+		if (pattern[i] == '\\') {
+			i += 2;
+		} else if (pattern[i] == '[') {
+			i = skip_class(pattern, i);
+		} else {
+			if (pattern[i] == '(')
+				++depth;
+			if (pattern[i] == ')' && --depth == 0)
+				return i + 1;
+			++i;
+		}
+	}
+
+	return pattern.size();
+}
+
+/// \brief Finds the runs of literal characters every match of a regular expression contains.
+///
+/// Groups, character classes and escapes other than for punctuation are not looked into, so the result may miss
+/// some of the text a match requires, but never contains text which is not required.
+/// \return The runs of at least three characters or nothing if the expression contains an alternative.
+static std::vector<std::string> required_literals(std::string_view pattern) {
+	std::vector<std::string> literals {};
+	std::string current {};
+
+	auto flush = [&literals, &current] {
+		if (current.size() >= 3)
+			literals.push_back(current);
+		current.clear();
+	};
+
+	for (std::size_t i = 0; i < pattern.size();) {
+		std::optional<char> literal {};
+		auto c = pattern[i];
+
+		if (c == '|')
+			return {};
+
+		if (c == '(') {
+			i = skip_group(pattern, i);
+		} else if (c == '[') {
+			i = skip_class(pattern, i);
+		} else if (c == '\\' && i + 1 < pattern.size()) {
+			auto escaped = pattern[i + 1];
+			i += 2;
+
+			if (!std::isalnum(static_cast<unsigned char>(escaped))) {
+				literal = escaped;
+			} else if (escaped == 'x') {
+				i += 2;
+			} else if (escaped == 'u') {
+				i += 4;
+			} else if (escaped == 'c') {
+				i += 1;
+			} else {
+				while (i < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i])))
+					++i;
+			}
+		} else if (std::strchr("\\^$.*+?{}])", c) != nullptr) {
+			++i;
+		} else {
+			literal = c;
+			++i;
+		}
+
+		// a quantifier makes the atom optional if it allows zero repetitions
+		auto optional = false, repeated = false;
+		if (i < pattern.size()) {
+			auto q = pattern[i];
+
+			if (q == '*' || q == '?' || q == '+') {
+				optional = q != '+';
+				repeated = true;
+				++i;
+			} else if (q == '{' && i + 1 < pattern.size() && std::isdigit(static_cast<unsigned char>(pattern[i + 1]))) {
+				optional = pattern[i + 1] == '0';
+				repeated = true;
+				i = std::min(pattern.find('}', i), pattern.size() - 1) + 1;
+			}
+
+			if (repeated && i < pattern.size() && pattern[i] == '?')
+				++i;
+		}
+
+		if (literal && !optional)
+			current.push_back(*literal);
+		if (!literal || repeated)
+			flush();
+	}
+
+	flush();
+	return literals;
+}
+
+index_result message_index::search(const index_query& query) const {
+	std::optional<std::regex> expression {};
+	std::vector<std::string> literals {query.pattern};
+
+	if (query.regex) {
+		auto flags = std::regex::ECMAScript | std::regex::optimize;
+		if (query.ignore_case)
+			flags |= std::regex::icase;
+
+		expression.emplace(query.pattern, flags);
+		literals = required_literals(query.pattern);
+	}
+
+	std::vector<std::uint32_t> trigrams {};
+	for (const auto& literal : literals) {
+		collect_trigrams(literal, trigrams);
+	}
+
+	std::sort(trigrams.begin(), trigrams.end());
+	trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+	// intersect the posting lists, shortest first
+	std::vector<std::vector<std::uint32_t>> postings {};
+	for (auto trigram : trigrams) {
+		auto& messages = postings.emplace_back(_postings(trigram));
+		if (messages.empty())
+			return {};
+	}
+
+	std::sort(postings.begin(), postings.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+
+	std::vector<std::uint32_t> candidates {};
+	if (postings.empty()) {
+		candidates.resize(_m_message_count);
+		for (std::uint32_t i = 0; i < _m_message_count; ++i) {
+			candidates[i] = i;
+		}
+	} else {
+		candidates = std::move(postings[0]);
+
+		std::vector<std::uint32_t> intersection {};
+		for (std::size_t i = 1; i < postings.size() && !candidates.empty(); ++i) {
+			intersection.clear();
+			std::set_intersection(candidates.begin(),
+			                      candidates.end(),
+			                      postings[i].begin(),
+			                      postings[i].end(),
+			                      std::back_inserter(intersection));
+			candidates.swap(intersection);
+		}
+	}
+
+	auto matches = [&query, &expression](std::string_view value) {
+		if (expression)
+			return std::regex_search(value.begin(), value.end(), *expression);
+		if (!query.ignore_case)
+			return value.find(query.pattern) != std::string_view::npos;
+
+		auto equal = [](char a, char b) { return fold(a) == fold(b); };
+		auto it = std::search(value.begin(), value.end(), query.pattern.begin(), query.pattern.end(), equal);
+		return it != value.end() || query.pattern.empty();
+	};
+
+	index_result result {};
+	result.candidates = candidates.size();
+
+	for (auto id : candidates) {
+		auto message = this->message(id);
+		if (matches(message.name) || matches(message.text))
+			result.messages.push_back(id);
+	}
+
+	return result;
+}
+
+/// \brief Parses the message blocks of a message file or of all message files of a VDF.
+static std::vector<message_entry> parse_source(const std::string& path, const std::uint16_t* table) {
+	auto in = px::buffer::mmap(path);
+	std::vector<message_entry> messages {};
+
+	auto add = [&messages, table](std::string_view file, const px::messages& obj) {
+		for (const auto& block : obj.blocks) {
+			messages.push_back({std::string {file}, to_utf8(block.name, table), to_utf8(block.message.text, table)});
+		}
+	};
+
+	auto format = detect_file_format(in);
+	if (format == file_format::csl) {
+		add({}, px::messages::parse(in));
+	} else if (format == file_format::vdf) {
+		auto vdf = px::vdf_file::open(in);
+
+		for (const auto& file : list_files(vdf)) {
+			auto entry = file.entry->open();
+			if (detect_file_format(entry) != file_format::csl)
+				continue;
+
+			try {
+				add(file.path, px::messages::parse(entry));
+			} catch (const std::exception& e) {
+				throw std::runtime_error {file.path + ": " + e.what()};
+			}
+		}
+	} else {
+		throw std::runtime_error {"neither a message file nor a VDF"};
+	}
+
+	return messages;
+}
+
+static void write_index(const fs::path& path, const std::vector<source_entry>& sources, std::uint32_t codepage) {
+	std::string source_table {}, message_table {}, trigram_table {}, postings {}, strings {};
+
+	auto store_string = [&strings](std::string& out, std::string_view value) {
+		store(out, to_uint32(strings.size()));
+		store(out, to_uint32(value.size()));
+		strings.append(value);
+	};
+
+	// the paths of the message files inside of VDFs repeat for every message, so they are only stored once
+	std::unordered_map<std::string_view, std::string> files {};
+
+	std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> trigram_messages {};
+	std::vector<std::uint32_t> trigrams {};
+	std::uint32_t id = 0;
+
+	for (std::size_t i = 0; i < sources.size(); ++i) {
+		const auto& source = sources[i];
+
+		store_string(source_table, source.path);
+		store(source_table, source.size);
+		store(source_table, static_cast<std::uint64_t>(source.modified));
+		store(source_table, id);
+		store(source_table, to_uint32(source.messages.size()));
+		store(source_table, source.codepage);
+
+		for (const auto& message : source.messages) {
+			store(message_table, static_cast<std::uint32_t>(i));
+
+			auto [file, inserted] = files.try_emplace(message.file);
+			if (inserted)
+				store_string(file->second, message.file);
+			message_table.append(file->second);
+
+			store_string(message_table, message.name);
+			store_string(message_table, message.text);
+
+			trigrams.clear();
+			collect_trigrams(message.name, trigrams);
+			collect_trigrams(message.text, trigrams);
+
+			std::sort(trigrams.begin(), trigrams.end());
+			trigrams.erase(std::unique(trigrams.begin(), trigrams.end()), trigrams.end());
+
+			for (auto trigram : trigrams) {
+				trigram_messages[trigram].push_back(id);
+			}
+
+			id = to_uint32(std::size_t {id} + 1);
+		}
+	}
+
+	trigrams.clear();
+	for (const auto& [trigram, messages] : trigram_messages) {
+		trigrams.push_back(trigram);
+	}
+	std::sort(trigrams.begin(), trigrams.end());
+
+	for (auto trigram : trigrams) {
+		const auto& messages = trigram_messages[trigram];
+		store(trigram_table, trigram);
+		store(trigram_table, to_uint32(messages.size()));
+		store(trigram_table, static_cast<std::uint64_t>(postings.size()));
+
+		std::uint32_t previous = 0;
+		for (auto message : messages) {
+			store_varint(postings, message - previous);
+			previous = message;
+		}
+	}
+
+	std::string header(INDEX_MAGIC, sizeof INDEX_MAGIC);
+	store(header, INDEX_VERSION);
+	store(header, codepage);
+	store(header, to_uint32(sources.size()));
+	store(header, id);
+	store(header, to_uint32(trigrams.size()));
+	store(header, static_cast<std::uint64_t>(postings.size()));
+	store(header, static_cast<std::uint64_t>(strings.size()));
+
+	// write the new index next to the old one so that it is replaced at once
+	auto temporary = path;
+	temporary += ".tmp";
+
+	{
+		using file_handle = std::unique_ptr<std::FILE, decltype(&std::fclose)>;
+		file_handle output {std::fopen(temporary.string().c_str(), "wb"), &std::fclose};
+		if (output == nullptr)
+			throw std::runtime_error {"cannot open " + temporary.string()};
+
+		for (const auto* section : {&header, &source_table, &message_table, &trigram_table, &postings, &strings}) {
+			if (std::fwrite(section->data(), 1, section->size(), output.get()) != section->size())
+				throw std::runtime_error {"cannot write " + temporary.string()};
+		}
+
+		if (std::fclose(output.release()) != 0)
+			throw std::runtime_error {"cannot write " + temporary.string()};
+	}
+
+	fs::rename(temporary, path);
+}
+
+index_update update_index(const std::filesystem::path& path,
+                          const std::vector<std::string>& inputs,
+                          std::optional<std::uint32_t> codepage,
+                          pstudio::thread_pool& pool) {
+	if (codepage && codepage_table(*codepage) == nullptr)
+		throw std::runtime_error {"unsupported code page " + std::to_string(*codepage)};
+
+	index_update update {};
+	std::vector<source_entry> sources {};
+	std::vector<std::optional<pending_source>> parsed {};
+	auto default_codepage = codepage.value_or(DEFAULT_CODEPAGE);
+
+	{
+		std::optional<message_index> previous {};
+		if (fs::exists(path))
+			previous.emplace(message_index::open(path));
+		if (previous && !codepage)
+			default_codepage = previous->codepage();
+
+		// only the code page of the sources given as inputs is changed
+		std::unordered_set<std::string> given {};
+
+		// the previous sources come first so that message numbers change as little as possible
+		std::vector<std::string> paths {};
+		std::unordered_map<std::string, std::uint32_t> previous_sources {};
+
+		for (std::uint32_t i = 0; previous && i < previous->source_count(); ++i) {
+			auto& source = paths.emplace_back(previous->source(i).path);
+			previous_sources.emplace(source, i);
+		}
+
+		for (const auto& input : inputs) {
+			auto source = fs::absolute(input).lexically_normal().string();
+			given.insert(source);
+
+			if (std::find(paths.begin(), paths.end(), source) == paths.end())
+				paths.push_back(std::move(source));
+		}
+
+		for (const auto& source_path : paths) {
+			auto it = previous_sources.find(source_path);
+			std::optional<indexed_source> old {};
+			if (it != previous_sources.end())
+				old = previous->source(it->second);
+
+			std::error_code error {};
+			auto size = fs::file_size(source_path, error);
+
+			fs::file_time_type modified_time {};
+			if (!error)
+				modified_time = fs::last_write_time(source_path, error);
+			auto modified = static_cast<std::int64_t>(modified_time.time_since_epoch().count());
+
+			if (error) {
+				if (old) {
+					++update.removed;
+				} else {
+					update.failures.emplace_back(source_path, error.message());
+				}
+				continue;
+			}
+
+			auto source_codepage = old ? old->codepage : default_codepage;
+			if (codepage && given.count(source_path) != 0)
+				source_codepage = *codepage;
+
+			const auto* table = codepage_table(source_codepage);
+			if (table == nullptr)
+				throw std::runtime_error {"unsupported code page " + std::to_string(source_codepage)};
+
+			auto changed = !old || old->size != size || old->modified != modified || old->codepage != source_codepage;
+
+			// the previous messages and their size, modification time and code page are kept in case the source
+			// cannot be parsed anymore, so that parsing it is tried again by the next update
+			source_entry source {source_path, size, modified, source_codepage};
+			if (old) {
+				source.known = true;
+				source.size = old->size;
+				source.modified = old->modified;
+				source.codepage = old->codepage;
+			}
+
+			for (std::uint32_t i = 0; old && i < old->message_count; ++i) {
+				auto message = previous->message(old->first_message + i);
+				source.messages.push_back({std::string {message.file},
+				                           std::string {message.name},
+				                           std::string {message.text}});
+			}
+
+			if (changed) {
+				auto messages = pool.submit([source_path, table] { return parse_source(source_path, table); });
+				parsed.push_back(pending_source {std::move(messages), size, modified, source_codepage});
+			} else {
+				parsed.emplace_back();
+				++update.reused;
+			}
+
+			sources.push_back(std::move(source));
+		}
+	}
+
+	std::vector<source_entry> indexed {};
+	for (std::size_t i = 0; i < sources.size(); ++i) {
+		if (parsed[i]) {
+			try {
+				sources[i].messages = parsed[i]->messages.get();
+				sources[i].size = parsed[i]->size;
+				sources[i].modified = parsed[i]->modified;
+				sources[i].codepage = parsed[i]->codepage;
+				++update.parsed;
+			} catch (const std::exception& e) {
+				update.failures.emplace_back(sources[i].path, e.what());
+
+				// sources which were not indexed before are left out
+				if (!sources[i].known)
+					continue;
+			}
+		}
+
+		update.messages += to_uint32(sources[i].messages.size());
+		indexed.push_back(std::move(sources[i]));
+	}
+
+	write_index(path, indexed, default_codepage);
+	return update;
+}
+
+void serialize(writer& w, const message_index& index, const index_result& result) {
+	w.begin_object();
+
+	w.key("candidates");
+	w.unsigned_integer(result.candidates);
+
+	w.key("matches");
+	w.begin_array();
+	for (auto id : result.messages) {
+		auto message = index.message(id);
+
+		w.begin_object();
+		w.key("source");
+		w.string(index.source(message.source).path);
+		w.key("file");
+		w.string(message.file);
+		w.key("name");
+		w.string(message.name);
+		w.key("text");
+		w.string(message.text);
+		w.end_object();
+	}
+	w.end_array();
+
+	w.end_object();
+}
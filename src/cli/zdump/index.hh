@@ -0,0 +1,171 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/buffer.hh>
+
+#include <pstudio/parallel.hh>
+
+#include "writer.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A file on disk whose message blocks are stored in a message_index.
+struct indexed_source {
+	/// \brief The absolute path of the file.
+	std::string path;
+
+	/// \brief The size and modification time of the file when it was indexed, used to detect changes.
+	std::uint64_t size;
+	std::int64_t modified;
+
+	/// \brief The Windows code page the messages of the file which were not valid UTF-8 were converted from.
+	std::uint32_t codepage;
+
+	/// \brief The range of the messages of this file in the index.
+	std::uint32_t first_message;
+	std::uint32_t message_count;
+};
+
+/// \brief A message block stored in a message_index. Its strings point into the index.
+struct indexed_message {
+	std::uint32_t source;
+
+	/// \brief The path of the message file inside of the source VDF or empty if the source is the message file itself.
+	std::string_view file;
+	std::string_view name;
+	std::string_view text;
+};
+
+/// \brief A query passed to message_index::search().
+struct index_query {
+	/// \brief The text to search for or, if #regex is set, an ECMAScript regular expression.
+	std::string pattern;
+	bool regex {false};
+
+	/// \brief Whether to ignore the case of ASCII letters.
+	bool ignore_case {false};
+};
+
+/// \brief The messages found by message_index::search().
+struct index_result {
+	/// \brief The matching messages in index order.
+	std::vector<std::uint32_t> messages {};
+
+	/// \brief The number of messages which had to be compared with the query after looking up its trigrams.
+	std::size_t candidates {0};
+};
+
+/// \brief A trigram index over the names and texts of the message blocks of a set of message files and VDFs.
+///
+/// The index is a single file which is mapped into memory as a whole and never parsed. It holds every message
+/// converted to UTF-8 together with a sorted table of the trigrams found in the lower-cased messages, each with the
+/// delta-encoded list of messages it appears in. Queries intersect the lists of the trigrams of the literal text they
+/// require and only compare the remaining candidates with the query.
+class message_index {
+public:
+	/// \brief Maps an index into memory.
+	/// \param path The path of the index file.
+	/// \return The index.
+	/// \throws std::runtime_error if the file is not a message index or was written by another version of zdump.
+	static message_index open(const std::filesystem::path& path);
+
+	/// \return The code page new sources are converted from unless update_index() is given another one.
+	[[nodiscard]] std::uint32_t codepage() const noexcept {
+		return _m_codepage;
+	}
+
+	/// \return The number of sources in the index.
+	[[nodiscard]] std::uint32_t source_count() const noexcept {
+		return _m_source_count;
+	}
+
+	/// \return The number of messages in the index.
+	[[nodiscard]] std::uint32_t message_count() const noexcept {
+		return _m_message_count;
+	}
+
+	[[nodiscard]] indexed_source source(std::uint32_t index) const;
+	[[nodiscard]] indexed_message message(std::uint32_t index) const;
+
+	/// \brief Finds the messages whose name or text matches a query.
+	/// \param query The query.
+	/// \return The matching messages.
+	/// \throws std::regex_error if the query is an invalid regular expression.
+	[[nodiscard]] index_result search(const index_query& query) const;
+
+private:
+	explicit message_index(px::buffer&& buffer) : _m_buffer(std::move(buffer)) {}
+
+	[[nodiscard]] std::string_view _string(const std::byte* ref) const;
+	[[nodiscard]] std::vector<std::uint32_t> _postings(std::uint32_t trigram) const;
+
+private:
+	px::buffer _m_buffer;
+	std::uint32_t _m_codepage {0};
+	std::uint32_t _m_source_count {0};
+	std::uint32_t _m_message_count {0};
+	std::uint32_t _m_trigram_count {0};
+
+	const std::byte* _m_sources {nullptr};
+	const std::byte* _m_messages {nullptr};
+	const std::byte* _m_trigrams {nullptr};
+	const std::byte* _m_postings {nullptr};
+	const std::byte* _m_strings {nullptr};
+	std::uint64_t _m_postings_size {0};
+	std::uint64_t _m_strings_size {0};
+};
+
+/// \brief What update_index() did.
+struct index_update {
+	/// \brief The number of sources which were parsed, taken from the previous index unchanged and removed.
+	std::size_t parsed {0};
+	std::size_t reused {0};
+	std::size_t removed {0};
+
+	std::uint32_t messages {0};
+
+	/// \brief The path of each source which could not be parsed and the reason. Their previously indexed messages,
+	///        if any, are kept.
+	std::vector<std::pair<std::string, std::string>> failures {};
+};
+
+/// \return Whether update_index() can convert messages from the given Windows code page.
+bool is_supported_codepage(std::uint32_t codepage);
+
+/// \brief Creates or updates a message index.
+///
+/// The sources of the new index are the ones of the existing index at \p path, if there is one, together with the
+/// given inputs. A source is either a message file, like `OU.BIN` or `OU.CSL`, or a VDF whose message files are
+/// indexed. Sources whose size and modification time did not change are copied from the existing index instead of
+/// being parsed again, sources which no longer exist are removed. Changed sources are parsed concurrently.
+///
+/// The new index is written next to the existing one and then renamed, so searches running at the same time keep
+/// seeing the old one.
+/// \param path The path of the index file.
+/// \param inputs The paths of the sources to add or update.
+/// \param codepage The Windows code page to convert the messages of the inputs from which are not valid UTF-8.
+///                 Inputs which were indexed using another code page are parsed again, all other sources keep
+///                 theirs. It also becomes the code page of new sources added by later updates. If not given, new
+///                 sources use the one of the existing index or Windows-1252 and all others keep theirs.
+/// \param pool The threads to parse the sources on.
+/// \return The number of sources which were parsed, reused and removed.
+/// \throws std::runtime_error if the code page is not supported or the index cannot be written.
+index_update update_index(const std::filesystem::path& path,
+                          const std::vector<std::string>& inputs,
+                          std::optional<std::uint32_t> codepage,
+                          pstudio::thread_pool& pool);
+
+/// \brief Writes the messages found by a search.
+/// \param w The writer to write to.
+/// \param index The index which was searched.
+/// \param result The result of the search.
+void serialize(writer& w, const message_index& index, const index_result& result);
@@ -1,154 +1,304 @@
 // Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
 // SPDX-License-Identifier: MIT
-#include "phoenix/animation.hh"
-#include "phoenix/font.hh"
-#include "phoenix/mesh.hh"
-#include "phoenix/messages.hh"
-#include "phoenix/model_hierarchy.hh"
-#include "phoenix/model_script.hh"
-#include "phoenix/texture.hh"
 #include "phoenix/vdfs.hh"
 
+#include <pstudio/daemon.hh>
+
 #include <CLI/App.hpp>
 #include <fmt/format.h>
-#include <nlohmann/json.hpp>
 
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <regex>
+#include <set>
+#include <stdexcept>
+#include <system_error>
 
+#include "archive.hh"
+#include "arena.hh"
 #include "config.hh"
+#include "diff.hh"
 #include "dump.hh"
+#include "format.hh"
+#include "index.hh"
+#include "select.hh"
+#include "serialize.hh"
+#include "stats.hh"
 
 namespace px = phoenix;
 
-enum class file_format {
-	mdh,
-	man,
-	csl,
-	fnt,
-	msh,
-	tex,
-	mds,
-	msb,
-	mrm,
-	mdm,
-	mmb,
-	vdf,
-	unknown,
-};
-
-int dump(file_format fmt, px::buffer& in, bool bson) {
-	nlohmann::json output {};
-
-	if (fmt == file_format::mdh) {
-		output = phoenix::model_hierarchy::parse(in);
-	} else if (fmt == file_format::man) {
-		output = phoenix::animation::parse(in);
-	} else if (fmt == file_format::csl) {
-		output = phoenix::messages::parse(in);
-	} else if (fmt == file_format::fnt) {
-		output = phoenix::font::parse(in);
-	} else if (fmt == file_format::msh) {
-		output = phoenix::mesh::parse(in, {});
-	} else if (fmt == file_format::tex) {
-		output = phoenix::texture::parse(in);
-	} else if (fmt == file_format::mds) {
-		output = phoenix::model_script::parse(in);
-	} else if (fmt == file_format::msb) {
-		output = phoenix::model_script::parse(in);
-	} else if (fmt == file_format::mrm) {
-		output = phoenix::proto_mesh::parse(in);
-	} else if (fmt == file_format::mdm) {
-		output = phoenix::model_mesh::parse(in);
-	} else if (fmt == file_format::mmb) {
-		output = phoenix::morph_mesh::parse(in);
-	} else if (fmt == file_format::vdf) {
-		phoenix::Vfs vfs;
-		vfs.mount_disk(in);
-		output = vfs;
-	} else {
+int dump(file_format fmt, px::buffer& in, const output_options& options, const vob_options& vobs, bool dom) {
+	auto emit = [&options, &vobs, dom](const auto& obj) {
+		if (dom) {
+			// the document is never destroyed, its memory is freed all at once together with the arena
+			arena memory {};
+			arena::scope scope {memory};
+			const auto* output = memory.make<arena_json>(obj);
+
+			if (options.bson) {
+				auto bin = arena_json::to_bson(*output);
+				if (std::fwrite(bin.data(), 1, bin.size(), stdout) != bin.size() || std::fflush(stdout) != 0)
+					throw std::system_error(errno, std::generic_category(), "cannot write the output");
+			} else {
+				std::cout << output->dump(4, ' ', false, arena_json::error_handler_t::replace) << std::flush;
+				if (!std::cout)
+					throw std::runtime_error {"cannot write the output"};
+			}
+
+			fmt::print(stderr,
+			           "arena high-water mark: {} bytes ({} bytes reserved in {} blocks)\n",
+			           memory.high_water_mark(),
+			           memory.reserved(),
+			           memory.blocks());
+		} else if (options.paths != nullptr) {
+			auto out = make_writer(stdout, options);
+			selecting_writer selected {*out, *options.paths};
+			serialize(selected, obj, vobs);
+			out->flush();
+		} else {
+			auto out = make_writer(stdout, options);
+			serialize(*out, obj, vobs);
+			out->flush();
+		}
+	};
+
+	if (!visit_file(fmt, in, emit)) {
 		fmt::print(stderr, "format not supported");
 		return EXIT_FAILURE;
 	}
 
-	if (bson) {
-		auto bin = nlohmann::json::to_bson(output);
-		std::fwrite(bin.data(), bin.size(), 1, stdout);
-	} else {
-		std::cout << output.dump(4, ' ', false, nlohmann::json::error_handler_t::replace);
-	}
-
 	return EXIT_SUCCESS;
 }
 
-file_format detect_file_format(px::buffer&& buf) {
-	buf.mark();
-	if (buf.get_string(4) == "ZTEX")
-		return file_format::tex;
+/// \brief Parses a file into a document kept in memory.
+/// \return The document or `std::nullopt` if the format of the file is not supported.
+static std::optional<document> load_document(px::buffer& in, const output_options& options, const vob_options& vobs) {
+	document_writer out {};
 
-	buf.reset();
-	if (buf.position(256), buf.get_string(12) == "PSVDSC_V2.00")
-		return file_format::vdf;
+	auto load = [&out, &options, &vobs](const auto& obj) {
+		if (options.paths != nullptr) {
+			selecting_writer selected {out, *options.paths};
+			serialize(selected, obj, vobs);
+		} else {
+			serialize(out, obj, vobs);
+		}
+	};
 
-	buf.reset();
-	if (buf.get_ushort() == 0xD000)
-		return file_format::mdm;
+	if (!visit_file(detect_file_format(in), in, load))
+		return std::nullopt;
 
-	buf.reset();
-	if (buf.get_ushort() == 0xE000)
-		return file_format::mmb;
+	return out.take();
+}
 
-	buf.reset();
-	if (buf.get_ushort() == 0xD100)
-		return file_format::mdh;
+/// \brief Prints the JSON Patch turning the file \p a into the file \p b.
+static int print_diff(const std::optional<std::string>& vdf,
+                      const std::string& a,
+                      const std::string& b,
+                      const output_options& options,
+                      const vob_options& vobs,
+                      const diff_options& diffs) {
+	std::vector<document> documents {};
 
-	buf.reset();
-	if (buf.get_ushort() == 0xB100)
-		return file_format::mrm;
+	try {
+		std::optional<px::vdf_file> container {};
+		if (vdf)
+			container.emplace(px::vdf_file::open(*vdf));
 
-	buf.reset();
-	if (buf.get_ushort() == 0xA000)
-		return file_format::man;
+		for (const auto& path : {a, b}) {
+			auto in = px::buffer::empty();
 
-	buf.reset();
-	if (buf.get_ushort() == 0xB000)
-		return file_format::msh;
+			if (container) {
+				const auto* entry = container->find_entry(path);
+				if (entry == nullptr) {
+					fmt::print(stderr, "the file named {} was not found in the VDF {}\n", path, *vdf);
+					return EXIT_FAILURE;
+				}
 
-	buf.reset();
-	if (buf.get_ushort() == 0xF000)
-		return file_format::msb;
+				in = entry->open();
+			} else {
+				in = px::buffer::mmap(path);
+			}
 
-	buf.reset();
-	std::string line;
-	do {
-		line = buf.get_line();
+			auto doc = load_document(in, options, vobs);
+			if (!doc) {
+				fmt::print(stderr, "format of {} not supported\n", path);
+				return EXIT_FAILURE;
+			}
 
-		if (std::regex_search(line, std::regex(R"(\s*Model\s*\(\s*"[\w\d]+"\s*\))", std::regex::icase))) {
-			buf.reset();
-			return file_format::mds;
+			documents.push_back(std::move(*doc));
 		}
-	} while (line[0] == '/' || line.empty());
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "failed to parse file: {}\n", e.what());
+		return EXIT_FAILURE;
+	}
 
-	buf.reset();
-	if (buf.get_line() == "ZenGin Archive") {
-		buf.reset();
-		auto copy = buf.duplicate();
-		auto reader = phoenix::archive_reader::open(copy);
+	try {
+		auto out = make_writer(stdout, options);
+		auto count = diff(*out, documents[0], documents[1], diffs);
+		out->flush();
 
-		px::archive_object obj {};
-		if (!reader->read_object_begin(obj))
-			return file_format::unknown;
+		fmt::print(stderr, "found {} differences\n", count);
+		return EXIT_SUCCESS;
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "failed to write the differences: {}\n", e.what());
+		return EXIT_FAILURE;
+	}
+}
 
-		if (obj.class_name == "zCCSLib")
-			return file_format::csl;
+/// \brief Dumps multiple files concurrently and reports the ones which failed.
+/// \param vdf The VDF to take the files from or `std::nullopt` to read them from disk.
+/// \param names The paths of the files or, inside of a VDF, the names or patterns matching them.
+/// \param directory The directory to write one output file per file to or `std::nullopt` to write to stdout.
+static int dump_batch(const std::optional<std::string>& vdf,
+                      const std::vector<std::string>& names,
+                      const output_options& options,
+                      const vob_options& vobs,
+                      batch_format format,
+                      const std::optional<std::string>& directory,
+                      unsigned threads) {
+	std::optional<px::vdf_file> container {};
+	try {
+		if (vdf)
+			container.emplace(px::vdf_file::open(*vdf));
+	} catch (const px::error& e) {
+		fmt::print(stderr, "failed to open VDF: {}\n", e.what());
+		return EXIT_FAILURE;
 	}
 
-	buf.reset();
-	if (buf.get_line() == "1") {
-		return file_format::fnt;
+	std::vector<archive_file> files {};
+	std::size_t missing = 0;
+
+	if (container) {
+		// files matched by more than one name are only dumped once
+		std::set<const px::vdf_entry*> seen {};
+
+		for (const auto& name : names) {
+			std::vector<archive_file> found {};
+			if (is_pattern(name)) {
+				found = find_files(*container, name);
+			} else if (const auto* entry = container->find_entry(name); entry != nullptr) {
+				found.push_back({name, entry});
+			}
+
+			if (found.empty()) {
+				fmt::print(stderr, "no file in the VDF {} matches {}\n", *vdf, name);
+				++missing;
+			}
+
+			for (auto& file : found) {
+				if (seen.insert(file.entry).second)
+					files.push_back(std::move(file));
+			}
+		}
+	} else {
+		// files given more than once, e.g. as `a.zen` and `./a.zen`, are only dumped once
+		std::set<std::string> seen {};
+
+		for (const auto& name : names) {
+			std::error_code ec;
+			auto path = std::filesystem::weakly_canonical(name, ec);
+
+			if (seen.insert(ec ? name : path.string()).second)
+				files.push_back({name, nullptr});
+		}
+	}
+
+	archive_stats stats {};
+	{
+		pstudio::thread_pool pool {threads};
+		stats = directory ? dump_files(std::filesystem::path {*directory}, files, options, vobs, pool)
+		                  : dump_files(stdout, files, options, vobs, format, pool);
+	}
+
+	for (const auto& [path, error] : stats.failures) {
+		fmt::print(stderr, "failed to dump {}: {}\n", path, error);
+	}
+
+	fmt::print(stderr,
+	           "dumped {} files ({} failed, {} skipped)\n",
+	           stats.dumped + stats.failed,
+	           stats.failed,
+	           stats.skipped);
+	return stats.failed == 0 && missing == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// \brief Adds message files and VDFs to a message index or updates the ones which changed.
+static int update_message_index(const std::string& path,
+                                const std::vector<std::string>& sources,
+                                std::optional<std::uint32_t> codepage,
+                                unsigned threads) {
+	index_update update {};
+
+	try {
+		pstudio::thread_pool pool {threads};
+		update = update_index(path, sources, codepage, pool);
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "failed to update the message index: {}\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	for (const auto& [source, error] : update.failures) {
+		fmt::print(stderr, "failed to index {}: {}\n", source, error);
+	}
+
+	fmt::print(stderr,
+	           "indexed {} messages ({} sources parsed, {} unchanged, {} removed, {} failed)\n",
+	           update.messages,
+	           update.parsed,
+	           update.reused,
+	           update.removed,
+	           update.failures.size());
+	return update.failures.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/// \brief Prints the messages of a message index matching a query.
+static int search_message_index(const std::string& path, const index_query& query, const output_options& options) {
+	auto start = std::chrono::steady_clock::now();
+
+	try {
+		auto index = message_index::open(path);
+		auto result = index.search(query);
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		auto out = make_writer(stdout, options);
+		serialize(*out, index, result);
+		out->flush();
+
+		fmt::print(stderr,
+		           "found {} of {} messages in {:.1f} ms ({} candidates)\n",
+		           result.messages.size(),
+		           index.message_count(),
+		           elapsed.count(),
+		           result.candidates);
+		return EXIT_SUCCESS;
+	} catch (const std::regex_error& e) {
+		fmt::print(stderr, "invalid regular expression: {}\n", e.what());
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "failed to search the message index: {}\n", e.what());
+	}
+
+	return EXIT_FAILURE;
+}
+
+/// \brief Asks a running pstudio-daemon to dump a file of a VDF it has open.
+/// \return The exit code or `std::nullopt` if the file has to be dumped locally.
+static std::optional<int> dump_remote(const std::string& vdf, const std::string& file, bool bson) {
+	namespace proto = pstudio::daemon;
+
+	auto res = proto::forward({proto::request_type::dump, bson ? 1u : 0u, proto::archive_path(vdf), file});
+	if (!res || res->status == proto::status::not_found || res->status == proto::status::unsupported)
+		return std::nullopt;
+
+	if (res->status != proto::status::ok) {
+		fmt::print(stderr, "failed to parse file: {}\n", res->payload);
+		return EXIT_FAILURE;
 	}
 
-	return file_format::unknown;
+	std::fwrite(res->payload.data(), 1, res->payload.size(), stdout);
+	return EXIT_SUCCESS;
 }
 
 int main(int argc, char** argv) {
@@ -159,14 +309,97 @@ int main(int argc, char** argv) {
 	bool display_version {false};
 	app.add_flag("-v,--version", display_version, "print version information");
 
-	std::optional<std::string> file {};
-	app.add_option("-f,--file", file, "operate on this file from disk or a VDF if -e is specified");
+	std::vector<std::string> files {};
+	app.add_option("-f,--file",
+	               files,
+	               "operate on this file from disk or a VDF if -e is specified; may be repeated and, with -e, "
+	               "contain * and ? to match files of the VDF");
 
 	std::optional<std::string> vdf {};
 	app.add_option("-e,--vdf", vdf, "open the given file from this VDF");
 
-	bool bson {false};
-	app.add_flag("-b,--bson", bson, "dump the contents of the file as BSON");
+	output_options options {};
+	app.add_flag("-b,--bson", options.bson, "dump the contents of the file as BSON");
+
+	app.add_flag("--typed-arrays",
+	             options.typed_arrays,
+	             "write large numeric arrays as raw little-endian data (BSON binary values or --sidecar)");
+
+	std::optional<std::string> sidecar {};
+	app.add_option("--sidecar", sidecar, "write the typed arrays of JSON output to this file");
+
+	bool dom {false};
+	app.add_flag("--dom", dom, "build the whole document in memory before writing it out");
+
+	bool all {false};
+	app.add_flag("--all", all, "dump every file of the VDF given with -e, like -f '*'");
+
+	bool array {false};
+	app.add_flag("--array", array, "write the documents of multiple files as a JSON array instead of one per line");
+
+	std::optional<std::string> output_dir {};
+	app.add_option("-o,--output-dir",
+	               output_dir,
+	               "write the document of each file to a file of its own in this directory");
+
+	std::vector<std::string> selects {};
+	app.add_option("--select",
+	               selects,
+	               "only dump the values at this path, e.g. /wayNet/waypoints or /materials/*/name (may be repeated)");
+
+	vob_options vobs {};
+	app.add_option("--vob-depth",
+	               vobs.max_depth,
+	               "only dump this many levels of child VOBs below the root VOBs of a world (default: all)");
+	app.add_flag("--vob-table",
+	             vobs.table,
+	             "dump the VOBs of a world as a table with one row per VOB and the row of its parent");
+
+	std::vector<std::string> stats {};
+	app.add_option("--stats", stats, "print statistics about every file of these VDFs as a single document");
+
+	std::vector<std::string> diff_inputs {};
+	app.add_option("--diff", diff_inputs, "print a JSON Patch which turns the first of these two files into the second")
+	    ->expected(2);
+
+	diff_options diffs {};
+	app.add_option("--epsilon",
+	               diffs.epsilon,
+	               "treat numbers as equal in --diff if they differ by at most this much (default: 0.00001)");
+
+	std::optional<std::string> index {};
+	app.add_option("--index", index, "the message index to update with --update-index or to search");
+
+	bool update_messages {false};
+	app.add_flag("--update-index",
+	             update_messages,
+	             "add the message files and VDFs given with -f to the index or update the ones which changed");
+
+	std::optional<std::string> search {};
+	app.add_option("--search", search, "print the messages of the index whose name or text contains this text");
+
+	std::optional<std::string> search_regex {};
+	app.add_option("--regex",
+	               search_regex,
+	               "print the messages of the index whose name or text matches this ECMAScript regular expression");
+
+	bool ignore_case {false};
+	app.add_flag("--ignore-case", ignore_case, "ignore the case of ASCII letters when searching the index");
+
+	std::optional<std::uint32_t> codepage {};
+	app.add_option("--codepage",
+	               codepage,
+	               "convert the messages of the files given with -f which are not UTF-8 from this Windows code page "
+	               "(1250, 1251 or 1252) when indexing them; by default, indexed files keep theirs and new ones use "
+	               "the one given last or 1252");
+
+	bool no_daemon {false};
+	app.add_flag("--no-daemon", no_daemon, "do not forward requests to a running pstudio-daemon");
+
+	unsigned threads {0};
+	app.add_option("-j,--threads",
+	               threads,
+	               "use this many threads for multiple files and --stats or one per CPU core if 0 (the default)");
 
 	CLI11_PARSE(app, argc, argv);
 
@@ -175,29 +408,180 @@ int main(int argc, char** argv) {
 		return EXIT_SUCCESS;
 	}
 
-	if (!file) {
+	if (!selects.empty() && dom) {
+		fmt::print(stderr, "--select cannot be combined with --dom\n");
+		return EXIT_FAILURE;
+	}
+
+	if ((vobs.max_depth >= 0 || vobs.table) && dom) {
+		fmt::print(stderr, "--vob-depth and --vob-table cannot be combined with --dom\n");
+		return EXIT_FAILURE;
+	}
+
+	selection paths {};
+	try {
+		for (const auto& path : selects) {
+			paths.add(path);
+		}
+	} catch (const std::invalid_argument& e) {
+		fmt::print(stderr, "invalid --select: {}\n", e.what());
+		return EXIT_FAILURE;
+	}
+
+	if (!selects.empty())
+		options.paths = &paths;
+
+	if (!stats.empty()) {
+		if (dom || all) {
+			fmt::print(stderr, "--stats cannot be combined with --dom or --all\n");
+			return EXIT_FAILURE;
+		}
+
+		try {
+			pstudio::thread_pool pool {threads};
+			auto report = collect_statistics(stats, pool);
+
+			auto out = make_writer(stdout, options);
+			serialize(*out, report);
+			out->flush();
+			fmt::print(stderr,
+			           "read {} files ({} failed, {} skipped)\n",
+			           report.files,
+			           report.failed,
+			           report.skipped);
+			return EXIT_SUCCESS;
+		} catch (const px::error& e) {
+			fmt::print(stderr, "failed to open VDF: {}\n", e.what());
+			return EXIT_FAILURE;
+		} catch (const std::exception& e) {
+			fmt::print(stderr, "failed to collect statistics: {}\n", e.what());
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (!diff_inputs.empty()) {
+		if (dom || all || options.bson || options.typed_arrays) {
+			fmt::print(stderr, "--diff cannot be combined with --dom, --all, --bson or --typed-arrays\n");
+			return EXIT_FAILURE;
+		}
+
+		return print_diff(vdf, diff_inputs[0], diff_inputs[1], options, vobs, diffs);
+	}
+
+	if (index || update_messages || search || search_regex) {
+		if (!index) {
+			fmt::print(stderr, "--update-index, --search and --regex require an index to be given using --index\n");
+			return EXIT_FAILURE;
+		}
+
+		if (int {update_messages} + int {search.has_value()} + int {search_regex.has_value()} != 1) {
+			fmt::print(stderr, "--index requires exactly one of --update-index, --search or --regex\n");
+			return EXIT_FAILURE;
+		}
+
+		if (!update_messages) {
+			index_query query {search ? *search : *search_regex, search_regex.has_value(), ignore_case};
+			return search_message_index(*index, query, options);
+		}
+
+		if (vdf) {
+			fmt::print(stderr, "--update-index reads message files and VDFs from disk and cannot be used with -e\n");
+			return EXIT_FAILURE;
+		}
+
+		if (codepage && !is_supported_codepage(*codepage)) {
+			fmt::print(stderr, "unsupported code page {}\n", *codepage);
+			return EXIT_FAILURE;
+		}
+
+		return update_message_index(*index, files, codepage, threads);
+	}
+
+	auto patterns = vdf && std::any_of(files.begin(), files.end(), [](const auto& name) { return is_pattern(name); });
+	if (all || array || output_dir || patterns || files.size() > 1) {
+		if (all && !vdf) {
+			fmt::print(stderr, "--all requires a VDF to be specified using -e\n");
+			return EXIT_FAILURE;
+		}
+
+		if (dom) {
+			fmt::print(stderr, "--dom cannot be used with multiple files\n");
+			return EXIT_FAILURE;
+		}
+
+		if (options.typed_arrays && !options.bson) {
+			fmt::print(stderr, "multiple files only support --typed-arrays for BSON output\n");
+			return EXIT_FAILURE;
+		}
+
+		if (array && (options.bson || output_dir)) {
+			fmt::print(stderr, "--array cannot be combined with --bson or --output-dir\n");
+			return EXIT_FAILURE;
+		}
+
+		if (all)
+			files.emplace_back("*");
+
+		auto format = array ? batch_format::array : batch_format::lines;
+		return dump_batch(vdf, files, options, vobs, format, output_dir, threads);
+	}
+
+	if (files.empty()) {
 		fmt::print(stderr, "no input file specified\n");
 		return EXIT_FAILURE;
 	}
 
+	const auto& file = files.front();
+
+	if (options.typed_arrays && dom) {
+		fmt::print(stderr, "--typed-arrays cannot be combined with --dom\n");
+		return EXIT_FAILURE;
+	}
+
+	std::unique_ptr<std::FILE, decltype(&std::fclose)> sidecar_file {nullptr, &std::fclose};
+	if (options.typed_arrays && !options.bson) {
+		if (!sidecar) {
+			fmt::print(stderr, "--typed-arrays requires --sidecar for JSON output\n");
+			return EXIT_FAILURE;
+		}
+
+		sidecar_file.reset(std::fopen(sidecar->c_str(), "wb"));
+		if (sidecar_file == nullptr) {
+			fmt::print(stderr, "cannot open sidecar file {}\n", *sidecar);
+			return EXIT_FAILURE;
+		}
+
+		options.sidecar = sidecar_file.get();
+	}
+
+	// only plain dumps are forwarded since the daemon does not know about any of the other options
+	auto plain = !dom && !options.typed_arrays && options.paths == nullptr && vobs.max_depth < 0 && !vobs.table;
+	if (vdf && plain && !no_daemon) {
+		if (auto result = dump_remote(*vdf, file, options.bson))
+			return *result;
+	}
+
 	try {
 		auto in = px::buffer::empty();
 
 		if (vdf) {
 			const auto container = px::vdf_file::open(*vdf);
-			if (const auto* entry = container.find_entry(*file); entry != nullptr) {
+			if (const auto* entry = container.find_entry(file); entry != nullptr) {
 				in = entry->open();
 			} else {
-				fmt::print(stderr, "the file named {} was not found in the VDF {}", *file, *vdf);
+				fmt::print(stderr, "the file named {} was not found in the VDF {}", file, *vdf);
 				return EXIT_FAILURE;
 			}
 		} else {
-			in = phoenix::buffer::mmap(*file);
+			in = phoenix::buffer::mmap(file);
 		}
 
-		return dump(detect_file_format(in.duplicate()), in, bson);
+		return dump(detect_file_format(in), in, options, vobs, dom);
 	} catch (const px::parser_error& e) {
-		fmt::print(stderr, "failed to parse file: {}", e.what());
+		fmt::print(stderr, "failed to parse file: {}\n", e.what());
+		return EXIT_FAILURE;
+	} catch (const std::exception& e) {
+		fmt::print(stderr, "failed to dump file: {}\n", e.what());
 		return EXIT_FAILURE;
 	}
 
@@ -0,0 +1,250 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "select.hh"
+
+#include <charconv>
+#include <stdexcept>
+
+const selection::node* selection::node::find(std::string_view segment) const {
+	if (auto it = children.find(segment); it != children.end())
+		return &it->second;
+
+	if (auto it = children.find("*"); it != children.end())
+		return &it->second;
+
+	return nullptr;
+}
+
+/// \brief Adds the remaining segments of a path below a node.
+///
+/// find() returns an exact child in favour of the `*` child, so everything selected through `*` is added to every
+/// exact sibling as well and new exact children start out as a copy of their `*` sibling.
+static void insert(selection::node& node, const std::vector<std::string>& segments, std::size_t i) {
+	if (i == segments.size()) {
+		node.selected = true;
+		return;
+	}
+
+	if (segments[i] == "*") {
+		for (auto& [name, child] : node.children) {
+			if (name != "*")
+				insert(child, segments, i + 1);
+		}
+
+		insert(node.children["*"], segments, i + 1);
+		return;
+	}
+
+	auto [it, inserted] = node.children.try_emplace(segments[i]);
+	if (auto wildcard = node.children.find("*"); inserted && wildcard != node.children.end())
+		it->second = wildcard->second;
+
+	insert(it->second, segments, i + 1);
+}
+
+void selection::add(std::string_view path) {
+	if (path.empty()) {
+		_m_root.selected = true;
+		return;
+	}
+
+	if (path[0] != '/')
+		throw std::invalid_argument {"paths must start with a '/': " + std::string {path}};
+
+	std::vector<std::string> segments {};
+	path.remove_prefix(1);
+
+	for (;;) {
+		auto end = path.find('/');
+		auto escaped = path.substr(0, end);
+
+		// JSON pointer escapes
+		auto& segment = segments.emplace_back();
+		for (std::size_t i = 0; i < escaped.size(); ++i) {
+			if (escaped[i] == '~' && i + 1 < escaped.size() && (escaped[i + 1] == '0' || escaped[i + 1] == '1')) {
+				segment.push_back(escaped[++i] == '0' ? '~' : '/');
+			} else {
+				segment.push_back(escaped[i]);
+			}
+		}
+
+		if (end == std::string_view::npos)
+			break;
+
+		path.remove_prefix(end + 1);
+	}
+
+	insert(_m_root, segments, 0);
+}
+
+selecting_writer::selecting_writer(writer& out, const selection& paths) : _m_out(out), _m_paths(paths) {}
+
+bool selecting_writer::select(std::string_view name) {
+	if (_m_skip_depth > 0 || _m_frames.empty())
+		return _m_skip_depth == 0;
+
+	return _select(name);
+}
+
+bool selecting_writer::select(std::size_t index) {
+	if (_m_skip_depth > 0 || _m_frames.empty())
+		return _m_skip_depth == 0;
+
+	_m_frames.back().index = index;
+	return _select_element(index);
+}
+
+void selecting_writer::begin_object() {
+	_begin_container(false);
+}
+
+void selecting_writer::end_object() {
+	if (_end_container())
+		_m_out.end_object();
+}
+
+void selecting_writer::begin_array() {
+	_begin_container(true);
+}
+
+void selecting_writer::end_array() {
+	if (_end_container())
+		_m_out.end_array();
+}
+
+void selecting_writer::key(std::string_view name) {
+	if (_m_skip_depth > 0)
+		return;
+
+	if (_select(name))
+		_m_out.key(name);
+}
+
+void selecting_writer::null() {
+	if (_accept())
+		_m_out.null();
+}
+
+void selecting_writer::boolean(bool value) {
+	if (_accept())
+		_m_out.boolean(value);
+}
+
+void selecting_writer::integer(std::int64_t value) {
+	if (_accept())
+		_m_out.integer(value);
+}
+
+void selecting_writer::unsigned_integer(std::uint64_t value) {
+	if (_accept())
+		_m_out.unsigned_integer(value);
+}
+
+void selecting_writer::number(float value) {
+	if (_accept())
+		_m_out.number(value);
+}
+
+void selecting_writer::number(double value) {
+	if (_accept())
+		_m_out.number(value);
+}
+
+void selecting_writer::string(std::string_view value) {
+	if (_accept())
+		_m_out.string(value);
+}
+
+bool selecting_writer::binary_array(const typed_array& array) {
+	if (_m_skip_depth > 0)
+		return true;
+
+	auto index = _m_frames.empty() ? 0 : _m_frames.back().index;
+	if (!_accept())
+		return true;
+
+	// arrays which are only partially selected are written element by element so they can be filtered
+	if (_m_next == nullptr && _m_out.binary_array(array))
+		return true;
+
+	// the caller writes the elements one by one instead, so the array has to be accepted again
+	if (!_m_frames.empty() && _m_frames.back().array)
+		_m_frames.back().index = index;
+	return false;
+}
+
+void selecting_writer::flush() {
+	_m_out.flush();
+}
+
+std::string selecting_writer::release() {
+	return _m_out.release();
+}
+
+bool selecting_writer::_select(std::string_view segment) {
+	const auto* parent = _m_frames.back().node;
+
+	if (parent == nullptr) {
+		_m_selected = true;
+		_m_next = nullptr;
+		return true;
+	}
+
+	const auto* child = parent->find(segment);
+	_m_selected = child != nullptr;
+	_m_next = child == nullptr || child->selected ? nullptr : child;
+	return _m_selected;
+}
+
+bool selecting_writer::_select_element(std::size_t index) {
+	if (_m_frames.back().node == nullptr)
+		return _select({});
+
+	char buffer[24];
+	auto result = std::to_chars(std::begin(buffer), std::end(buffer), index);
+	return _select({buffer, static_cast<std::size_t>(result.ptr - buffer)});
+}
+
+bool selecting_writer::_accept() {
+	if (_m_skip_depth > 0)
+		return false;
+
+	if (_m_frames.empty()) {
+		const auto& root = _m_paths.root();
+		_m_next = root.selected ? nullptr : &root;
+		return true;
+	}
+
+	// members were decided by key(), elements are decided by their position
+	if (auto& parent = _m_frames.back(); parent.array) {
+		_select_element(parent.index);
+		++parent.index;
+	}
+
+	return _m_selected;
+}
+
+void selecting_writer::_begin_container(bool array) {
+	if (!_accept()) {
+		++_m_skip_depth;
+		return;
+	}
+
+	_m_frames.push_back({_m_next, array, 0});
+
+	if (array) {
+		_m_out.begin_array();
+	} else {
+		_m_out.begin_object();
+	}
+}
+
+bool selecting_writer::_end_container() {
+	if (_m_skip_depth > 0) {
+		--_m_skip_depth;
+		return false;
+	}
+
+	_m_frames.pop_back();
+	return true;
+}
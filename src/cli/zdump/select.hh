@@ -0,0 +1,103 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "writer.hh"
+
+/// \brief A set of paths into a document, each selecting a subtree to include in the output.
+///
+/// Paths are written like JSON pointers, e.g. `/wayNet/waypoints` or `/mesh/materials/0/name`. Segments are matched
+/// against member names and array indices; a segment `*` matches any member or element.
+class selection {
+public:
+	struct node {
+		std::map<std::string, node, std::less<>> children {};
+
+		/// \brief Whether the whole subtree rooted at this node is selected.
+		bool selected {false};
+
+		/// \brief Finds the child matching the given member name or array index.
+		///
+		/// A child named after the segment is preferred over the `*` child. It includes everything selected through
+		/// the `*` child as well.
+		[[nodiscard]] const node* find(std::string_view segment) const;
+	};
+
+	/// \brief Adds a path to the selection.
+	/// \param path The path to add. An empty path selects the whole document.
+	/// \throws std::invalid_argument if the path does not start with a `/`.
+	void add(std::string_view path);
+
+	[[nodiscard]] const node& root() const noexcept {
+		return _m_root;
+	}
+
+private:
+	node _m_root {};
+};
+
+/// \brief Passes only the selected parts of a document on to another writer.
+///
+/// Serializers ask select() before producing a member or element, so unselected subtrees are never visited. Values
+/// written without asking are filtered as well. Objects and arrays on the way to a selected value are kept, thus the
+/// output has the same structure as the full document with all unselected members and elements removed.
+class selecting_writer final : public writer {
+public:
+	/// \param out The writer to pass the selected values to.
+	/// \param paths The paths to pass on. Must outlive the writer.
+	selecting_writer(writer& out, const selection& paths);
+
+	bool select(std::string_view name) override;
+	bool select(std::size_t index) override;
+
+	void begin_object() override;
+	void end_object() override;
+	void begin_array() override;
+	void end_array() override;
+	void key(std::string_view name) override;
+
+	void null() override;
+	void boolean(bool value) override;
+	void integer(std::int64_t value) override;
+	void unsigned_integer(std::uint64_t value) override;
+	void number(float value) override;
+	void number(double value) override;
+	void string(std::string_view value) override;
+	bool binary_array(const typed_array& array) override;
+
+	void flush() override;
+	[[nodiscard]] std::string release() override;
+
+private:
+	struct frame {
+		/// \brief The selection of the container's children or `nullptr` if all of them are selected.
+		const selection::node* node;
+		bool array;
+		std::size_t index;
+	};
+
+	bool _select(std::string_view segment);
+	bool _select_element(std::size_t index);
+	bool _accept();
+	void _begin_container(bool array);
+	bool _end_container();
+
+private:
+	writer& _m_out;
+	const selection& _m_paths;
+	std::vector<frame> _m_frames {};
+
+	/// \brief Whether the next value is selected.
+	bool _m_selected {false};
+
+	/// \brief The selection of the next value's children or `nullptr` if all of them are selected.
+	const selection::node* _m_next {nullptr};
+
+	/// \brief The number of containers opened since the value currently being discarded started.
+	std::size_t _m_skip_depth {0};
+};
@@ -0,0 +1,1755 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "serialize.hh"
+#include "dump.hh"
+
+#include <phoenix/vobs/camera.hh>
+#include <phoenix/vobs/light.hh>
+#include <phoenix/vobs/misc.hh>
+#include <phoenix/vobs/mob.hh>
+#include <phoenix/vobs/sound.hh>
+#include <phoenix/vobs/trigger.hh>
+#include <phoenix/vobs/zone.hh>
+
+#include <algorithm>
+#include <set>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Overloads are found through the `writer` argument, so the templates below resolve to functions declared after them.
+
+template <typename T, std::enable_if_t<std::is_arithmetic_v<T> || std::is_enum_v<T>, int> = 0>
+static void serialize(writer& w, T value) {
+	if constexpr (std::is_enum_v<T>) {
+		serialize(w, static_cast<std::underlying_type_t<T>>(value));
+	} else if constexpr (std::is_same_v<T, bool>) {
+		w.boolean(value);
+	} else if constexpr (std::is_floating_point_v<T>) {
+		w.number(value);
+	} else if constexpr (std::is_signed_v<T>) {
+		w.integer(value);
+	} else {
+		w.unsigned_integer(value);
+	}
+}
+
+static void serialize(writer& w, std::string_view value) {
+	w.string(value);
+}
+
+template <std::size_t N>
+static void serialize(writer& w, const char (&value)[N]) {
+	w.string(value);
+}
+
+/// \brief Writes an array of the given values, skipping the ones the writer does not select.
+template <typename Iterator>
+static void serialize_elements(writer& w, Iterator begin, Iterator end) {
+	w.begin_array();
+	std::size_t index = 0;
+	for (auto it = begin; it != end; ++it, ++index) {
+		if (w.select(index))
+			serialize(w, *it);
+	}
+	w.end_array();
+}
+
+template <typename T, typename Allocator>
+static void serialize(writer& w, const std::vector<T, Allocator>& values) {
+	serialize_elements(w, std::begin(values), std::end(values));
+}
+
+template <typename T, typename Compare>
+static void serialize(writer& w, const std::set<T, Compare>& values) {
+	serialize_elements(w, std::begin(values), std::end(values));
+}
+
+template <typename T, std::size_t N>
+static void serialize(writer& w, const T (&values)[N]) {
+	serialize_elements(w, std::begin(values), std::end(values));
+}
+
+/// \brief Writes a single member of an object.
+template <typename T>
+static void field(writer& w, std::string_view name, const T& value) {
+	if (!w.select(name))
+		return;
+
+	w.key(name);
+	serialize(w, value);
+}
+
+/// \brief Describes the memory layout of types which consist of numbers of a single type only.
+template <typename T>
+struct array_traits;
+
+template <typename Element, array_type Type, std::size_t Components>
+struct array_layout {
+	using element = Element;
+	static constexpr array_type type = Type;
+	static constexpr std::size_t components = Components;
+	static constexpr const std::string_view* fields = nullptr;
+};
+
+template <>
+struct array_traits<std::uint16_t> : array_layout<std::uint16_t, array_type::uint16, 1> {};
+
+template <>
+struct array_traits<std::int32_t> : array_layout<std::int32_t, array_type::int32, 1> {};
+
+template <>
+struct array_traits<std::uint32_t> : array_layout<std::uint32_t, array_type::uint32, 1> {};
+
+template <>
+struct array_traits<std::uint64_t> : array_layout<std::uint64_t, array_type::uint64, 1> {};
+
+template <>
+struct array_traits<float> : array_layout<float, array_type::float32, 1> {};
+
+template <>
+struct array_traits<glm::vec3> : array_layout<float, array_type::float32, 3> {
+	static constexpr std::string_view fields[] = {"/x", "/y", "/z"};
+};
+
+template <>
+struct array_traits<px::triangle> : array_layout<std::uint16_t, array_type::uint16, 3> {
+	static constexpr std::string_view fields[] = {"/wedges/0", "/wedges/1", "/wedges/2"};
+};
+
+template <>
+struct array_traits<px::triangle_edge> : array_layout<std::uint16_t, array_type::uint16, 3> {
+	static constexpr std::string_view fields[] = {"/edges/0", "/edges/1", "/edges/2"};
+};
+
+template <>
+struct array_traits<px::edge> : array_layout<std::uint16_t, array_type::uint16, 2> {
+	static constexpr std::string_view fields[] = {"/edges/0", "/edges/1"};
+};
+
+// the position followed by the rotation in glm's default quaternion order: x, y, z, w
+template <>
+struct array_traits<px::animation_sample> : array_layout<float, array_type::float32, 7> {
+	static constexpr std::string_view fields[] = {
+	    "/position/x",
+	    "/position/y",
+	    "/position/z",
+	    "/rotation/x",
+	    "/rotation/y",
+	    "/rotation/z",
+	    "/rotation/w",
+	};
+};
+
+/// \brief Writes a member holding a large array of numbers, as a single binary value if the writer supports it.
+template <typename T>
+static void array_field(writer& w, std::string_view name, const std::vector<T>& values) {
+	using traits = array_traits<T>;
+	static_assert(sizeof(T) == sizeof(typename traits::element) * traits::components, "T must not contain padding");
+
+	if (!w.select(name))
+		return;
+
+	w.key(name);
+	if (!w.binary_array({traits::type, values.data(), values.size(), traits::components, traits::fields}))
+		serialize(w, values);
+}
+
+static void serialize(writer& w, const glm::vec2& obj) {
+	w.begin_object();
+	field(w, "x", obj.x);
+	field(w, "y", obj.y);
+	w.end_object();
+}
+
+static void serialize(writer& w, const glm::vec3& obj) {
+	w.begin_object();
+	field(w, "x", obj.x);
+	field(w, "y", obj.y);
+	field(w, "z", obj.z);
+	w.end_object();
+}
+
+static void serialize(writer& w, const glm::vec4& obj) {
+	w.begin_object();
+	field(w, "x", obj.x);
+	field(w, "y", obj.y);
+	field(w, "z", obj.z);
+	field(w, "w", obj.w);
+	w.end_object();
+}
+
+static void serialize(writer& w, const glm::quat& obj) {
+	w.begin_object();
+	field(w, "x", obj.x);
+	field(w, "y", obj.y);
+	field(w, "z", obj.z);
+	field(w, "w", obj.w);
+	w.end_object();
+}
+
+static void serialize(writer& w, const glm::mat4x4& obj) {
+	w.begin_array();
+	for (int i = 0; i < 4; ++i) {
+		serialize(w, obj[i]);
+	}
+	w.end_array();
+}
+
+static void serialize(writer& w, const glm::mat3x3& obj) {
+	w.begin_array();
+	for (int i = 0; i < 3; ++i) {
+		serialize(w, obj[i]);
+	}
+	w.end_array();
+}
+
+static void serialize(writer& w, const glm::u8vec4& obj) {
+	w.begin_object();
+	field(w, "r", obj.r);
+	field(w, "g", obj.g);
+	field(w, "b", obj.b);
+	field(w, "a", obj.a);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::glyph& obj) {
+	w.begin_object();
+	field(w, "width", obj.width);
+	field(w, "uv", obj.uv);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::font& obj) {
+	w.begin_object();
+	field(w, "type", "font");
+	field(w, "name", obj.name);
+	field(w, "height", obj.height);
+	field(w, "glyphs", obj.glyphs);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::message_block& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+
+	if (w.select("message")) {
+		w.key("message");
+		w.begin_object();
+		field(w, "type", obj.message.type);
+		field(w, "name", obj.message.name);
+		field(w, "text", obj.message.text);
+		w.end_object();
+	}
+
+	w.end_object();
+}
+
+void serialize(writer& w, const px::messages& obj) {
+	w.begin_object();
+	field(w, "type", "messages");
+	field(w, "blocks", obj.blocks);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::bounding_box& obj) {
+	w.begin_object();
+	field(w, "min", obj.min);
+	field(w, "max", obj.max);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::obb& obj) {
+	w.begin_object();
+	field(w, "center", obj.center);
+	field(w, "axes", obj.axes);
+	field(w, "halfWidth", obj.half_width);
+	field(w, "children", obj.children);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::date& obj) {
+	w.begin_object();
+	field(w, "year", obj.year);
+	field(w, "month", obj.month);
+	field(w, "day", obj.day);
+	field(w, "hour", obj.hour);
+	field(w, "minute", obj.minute);
+	field(w, "second", obj.second);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::animation_sample& obj) {
+	w.begin_object();
+	field(w, "position", obj.position);
+	field(w, "rotation", obj.rotation);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::animation_event& obj) {
+	w.begin_object();
+	field(w, "type", obj.type);
+	field(w, "no", obj.no);
+	field(w, "tag", obj.tag);
+	field(w, "content", obj.content);
+	field(w, "values", obj.values);
+	field(w, "probability", obj.probability);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::animation& obj) {
+	w.begin_object();
+	field(w, "type", "animation");
+	field(w, "name", obj.name);
+	field(w, "next", obj.next);
+	field(w, "layer", obj.layer);
+	field(w, "frameCount", obj.frame_count);
+	field(w, "nodeCount", obj.node_count);
+	field(w, "fps", obj.fps);
+	field(w, "fpsSource", obj.fps_source);
+	field(w, "samplePositionRangeMin", obj.sample_position_range_min);
+	field(w, "samplePositionScalar", obj.sample_position_scalar);
+	field(w, "bbox", obj.bbox);
+	field(w, "checksum", obj.checksum);
+	field(w, "sourcePath", obj.source_path);
+	field(w, "sourceScript", obj.source_script);
+	array_field(w, "samples", obj.samples);
+	field(w, "events", obj.events);
+	array_field(w, "nodeIndices", obj.node_indices);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::model_hierarchy_node& obj) {
+	w.begin_object();
+	field(w, "parentIndex", obj.parent_index);
+	field(w, "name", obj.name);
+	field(w, "transform", obj.transform);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::model_hierarchy& obj) {
+	w.begin_object();
+	field(w, "type", "hierarchy");
+	field(w, "nodes", obj.nodes);
+	field(w, "bbox", obj.bbox);
+	field(w, "collisionBbox", obj.collision_bbox);
+	field(w, "rootTranslation", obj.root_translation);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::texture& obj) {
+	w.begin_object();
+	field(w, "format", obj.format());
+	field(w, "width", obj.width());
+	field(w, "height", obj.height());
+	field(w, "referenceWidth", obj.ref_width());
+	field(w, "referenceHeight", obj.ref_height());
+	field(w, "mipmapCount", obj.mipmaps());
+	field(w, "averageColor", obj.average_color());
+	w.end_object();
+}
+
+static void serialize(writer& w, px::material_group obj) {
+	switch (obj) {
+	case px::material_group::undefined:
+		return w.string("undefined");
+	case px::material_group::metal:
+		return w.string("metal");
+	case px::material_group::stone:
+		return w.string("stone");
+	case px::material_group::wood:
+		return w.string("wood");
+	case px::material_group::earth:
+		return w.string("earth");
+	case px::material_group::water:
+		return w.string("water");
+	case px::material_group::snow:
+		return w.string("snow");
+	case px::material_group::none:
+		return w.string("none");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::animation_mapping_mode obj) {
+	switch (obj) {
+	case px::animation_mapping_mode::none:
+		return w.string("none");
+	case px::animation_mapping_mode::linear:
+		return w.string("linear");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::wave_mode_type obj) {
+	switch (obj) {
+	case px::wave_mode_type::none:
+		return w.string("none");
+	case px::wave_mode_type::ambient_ground:
+		return w.string("ambientGround");
+	case px::wave_mode_type::ground:
+		return w.string("ground");
+	case px::wave_mode_type::ambient_wall:
+		return w.string("ambientWall");
+	case px::wave_mode_type::wall:
+		return w.string("wall");
+	case px::wave_mode_type::env:
+		return w.string("env");
+	case px::wave_mode_type::ambient_wind:
+		return w.string("ambientWind");
+	case px::wave_mode_type::wind:
+		return w.string("wind");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::wave_speed_type obj) {
+	switch (obj) {
+	case px::wave_speed_type::none:
+		return w.string("none");
+	case px::wave_speed_type::slow:
+		return w.string("slow");
+	case px::wave_speed_type::normal:
+		return w.string("normal");
+	case px::wave_speed_type::fast:
+		return w.string("fast");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::alpha_function obj) {
+	switch (obj) {
+	case px::alpha_function::default_:
+		return w.string("default");
+	case px::alpha_function::none:
+		return w.string("none");
+	case px::alpha_function::blend:
+		return w.string("blend");
+	case px::alpha_function::add:
+		return w.string("add");
+	case px::alpha_function::sub:
+		return w.string("sub");
+	case px::alpha_function::mul:
+		return w.string("mul");
+	case px::alpha_function::mul2:
+		return w.string("mul2");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, const px::material& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "group", obj.group);
+	field(w, "color", obj.color);
+	field(w, "smoothAngle", obj.smooth_angle);
+	field(w, "texture", obj.texture);
+	field(w, "textureScale", obj.texture_scale);
+	field(w, "textureAnimFps", obj.texture_anim_fps);
+	field(w, "textureAnimMapMode", obj.texture_anim_map_mode);
+	field(w, "textureAnimMapDir", obj.texture_anim_map_dir);
+	field(w, "disableCollision", obj.disable_collision);
+	field(w, "disableLightmap", obj.disable_lightmap);
+	field(w, "dontCollapse", obj.dont_collapse);
+	field(w, "detailObject", obj.detail_object);
+	field(w, "detailTextureScale", obj.detail_texture_scale);
+	field(w, "forceOccluder", obj.force_occluder);
+	field(w, "environmentMapping", obj.environment_mapping);
+	field(w, "environmentMappingStrength", obj.environment_mapping_strength);
+	field(w, "waveMode", obj.wave_mode);
+	field(w, "waveSpeed", obj.wave_speed);
+	field(w, "waveMaxAmplitude", obj.wave_max_amplitude);
+	field(w, "waveGridSize", obj.wave_grid_size);
+	field(w, "ignoreSun", obj.ignore_sun);
+	field(w, "alphaFunc", obj.alpha_func);
+	field(w, "defaultMapping", obj.default_mapping);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::vertex_feature& obj) {
+	w.begin_object();
+	field(w, "texture", obj.texture);
+	field(w, "light", obj.light);
+	field(w, "normal", obj.normal);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::light_map& obj) {
+	w.begin_object();
+	field(w, "image", *obj.image);
+	field(w, "normals", obj.normals);
+	field(w, "origin", obj.origin);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::polygon_flags& obj) {
+	w.begin_object();
+	field(w, "isPortal", obj.is_portal);
+	field(w, "isOcclude", obj.is_occluder);
+	field(w, "isSector", obj.is_sector);
+	field(w, "shouldRelight", obj.should_relight);
+	field(w, "isOutdoor", obj.is_outdoor);
+	field(w, "isGhostOccluder", obj.is_ghost_occluder);
+	field(w, "isDynamicallyLit", obj.is_dynamically_lit);
+	field(w, "sectorIndex", obj.sector_index);
+	field(w, "isLod", obj.is_lod);
+	field(w, "normalAxis", obj.normal_axis);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::polygon_list& obj) {
+	w.begin_object();
+	array_field(w, "materialIndices", obj.material_indices);
+	array_field(w, "lightmapIndices", obj.lightmap_indices);
+	array_field(w, "featureIndices", obj.feature_indices);
+	array_field(w, "vertexIndices", obj.vertex_indices);
+	field(w, "flags", obj.flags);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::mesh& obj) {
+	w.begin_object();
+	field(w, "date", obj.date);
+	field(w, "name", obj.name);
+	field(w, "bbox", obj.bbox);
+	field(w, "obb", obj.obb);
+	field(w, "materials", obj.materials);
+	array_field(w, "vertices", obj.vertices);
+	field(w, "features", obj.features);
+	field(w, "lightmaps", obj.lightmaps);
+	field(w, "polygons", obj.polygons);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::way_point& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "waterDepth", obj.water_depth);
+	field(w, "underWater", obj.under_water);
+	field(w, "position", obj.position);
+	field(w, "direction", obj.direction);
+	field(w, "freePoint", obj.free_point);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::way_edge& obj) {
+	w.begin_object();
+	field(w, "a", obj.a);
+	field(w, "b", obj.b);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::way_net& obj) {
+	w.begin_object();
+	field(w, "waypoints", obj.waypoints);
+	field(w, "edges", obj.edges);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::bsp_sector& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	array_field(w, "nodeIndices", obj.node_indices);
+	field(w, "portalPolygonIndices", obj.portal_polygon_indices);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::bsp_node& obj) {
+	w.begin_object();
+	field(w, "plane", obj.plane);
+	field(w, "bbox", obj.bbox);
+	field(w, "polygonIndex", obj.polygon_index);
+	field(w, "polygonCount", obj.polygon_count);
+	field(w, "frontIndex", obj.front_index);
+	field(w, "backIndex", obj.back_index);
+	field(w, "parentIndex", obj.parent_index);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::bsp_tree& obj) {
+	w.begin_object();
+	field(w, "mode", obj.mode == px::bsp_tree_mode::indoor ? "indoor" : "outdoor");
+	array_field(w, "leafPolygons", obj.leaf_polygons);
+	array_field(w, "lightPoints", obj.light_points);
+	field(w, "sectors", obj.sectors);
+	field(w, "portalPolygonIndices", obj.portal_polygon_indices);
+	field(w, "nodes", obj.nodes);
+	array_field(w, "leafNodeIndices", obj.leaf_node_indices);
+	w.end_object();
+}
+
+static void serialize(writer& w, px::visual_type obj) {
+	switch (obj) {
+	case px::visual_type::decal:
+		return w.string("decal");
+	case px::visual_type::mesh:
+		return w.string("mesh");
+	case px::visual_type::proto_mesh:
+		return w.string("protoMesh");
+	case px::visual_type::particle_system:
+		return w.string("particleSystem");
+	case px::visual_type::ai_camera:
+		return w.string("aiCamera");
+	case px::visual_type::model:
+		return w.string("model");
+	case px::visual_type::morph_mesh:
+		return w.string("morphMesh");
+	case px::visual_type::unknown:
+		return w.string("unknown");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::sprite_alignment obj) {
+	switch (obj) {
+	case px::sprite_alignment::none:
+		return w.string("none");
+	case px::sprite_alignment::yaw:
+		return w.string("yaw");
+	case px::sprite_alignment::full:
+		return w.string("full");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::shadow_mode obj) {
+	switch (obj) {
+	case px::shadow_mode::none:
+		return w.string("none");
+	case px::shadow_mode::blob:
+		return w.string("blob");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::animation_mode obj) {
+	switch (obj) {
+	case px::animation_mode::none:
+		return w.string("none");
+	case px::animation_mode::wind:
+		return w.string("wind");
+	case px::animation_mode::wind2:
+		return w.string("wind2");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::camera_motion obj) {
+	switch (obj) {
+	case px::vobs::camera_motion::undefined:
+		return w.string("undefined");
+	case px::vobs::camera_motion::smooth:
+		return w.string("smooth");
+	case px::vobs::camera_motion::linear:
+		return w.string("linear");
+	case px::vobs::camera_motion::step:
+		return w.string("step");
+	case px::vobs::camera_motion::slow:
+		return w.string("slow");
+	case px::vobs::camera_motion::fast:
+		return w.string("fast");
+	case px::vobs::camera_motion::custom:
+		return w.string("custom");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::camera_trajectory obj) {
+	switch (obj) {
+	case px::vobs::camera_trajectory::world:
+		return w.string("world");
+	case px::vobs::camera_trajectory::object:
+		return w.string("object");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::camera_lerp_mode obj) {
+	switch (obj) {
+	case px::vobs::camera_lerp_mode::undefined:
+		return w.string("undefined");
+	case px::vobs::camera_lerp_mode::path:
+		return w.string("path");
+	case px::vobs::camera_lerp_mode::path_ignore_roll:
+		return w.string("pathIgnoreRoll");
+	case px::vobs::camera_lerp_mode::path_rotation_samples:
+		return w.string("pathRotationSamples");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::camera_loop obj) {
+	switch (obj) {
+	case px::vobs::camera_loop::none:
+		return w.string("none");
+	case px::vobs::camera_loop::restart:
+		return w.string("restart");
+	case px::vobs::camera_loop::pingpong:
+		return w.string("pingpong");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::light_mode obj) {
+	switch (obj) {
+	case px::vobs::light_mode::point:
+		return w.string("point");
+	case px::vobs::light_mode::spot:
+		return w.string("spot");
+	case px::vobs::light_mode::reserved0:
+		return w.string("reserved0");
+	case px::vobs::light_mode::reserved1:
+		return w.string("reserved1");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::light_quality obj) {
+	switch (obj) {
+	case px::vobs::light_quality::high:
+		return w.string("high");
+	case px::vobs::light_quality::medium:
+		return w.string("medium");
+	case px::vobs::light_quality::low:
+		return w.string("low");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::message_filter_action obj) {
+	switch (obj) {
+	case px::vobs::message_filter_action::none:
+		return w.string("none");
+	case px::vobs::message_filter_action::trigger:
+		return w.string("trigger");
+	case px::vobs::message_filter_action::untrigger:
+		return w.string("untrigger");
+	case px::vobs::message_filter_action::enable:
+		return w.string("enable");
+	case px::vobs::message_filter_action::disable:
+		return w.string("disable");
+	case px::vobs::message_filter_action::toggle:
+		return w.string("toggle");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::mover_message_type obj) {
+	switch (obj) {
+	case px::vobs::mover_message_type::fixed_direct:
+		return w.string("fixedDirect");
+	case px::vobs::mover_message_type::fixed_order:
+		return w.string("fixedOrder");
+	case px::vobs::mover_message_type::next:
+		return w.string("next");
+	case px::vobs::mover_message_type::previous:
+		return w.string("previous");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::collision_type obj) {
+	switch (obj) {
+	case px::vobs::collision_type::none:
+		return w.string("none");
+	case px::vobs::collision_type::point:
+		return w.string("point");
+	case px::vobs::collision_type::box:
+		return w.string("box");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::sound_material obj) {
+	switch (obj) {
+	case px::vobs::sound_material::wood:
+		return w.string("wood");
+	case px::vobs::sound_material::stone:
+		return w.string("stone");
+	case px::vobs::sound_material::metal:
+		return w.string("metal");
+	case px::vobs::sound_material::leather:
+		return w.string("leather");
+	case px::vobs::sound_material::clay:
+		return w.string("clay");
+	case px::vobs::sound_material::glass:
+		return w.string("glass");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::sound_mode obj) {
+	switch (obj) {
+	case px::vobs::sound_mode::loop:
+		return w.string("loop");
+	case px::vobs::sound_mode::once:
+		return w.string("once");
+	case px::vobs::sound_mode::random:
+		return w.string("random");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::sound_trigger_volume obj) {
+	switch (obj) {
+	case px::vobs::sound_trigger_volume::spherical:
+		return w.string("spherical");
+	case px::vobs::sound_trigger_volume::ellipsoidal:
+		return w.string("ellipsoidal");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::mover_behavior obj) {
+	switch (obj) {
+	case px::vobs::mover_behavior::toggle:
+		return w.string("toggle");
+	case px::vobs::mover_behavior::trigger_control:
+		return w.string("triggerControl");
+	case px::vobs::mover_behavior::open_timed:
+		return w.string("openTimed");
+	case px::vobs::mover_behavior::loop:
+		return w.string("loop");
+	case px::vobs::mover_behavior::single_keys:
+		return w.string("singleKeys");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::mover_lerp_type obj) {
+	switch (obj) {
+	case px::vobs::mover_lerp_type::curve:
+		return w.string("curve");
+	case px::vobs::mover_lerp_type::linear:
+		return w.string("linear");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::mover_speed_type obj) {
+	switch (obj) {
+	case px::vobs::mover_speed_type::seg_constant:
+		return w.string("segConstant");
+	case px::vobs::mover_speed_type::slow_start_end:
+		return w.string("slowStartEnd");
+	case px::vobs::mover_speed_type::slow_start:
+		return w.string("slowStart");
+	case px::vobs::mover_speed_type::slow_end:
+		return w.string("slowEnd");
+	case px::vobs::mover_speed_type::seg_slow_start_end:
+		return w.string("segSlowStartEnd");
+	case px::vobs::mover_speed_type::seg_slow_start:
+		return w.string("segSlowStart");
+	case px::vobs::mover_speed_type::seg_slow_end:
+		return w.string("segSlowEnd");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, px::vobs::trigger_batch_mode obj) {
+	switch (obj) {
+	case px::vobs::trigger_batch_mode::all:
+		return w.string("all");
+	case px::vobs::trigger_batch_mode::next:
+		return w.string("next");
+	case px::vobs::trigger_batch_mode::random:
+		return w.string("random");
+	}
+
+	w.null();
+}
+
+static void serialize(writer& w, const px::decal& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "dimension", obj.dimension);
+	field(w, "offset", obj.offset);
+	field(w, "twoSided", obj.two_sided);
+	field(w, "alphaFunc", obj.alpha_func);
+	field(w, "textureAnimFps", obj.texture_anim_fps);
+	field(w, "alphaWeight", obj.alpha_weight);
+	field(w, "ignoreDaylight", obj.ignore_daylight);
+	w.end_object();
+}
+
+// Each `vob_fields` overload writes the members of one VOB class after the ones of its base classes.
+
+static void vob_fields(writer& w, const px::vob& obj) {
+	field(w, "type", vob_type_name(obj.type));
+	field(w, "id", obj.id);
+	field(w, "bbox", obj.bbox);
+	field(w, "position", obj.position);
+	field(w, "rotation", obj.rotation);
+	field(w, "showVisual", obj.show_visual);
+	field(w, "spriteCameraFacingMode", obj.sprite_camera_facing_mode);
+	field(w, "cdStatic", obj.cd_static);
+	field(w, "cdDynamic", obj.cd_dynamic);
+	field(w, "vobStatic", obj.vob_static);
+	field(w, "dynamicShadows", obj.dynamic_shadows);
+	field(w, "physicsEnabled", obj.physics_enabled);
+	field(w, "animMode", obj.anim_mode);
+	field(w, "bias", obj.bias);
+	field(w, "ambient", obj.ambient);
+	field(w, "animStrength", obj.anim_strength);
+	field(w, "farClipScale", obj.far_clip_scale);
+	field(w, "presetName", obj.preset_name);
+	field(w, "vobName", obj.vob_name);
+	field(w, "visualName", obj.visual_name);
+	field(w, "visualType", obj.associated_visual_type);
+
+	if (w.select("visualDecal")) {
+		w.key("visualDecal");
+		if (obj.visual_decal) {
+			serialize(w, *obj.visual_decal);
+		} else {
+			w.null();
+		}
+	}
+}
+
+static void vob_fields(writer& w, const px::vobs::camera_trj_frame& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "time", obj.time);
+	field(w, "rollAngle", obj.roll_angle);
+	field(w, "fovScale", obj.fov_scale);
+	field(w, "motionType", obj.motion_type);
+	field(w, "fovMotionType", obj.fov_motion_type);
+	field(w, "rollMotionType", obj.roll_motion_type);
+	field(w, "timeMotionType", obj.time_motion_type);
+	field(w, "tension", obj.tension);
+	field(w, "camBias", obj.cam_bias);
+	field(w, "continuity", obj.continuity);
+	field(w, "timeScale", obj.time_scale);
+	field(w, "timeFixed", obj.time_fixed);
+	field(w, "originalPose", obj.original_pose);
+}
+
+static void serialize(writer& w, const std::unique_ptr<px::vobs::camera_trj_frame>& obj) {
+	w.begin_object();
+	vob_fields(w, *obj);
+	w.end_object();
+}
+
+static void vob_fields(writer& w, const px::vobs::cs_camera& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "trajectoryFor", obj.trajectory_for);
+	field(w, "targetTrajectoryFor", obj.target_trajectory_for);
+	field(w, "loopMode", obj.loop_mode);
+	field(w, "lerpMode", obj.lerp_mode);
+	field(w, "ignoreForVobRotation", obj.ignore_for_vob_rotation);
+	field(w, "ignoreForVobRotationTarget", obj.ignore_for_vob_rotation_target);
+	field(w, "adapt", obj.adapt);
+	field(w, "easeFirst", obj.ease_first);
+	field(w, "easeLast", obj.ease_last);
+	field(w, "totalDuration", obj.total_duration);
+	field(w, "autoFocusVob", obj.auto_focus_vob);
+	field(w, "autoPlayerMovable", obj.auto_player_movable);
+	field(w, "autoUntriggerLast", obj.auto_untrigger_last);
+	field(w, "autoUntriggerLastDelay", obj.auto_untrigger_last_delay);
+	field(w, "positionCount", obj.position_count);
+	field(w, "targetCount", obj.target_count);
+	field(w, "frames", obj.frames);
+}
+
+static void vob_fields(writer& w, const px::vobs::light& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "preset", obj.preset);
+	field(w, "lightType", obj.light_type);
+	field(w, "range", obj.range);
+	field(w, "color", obj.color);
+	field(w, "coneAngle", obj.cone_angle);
+	field(w, "isStatic", obj.is_static);
+	field(w, "quality", obj.quality);
+	field(w, "lensflareFx", obj.lensflare_fx);
+	field(w, "on", obj.on);
+	field(w, "rangeAnimationScale", obj.range_animation_scale);
+	field(w, "rangeAnimationFps", obj.range_animation_fps);
+	field(w, "rangeAnimationSmooth", obj.range_animation_smooth);
+	field(w, "colorAnimationList", obj.color_animation_list);
+	field(w, "colorAnimationFps", obj.color_animation_fps);
+	field(w, "colorAnimationSmooth", obj.color_animation_smooth);
+	field(w, "canMove", obj.can_move);
+}
+
+static void vob_fields(writer& w, const px::vobs::animate& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "startOn", obj.start_on);
+}
+
+static void vob_fields(writer& w, const px::vobs::item& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "instance", obj.instance);
+}
+
+static void vob_fields(writer& w, const px::vobs::lens_flare& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "fx", obj.fx);
+}
+
+static void vob_fields(writer& w, const px::vobs::pfx_controller& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "pfxName", obj.pfx_name);
+	field(w, "killWhenDone", obj.kill_when_done);
+	field(w, "initiallyRunning", obj.initially_running);
+}
+
+static void vob_fields(writer& w, const px::vobs::message_filter& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+	field(w, "onTrigger", obj.on_trigger);
+	field(w, "onUntrigger", obj.on_untrigger);
+}
+
+static void vob_fields(writer& w, const px::vobs::code_master& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+	field(w, "ordered", obj.ordered);
+	field(w, "firstFalseIsFailure", obj.first_false_is_failure);
+	field(w, "failureTarget", obj.failure_target);
+	field(w, "untriggeredCancels", obj.untriggered_cancels);
+	field(w, "slaves", obj.slaves);
+}
+
+static void vob_fields(writer& w, const px::vobs::mover_controller& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+	field(w, "message", obj.message);
+	field(w, "key", obj.key);
+}
+
+static void vob_fields(writer& w, const px::vobs::touch_damage& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "damage", obj.damage);
+	field(w, "barrier", obj.barrier);
+	field(w, "blunt", obj.blunt);
+	field(w, "edge", obj.edge);
+	field(w, "fire", obj.fire);
+	field(w, "fly", obj.fly);
+	field(w, "magic", obj.magic);
+	field(w, "point", obj.point);
+	field(w, "fall", obj.fall);
+	field(w, "repeatDelaySec", obj.repeat_delay_sec);
+	field(w, "volumeScale", obj.volume_scale);
+	field(w, "collision", obj.collision);
+}
+
+static void vob_fields(writer& w, const px::vobs::earthquake& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "radius", obj.radius);
+	field(w, "duration", obj.duration);
+	field(w, "amplitude", obj.amplitude);
+}
+
+static void vob_fields(writer& w, const px::vobs::mob& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "name", obj.name);
+	field(w, "hp", obj.hp);
+	field(w, "damage", obj.damage);
+	field(w, "movable", obj.movable);
+	field(w, "takable", obj.takable);
+	field(w, "focusOverride", obj.focus_override);
+	field(w, "material", obj.material);
+	field(w, "visualDestroyed", obj.visual_destroyed);
+	field(w, "owner", obj.owner);
+	field(w, "ownerGuild", obj.owner_guild);
+	field(w, "destroyed", obj.destroyed);
+}
+
+static void vob_fields(writer& w, const px::vobs::mob_inter& obj) {
+	vob_fields(w, static_cast<const px::vobs::mob&>(obj));
+	field(w, "state", obj.state);
+	field(w, "target", obj.target);
+	field(w, "item", obj.item);
+	field(w, "conditionFunction", obj.condition_function);
+	field(w, "onStateChangeFunction", obj.on_state_change_function);
+	field(w, "rewind", obj.rewind);
+}
+
+static void vob_fields(writer& w, const px::vobs::mob_fire& obj) {
+	vob_fields(w, static_cast<const px::vobs::mob_inter&>(obj));
+	field(w, "slot", obj.slot);
+	field(w, "vobTree", obj.vob_tree);
+}
+
+static void vob_fields(writer& w, const px::vobs::mob_container& obj) {
+	vob_fields(w, static_cast<const px::vobs::mob_inter&>(obj));
+	field(w, "locked", obj.locked);
+	field(w, "key", obj.key);
+	field(w, "pickString", obj.pick_string);
+	field(w, "contents", obj.contents);
+}
+
+static void vob_fields(writer& w, const px::vobs::mob_door& obj) {
+	vob_fields(w, static_cast<const px::vobs::mob_inter&>(obj));
+	field(w, "locked", obj.locked);
+	field(w, "key", obj.key);
+	field(w, "pickString", obj.pick_string);
+}
+
+static void vob_fields(writer& w, const px::vobs::sound& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "volume", obj.volume);
+	field(w, "mode", obj.mode);
+	field(w, "randomDelay", obj.random_delay);
+	field(w, "randomDelayVar", obj.random_delay_var);
+	field(w, "initiallyPlaying", obj.initially_playing);
+	field(w, "ambient3d", obj.ambient3d);
+	field(w, "obstruction", obj.obstruction);
+	field(w, "coneAngle", obj.cone_angle);
+	field(w, "volumeType", obj.volume_type);
+	field(w, "radius", obj.radius);
+	field(w, "soundName", obj.sound_name);
+}
+
+static void vob_fields(writer& w, const px::vobs::sound_daytime& obj) {
+	vob_fields(w, static_cast<const px::vobs::sound&>(obj));
+	field(w, "startTime", obj.start_time);
+	field(w, "endTime", obj.end_time);
+	field(w, "soundName2", obj.sound_name2);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+	field(w, "flags", obj.flags);
+	field(w, "filterFlags", obj.filter_flags);
+	field(w, "vobTarget", obj.vob_target);
+	field(w, "maxActivationCount", obj.max_activation_count);
+	field(w, "retriggerDelaySec", obj.retrigger_delay_sec);
+	field(w, "damageThreshold", obj.damage_threshold);
+	field(w, "fireDelaySec", obj.fire_delay_sec);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_mover& obj) {
+	vob_fields(w, static_cast<const px::vobs::trigger&>(obj));
+	field(w, "behavior", obj.behavior);
+	field(w, "touchBlockerDamage", obj.touch_blocker_damage);
+	field(w, "stayOpenTimeSec", obj.stay_open_time_sec);
+	field(w, "locked", obj.locked);
+	field(w, "autoLink", obj.auto_link);
+	field(w, "autoRotate", obj.auto_rotate);
+	field(w, "speed", obj.speed);
+	field(w, "lerpMode", obj.lerp_mode);
+	field(w, "speedMode", obj.speed_mode);
+	array_field(w, "keyframes", obj.keyframes);
+	field(w, "sfxOpenStart", obj.sfx_open_start);
+	field(w, "sfxOpenEnd", obj.sfx_open_end);
+	field(w, "sfxTransitioning", obj.sfx_transitioning);
+	field(w, "sfxCloseStart", obj.sfx_close_start);
+	field(w, "sfxCloseEnd", obj.sfx_close_end);
+	field(w, "sfxLock", obj.sfx_lock);
+	field(w, "sfxUnlock", obj.sfx_unlock);
+	field(w, "sfxUseLocked", obj.sfx_use_locked);
+}
+
+static void serialize(writer& w, const px::vobs::trigger_list::target& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "delay", obj.delay);
+	w.end_object();
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_list& obj) {
+	vob_fields(w, static_cast<const px::vobs::trigger&>(obj));
+	field(w, "mode", obj.mode);
+	field(w, "targets", obj.targets);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_script& obj) {
+	vob_fields(w, static_cast<const px::vobs::trigger&>(obj));
+	field(w, "function", obj.function);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_change_level& obj) {
+	vob_fields(w, static_cast<const px::vobs::trigger&>(obj));
+	field(w, "levelName", obj.level_name);
+	field(w, "startVob", obj.start_vob);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_world_start& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+	field(w, "fireOnce", obj.fire_once);
+}
+
+static void vob_fields(writer& w, const px::vobs::trigger_untouch& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "target", obj.target);
+}
+
+static void vob_fields(writer& w, const px::vobs::zone_music& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "enabled", obj.enabled);
+	field(w, "priority", obj.priority);
+	field(w, "ellipsoid", obj.ellipsoid);
+	field(w, "reverb", obj.reverb);
+	field(w, "volume", obj.volume);
+	field(w, "loop", obj.loop);
+}
+
+static void vob_fields(writer& w, const px::vobs::zone_far_plane& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "vobFarPlaneZ", obj.vob_far_plane_z);
+	field(w, "innerRangePercentage", obj.inner_range_percentage);
+}
+
+static void vob_fields(writer& w, const px::vobs::zone_fog& obj) {
+	vob_fields(w, static_cast<const px::vob&>(obj));
+	field(w, "rangeCenter", obj.range_center);
+	field(w, "innerRangePercentage", obj.inner_range_percentage);
+	field(w, "color", obj.color);
+	field(w, "fadeOutSky", obj.fade_out_sky);
+	field(w, "overrideColor", obj.override_color);
+}
+
+/// \brief Writes the members of a VOB of any class.
+///
+/// The world parser creates VOBs of the class matching their type, which this relies on to downcast them.
+static void any_vob_fields(writer& w, const px::vob& obj) {
+	switch (obj.type) {
+	case px::vob_type::zCCSCamera:
+		return vob_fields(w, static_cast<const px::vobs::cs_camera&>(obj));
+	case px::vob_type::zCCamTrj_KeyFrame:
+		return vob_fields(w, static_cast<const px::vobs::camera_trj_frame&>(obj));
+	case px::vob_type::zCVobLight:
+		return vob_fields(w, static_cast<const px::vobs::light&>(obj));
+	case px::vob_type::zCVobAnimate:
+		return vob_fields(w, static_cast<const px::vobs::animate&>(obj));
+	case px::vob_type::oCItem:
+		return vob_fields(w, static_cast<const px::vobs::item&>(obj));
+	case px::vob_type::zCVobLensFlare:
+		return vob_fields(w, static_cast<const px::vobs::lens_flare&>(obj));
+	case px::vob_type::zCPFXController:
+		return vob_fields(w, static_cast<const px::vobs::pfx_controller&>(obj));
+	case px::vob_type::zCMessageFilter:
+		return vob_fields(w, static_cast<const px::vobs::message_filter&>(obj));
+	case px::vob_type::zCCodeMaster:
+		return vob_fields(w, static_cast<const px::vobs::code_master&>(obj));
+	case px::vob_type::zCMoverController:
+		return vob_fields(w, static_cast<const px::vobs::mover_controller&>(obj));
+	case px::vob_type::oCTouchDamage:
+		return vob_fields(w, static_cast<const px::vobs::touch_damage&>(obj));
+	case px::vob_type::zCEarthquake:
+		return vob_fields(w, static_cast<const px::vobs::earthquake&>(obj));
+	case px::vob_type::oCMOB:
+		return vob_fields(w, static_cast<const px::vobs::mob&>(obj));
+	case px::vob_type::oCMobInter:
+	case px::vob_type::oCMobBed:
+	case px::vob_type::oCMobLadder:
+	case px::vob_type::oCMobSwitch:
+	case px::vob_type::oCMobWheel:
+		return vob_fields(w, static_cast<const px::vobs::mob_inter&>(obj));
+	case px::vob_type::oCMobFire:
+		return vob_fields(w, static_cast<const px::vobs::mob_fire&>(obj));
+	case px::vob_type::oCMobContainer:
+		return vob_fields(w, static_cast<const px::vobs::mob_container&>(obj));
+	case px::vob_type::oCMobDoor:
+		return vob_fields(w, static_cast<const px::vobs::mob_door&>(obj));
+	case px::vob_type::zCVobSound:
+		return vob_fields(w, static_cast<const px::vobs::sound&>(obj));
+	case px::vob_type::zCVobSoundDaytime:
+		return vob_fields(w, static_cast<const px::vobs::sound_daytime&>(obj));
+	case px::vob_type::zCTrigger:
+	case px::vob_type::oCCSTrigger:
+		return vob_fields(w, static_cast<const px::vobs::trigger&>(obj));
+	case px::vob_type::zCMover:
+		return vob_fields(w, static_cast<const px::vobs::trigger_mover&>(obj));
+	case px::vob_type::zCTriggerList:
+		return vob_fields(w, static_cast<const px::vobs::trigger_list&>(obj));
+	case px::vob_type::oCTriggerScript:
+		return vob_fields(w, static_cast<const px::vobs::trigger_script&>(obj));
+	case px::vob_type::oCTriggerChangeLevel:
+		return vob_fields(w, static_cast<const px::vobs::trigger_change_level&>(obj));
+	case px::vob_type::zCTriggerWorldStart:
+		return vob_fields(w, static_cast<const px::vobs::trigger_world_start&>(obj));
+	case px::vob_type::zCTriggerUntouch:
+		return vob_fields(w, static_cast<const px::vobs::trigger_untouch&>(obj));
+	case px::vob_type::oCZoneMusic:
+	case px::vob_type::oCZoneMusicDefault:
+		return vob_fields(w, static_cast<const px::vobs::zone_music&>(obj));
+	case px::vob_type::zCZoneVobFarPlane:
+	case px::vob_type::zCZoneVobFarPlaneDefault:
+		return vob_fields(w, static_cast<const px::vobs::zone_far_plane&>(obj));
+	case px::vob_type::zCZoneZFog:
+	case px::vob_type::zCZoneZFogDefault:
+		return vob_fields(w, static_cast<const px::vobs::zone_fog&>(obj));
+	default:
+		return vob_fields(w, obj);
+	}
+}
+
+/// \brief Writes a VOB and its children.
+/// \param depth The number of levels of children left to write or a negative value to write all of them.
+static void serialize_vob(writer& w, const px::vob& obj, int depth) {
+	w.begin_object();
+	any_vob_fields(w, obj);
+
+	if (w.select("children")) {
+		w.key("children");
+
+		if (depth == 0 && !obj.children.empty()) {
+			w.null();
+		} else {
+			w.begin_array();
+			for (std::size_t i = 0; i < obj.children.size(); ++i) {
+				if (w.select(i))
+					serialize_vob(w, *obj.children[i], depth - 1);
+			}
+			w.end_array();
+		}
+	}
+
+	w.end_object();
+}
+
+void serialize(writer& w, const px::vob& obj, int max_depth) {
+	serialize_vob(w, obj, max_depth);
+}
+
+namespace {
+	/// \brief A VOB in the flattened VOB tree.
+	struct vob_row {
+		const px::vob* vob;
+
+		/// \brief The row of the parent VOB or -1 for root VOBs.
+		std::int32_t parent;
+		std::uint32_t depth;
+	};
+} // namespace
+
+static void collect_vob_rows(const std::vector<std::unique_ptr<px::vob>>& vobs,
+                             std::int32_t parent,
+                             std::uint32_t depth,
+                             int max_depth,
+                             std::vector<vob_row>& rows) {
+	for (const auto& vob : vobs) {
+		auto index = static_cast<std::int32_t>(rows.size());
+		rows.push_back({vob.get(), parent, depth});
+
+		if (max_depth < 0 || depth < static_cast<std::uint32_t>(max_depth))
+			collect_vob_rows(vob->children, index, depth + 1, max_depth, rows);
+	}
+}
+
+template <typename T, typename = void>
+constexpr bool has_array_traits = false;
+
+template <typename T>
+constexpr bool has_array_traits<T, std::void_t<decltype(array_traits<T>::type)>> = true;
+
+/// \brief Writes one value of every row as a member holding an array.
+template <typename F>
+static void vob_column(writer& w, std::string_view name, const std::vector<vob_row>& rows, F&& get) {
+	if (!w.select(name))
+		return;
+
+	std::vector<std::decay_t<std::invoke_result_t<F, const vob_row&>>> values {};
+	values.reserve(rows.size());
+
+	for (const auto& row : rows) {
+		values.push_back(get(row));
+	}
+
+	if constexpr (has_array_traits<typename decltype(values)::value_type>) {
+		array_field(w, name, values);
+	} else {
+		field(w, name, values);
+	}
+}
+
+/// \brief Writes the VOBs as a table of columns with one row per VOB.
+static void serialize_vob_table(writer& w, const std::vector<std::unique_ptr<px::vob>>& vobs, int max_depth) {
+	std::vector<vob_row> rows {};
+	collect_vob_rows(vobs, -1, 0, max_depth, rows);
+
+	w.begin_object();
+	field(w, "count", rows.size());
+	vob_column(w, "parent", rows, [](const vob_row& row) { return row.parent; });
+	vob_column(w, "depth", rows, [](const vob_row& row) { return row.depth; });
+	vob_column(w, "type", rows, [](const vob_row& row) { return std::string_view {vob_type_name(row.vob->type)}; });
+	vob_column(w, "id", rows, [](const vob_row& row) { return row.vob->id; });
+	vob_column(w, "vobName", rows, [](const vob_row& row) { return std::string_view {row.vob->vob_name}; });
+	vob_column(w, "presetName", rows, [](const vob_row& row) { return std::string_view {row.vob->preset_name}; });
+	vob_column(w, "visualName", rows, [](const vob_row& row) { return std::string_view {row.vob->visual_name}; });
+	vob_column(w, "visualType", rows, [](const vob_row& row) { return row.vob->associated_visual_type; });
+	vob_column(w, "positionX", rows, [](const vob_row& row) { return row.vob->position.x; });
+	vob_column(w, "positionY", rows, [](const vob_row& row) { return row.vob->position.y; });
+	vob_column(w, "positionZ", rows, [](const vob_row& row) { return row.vob->position.z; });
+	vob_column(w, "showVisual", rows, [](const vob_row& row) { return row.vob->show_visual; });
+	vob_column(w, "cdStatic", rows, [](const vob_row& row) { return row.vob->cd_static; });
+	vob_column(w, "cdDynamic", rows, [](const vob_row& row) { return row.vob->cd_dynamic; });
+	vob_column(w, "vobStatic", rows, [](const vob_row& row) { return row.vob->vob_static; });
+	w.end_object();
+}
+
+void serialize(writer& w, const px::world& obj) {
+	serialize(w, obj, vob_options {});
+}
+
+void serialize(writer& w, const px::world& obj, const vob_options& vobs) {
+	w.begin_object();
+
+	if (vobs.table) {
+		if (w.select("vobTable")) {
+			w.key("vobTable");
+			serialize_vob_table(w, obj.world_vobs, vobs.max_depth);
+		}
+	} else if (w.select("vobTree")) {
+		w.key("vobTree");
+		w.begin_array();
+		for (std::size_t i = 0; i < obj.world_vobs.size(); ++i) {
+			if (w.select(i))
+				serialize_vob(w, *obj.world_vobs[i], vobs.max_depth);
+		}
+		w.end_array();
+	}
+
+	field(w, "mesh", obj.world_mesh);
+	field(w, "bspTree", obj.world_bsp_tree);
+	field(w, "wayNet", obj.world_way_net);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::edge& obj) {
+	w.begin_object();
+	field(w, "edges", obj.edges);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::triangle_edge& obj) {
+	w.begin_object();
+	field(w, "edges", obj.edges);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::triangle& obj) {
+	w.begin_object();
+	field(w, "wedges", obj.wedges);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::wedge& obj) {
+	w.begin_object();
+	field(w, "index", obj.index);
+	field(w, "normal", obj.normal);
+	field(w, "texture", obj.texture);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::sub_mesh& obj) {
+	w.begin_object();
+	array_field(w, "colors", obj.colors);
+	array_field(w, "edgeScores", obj.edge_scores);
+	array_field(w, "edges", obj.edges);
+	field(w, "material", obj.mat);
+	array_field(w, "triangleEdges", obj.triangle_edges);
+	array_field(w, "trianglePlaneIndices", obj.triangle_plane_indices);
+	array_field(w, "triangles", obj.triangles);
+	array_field(w, "wedgeMap", obj.wedge_map);
+	field(w, "wedges", obj.wedges);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::proto_mesh& obj) {
+	w.begin_object();
+	field(w, "materials", obj.materials);
+	array_field(w, "normals", obj.normals);
+	field(w, "alphaTest", obj.alpha_test);
+	field(w, "bbox", obj.bbox);
+	field(w, "obbox", obj.obbox);
+	array_field(w, "positions", obj.positions);
+	field(w, "subMeshes", obj.sub_meshes);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::wedge_normal& obj) {
+	w.begin_object();
+	field(w, "index", obj.index);
+	field(w, "normal", obj.normal);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::weight_entry& obj) {
+	w.begin_object();
+	field(w, "position", obj.position);
+	field(w, "nodeIndex", obj.node_index);
+	field(w, "weight", obj.weight);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::softskin_mesh& obj) {
+	w.begin_object();
+	field(w, "bboxes", obj.bboxes);
+	field(w, "mesh", obj.mesh);
+	array_field(w, "nodes", obj.nodes);
+	field(w, "wedgeNormals", obj.wedge_normals);
+	field(w, "weights", obj.weights);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::model_mesh& obj) {
+	// attachments are written in order of their name to keep the output stable
+	std::vector<const std::pair<const std::string, px::proto_mesh>*> attachments {};
+	attachments.reserve(obj.attachments.size());
+
+	for (const auto& attachment : obj.attachments) {
+		attachments.push_back(&attachment);
+	}
+
+	std::sort(attachments.begin(), attachments.end(), [](auto* a, auto* b) { return a->first < b->first; });
+
+	w.begin_object();
+	field(w, "checksum", obj.checksum);
+	field(w, "meshes", obj.meshes);
+
+	if (w.select("attachments")) {
+		w.key("attachments");
+		w.begin_object();
+		for (const auto* attachment : attachments) {
+			field(w, attachment->first, attachment->second);
+		}
+		w.end_object();
+	}
+
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::morph_animation& obj) {
+	w.begin_object();
+	array_field(w, "samples", obj.samples);
+	field(w, "name", obj.name);
+	field(w, "blendIn", obj.blend_in);
+	field(w, "blendOut", obj.blend_out);
+	field(w, "duration", obj.duration);
+	field(w, "flags", obj.flags);
+	field(w, "frameCount", obj.frame_count);
+	field(w, "layer", obj.layer);
+	field(w, "speed", obj.speed);
+	array_field(w, "vertices", obj.vertices);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::morph_source& obj) {
+	w.begin_object();
+	field(w, "fileDate", obj.file_date);
+	field(w, "fileName", obj.file_name);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::morph_mesh& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "mesh", obj.mesh);
+	field(w, "animations", obj.animations);
+	array_field(w, "morphPositions", obj.morph_positions);
+	field(w, "sources", obj.sources);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::model& obj) {
+	w.begin_object();
+	field(w, "mesh", obj.mesh);
+	field(w, "hierarchy", obj.hierarchy);
+	w.end_object();
+}
+
+static void serialize(writer& w, px::VfsNodeType obj) {
+	w.string(obj == px::VfsNodeType::FILE ? "FILE" : "DIRECTORY");
+}
+
+static void serialize(writer& w, const px::VfsNode& obj) {
+	w.begin_object();
+	field(w, "name", obj.name());
+	field(w, "type", obj.type());
+	field(w, "time", obj.time());
+
+	if (obj.type() == px::VfsNodeType::DIRECTORY) {
+		field(w, "children", obj.children());
+	}
+
+	w.end_object();
+}
+
+void serialize(writer& w, const px::Vfs& obj) {
+	w.begin_object();
+	field(w, "root", obj.root());
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::skeleton& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "disableMesh", obj.disable_mesh);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::animation_combination& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "layer", obj.layer);
+	field(w, "next", obj.next);
+	field(w, "blendIn", obj.blend_in);
+	field(w, "blendOut", obj.blend_out);
+	field(w, "blendFlags", obj.flags);
+	field(w, "model", obj.model);
+	field(w, "lastFrame", obj.last_frame);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_tag& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "type", obj.type);
+	field(w, "slot", obj.slot);
+	field(w, "slot2", obj.slot2);
+	field(w, "item", obj.item);
+	field(w, "frames", obj.frames);
+	field(w, "fightMode", obj.fight_mode);
+	field(w, "attached", obj.attached);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_pfx& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "index", obj.index);
+	field(w, "name", obj.name);
+	field(w, "position", obj.position);
+	field(w, "attached", obj.attached);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_pfx_stop& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "index", obj.index);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_sfx& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "name", obj.name);
+	field(w, "range", obj.range);
+	field(w, "emptySlot", obj.empty_slot);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_sfx_ground& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "name", obj.name);
+	field(w, "range", obj.range);
+	field(w, "emptySlot", obj.empty_slot);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_morph_animate& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "animation", obj.animation);
+	field(w, "node", obj.node);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::event_camera_tremor& obj) {
+	w.begin_object();
+	field(w, "frame", obj.frame);
+	field(w, "field1", obj.field1);
+	field(w, "field2", obj.field2);
+	field(w, "field3", obj.field3);
+	field(w, "field4", obj.field4);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::animation& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "layer", obj.layer);
+	field(w, "next", obj.next);
+	field(w, "blendIn", obj.blend_in);
+	field(w, "blendOut", obj.blend_out);
+	field(w, "blendFlags", obj.flags);
+	field(w, "model", obj.model);
+	field(w, "direction", obj.direction);
+	field(w, "firstFrame", obj.first_frame);
+	field(w, "lastFrame", obj.last_frame);
+	field(w, "fps", obj.fps);
+	field(w, "speed", obj.speed);
+	field(w, "collisionVolumeScale", obj.collision_volume_scale);
+
+	field(w, "events", obj.events);
+	field(w, "pfx", obj.pfx);
+	field(w, "pfxStop", obj.pfx_stop);
+	field(w, "sfx", obj.sfx);
+	field(w, "sfxGround", obj.sfx_ground);
+	field(w, "morph", obj.morph);
+	field(w, "tremors", obj.tremors);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::animation_blending& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "next", obj.next);
+	field(w, "blendIn", obj.blend_in);
+	field(w, "blendOut", obj.blend_out);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::animation_alias& obj) {
+	w.begin_object();
+	field(w, "name", obj.name);
+	field(w, "layer", obj.layer);
+	field(w, "next", obj.next);
+	field(w, "blendIn", obj.blend_in);
+	field(w, "blendOut", obj.blend_out);
+	field(w, "blendFlags", obj.flags);
+	field(w, "alias", obj.alias);
+	field(w, "direction", obj.direction);
+	w.end_object();
+}
+
+static void serialize(writer& w, const px::mds::model_tag& obj) {
+	w.begin_object();
+	field(w, "bone", obj.bone);
+	w.end_object();
+}
+
+void serialize(writer& w, const px::model_script& obj) {
+	w.begin_object();
+	field(w, "skeleton", obj.skeleton);
+	field(w, "meshes", obj.meshes);
+	field(w, "disabledAnimations", obj.disabled_animations);
+	field(w, "combinations", obj.combinations);
+	field(w, "blends", obj.blends);
+	field(w, "aliases", obj.aliases);
+	field(w, "modelTags", obj.model_tags);
+	field(w, "animations", obj.animations);
+	w.end_object();
+}
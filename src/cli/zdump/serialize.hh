@@ -0,0 +1,75 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/animation.hh>
+#include <phoenix/font.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/messages.hh>
+#include <phoenix/model.hh>
+#include <phoenix/model_hierarchy.hh>
+#include <phoenix/model_mesh.hh>
+#include <phoenix/model_script.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/texture.hh>
+#include <phoenix/world.hh>
+#include <phoenix/Vfs.hh>
+
+#include "writer.hh"
+
+namespace px = phoenix;
+
+// These produce the same documents as the `to_json` functions in dump.hh, but pass every value to the writer as
+// soon as it is visited instead of building a `nlohmann::json` tree first. The `to_json` functions build VOBs using
+// serialize(writer&, const px::vob&, int), so both write the same VOB fields.
+
+void serialize(writer& w, const px::font& obj);
+
+void serialize(writer& w, const px::messages& obj);
+
+void serialize(writer& w, const px::animation& obj);
+
+void serialize(writer& w, const px::model_hierarchy& obj);
+
+void serialize(writer& w, const px::texture& obj);
+
+void serialize(writer& w, const px::mesh& obj);
+
+void serialize(writer& w, const px::model_script& obj);
+
+void serialize(writer& w, const px::proto_mesh& obj);
+
+/// \brief How the VOBs of a world are written.
+struct vob_options {
+	/// \brief The number of levels of children written below the root VOBs or a negative value to write all of them.
+	///
+	/// The `children` of VOBs at the last written level are `null` if they have any.
+	int max_depth {-1};
+
+	/// \brief Whether to write the VOBs as a table with one column per field instead of a tree.
+	///
+	/// The table has one row per VOB in depth-first order and refers to the parent of each VOB by its row index. It
+	/// only contains the fields common to all VOBs.
+	bool table {false};
+};
+
+/// \brief Writes a VOB and its children.
+/// \param max_depth The number of levels of children to write or a negative value to write all of them.
+void serialize(writer& w, const px::vob& obj, int max_depth = -1);
+
+void serialize(writer& w, const px::world& obj);
+
+void serialize(writer& w, const px::world& obj, const vob_options& vobs);
+
+void serialize(writer& w, const px::model_mesh& obj);
+
+void serialize(writer& w, const px::morph_mesh& obj);
+
+void serialize(writer& w, const px::model& obj);
+
+void serialize(writer& w, const px::Vfs& obj);
+
+/// \brief Writes objects which do not contain VOBs, ignoring the given options.
+template <typename T>
+void serialize(writer& w, const T& obj, const vob_options&) {
+	serialize(w, obj);
+}
@@ -0,0 +1,296 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "stats.hh"
+#include "archive.hh"
+#include "dump.hh"
+#include "format.hh"
+
+#include <phoenix/vdfs.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+
+namespace {
+	/// \brief A file to collect statistics about and the VDF it is stored in.
+	struct statistics_file {
+		const archive_file* file;
+		std::string_view archive;
+	};
+} // namespace
+
+// names of the pixel formats of ZenGin textures, in the order of their numeric values
+static constexpr std::string_view TEXTURE_FORMAT_NAMES[] = {
+    "B8G8R8A8",
+    "R8G8B8A8",
+    "A8B8G8R8",
+    "A8R8G8B8",
+    "B8G8R8",
+    "R8G8B8",
+    "A4R4G4B4",
+    "A1R5G5B5",
+    "R5G6B5",
+    "P8",
+    "DXT1",
+    "DXT2",
+    "DXT3",
+    "DXT4",
+    "DXT5",
+};
+
+static std::string texture_format_name(std::uint32_t format) {
+	if (format < std::size(TEXTURE_FORMAT_NAMES))
+		return std::string {TEXTURE_FORMAT_NAMES[format]};
+	return "unknown";
+}
+
+/// \return The name of the model an animation belongs to, which is the part of its file name before the first `-`.
+static std::string_view animation_model_name(std::string_view path) {
+	if (auto slash = path.rfind('/'); slash != std::string_view::npos)
+		path.remove_prefix(slash + 1);
+
+	return path.substr(0, std::min(path.find('-'), path.find('.')));
+}
+
+static void count_vobs(const std::vector<std::unique_ptr<px::vob>>& vobs,
+                       archive_statistics& stats,
+                       world_totals& world) {
+	for (const auto& vob : vobs) {
+		++world.vobs;
+		++stats.vob_types[vob->type];
+		count_vobs(vob->children, stats, world);
+	}
+}
+
+/// \brief Parses a single file and adds it to the given statistics.
+static void collect_file(const statistics_file& file, archive_statistics& stats) {
+	++stats.files;
+
+	auto format = file_format::unknown;
+	std::uint64_t size = 0;
+
+	try {
+		auto in = file.file->entry->open();
+		size = in.remaining();
+		format = detect_file_format(in);
+
+		auto& totals = stats.formats[format];
+		++totals.count;
+		totals.bytes += size;
+
+		if (format == file_format::unknown) {
+			++stats.skipped;
+			return;
+		}
+
+		visit_file(format, in, [&](const auto& obj) {
+			using type = std::decay_t<decltype(obj)>;
+
+			if constexpr (std::is_same_v<type, px::world>) {
+				world_totals world {};
+				world.archive = file.archive;
+				world.path = file.file->path;
+				world.polygons = obj.world_mesh.polygons.material_indices.size();
+				world.vertices = obj.world_mesh.vertices.size();
+				world.materials = obj.world_mesh.materials.size();
+				world.waypoints = obj.world_way_net.waypoints.size();
+				count_vobs(obj.world_vobs, stats, world);
+				stats.worlds.push_back(std::move(world));
+			} else if constexpr (std::is_same_v<type, px::texture>) {
+				auto& totals = stats.texture_formats[texture_format_name(static_cast<std::uint32_t>(obj.format()))];
+				++totals.count;
+				totals.bytes += size;
+			} else if constexpr (std::is_same_v<type, px::animation>) {
+				auto name = animation_model_name(file.file->path);
+				auto it = stats.animations.find(name);
+				if (it == stats.animations.end())
+					it = stats.animations.emplace(std::string {name}, animation_totals {}).first;
+
+				++it->second.animations;
+				it->second.frames += obj.frame_count;
+				it->second.samples += obj.samples.size();
+				it->second.events += obj.events.size();
+			}
+		});
+	} catch (const std::exception&) {
+		// the file could not be opened or parsed, its format is unknown in the former case
+		++stats.failed;
+
+		if (format != file_format::unknown)
+			++stats.formats[format].failed;
+	}
+}
+
+void merge(archive_statistics& into, archive_statistics&& from) {
+	into.files += from.files;
+	into.failed += from.failed;
+	into.skipped += from.skipped;
+
+	auto add_totals = [](file_totals& a, const file_totals& b) {
+		a.count += b.count;
+		a.bytes += b.bytes;
+		a.failed += b.failed;
+	};
+
+	for (const auto& [format, totals] : from.formats) {
+		add_totals(into.formats[format], totals);
+	}
+
+	for (const auto& [name, totals] : from.texture_formats) {
+		add_totals(into.texture_formats[name], totals);
+	}
+
+	for (const auto& [type, count] : from.vob_types) {
+		into.vob_types[type] += count;
+	}
+
+	for (const auto& [name, totals] : from.animations) {
+		auto& result = into.animations[name];
+		result.animations += totals.animations;
+		result.frames += totals.frames;
+		result.samples += totals.samples;
+		result.events += totals.events;
+	}
+
+	into.worlds.insert(into.worlds.end(),
+	                   std::make_move_iterator(from.worlds.begin()),
+	                   std::make_move_iterator(from.worlds.end()));
+}
+
+archive_statistics collect_statistics(const std::vector<std::string>& archives, pstudio::thread_pool& pool) {
+	// the files point into the VDFs, so they must not be moved once the files are listed
+	std::vector<px::vdf_file> vdfs {};
+	std::vector<std::vector<archive_file>> listings {};
+	vdfs.reserve(archives.size());
+	listings.reserve(archives.size());
+
+	std::vector<statistics_file> files {};
+	for (const auto& archive : archives) {
+		const auto& listing = listings.emplace_back(list_files(vdfs.emplace_back(px::vdf_file::open(archive))));
+
+		for (const auto& file : listing) {
+			files.push_back({&file, archive});
+		}
+	}
+
+	// every worker takes files from the shared list until there are none left and collects into its own statistics
+	std::atomic_size_t next {0};
+	std::vector<std::future<archive_statistics>> partials {};
+
+	for (unsigned i = 0; i < pool.size(); ++i) {
+		partials.push_back(pool.submit([&files, &next] {
+			archive_statistics stats {};
+
+			for (auto index = next++; index < files.size(); index = next++) {
+				collect_file(files[index], stats);
+			}
+
+			return stats;
+		}));
+	}
+
+	archive_statistics result {};
+	result.archives = archives;
+
+	for (auto& partial : partials) {
+		merge(result, partial.get());
+	}
+
+	std::sort(result.worlds.begin(), result.worlds.end(), [](const world_totals& a, const world_totals& b) {
+		return std::tie(a.archive, a.path) < std::tie(b.archive, b.path);
+	});
+
+	return result;
+}
+
+static void serialize(writer& w, const file_totals& obj) {
+	w.begin_object();
+	w.key("count");
+	w.unsigned_integer(obj.count);
+	w.key("bytes");
+	w.unsigned_integer(obj.bytes);
+	w.key("failed");
+	w.unsigned_integer(obj.failed);
+	w.end_object();
+}
+
+void serialize(writer& w, const archive_statistics& obj) {
+	auto count = [&w](std::string_view name, std::uint64_t value) {
+		w.key(name);
+		w.unsigned_integer(value);
+	};
+
+	w.begin_object();
+
+	w.key("archives");
+	w.begin_array();
+	for (const auto& archive : obj.archives) {
+		w.string(archive);
+	}
+	w.end_array();
+
+	count("files", obj.files);
+	count("failed", obj.failed);
+	count("skipped", obj.skipped);
+
+	w.key("formats");
+	w.begin_object();
+	for (const auto& [format, totals] : obj.formats) {
+		w.key(pstudio::format_name(format));
+		serialize(w, totals);
+	}
+	w.end_object();
+
+	w.key("textureFormats");
+	w.begin_object();
+	for (const auto& [name, totals] : obj.texture_formats) {
+		w.key(name);
+		w.begin_object();
+		count("count", totals.count);
+		count("bytes", totals.bytes);
+		w.end_object();
+	}
+	w.end_object();
+
+	w.key("vobTypes");
+	w.begin_object();
+	for (const auto& [type, value] : obj.vob_types) {
+		count(vob_type_name(type), value);
+	}
+	w.end_object();
+
+	w.key("animations");
+	w.begin_object();
+	for (const auto& [name, totals] : obj.animations) {
+		w.key(name);
+		w.begin_object();
+		count("animations", totals.animations);
+		count("frames", totals.frames);
+		count("samples", totals.samples);
+		count("events", totals.events);
+		w.end_object();
+	}
+	w.end_object();
+
+	w.key("worlds");
+	w.begin_array();
+	for (const auto& world : obj.worlds) {
+		w.begin_object();
+		w.key("archive");
+		w.string(world.archive);
+		w.key("path");
+		w.string(world.path);
+		count("vobs", world.vobs);
+		count("polygons", world.polygons);
+		count("vertices", world.vertices);
+		count("materials", world.materials);
+		count("waypoints", world.waypoints);
+		w.end_object();
+	}
+	w.end_array();
+
+	w.end_object();
+}
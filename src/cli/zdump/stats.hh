@@ -0,0 +1,84 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/world.hh>
+
+#include <pstudio/file_format.hh>
+#include <pstudio/parallel.hh>
+
+#include "writer.hh"
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief The number and total size of a set of files.
+struct file_totals {
+	std::uint64_t count {0};
+	std::uint64_t bytes {0};
+
+	/// \brief The number of files which could not be parsed.
+	std::uint64_t failed {0};
+};
+
+/// \brief The sizes of a single world.
+struct world_totals {
+	std::string archive;
+	std::string path;
+	std::uint64_t vobs {0};
+	std::uint64_t polygons {0};
+	std::uint64_t vertices {0};
+	std::uint64_t materials {0};
+	std::uint64_t waypoints {0};
+};
+
+/// \brief The sizes of all animations of a model.
+struct animation_totals {
+	std::uint64_t animations {0};
+	std::uint64_t frames {0};
+	std::uint64_t samples {0};
+	std::uint64_t events {0};
+};
+
+/// \brief Totals collected from the files of one or more VDFs.
+struct archive_statistics {
+	std::vector<std::string> archives {};
+	std::uint64_t files {0};
+	std::uint64_t failed {0};
+
+	/// \brief The number of files in a format zdump does not support.
+	std::uint64_t skipped {0};
+
+	std::map<pstudio::file_format, file_totals> formats {};
+
+	/// \brief The textures by the name of their pixel format.
+	std::map<std::string, file_totals, std::less<>> texture_formats {};
+
+	/// \brief The number of VOBs of each type in all worlds.
+	std::map<px::vob_type, std::uint64_t> vob_types {};
+
+	/// \brief The animations by the name of the model they belong to, taken from their file name.
+	std::map<std::string, animation_totals, std::less<>> animations {};
+
+	/// \brief The worlds ordered by archive and path.
+	std::vector<world_totals> worlds {};
+};
+
+/// \brief Adds the totals of \p from to \p into.
+void merge(archive_statistics& into, archive_statistics&& from);
+
+/// \brief Parses every file of the given VDFs and collects statistics about them.
+///
+/// Files are parsed concurrently. Every thread collects into its own archive_statistics which are merged once all
+/// files have been parsed, so no locking is necessary while parsing and no document is built for any file.
+/// \param archives The paths of the VDFs to collect statistics about.
+/// \param pool The threads to parse the files on.
+/// \return The statistics of all files together.
+/// \throws px::error if one of the VDFs cannot be opened.
+archive_statistics collect_statistics(const std::vector<std::string>& archives, pstudio::thread_pool& pool);
+
+void serialize(writer& w, const archive_statistics& obj);
@@ -0,0 +1,551 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "writer.hh"
+
+#include <fmt/format.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+
+/// \brief The number of bytes buffered before they are written to the output.
+static constexpr std::size_t FLUSH_THRESHOLD = 1024 * 1024;
+
+/// \brief The alignment of binary arrays in sidecar files in bytes.
+static constexpr std::size_t SIDECAR_ALIGNMENT = 16;
+
+static bool is_little_endian() noexcept {
+	const std::uint16_t probe = 1;
+	std::uint8_t first;
+	std::memcpy(&first, &probe, 1);
+	return first == 1;
+}
+
+/// \brief Writes the dimensions of a typed array, omitting the second one for arrays of plain numbers.
+static void write_shape(writer& w, const typed_array& array) {
+	w.begin_array();
+	w.unsigned_integer(array.count);
+
+	if (array.components != 1)
+		w.unsigned_integer(array.components);
+
+	w.end_array();
+}
+
+std::string_view array_type_name(array_type type) {
+	switch (type) {
+	case array_type::uint8:
+		return "uint8";
+	case array_type::uint16:
+		return "uint16";
+	case array_type::int32:
+		return "int32";
+	case array_type::uint32:
+		return "uint32";
+	case array_type::uint64:
+		return "uint64";
+	case array_type::float32:
+		return "float32";
+	}
+
+	return "unknown";
+}
+
+std::size_t array_type_size(array_type type) {
+	switch (type) {
+	case array_type::uint8:
+		return 1;
+	case array_type::uint16:
+		return 2;
+	case array_type::int32:
+	case array_type::uint32:
+	case array_type::float32:
+		return 4;
+	case array_type::uint64:
+		return 8;
+	}
+
+	return 0;
+}
+
+std::size_t utf8_sequence_length(std::string_view text) {
+	auto byte = [&](std::size_t i) { return static_cast<unsigned char>(text[i]); };
+	auto continuation = [&](std::size_t i) { return i < text.size() && (byte(i) & 0xC0) == 0x80; };
+
+	auto lead = byte(0);
+	std::size_t length;
+	unsigned char min = 0x80, max = 0xBF;
+
+	if (lead >= 0xC2 && lead <= 0xDF) {
+		length = 2;
+	} else if (lead >= 0xE0 && lead <= 0xEF) {
+		length = 3;
+		if (lead == 0xE0)
+			min = 0xA0;
+		if (lead == 0xED)
+			max = 0x9F;
+	} else if (lead >= 0xF0 && lead <= 0xF4) {
+		length = 4;
+		if (lead == 0xF0)
+			min = 0x90;
+		if (lead == 0xF4)
+			max = 0x8F;
+	} else {
+		return 0;
+	}
+
+	if (text.size() < length || byte(1) < min || byte(1) > max)
+		return 0;
+
+	for (std::size_t i = 2; i < length; ++i) {
+		if (!continuation(i))
+			return 0;
+	}
+
+	return length;
+}
+
+json_writer::json_writer(std::FILE* out, int indent) : _m_out(out), _m_indent(indent) {}
+
+json_writer::~json_writer() {
+	// write errors are only reported by explicit calls to flush()
+	try {
+		flush();
+	} catch (const std::system_error&) {
+	}
+}
+
+void json_writer::begin_object() {
+	_begin_value();
+	_put("{");
+	_m_counts.push_back(0);
+}
+
+void json_writer::end_object() {
+	_end_container('}');
+}
+
+void json_writer::begin_array() {
+	_begin_value();
+	_put("[");
+	_m_counts.push_back(0);
+}
+
+void json_writer::end_array() {
+	_end_container(']');
+}
+
+void json_writer::key(std::string_view name) {
+	_begin_value();
+	_escape(name);
+	_put(_m_indent < 0 ? ":" : ": ");
+	_m_after_key = true;
+}
+
+void json_writer::null() {
+	_begin_value();
+	_put("null");
+}
+
+void json_writer::boolean(bool value) {
+	_begin_value();
+	_put(value ? "true" : "false");
+}
+
+void json_writer::integer(std::int64_t value) {
+	_begin_value();
+	fmt::format_to(std::back_inserter(_m_buffer), "{}", value);
+}
+
+void json_writer::unsigned_integer(std::uint64_t value) {
+	_begin_value();
+	fmt::format_to(std::back_inserter(_m_buffer), "{}", value);
+}
+
+void json_writer::number(float value) {
+	if (!std::isfinite(value))
+		return null();
+
+	// floats are formatted with the shortest representation which parses back to the same float
+	_begin_value();
+	auto start = _m_buffer.size();
+	fmt::format_to(std::back_inserter(_m_buffer), "{}", value);
+
+	if (_m_buffer.find_first_of(".en", start) == std::string::npos)
+		_put(".0");
+}
+
+void json_writer::number(double value) {
+	if (!std::isfinite(value))
+		return null();
+
+	_begin_value();
+	auto start = _m_buffer.size();
+	fmt::format_to(std::back_inserter(_m_buffer), "{}", value);
+
+	if (_m_buffer.find_first_of(".en", start) == std::string::npos)
+		_put(".0");
+}
+
+void json_writer::string(std::string_view value) {
+	_begin_value();
+	_escape(value);
+}
+
+bool json_writer::binary_array(const typed_array& array) {
+	if (_m_sidecar == nullptr || !is_little_endian())
+		return false;
+
+	static constexpr char PADDING[SIDECAR_ALIGNMENT] = {};
+	auto padding = (SIDECAR_ALIGNMENT - _m_sidecar_size % SIDECAR_ALIGNMENT) % SIDECAR_ALIGNMENT;
+	auto size = array.count * array.components * array_type_size(array.type);
+
+	if (std::fwrite(PADDING, 1, padding, _m_sidecar) != padding ||
+	    std::fwrite(array.data, 1, size, _m_sidecar) != size)
+		throw std::system_error(errno, std::generic_category(), "cannot write to the sidecar file");
+
+	_m_sidecar_size += padding;
+
+	begin_object();
+	key("dtype");
+	string(array_type_name(array.type));
+	key("shape");
+	write_shape(*this, array);
+	key("offset");
+	unsigned_integer(_m_sidecar_size);
+	key("byteLength");
+	unsigned_integer(size);
+	end_object();
+
+	_m_sidecar_size += size;
+	return true;
+}
+
+void json_writer::use_sidecar(std::FILE* sidecar) {
+	_m_sidecar = sidecar;
+	_m_sidecar_size = 0;
+}
+
+void json_writer::flush() {
+	if (_m_out == nullptr)
+		return;
+
+	_drain();
+	if (std::fflush(_m_out) != 0)
+		throw std::system_error(errno, std::generic_category(), "cannot write the output");
+}
+
+std::string json_writer::release() {
+	auto text = std::move(_m_buffer);
+	_m_buffer.clear();
+	return text;
+}
+
+void json_writer::_begin_value() {
+	if (_m_out != nullptr && _m_buffer.size() >= FLUSH_THRESHOLD)
+		_drain();
+
+	if (_m_after_key) {
+		_m_after_key = false;
+		return;
+	}
+
+	if (_m_counts.empty())
+		return;
+
+	if (_m_counts.back()++ > 0)
+		_put(",");
+
+	_newline();
+}
+
+void json_writer::_end_container(char close) {
+	auto count = _m_counts.back();
+	_m_counts.pop_back();
+
+	if (count > 0)
+		_newline();
+
+	_m_buffer.push_back(close);
+}
+
+void json_writer::_newline() {
+	if (_m_indent < 0)
+		return;
+
+	_m_buffer.push_back('\n');
+	_m_buffer.append(_m_counts.size() * static_cast<std::size_t>(_m_indent), ' ');
+}
+
+void json_writer::_escape(std::string_view value) {
+	static constexpr const char* HEX = "0123456789abcdef";
+	_m_buffer.push_back('"');
+
+	for (std::size_t i = 0; i < value.size();) {
+		auto c = static_cast<unsigned char>(value[i]);
+
+		if (c >= 0x80) {
+			auto length = utf8_sequence_length(value.substr(i));
+
+			if (length == 0) {
+				_put("\xEF\xBF\xBD");
+				i += 1;
+			} else {
+				_put(value.substr(i, length));
+				i += length;
+			}
+
+			continue;
+		}
+
+		switch (c) {
+		case '"':
+			_put("\\\"");
+			break;
+		case '\\':
+			_put("\\\\");
+			break;
+		case '\b':
+			_put("\\b");
+			break;
+		case '\f':
+			_put("\\f");
+			break;
+		case '\n':
+			_put("\\n");
+			break;
+		case '\r':
+			_put("\\r");
+			break;
+		case '\t':
+			_put("\\t");
+			break;
+		default:
+			if (c < 0x20) {
+				_put("\\u00");
+				_m_buffer.push_back(HEX[c >> 4]);
+				_m_buffer.push_back(HEX[c & 0xF]);
+			} else {
+				_m_buffer.push_back(static_cast<char>(c));
+			}
+			break;
+		}
+
+		i += 1;
+	}
+
+	_m_buffer.push_back('"');
+}
+
+void json_writer::_put(std::string_view data) {
+	_m_buffer.append(data);
+}
+
+void json_writer::_drain() {
+	if (std::fwrite(_m_buffer.data(), 1, _m_buffer.size(), _m_out) != _m_buffer.size())
+		throw std::system_error(errno, std::generic_category(), "cannot write the output");
+
+	_m_buffer.clear();
+}
+
+namespace bson {
+	static constexpr std::uint8_t DOUBLE = 0x01;
+	static constexpr std::uint8_t STRING = 0x02;
+	static constexpr std::uint8_t DOCUMENT = 0x03;
+	static constexpr std::uint8_t ARRAY = 0x04;
+	static constexpr std::uint8_t BINARY = 0x05;
+	static constexpr std::uint8_t BOOLEAN = 0x08;
+	static constexpr std::uint8_t NULL_ = 0x0A;
+	static constexpr std::uint8_t INT32 = 0x10;
+	static constexpr std::uint8_t INT64 = 0x12;
+} // namespace bson
+
+bson_writer::bson_writer(std::FILE* out) : _m_out(out) {}
+
+bson_writer::~bson_writer() {
+	// write errors are only reported by explicit calls to flush()
+	try {
+		flush();
+	} catch (const std::system_error&) {
+	}
+}
+
+void bson_writer::begin_object() {
+	_begin_document(bson::DOCUMENT, false);
+}
+
+void bson_writer::end_object() {
+	_end_document();
+}
+
+void bson_writer::begin_array() {
+	_begin_document(bson::ARRAY, true);
+}
+
+void bson_writer::end_array() {
+	_end_document();
+}
+
+void bson_writer::key(std::string_view name) {
+	_m_key = name;
+}
+
+void bson_writer::null() {
+	_element(bson::NULL_);
+}
+
+void bson_writer::boolean(bool value) {
+	_element(bson::BOOLEAN);
+	_m_buffer.push_back(value ? '\x01' : '\x00');
+}
+
+void bson_writer::integer(std::int64_t value) {
+	if (value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max()) {
+		_element(bson::INT32);
+		_put_uint(static_cast<std::uint32_t>(static_cast<std::int32_t>(value)), 4);
+	} else {
+		_element(bson::INT64);
+		_put_uint(static_cast<std::uint64_t>(value), 8);
+	}
+}
+
+void bson_writer::unsigned_integer(std::uint64_t value) {
+	if (value > static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()))
+		throw std::out_of_range {fmt::format("integer {} cannot be represented by BSON", value)};
+
+	integer(static_cast<std::int64_t>(value));
+}
+
+void bson_writer::number(float value) {
+	number(static_cast<double>(value));
+}
+
+void bson_writer::number(double value) {
+	std::uint64_t bits;
+	std::memcpy(&bits, &value, sizeof bits);
+
+	_element(bson::DOUBLE);
+	_put_uint(bits, 8);
+}
+
+void bson_writer::string(std::string_view value) {
+	_element(bson::STRING);
+	_put_uint(value.size() + 1, 4);
+	_m_buffer.append(value);
+	_m_buffer.push_back('\0');
+}
+
+bool bson_writer::binary_array(const typed_array& array) {
+	auto size = array.count * array.components * array_type_size(array.type);
+	if (!_m_binary_arrays || !is_little_endian() || size > std::numeric_limits<std::int32_t>::max())
+		return false;
+
+	begin_object();
+	key("dtype");
+	string(array_type_name(array.type));
+	key("shape");
+	write_shape(*this, array);
+
+	// generic binary subtype
+	key("data");
+	_element(bson::BINARY);
+	_put_uint(size, 4);
+	_m_buffer.push_back('\x00');
+	_m_buffer.append(static_cast<const char*>(array.data), size);
+	end_object();
+	return true;
+}
+
+void bson_writer::use_binary_arrays(bool enabled) noexcept {
+	_m_binary_arrays = enabled;
+}
+
+void bson_writer::flush() {
+	if (_m_out == nullptr)
+		return;
+
+	// incomplete documents stay buffered since their size is not known yet
+	if (_m_frames.empty() && !_m_buffer.empty()) {
+		if (std::fwrite(_m_buffer.data(), 1, _m_buffer.size(), _m_out) != _m_buffer.size())
+			throw std::system_error(errno, std::generic_category(), "cannot write the output");
+
+		_m_buffer.clear();
+	}
+
+	if (std::fflush(_m_out) != 0)
+		throw std::system_error(errno, std::generic_category(), "cannot write the output");
+}
+
+std::string bson_writer::release() {
+	if (!_m_frames.empty())
+		throw std::logic_error {"cannot release an incomplete BSON document"};
+
+	auto data = std::move(_m_buffer);
+	_m_buffer.clear();
+	return data;
+}
+
+void bson_writer::_element(std::uint8_t type) {
+	if (_m_frames.empty())
+		throw std::logic_error {"BSON only supports objects as top-level values"};
+
+	_m_buffer.push_back(static_cast<char>(type));
+
+	auto& parent = _m_frames.back();
+	if (parent.array) {
+		fmt::format_to(std::back_inserter(_m_buffer), "{}", parent.index++);
+	} else {
+		_m_buffer.append(_m_key);
+	}
+
+	_m_buffer.push_back('\0');
+}
+
+void bson_writer::_begin_document(std::uint8_t type, bool array) {
+	if (!_m_frames.empty()) {
+		_element(type);
+	} else if (array) {
+		throw std::logic_error {"BSON only supports objects as top-level values"};
+	}
+
+	_m_frames.push_back({_m_buffer.size(), array, 0});
+	_put_uint(0, 4);
+}
+
+void bson_writer::_end_document() {
+	_m_buffer.push_back('\0');
+
+	auto start = _m_frames.back().start;
+	auto size = static_cast<std::uint32_t>(_m_buffer.size() - start);
+	_m_frames.pop_back();
+
+	for (unsigned i = 0; i < 4; ++i) {
+		_m_buffer[start + i] = static_cast<char>((size >> (i * 8)) & 0xFF);
+	}
+
+	if (_m_frames.empty() && _m_buffer.size() >= FLUSH_THRESHOLD)
+		flush();
+}
+
+void bson_writer::_put_uint(std::uint64_t value, unsigned size) {
+	for (unsigned i = 0; i < size; ++i) {
+		_m_buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+	}
+}
+
+std::unique_ptr<writer> make_writer(std::FILE* out, const output_options& options) {
+	if (options.bson) {
+		auto result = std::make_unique<bson_writer>(out);
+		result->use_binary_arrays(options.typed_arrays);
+		return result;
+	}
+
+	auto result = std::make_unique<json_writer>(out, options.indent);
+	if (options.typed_arrays)
+		result->use_sidecar(options.sidecar);
+	return result;
+}
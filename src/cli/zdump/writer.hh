@@ -0,0 +1,239 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/// \brief The element types of typed arrays.
+enum class array_type {
+	uint8,
+	uint16,
+	int32,
+	uint32,
+	uint64,
+	float32,
+};
+
+/// \brief A contiguous array of numbers in the host's byte order.
+///
+/// Each of the `count` rows of the array consists of `components` numbers, so an array of 3D vectors has three
+/// components per row.
+struct typed_array {
+	array_type type;
+	const void* data;
+	std::size_t count;
+	std::size_t components;
+
+	/// \brief Where each of the numbers of a row is found within the row's value in the document, as JSON pointers
+	///        like `/position/x`, or `nullptr` if the value of a row is the number itself.
+	const std::string_view* fields {nullptr};
+};
+
+/// \return The name of the array type as understood by `numpy.dtype`.
+std::string_view array_type_name(array_type type);
+
+/// \return The size of a single number of the given type in bytes.
+std::size_t array_type_size(array_type type);
+
+/// \return The length of the valid UTF-8 sequence at the start of the given text or 0 if it is invalid.
+std::size_t utf8_sequence_length(std::string_view text);
+
+/// \brief Receives a document as a sequence of events and encodes it straight to its output.
+///
+/// Values are passed in the order they appear in the document, thus nothing but the current nesting has to be kept
+/// in memory. Inside of objects, every value has to be preceded by a call to key().
+class writer {
+public:
+	virtual ~writer() = default;
+
+	/// \brief Checks whether the member of the current object with the given name is part of the output.
+	///
+	/// Serializers call this before key() to skip producing values which would be discarded anyway.
+	virtual bool select(std::string_view name) {
+		(void) name;
+		return true;
+	}
+
+	/// \brief Checks whether the element of the current array at the given index is part of the output.
+	virtual bool select(std::size_t index) {
+		(void) index;
+		return true;
+	}
+
+	virtual void begin_object() = 0;
+	virtual void end_object() = 0;
+	virtual void begin_array() = 0;
+	virtual void end_array() = 0;
+
+	/// \brief Sets the name of the next value written into the current object.
+	virtual void key(std::string_view name) = 0;
+
+	virtual void null() = 0;
+	virtual void boolean(bool value) = 0;
+	virtual void integer(std::int64_t value) = 0;
+	virtual void unsigned_integer(std::uint64_t value) = 0;
+	virtual void number(float value) = 0;
+	virtual void number(double value) = 0;
+	virtual void string(std::string_view value) = 0;
+
+	/// \brief Writes a numeric array as a single binary value if the writer supports it.
+	///
+	/// Binary arrays are written as little-endian data, described by an object with the keys `dtype` and `shape`.
+	/// \param array The array to write.
+	/// \return `false` if nothing was written and the caller has to write the elements one by one instead.
+	virtual bool binary_array(const typed_array& array) {
+		(void) array;
+		return false;
+	}
+
+	/// \brief Writes all buffered data to the output.
+	///
+	/// Writers flush when they are destroyed as well but only an explicit call reports errors.
+	/// \throws std::system_error if the output cannot be written.
+	virtual void flush() = 0;
+
+	/// \brief Takes the data kept in memory by a writer without an output file.
+	/// \return All complete documents written since the last call.
+	[[nodiscard]] virtual std::string release() = 0;
+};
+
+/// \brief Encodes documents as JSON text.
+///
+/// Strings are expected to be UTF-8. Invalid sequences are replaced by U+FFFD and non-finite numbers are written as
+/// `null`, just like `nlohmann::json::dump` does with `error_handler_t::replace`.
+class json_writer final : public writer {
+public:
+	/// \param out The file to write the text to or `nullptr` to keep it in memory until release() is called.
+	/// \param indent The number of spaces to indent nested values by or a negative value to write everything on a
+	///               single line.
+	explicit json_writer(std::FILE* out, int indent = 4);
+	~json_writer() override;
+
+	void begin_object() override;
+	void end_object() override;
+	void begin_array() override;
+	void end_array() override;
+	void key(std::string_view name) override;
+
+	void null() override;
+	void boolean(bool value) override;
+	void integer(std::int64_t value) override;
+	void unsigned_integer(std::uint64_t value) override;
+	void number(float value) override;
+	void number(double value) override;
+	void string(std::string_view value) override;
+	bool binary_array(const typed_array& array) override;
+
+	void flush() override;
+
+	/// \brief Writes binary arrays to the given file from now on.
+	///
+	/// Instead of their data, the JSON output then contains the `offset` and `byteLength` of each array in the
+	/// sidecar file. Arrays are aligned to 16 bytes.
+	/// \param sidecar The file to append the arrays to or `nullptr` to write them as JSON again.
+	void use_sidecar(std::FILE* sidecar);
+
+	[[nodiscard]] std::string release() override;
+
+private:
+	void _begin_value();
+	void _end_container(char close);
+	void _newline();
+	void _escape(std::string_view value);
+	void _put(std::string_view data);
+	void _drain();
+
+private:
+	std::FILE* _m_out;
+	int _m_indent;
+	bool _m_after_key {false};
+
+	std::FILE* _m_sidecar {nullptr};
+	std::uint64_t _m_sidecar_size {0};
+
+	/// \brief The number of values written into each open object or array.
+	std::vector<std::size_t> _m_counts {};
+	std::string _m_buffer {};
+};
+
+/// \brief Encodes documents as BSON.
+///
+/// Because BSON prefixes every document with its size, each top-level document is buffered until it is complete.
+/// Nested documents are never copied; their sizes are patched in once they are closed.
+class bson_writer final : public writer {
+public:
+	/// \param out The file to write the documents to or `nullptr` to keep them in memory until release() is called.
+	explicit bson_writer(std::FILE* out);
+	~bson_writer() override;
+
+	void begin_object() override;
+	void end_object() override;
+	void begin_array() override;
+	void end_array() override;
+	void key(std::string_view name) override;
+
+	void null() override;
+	void boolean(bool value) override;
+	void integer(std::int64_t value) override;
+	void unsigned_integer(std::uint64_t value) override;
+	void number(float value) override;
+	void number(double value) override;
+	void string(std::string_view value) override;
+	bool binary_array(const typed_array& array) override;
+
+	void flush() override;
+
+	/// \brief Sets whether to write arrays passed to binary_array() as BSON binary values.
+	void use_binary_arrays(bool enabled) noexcept;
+
+	[[nodiscard]] std::string release() override;
+
+private:
+	struct frame {
+		std::size_t start;
+		bool array;
+		std::uint32_t index;
+	};
+
+	void _element(std::uint8_t type);
+	void _begin_document(std::uint8_t type, bool array);
+	void _end_document();
+	void _put_uint(std::uint64_t value, unsigned size);
+
+private:
+	std::FILE* _m_out;
+	bool _m_binary_arrays {false};
+	std::string _m_key {};
+	std::vector<frame> _m_frames {};
+	std::string _m_buffer {};
+};
+
+class selection;
+
+/// \brief Options for encoding documents.
+struct output_options {
+	/// \brief Whether to write BSON instead of JSON.
+	bool bson {false};
+
+	/// \brief Whether to write large numeric arrays as binary values. For JSON, this requires a sidecar file.
+	bool typed_arrays {false};
+
+	/// \brief The file binary arrays of JSON documents are written to.
+	std::FILE* sidecar {nullptr};
+
+	/// \brief The number of spaces JSON documents are indented by or a negative value for single-line documents.
+	int indent {4};
+
+	/// \brief The parts of each document to write or `nullptr` to write whole documents.
+	const selection* paths {nullptr};
+};
+
+/// \brief Creates a writer for the given options.
+/// \param out The file to write to or `nullptr` to keep the output in memory.
+/// \param options The encoding options.
+/// \return The new writer.
+std::unique_ptr<writer> make_writer(std::FILE* out, const output_options& options);
@@ -0,0 +1,261 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "batch.hh"
+#include "gltf.hh"
+#include "indexed_mesh.hh"
+#include "optimize.hh"
+#include "parts.hh"
+#include "wavefront.hh"
+
+#include <phoenix/model.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <fmt/format.h>
+
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <system_error>
+#include <unordered_set>
+#include <vector>
+
+static constexpr std::string_view BATCH_FORMATS[] = {"MRM", "MSH", "MMB", "MDL", "MDM"};
+
+namespace {
+	/// \brief The result of converting a single file.
+	struct batch_result {
+		std::uint64_t input_bytes {0};
+		std::uint64_t output_bytes {0};
+		double seconds {0};
+		bool failed {false};
+		std::vector<px::material> materials {};
+	};
+} // namespace
+
+bool match_pattern(std::string_view pattern, std::string_view name) {
+	std::size_t p = 0, n = 0;
+	std::size_t star = std::string_view::npos, resume = 0;
+
+	auto same = [](char a, char b) {
+		return std::toupper(static_cast<unsigned char>(a)) == std::toupper(static_cast<unsigned char>(b));
+	};
+
+	while (n < name.size()) {
+		if (p < pattern.size() && (pattern[p] == '?' || (pattern[p] != '*' && same(pattern[p], name[n])))) {
+			++p;
+			++n;
+		} else if (p < pattern.size() && pattern[p] == '*') {
+			// remember the star and first try to let it match nothing
+			star = p++;
+			resume = n;
+		} else if (star != std::string_view::npos) {
+			// let the last star swallow one more character
+			p = star + 1;
+			n = ++resume;
+		} else {
+			return false;
+		}
+	}
+
+	while (p < pattern.size() && pattern[p] == '*') {
+		++p;
+	}
+
+	return p == pattern.size();
+}
+
+/// \brief Collects all files matching the pattern with a supported extension.
+static void collect_entries(const std::set<px::vdf_entry, px::vdf_entry_comparator>& entries,
+                            std::string_view pattern,
+                            std::vector<const px::vdf_entry*>& result) {
+	for (const auto& entry : entries) {
+		if (entry.is_directory()) {
+			collect_entries(entry.children, pattern, result);
+			continue;
+		}
+
+		auto dot = entry.name.rfind('.');
+		if (dot == std::string::npos || !match_pattern(pattern, entry.name))
+			continue;
+
+		auto extension = std::string_view {entry.name}.substr(dot + 1);
+		for (auto format : BATCH_FORMATS) {
+			if (px::iequals(extension, format)) {
+				result.push_back(&entry);
+				break;
+			}
+		}
+	}
+}
+
+/// \brief Converts a single file and writes it to the output directory.
+static batch_result
+convert_entry(const px::vdf_entry& entry, const batch_options& options, pstudio::thread_pool& pool) {
+	auto start = std::chrono::steady_clock::now();
+	batch_result result {};
+
+	auto in = entry.open();
+	result.input_bytes = in.limit();
+
+	auto extension = entry.name.substr(entry.name.rfind('.') + 1);
+	auto stem = entry.name.substr(0, entry.name.rfind('.'));
+	auto path = options.output / fmt::format("{}.{}", entry.name, options.binary ? "glb" : "obj");
+
+	auto write_mesh = [&](indexed_mesh&& mesh) {
+		if (options.optimize)
+			optimize_mesh(mesh);
+
+		std::ofstream out {path, options.binary ? std::ios::binary : std::ios::out};
+		if (!out)
+			throw std::system_error(errno, std::generic_category(), "cannot open " + path.string());
+
+		if (options.binary) {
+			dump_gltf(out, mesh);
+		} else {
+			dump_wavefront(out, nullptr, options.material_library, mesh);
+		}
+
+		result.materials = std::move(mesh.materials);
+	};
+
+	// Models are written using the same pool. Its parallel_for() runs inline when called from a worker.
+	auto write_model = [&](const px::model_mesh& mesh, const px::model_hierarchy* hierarchy) {
+		auto parts = collect_model_parts(mesh, hierarchy);
+
+		if (options.binary) {
+			std::ofstream out {path, std::ios::binary};
+			if (!out)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + path.string());
+
+			dump_gltf(out, parts, hierarchy, pool);
+		} else {
+			std::FILE* out = std::fopen(path.string().c_str(), "wb");
+			if (out == nullptr)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + path.string());
+
+			dump_wavefront(out, nullptr, options.material_library, parts, pool);
+			std::fclose(out);
+		}
+
+		result.materials = collect_materials(parts);
+	};
+
+	if (px::iequals(extension, "MRM")) {
+		write_mesh(to_indexed_mesh(px::proto_mesh::parse(in), stem));
+	} else if (px::iequals(extension, "MSH")) {
+		write_mesh(to_indexed_mesh(px::mesh::parse(in, {})));
+	} else if (px::iequals(extension, "MMB")) {
+		write_mesh(to_indexed_mesh(px::morph_mesh::parse(in).mesh, stem));
+	} else if (px::iequals(extension, "MDL")) {
+		auto mdl = px::model::parse(in);
+		write_model(mdl.mesh, &mdl.hierarchy);
+	} else {
+		write_model(px::model_mesh::parse(in), nullptr);
+	}
+
+	result.output_bytes = std::filesystem::file_size(path);
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
+
+std::map<std::string, batch_stats>
+convert_batch(const px::vdf_file& vdf, const batch_options& options, pstudio::thread_pool& pool) {
+	std::vector<const px::vdf_entry*> entries {};
+	collect_entries(vdf.entries, options.pattern, entries);
+	std::filesystem::create_directories(options.output);
+
+	std::vector<std::future<batch_result>> futures {};
+	futures.reserve(entries.size());
+
+	for (const auto* entry : entries) {
+		futures.push_back(pool.submit([entry, &options, &pool] {
+			try {
+				return convert_entry(*entry, options, pool);
+			} catch (const std::exception& e) {
+				fmt::print(stderr, "cannot convert {}: {}\n", entry->name, e.what());
+
+				batch_result result {};
+				result.failed = true;
+				return result;
+			}
+		}));
+	}
+
+	std::map<std::string, batch_stats> stats {};
+	std::vector<px::material> materials {};
+	std::unordered_set<std::string> material_names {};
+
+	// results are collected in catalog order so that the material library does not depend on scheduling
+	for (std::size_t i = 0; i < entries.size(); ++i) {
+		auto result = futures[i].get();
+
+		const auto& name = entries[i]->name;
+		auto extension = name.substr(name.rfind('.') + 1);
+		for (auto& c : extension) {
+			c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+		}
+
+		auto& format = stats[extension];
+		++format.files;
+		format.failed += result.failed ? 1 : 0;
+		format.input_bytes += result.input_bytes;
+		format.output_bytes += result.output_bytes;
+		format.seconds += result.seconds;
+
+		for (auto& material : result.materials) {
+			if (material_names.insert(material.name).second)
+				materials.push_back(std::move(material));
+		}
+	}
+
+	if (!options.binary && !options.material_library.empty()) {
+		std::ofstream mtl {options.output / (options.material_library + ".mtl")};
+		dump_material(mtl, materials);
+	}
+
+	return stats;
+}
+
+void print_batch_summary(std::FILE* out, const std::map<std::string, batch_stats>& stats, double seconds) {
+	constexpr double mib = 1024.0 * 1024.0;
+
+	fmt::print(out,
+	           "{:<6} {:>7} {:>7} {:>11} {:>11} {:>9} {:>10}\n",
+	           "format",
+	           "files",
+	           "failed",
+	           "input MiB",
+	           "output MiB",
+	           "time s",
+	           "MiB/s");
+
+	batch_stats total {};
+	for (const auto& [format, item] : stats) {
+		fmt::print(out,
+		           "{:<6} {:>7} {:>7} {:>11.2f} {:>11.2f} {:>9.3f} {:>10.2f}\n",
+		           format,
+		           item.files,
+		           item.failed,
+		           static_cast<double>(item.input_bytes) / mib,
+		           static_cast<double>(item.output_bytes) / mib,
+		           item.seconds,
+		           item.seconds > 0 ? static_cast<double>(item.input_bytes) / mib / item.seconds : 0.0);
+
+		total.files += item.files;
+		total.failed += item.failed;
+		total.input_bytes += item.input_bytes;
+		total.output_bytes += item.output_bytes;
+	}
+
+	fmt::print(out,
+	           "total  {:>7} {:>7} {:>11.2f} {:>11.2f} {:>9.3f} {:>10.2f}\n",
+	           total.files,
+	           total.failed,
+	           static_cast<double>(total.input_bytes) / mib,
+	           static_cast<double>(total.output_bytes) / mib,
+	           seconds,
+	           seconds > 0 ? static_cast<double>(total.input_bytes) / mib / seconds : 0.0);
+}
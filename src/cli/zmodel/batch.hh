@@ -0,0 +1,69 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/vdfs.hh>
+
+#include <pstudio/parallel.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <string_view>
+
+namespace px = phoenix;
+
+/// \brief Options for converting many files of a VDF at once.
+struct batch_options {
+	/// \brief A case-insensitive pattern the names of the files to convert have to match. `*` matches any number
+	///        of characters and `?` matches a single character.
+	std::string pattern;
+
+	/// \brief The directory to write the converted files to.
+	std::filesystem::path output;
+
+	/// \brief The name of the shared material library written to the output directory or an empty string to
+	///        omit it. Ignored for glTF output.
+	std::string material_library;
+
+	/// \brief Whether to write binary glTF files instead of Wavefront OBJ files.
+	bool binary;
+
+	/// \brief Whether to optimize single meshes before writing them.
+	bool optimize;
+};
+
+/// \brief Conversion statistics of all files of one format.
+struct batch_stats {
+	std::size_t files {0};
+	std::size_t failed {0};
+	std::uint64_t input_bytes {0};
+	std::uint64_t output_bytes {0};
+
+	/// \brief The sum of the time spent converting each file in seconds.
+	double seconds {0};
+};
+
+/// \brief Checks whether the given name matches a pattern consisting of literal characters, `*` and `?`.
+///
+/// The comparison is case-insensitive.
+bool match_pattern(std::string_view pattern, std::string_view name);
+
+/// \brief Converts all MRM, MSH, MMB, MDL and MDM files of a VDF matching a pattern concurrently.
+///
+/// The VDF's catalog is only read once. Every material is written to the shared material library once, even if it is
+/// used by multiple files. Files which fail to convert are reported to stderr and skipped.
+/// \param vdf The VDF to convert files from.
+/// \param options The conversion options.
+/// \param pool The threads to convert the files on.
+/// \return The statistics for each file extension.
+std::map<std::string, batch_stats>
+convert_batch(const px::vdf_file& vdf, const batch_options& options, pstudio::thread_pool& pool);
+
+/// \brief Prints a table of per-format throughput statistics.
+/// \param out The file to print to.
+/// \param stats The statistics returned by convert_batch().
+/// \param seconds The total wall-clock time of the batch conversion in seconds.
+void print_batch_summary(std::FILE* out, const std::map<std::string, batch_stats>& stats, double seconds);
@@ -0,0 +1,181 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "chunks.hh"
+
+#include <fmt/format.h>
+#include <glm/common.hpp>
+#include <nlohmann/json.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <utility>
+
+namespace {
+	px::bounding_box empty_bbox() {
+		constexpr auto inf = std::numeric_limits<float>::infinity();
+		return {glm::vec3 {inf}, glm::vec3 {-inf}};
+	}
+
+	void extend_bbox(px::bounding_box& bbox, const px::mesh& mesh, std::uint32_t polygon) {
+		for (std::size_t v = polygon * 3; v < polygon * 3 + 3; ++v) {
+			const auto& position = mesh.vertices[mesh.polygons.vertex_indices[v]];
+			bbox.min = glm::min(bbox.min, position);
+			bbox.max = glm::max(bbox.max, position);
+		}
+	}
+} // namespace
+
+std::vector<mesh_chunk> partition_by_bsp(const px::mesh& mesh, const px::bsp_tree& tree, std::size_t max_polygons) {
+	const auto& nodes = tree.nodes;
+	auto polygon_count = mesh.polygons.material_indices.size();
+
+	// the number of polygon references in every sub-tree, accumulated bottom-up. Children always come
+	// after their parent in the node list, so a reverse pass visits them first.
+	std::vector<std::size_t> references(nodes.size(), 0);
+	for (auto i = nodes.size(); i-- > 0;) {
+		if (nodes[i].is_leaf())
+			references[i] += nodes[i].polygon_count;
+
+		auto parent = nodes[i].parent_index;
+		if (parent >= 0 && static_cast<std::size_t>(parent) < i)
+			references[static_cast<std::size_t>(parent)] += references[i];
+	}
+
+	std::vector<bool> assigned(polygon_count, false);
+	std::vector<mesh_chunk> chunks {};
+
+	// collects the polygons of all leaves below the given node into a single chunk
+	auto collect = [&](std::int32_t root) {
+		mesh_chunk chunk {fmt::format("node{}", root), empty_bbox(), {}};
+
+		std::vector<std::int32_t> stack {root};
+		while (!stack.empty()) {
+			const auto& node = nodes[static_cast<std::size_t>(stack.back())];
+			stack.pop_back();
+
+			if (node.is_leaf()) {
+				for (auto i = node.polygon_index; i < node.polygon_index + node.polygon_count; ++i) {
+					auto polygon = tree.polygon_indices[i];
+					if (polygon >= polygon_count || assigned[polygon])
+						continue;
+
+					assigned[polygon] = true;
+					chunk.polygons.push_back(polygon);
+					extend_bbox(chunk.bbox, mesh, polygon);
+				}
+			} else {
+				// push back first so that the front child is visited first
+				if (node.back_index >= 0)
+					stack.push_back(node.back_index);
+				if (node.front_index >= 0)
+					stack.push_back(node.front_index);
+			}
+		}
+
+		if (!chunk.polygons.empty())
+			chunks.push_back(std::move(chunk));
+	};
+
+	// descend from every root until the sub-trees are small enough
+	std::vector<std::int32_t> stack {};
+	for (auto i = nodes.size(); i-- > 0;) {
+		if (nodes[i].parent_index < 0)
+			stack.push_back(static_cast<std::int32_t>(i));
+	}
+
+	while (!stack.empty()) {
+		auto index = stack.back();
+		stack.pop_back();
+
+		const auto& node = nodes[static_cast<std::size_t>(index)];
+		if (node.is_leaf() || references[static_cast<std::size_t>(index)] <= max_polygons) {
+			collect(index);
+			continue;
+		}
+
+		if (node.back_index >= 0)
+			stack.push_back(node.back_index);
+		if (node.front_index >= 0)
+			stack.push_back(node.front_index);
+	}
+
+	mesh_chunk rest {"rest", empty_bbox(), {}};
+	for (std::uint32_t polygon = 0; polygon < polygon_count; ++polygon) {
+		if (assigned[polygon])
+			continue;
+
+		rest.polygons.push_back(polygon);
+		extend_bbox(rest.bbox, mesh, polygon);
+	}
+
+	if (!rest.polygons.empty())
+		chunks.push_back(std::move(rest));
+
+	return chunks;
+}
+
+std::vector<mesh_chunk> partition_by_grid(const px::mesh& mesh, float cell_size) {
+	std::map<std::pair<std::int64_t, std::int64_t>, mesh_chunk> cells {};
+	auto polygon_count = mesh.polygons.material_indices.size();
+
+	for (std::uint32_t polygon = 0; polygon < polygon_count; ++polygon) {
+		glm::vec3 centroid {0};
+		for (std::size_t v = polygon * 3; v < polygon * 3 + 3; ++v) {
+			centroid += mesh.vertices[mesh.polygons.vertex_indices[v]];
+		}
+		centroid /= 3.f;
+
+		// the y-axis points up in ZenGin worlds
+		auto x = static_cast<std::int64_t>(std::floor(centroid.x / cell_size));
+		auto z = static_cast<std::int64_t>(std::floor(centroid.z / cell_size));
+
+		auto [it, inserted] = cells.try_emplace({x, z});
+		auto& chunk = it->second;
+
+		if (inserted) {
+			chunk.name = fmt::format("cell_{}_{}", x, z);
+			chunk.bbox = empty_bbox();
+		}
+
+		chunk.polygons.push_back(polygon);
+		extend_bbox(chunk.bbox, mesh, polygon);
+	}
+
+	std::vector<mesh_chunk> chunks {};
+	chunks.reserve(cells.size());
+
+	for (auto& [_, chunk] : cells) {
+		chunks.push_back(std::move(chunk));
+	}
+
+	return chunks;
+}
+
+void dump_chunk_manifest(std::ostream& out,
+                         std::string_view mode,
+                         const std::vector<mesh_chunk>& chunks,
+                         const std::vector<chunk_file>& files) {
+	auto entries = nlohmann::json::array();
+
+	for (std::size_t i = 0; i < chunks.size(); ++i) {
+		const auto& chunk = chunks[i];
+		const auto& file = files[i];
+
+		entries.push_back({
+		    {"name", chunk.name},
+		    {"file", file.path},
+		    {"bbox",
+		     {
+		         {"min", {chunk.bbox.min.z, chunk.bbox.min.y, chunk.bbox.min.x}},
+		         {"max", {chunk.bbox.max.z, chunk.bbox.max.y, chunk.bbox.max.x}},
+		     }},
+		    {"polygons", chunk.polygons.size()},
+		    {"vertices", file.vertices},
+		    {"triangles", file.triangles},
+		});
+	}
+
+	out << nlohmann::json {{"mode", mode}, {"chunks", std::move(entries)}}.dump(2) << "\n";
+}
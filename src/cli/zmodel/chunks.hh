@@ -0,0 +1,70 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/math.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/world.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A spatial tile of a world mesh.
+struct mesh_chunk {
+	/// \brief A name for the chunk which is unique within its world.
+	std::string name;
+
+	/// \brief The bounding box of all vertices of the chunk's polygons.
+	px::bounding_box bbox;
+
+	/// \brief The indices of the polygons in the chunk.
+	std::vector<std::uint32_t> polygons;
+};
+
+/// \brief Partitions a world mesh using its BSP tree.
+///
+/// The tree is split into the largest sub-trees referencing at most \p max_polygons polygons, each of which
+/// becomes one chunk. Polygons referenced by multiple leaves are assigned to the first chunk they appear in and
+/// polygons not referenced by any leaf are collected in a final chunk named `rest`.
+/// \param mesh The world mesh to partition.
+/// \param tree The BSP tree of the world.
+/// \param max_polygons The maximum number of polygons referenced by a chunk unless it is a single leaf.
+/// \return All non-empty chunks.
+std::vector<mesh_chunk> partition_by_bsp(const px::mesh& mesh, const px::bsp_tree& tree, std::size_t max_polygons);
+
+/// \brief Partitions a mesh using a uniform grid in the horizontal plane.
+///
+/// Every polygon is assigned to the cell which contains its centroid.
+/// \param mesh The mesh to partition.
+/// \param cell_size The width and depth of a grid cell.
+/// \return All non-empty chunks ordered by their grid coordinates.
+std::vector<mesh_chunk> partition_by_grid(const px::mesh& mesh, float cell_size);
+
+/// \brief Information about the file a chunk was written to.
+struct chunk_file {
+	/// \brief The path of the file relative to the manifest.
+	std::string path;
+
+	/// \brief The number of vertices written.
+	std::size_t vertices;
+
+	/// \brief The number of triangles written.
+	std::size_t triangles;
+};
+
+/// \brief Writes a JSON manifest listing all chunks of a world and the files they were written to.
+///
+/// Bounding boxes are converted into the coordinate system of the exported files by swapping their X and Z axes.
+/// \param out The stream to write the manifest to.
+/// \param mode The partitioning mode used to create the chunks.
+/// \param chunks The chunks to list.
+/// \param files The file each chunk was written to, in the same order as \p chunks.
+void dump_chunk_manifest(std::ostream& out,
+                         std::string_view mode,
+                         const std::vector<mesh_chunk>& chunks,
+                         const std::vector<chunk_file>& files);
@@ -0,0 +1,526 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "convert.hh"
+#include "chunks.hh"
+#include "gltf.hh"
+#include "indexed_mesh.hh"
+#include "lightmap.hh"
+#include "lod.hh"
+#include "mesh_cache.hh"
+#include "morph.hh"
+#include "optimize.hh"
+#include "parts.hh"
+#include "scene.hh"
+#include "wavefront.hh"
+
+#include <phoenix/vdfs.hh>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <filesystem>
+#include <future>
+#include <iostream>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <unordered_set>
+
+/// \brief The size of the output buffer used by convert_streaming().
+static constexpr std::size_t LOW_MEMORY_BUFFER_SIZE = 1024 * 1024;
+
+std::unique_ptr<std::ofstream> open_output(const std::optional<std::string>& path, std::ios::openmode mode) {
+	if (!path)
+		return nullptr;
+
+	auto out = std::make_unique<std::ofstream>(*path, mode);
+	if (!*out)
+		throw std::system_error(errno, std::generic_category(), "cannot open " + *path);
+	return out;
+}
+
+/// \brief Writes a single mesh to the output.
+template <typename T>
+static void dump(const T& mesh,
+                 const convert_options& options,
+                 pstudio::thread_pool& pool,
+                 const lightmap_atlas* atlas = nullptr) {
+	// world meshes and MSH files are formatted in parallel unless only one thread is requested
+	if constexpr (std::is_same_v<T, px::mesh>) {
+		if (!options.binary && pool.size() > 1) {
+			std::FILE* model_out = options.output ? std::fopen(options.output->c_str(), "wb") : stdout;
+			if (model_out == nullptr)
+				throw std::system_error(errno, std::generic_category(), "cannot open output file");
+
+			std::fflush(stdout);
+			dump_wavefront(model_out,
+			               options.material_out,
+			               options.material_library,
+			               mesh,
+			               pool,
+			               options.group_materials);
+
+			if (model_out != stdout)
+				std::fclose(model_out);
+			return;
+		}
+	}
+
+	auto file = open_output(options.output, options.binary ? std::ios::binary : std::ios::out);
+	std::ostream& model_out = file ? *file : std::cout;
+
+	if constexpr (std::is_same_v<T, indexed_mesh>) {
+		if (options.binary) {
+			dump_gltf(model_out, mesh, atlas);
+		} else {
+			dump_wavefront(model_out, options.material_out, options.material_library, mesh);
+		}
+	} else if (options.binary) {
+		dump_gltf(model_out, mesh);
+	} else if constexpr (std::is_same_v<T, px::mesh>) {
+		dump_wavefront(model_out, options.material_out, options.material_library, mesh, options.group_materials);
+	} else {
+		dump_wavefront(model_out, options.material_out, options.material_library, mesh);
+	}
+
+	model_out.flush();
+}
+
+/// \brief Writes a mesh cache and optionally checks that it reads back identically.
+static bool dump_cache(const indexed_mesh& mesh, const convert_options& options) {
+	auto data = encode_mesh_cache(mesh);
+
+	if (auto file = open_output(options.output, std::ios::binary); file != nullptr) {
+		file->write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	} else {
+		std::cout.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		std::cout.flush();
+	}
+
+	if (!options.verify)
+		return true;
+
+	// written files are read back through a memory-mapping, just like consumers would do it
+	std::optional<std::string> error {};
+	if (options.output) {
+		auto mapped = px::buffer::mmap(*options.output);
+		error = compare_mesh_cache({mapped.array(), static_cast<std::size_t>(mapped.limit())}, mesh);
+	} else {
+		error = compare_mesh_cache({data.data(), data.size()}, mesh);
+	}
+
+	if (error) {
+		fmt::print(stderr, "mesh cache verification failed: {}\n", *error);
+		return false;
+	}
+
+	fmt::print(stderr,
+	           "verified mesh cache: {} vertices, {} triangles, {} bytes\n",
+	           mesh.positions.size(),
+	           mesh.indices.size() / 3,
+	           data.size());
+	return true;
+}
+
+/// \brief Simplifies a single mesh and writes all of its levels of detail.
+template <typename T>
+static bool dump_lods(const T& mesh, const convert_options& options) {
+	if (options.cache) {
+		fmt::print(stderr, "--lods is not supported for zmc output\n");
+		return false;
+	}
+
+	if (!options.binary && !options.output) {
+		fmt::print(stderr, "--lods requires --output to be set for Wavefront output\n");
+		return false;
+	}
+
+	if (options.lightmaps)
+		fmt::print(stderr, "--lightmaps is not supported together with --lods and will be ignored\n");
+
+	std::vector<mesh_lod> levels {};
+	if constexpr (std::is_same_v<T, px::proto_mesh>) {
+		levels = build_mrm_lods(mesh, "mesh", options.lods);
+
+		if (levels.empty()) {
+			fmt::print(stderr, "the mesh contains no usable progressive mesh data, using quadric simplification\n");
+			levels = build_quadric_lods(to_indexed_mesh(mesh, "mesh"), options.lods);
+		}
+	} else {
+		levels = build_quadric_lods(to_indexed_mesh(mesh), options.lods);
+	}
+
+	for (std::size_t i = 0; i < levels.size(); ++i) {
+		auto& level = levels[i];
+		if (i > 0)
+			level.mesh.name = fmt::format("{}_lod{}", level.mesh.name, i);
+		if (options.optimize)
+			optimize_mesh(level.mesh);
+
+		fmt::print(stderr,
+		           "lod {}: {} triangles, {} vertices, error {:.4f}\n",
+		           i,
+		           level.mesh.indices.size() / 3,
+		           level.mesh.positions.size(),
+		           level.error);
+	}
+
+	if (options.binary) {
+		auto file = open_output(options.output, std::ios::binary);
+		std::ostream& model_out = file ? *file : std::cout;
+
+		dump_gltf(model_out, levels);
+		model_out.flush();
+		return true;
+	}
+
+	std::filesystem::path path {*options.output};
+	for (std::size_t i = 0; i < levels.size(); ++i) {
+		auto level_path = path;
+		if (i > 0)
+			level_path.replace_filename(fmt::format("{}_lod{}{}", path.stem().string(), i, path.extension().string()));
+
+		std::ofstream model_out {level_path};
+		dump_wavefront(model_out,
+		               i == 0 ? options.material_out : nullptr,
+		               options.material_library,
+		               levels[i].mesh);
+	}
+
+	return true;
+}
+
+/// \brief Runs the optional processing stages on a single mesh before writing it.
+template <typename T>
+static bool process(const T& mesh, const convert_options& options, pstudio::thread_pool& pool) {
+	if (options.lods > 0)
+		return dump_lods(mesh, options);
+
+	if (!options.optimize && !options.lightmaps && !options.cache) {
+		dump(mesh, options, pool);
+		return true;
+	}
+
+	indexed_mesh indexed {};
+	lightmap_atlas atlas {};
+
+	// indexing already groups the triangles by material, so the original order is measured beforehand
+	auto original_acmr = options.optimize ? compute_acmr(mesh) : 0.f;
+
+	if constexpr (std::is_same_v<T, px::mesh>) {
+		if (options.lightmaps) {
+			atlas = build_lightmap_atlas(mesh, options.lightmap_size, pool);
+			fmt::print(stderr,
+			           "packed {} lightmaps into {} atlas pages of {}x{} pixels, {:.1f}% covered\n",
+			           atlas.textures,
+			           atlas.pages.size(),
+			           atlas.size,
+			           atlas.size,
+			           atlas.coverage * 100);
+		}
+
+		indexed = to_indexed_mesh(mesh, options.lightmaps ? &atlas : nullptr);
+	} else {
+		if (options.lightmaps)
+			fmt::print(stderr, "only world and MSH meshes contain lightmaps\n");
+
+		indexed = to_indexed_mesh(mesh, "mesh");
+	}
+
+	if (options.optimize) {
+		auto corners = indexed.indices.size();
+		auto stats = optimize_mesh(indexed);
+		fmt::print(stderr,
+		           "optimized mesh: {} face corners, {} -> {} vertices, ACMR {:.3f} -> {:.3f}\n",
+		           corners,
+		           stats.vertices_before,
+		           stats.vertices_after,
+		           original_acmr,
+		           stats.acmr_after);
+	}
+
+	if (options.cache)
+		return dump_cache(indexed, options);
+
+	dump(indexed, options, pool, &atlas);
+	return true;
+}
+
+bool convert_mesh(const px::mesh& mesh, const convert_options& options, pstudio::thread_pool& pool) {
+	return process(mesh, options, pool);
+}
+
+bool convert_mesh(const px::proto_mesh& mesh, const convert_options& options, pstudio::thread_pool& pool) {
+	return process(mesh, options, pool);
+}
+
+bool convert_chunks(const px::world& wld, const convert_options& options, pstudio::thread_pool& pool) {
+	if (!options.output) {
+		fmt::print(stderr, "--chunks requires --output to be set\n");
+		return false;
+	}
+
+	if (options.lods > 0)
+		fmt::print(stderr, "--lods is not supported for chunked worlds and will be ignored\n");
+
+	auto mode = phoenix::iequals(options.chunks, "bsp") ? "bsp" : "grid";
+	auto parts = mode == std::string_view {"bsp"}
+	    ? partition_by_bsp(wld.world_mesh, wld.world_bsp_tree, options.chunk_polygons)
+	    : partition_by_grid(wld.world_mesh, options.chunk_size);
+
+	std::filesystem::path manifest_path {*options.output};
+	auto directory = manifest_path.parent_path();
+	auto stem = manifest_path.stem().string();
+
+	if (options.material_out != nullptr)
+		dump_material(*options.material_out, wld.world_mesh.materials);
+
+	std::vector<std::future<chunk_file>> futures {};
+	futures.reserve(parts.size());
+
+	for (const auto& chunk : parts) {
+		futures.push_back(pool.submit([&, chunk]() {
+			lightmap_atlas atlas {};
+			if (options.lightmaps)
+				atlas = build_lightmap_atlas(wld.world_mesh, chunk.polygons, options.lightmap_size, pool);
+
+			auto indexed =
+			    to_indexed_mesh(wld.world_mesh, chunk.polygons, chunk.name, options.lightmaps ? &atlas : nullptr);
+			if (options.optimize)
+				optimize_mesh(indexed);
+
+			auto suffix = options.binary ? "glb" : options.cache ? "zmc" : "obj";
+			chunk_file file {fmt::format("{}_{}.{}", stem, chunk.name, suffix),
+			                 indexed.positions.size(),
+			                 indexed.indices.size() / 3};
+
+			std::ofstream out {directory / file.path,
+			                   options.binary || options.cache ? std::ios::binary : std::ios::out};
+			if (!out)
+				throw std::system_error(errno, std::generic_category(), "cannot open " + file.path);
+
+			if (options.cache) {
+				auto data = encode_mesh_cache(indexed);
+				out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+			} else if (options.binary) {
+				dump_gltf(out, indexed, &atlas);
+			} else {
+				dump_wavefront(out, nullptr, options.material_library, indexed);
+			}
+
+			return file;
+		}));
+	}
+
+	// the tasks reference this frame, so all of them have to be done before a failure is rethrown
+	for (auto& future : futures) {
+		future.wait();
+	}
+
+	std::vector<chunk_file> files {};
+	files.reserve(futures.size());
+
+	for (auto& future : futures) {
+		files.push_back(future.get());
+	}
+
+	std::ofstream manifest {manifest_path};
+	dump_chunk_manifest(manifest, mode, parts, files);
+
+	fmt::print(stderr, "wrote {} chunks\n", parts.size());
+	return true;
+}
+
+void convert_streaming(const px::mesh& mesh, const convert_options& options) {
+	if (options.optimize || options.lightmaps || options.lods > 0 || !options.chunks.empty() || !options.vobs.empty())
+		fmt::print(stderr,
+		           "--optimize, --lightmaps, --lods, --chunks and --vobs are not supported together with "
+		           "--low-memory and will be ignored\n");
+
+	std::vector<char> buffer(LOW_MEMORY_BUFFER_SIZE);
+	std::ofstream file_out {};
+	std::ostream* model_out = &std::cout;
+
+	if (options.output) {
+		// the buffer has to be set before opening the file for it to be used
+		file_out.rdbuf()->pubsetbuf(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+		file_out.open(*options.output);
+		if (!file_out)
+			throw std::system_error(errno, std::generic_category(), "cannot open output file");
+
+		model_out = &file_out;
+	}
+
+	dump_wavefront(*model_out, options.material_out, options.material_library, mesh, options.group_materials);
+	model_out->flush();
+}
+
+void convert_morphs(const px::morph_mesh& mesh, const convert_options& options, pstudio::thread_pool& pool) {
+	if (options.optimize || options.lods > 0 || options.lightmaps)
+		fmt::print(stderr, "--optimize, --lods and --lightmaps are not supported for morph meshes\n");
+
+	auto targets = build_morph_targets(mesh, pool);
+	auto indexed = to_indexed_mesh(mesh.mesh, mesh.name.empty() ? "mesh" : mesh.name);
+
+	std::size_t stored = 0;
+	for (const auto& target : targets.targets) {
+		stored += target.vertices.size();
+	}
+
+	fmt::print(stderr,
+	           "{} morph targets in {} animations, {} of {} vertex offsets stored\n",
+	           targets.targets.size(),
+	           targets.clips.size(),
+	           stored,
+	           targets.targets.size() * indexed.positions.size());
+
+	auto file = open_output(options.output, std::ios::binary);
+	std::ostream& model_out = file ? *file : std::cout;
+
+	dump_gltf(model_out, indexed, targets);
+	model_out.flush();
+}
+
+bool convert_scene(const px::world& wld, const convert_options& options, pstudio::thread_pool& pool) {
+	if (!options.binary && !options.output) {
+		fmt::print(stderr, "--vobs requires --output to be set for Wavefront output\n");
+		return false;
+	}
+
+	if (options.cache) {
+		fmt::print(stderr, "--vobs is not supported for zmc output\n");
+		return false;
+	}
+
+	if (options.lods > 0)
+		fmt::print(stderr, "--lods is not supported together with --vobs and will be ignored\n");
+	if (options.lightmaps)
+		fmt::print(stderr, "--lightmaps is not supported together with --vobs and will be ignored\n");
+
+	std::vector<px::vdf_file> vdfs {};
+	for (const auto& path : options.vobs) {
+		vdfs.push_back(px::vdf_file::open(path));
+	}
+
+	auto scene = collect_vob_instances(wld.world_vobs);
+	auto visuals = convert_visuals(scene.visuals, vdfs, options.optimize, pool);
+
+	auto world = to_indexed_mesh(wld.world_mesh);
+	if (options.optimize)
+		optimize_mesh(world);
+
+	if (options.binary) {
+		auto file = open_output(options.output, std::ios::binary);
+		std::ostream& model_out = file ? *file : std::cout;
+
+		dump_gltf(model_out, world, scene, visuals);
+		model_out.flush();
+	} else {
+		std::filesystem::path path {*options.output};
+		auto directory = path.parent_path();
+
+		std::ofstream model_out {path};
+		dump_wavefront(model_out, nullptr, options.material_library, world);
+
+		// visuals are written concurrently, each into its own file
+		std::vector<std::future<std::string>> futures {};
+		futures.reserve(visuals.size());
+
+		for (const auto& visual : visuals) {
+			futures.push_back(pool.submit([&, mesh = &visual]() {
+				if (mesh->positions.empty())
+					return std::string {};
+
+				auto file = fmt::format("{}.obj", mesh->name);
+				std::ofstream out {directory / file};
+				if (!out)
+					throw std::system_error(errno, std::generic_category(), "cannot open " + file);
+
+				dump_wavefront(out, nullptr, options.material_library, *mesh);
+				return file;
+			}));
+		}
+
+		// the tasks reference this frame, so all of them have to be done before a failure is rethrown
+		for (auto& future : futures) {
+			future.wait();
+		}
+
+		std::vector<std::string> files {};
+		files.reserve(futures.size());
+
+		for (auto& future : futures) {
+			files.push_back(future.get());
+		}
+
+		std::ofstream manifest {directory / fmt::format("{}_vobs.json", path.stem().string())};
+		dump_vob_manifest(manifest, scene, files);
+
+		if (options.material_out != nullptr) {
+			std::vector<px::material> materials {world.materials};
+			std::unordered_set<std::string> names {};
+			for (const auto& mat : materials) {
+				names.insert(mat.name);
+			}
+
+			for (const auto& visual : visuals) {
+				for (const auto& mat : visual.materials) {
+					if (names.insert(mat.name).second)
+						materials.push_back(mat);
+				}
+			}
+
+			dump_material(*options.material_out, materials);
+		}
+	}
+
+	auto converted = std::count_if(visuals.begin(), visuals.end(), [](const indexed_mesh& visual) {
+		return !visual.positions.empty();
+	});
+
+	fmt::print(stderr,
+	           "converted {} of {} visuals placed by {} vobs\n",
+	           converted,
+	           visuals.size(),
+	           scene.instances.size());
+	return true;
+}
+
+bool convert_model(const px::model_mesh& mesh,
+                   const px::model_hierarchy* hierarchy,
+                   const convert_options& options,
+                   pstudio::thread_pool& pool) {
+	if (options.cache) {
+		fmt::print(stderr, "zmc output is not supported for models\n");
+		return false;
+	}
+
+	if (options.optimize)
+		fmt::print(stderr, "--optimize is not supported for models and will be ignored\n");
+	if (options.lods > 0)
+		fmt::print(stderr, "--lods is not supported for models and will be ignored\n");
+
+	auto parts = collect_model_parts(mesh, hierarchy);
+
+	if (options.binary) {
+		auto file = open_output(options.output, std::ios::binary);
+		std::ostream& model_out = file ? *file : std::cout;
+
+		dump_gltf(model_out, parts, hierarchy, pool);
+		model_out.flush();
+	} else {
+		std::FILE* model_out = options.output ? std::fopen(options.output->c_str(), "wb") : stdout;
+		if (model_out == nullptr)
+			throw std::system_error(errno, std::generic_category(), "cannot open output file");
+
+		std::fflush(stdout);
+		dump_wavefront(model_out, options.material_out, options.material_library, parts, pool);
+
+		if (model_out != stdout)
+			std::fclose(model_out);
+	}
+
+	return true;
+}
@@ -0,0 +1,109 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/model_hierarchy.hh>
+#include <phoenix/model_mesh.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+#include <phoenix/world.hh>
+
+#include <pstudio/parallel.hh>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief Options for converting a single file.
+struct convert_options {
+	/// \brief The path to write the model to or `std::nullopt` to write it to stdout.
+	std::optional<std::string> output;
+
+	/// \brief The stream to write the Wavefront material library to or `nullptr` to omit it. Not owned.
+	std::ostream* material_out {nullptr};
+
+	/// \brief The name of the material library referenced by Wavefront output.
+	std::string material_library;
+
+	/// \brief Whether to write binary glTF instead of Wavefront OBJ.
+	bool binary {false};
+
+	/// \brief Whether to write a mesh cache instead of Wavefront OBJ.
+	bool cache {false};
+
+	/// \brief Whether to read written mesh caches back and compare them with the converted mesh.
+	bool verify {false};
+
+	/// \brief Whether to weld vertices and reorder triangles and vertices for GPU cache efficiency.
+	bool optimize {false};
+
+	/// \brief Whether to write each material of world and MSH meshes as a single Wavefront group.
+	bool group_materials {false};
+
+	/// \brief Whether to pack the lightmaps of world and MSH meshes into atlases.
+	bool lightmaps {false};
+
+	/// \brief The width and height of lightmap atlas pages.
+	std::uint32_t lightmap_size {2048};
+
+	/// \brief The number of levels of detail to create in addition to the original mesh.
+	std::size_t lods {0};
+
+	/// \brief How to split worlds into chunks (`bsp` or `grid`) or an empty string to not split them.
+	std::string chunks;
+
+	/// \brief The size of a grid chunk in world units.
+	float chunk_size {5000.f};
+
+	/// \brief The maximum number of polygons per BSP chunk unless it is a single leaf.
+	std::size_t chunk_polygons {20000};
+
+	/// \brief The VDFs to look up the visuals of a world's VOBs in or an empty list to not export them.
+	std::vector<std::string> vobs;
+};
+
+/// \brief Opens a file to write output to.
+/// \param path The path of the file or `std::nullopt` to write to stdout instead.
+/// \param mode The mode to open the file in.
+/// \return The opened file or `nullptr` if \p path is not set.
+/// \throws std::system_error if the file cannot be opened.
+std::unique_ptr<std::ofstream> open_output(const std::optional<std::string>& path, std::ios::openmode mode);
+
+/// \brief Runs the processing stages requested by the options on a single mesh and writes it.
+/// \return `false` if the options are not supported for the mesh, after reporting them to stderr.
+bool convert_mesh(const px::mesh& mesh, const convert_options& options, pstudio::thread_pool& pool);
+
+/// \copydoc convert_mesh(const px::mesh&, const convert_options&, pstudio::thread_pool&)
+bool convert_mesh(const px::proto_mesh& mesh, const convert_options& options, pstudio::thread_pool& pool);
+
+/// \brief Splits a world into chunks, writes them concurrently and lists them in a manifest written to the output.
+/// \return `false` if the options are not supported for chunked worlds, after reporting them to stderr.
+bool convert_chunks(const px::world& wld, const convert_options& options, pstudio::thread_pool& pool);
+
+/// \brief Writes a world or MSH mesh as Wavefront OBJ without creating any copies of it.
+///
+/// The faces are streamed straight from the mesh through a fixed-size buffer on the calling thread. Options which
+/// would require a copy are reported to stderr and ignored.
+void convert_streaming(const px::mesh& mesh, const convert_options& options);
+
+/// \brief Writes a morph mesh together with its animations as binary glTF.
+void convert_morphs(const px::morph_mesh& mesh, const convert_options& options, pstudio::thread_pool& pool);
+
+/// \brief Writes a world mesh and the instanced visuals of its VOBs.
+/// \return `false` if the options are not supported for scenes, after reporting them to stderr.
+bool convert_scene(const px::world& wld, const convert_options& options, pstudio::thread_pool& pool);
+
+/// \brief Writes a model mesh and optionally its hierarchy.
+/// \param hierarchy The hierarchy of the model or `nullptr` if the mesh has none.
+/// \return `false` if the options are not supported for models, after reporting them to stderr.
+bool convert_model(const px::model_mesh& mesh,
+                   const px::model_hierarchy* hierarchy,
+                   const convert_options& options,
+                   pstudio::thread_pool& pool);
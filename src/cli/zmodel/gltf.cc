@@ -0,0 +1,744 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "gltf.hh"
+#include "config.hh"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+static constexpr std::uint32_t GLB_MAGIC = 0x46546C67;
+static constexpr std::uint32_t GLB_VERSION = 2;
+static constexpr std::uint32_t GLB_CHUNK_JSON = 0x4E4F534A;
+static constexpr std::uint32_t GLB_CHUNK_BIN = 0x004E4942;
+
+// Source arrays can only be appended to the binary chunk directly if their memory layout matches what
+// glTF expects, i.e. if vectors consist of tightly packed 32-bit floats.
+static constexpr bool GLM_IS_PACKED = sizeof(glm::vec2) == 2 * sizeof(float) && sizeof(glm::vec3) == 3 * sizeof(float);
+static constexpr bool WEDGES_ARE_PACKED = GLM_IS_PACKED && sizeof(px::wedge) % 4 == 0;
+static constexpr bool FEATURES_ARE_PACKED = GLM_IS_PACKED && sizeof(px::vertex_feature) % 4 == 0;
+static constexpr bool TRIANGLES_ARE_PACKED = sizeof(px::triangle) == 3 * sizeof(std::uint16_t);
+
+static constexpr std::size_t align4(std::size_t v) {
+	return (v + 3) & ~std::size_t {3};
+}
+
+/// \brief Writes a number in little-endian byte order, as GLB headers require, regardless of the host's byte order.
+static void write_u32(std::ostream& out, std::uint32_t v) {
+	char bytes[4];
+	for (std::size_t i = 0; i < sizeof bytes; ++i) {
+		bytes[i] = static_cast<char>((v >> (8 * i)) & 0xFF);
+	}
+
+	out.write(bytes, sizeof bytes);
+}
+
+glb_writer::glb_writer() {
+	_m_json = {
+	    {"asset", {{"version", "2.0"}, {"generator", std::string {"zmodel v"} + ZMODEL_VERSION}}},
+	    {"scene", 0},
+	    {"scenes", {{{"nodes", nlohmann::json::array()}}}},
+	    {"nodes", nlohmann::json::array()},
+	    {"meshes", nlohmann::json::array()},
+	    {"materials", nlohmann::json::array()},
+	    {"textures", nlohmann::json::array()},
+	    {"images", nlohmann::json::array()},
+	    {"accessors", nlohmann::json::array()},
+	    {"animations", nlohmann::json::array()},
+	    {"bufferViews", nlohmann::json::array()},
+	    {"extensionsUsed", nlohmann::json::array()},
+	};
+}
+
+std::uint32_t glb_writer::add_view(const void* data, std::size_t size, std::uint32_t stride) {
+	nlohmann::json view = {{"buffer", 0}, {"byteOffset", _m_size}, {"byteLength", size}};
+	if (stride != 0)
+		view["byteStride"] = stride;
+
+	auto& views = _m_json["bufferViews"];
+	views.push_back(std::move(view));
+	_m_views.push_back({data, size});
+	_m_size += align4(size);
+	return static_cast<std::uint32_t>(views.size() - 1);
+}
+
+std::uint32_t glb_writer::add_accessor(std::uint32_t view,
+                                       std::size_t offset,
+                                       std::uint32_t component,
+                                       std::size_t count,
+                                       const char* type) {
+	auto& accessors = _m_json["accessors"];
+	accessors.push_back({
+	    {"bufferView", view},
+	    {"byteOffset", offset},
+	    {"componentType", component},
+	    {"count", count},
+	    {"type", type},
+	});
+	return static_cast<std::uint32_t>(accessors.size() - 1);
+}
+
+std::uint32_t glb_writer::add_positions(const std::vector<glm::vec3>& positions) {
+	if constexpr (!GLM_IS_PACKED) {
+		return add_positions(std::vector<glm::vec3> {positions});
+	}
+
+	return _add_position_accessor(add_view(positions.data(), positions.size() * sizeof(glm::vec3)), positions);
+}
+
+std::uint32_t glb_writer::add_positions(std::vector<glm::vec3>&& positions) {
+	if constexpr (GLM_IS_PACKED) {
+		auto owned = std::make_shared<std::vector<glm::vec3>>(std::move(positions));
+		_m_owned.push_back(owned);
+		return add_positions(*owned);
+	}
+
+	std::vector<float> packed {};
+	packed.reserve(positions.size() * 3);
+	for (const auto& p : positions) {
+		packed.insert(packed.end(), {p.x, p.y, p.z});
+	}
+
+	return _add_position_accessor(add_view(std::move(packed)), positions);
+}
+
+std::uint32_t glb_writer::_add_position_accessor(std::uint32_t view, const std::vector<glm::vec3>& positions) {
+	auto accessor = add_accessor(view, 0, component_f32, positions.size(), "VEC3");
+	if (positions.empty())
+		return accessor;
+
+	glm::vec3 min {std::numeric_limits<float>::max()};
+	glm::vec3 max {std::numeric_limits<float>::lowest()};
+
+	for (const auto& p : positions) {
+		min = {std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z)};
+		max = {std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z)};
+	}
+
+	auto& object = _m_json["accessors"][accessor];
+	object["min"] = {min.x, min.y, min.z};
+	object["max"] = {max.x, max.y, max.z};
+	return accessor;
+}
+
+std::uint32_t glb_writer::add_sparse_attribute(std::size_t count,
+                                               std::vector<std::uint32_t>&& indices,
+                                               const std::vector<glm::vec3>& values) {
+	// implicit elements are zero, so zero is always within the bounds unless every element is stored
+	glm::vec3 min {values.size() < count ? 0.f : std::numeric_limits<float>::max()};
+	glm::vec3 max {values.size() < count ? 0.f : std::numeric_limits<float>::lowest()};
+
+	std::vector<float> packed {};
+	packed.reserve(values.size() * 3);
+
+	for (const auto& v : values) {
+		packed.insert(packed.end(), {v.x, v.y, v.z});
+		min = {std::min(min.x, v.x), std::min(min.y, v.y), std::min(min.z, v.z)};
+		max = {std::max(max.x, v.x), std::max(max.y, v.y), std::max(max.z, v.z)};
+	}
+
+	if (count == 0)
+		min = max = glm::vec3 {0};
+
+	nlohmann::json accessor = {
+	    {"componentType", component_f32},
+	    {"count", count},
+	    {"type", "VEC3"},
+	    {"min", {min.x, min.y, min.z}},
+	    {"max", {max.x, max.y, max.z}},
+	};
+
+	// accessors without a buffer view are all zeroes, which is what an empty sparse set amounts to
+	if (!indices.empty()) {
+		auto sparse = indices.size();
+		accessor["sparse"] = {
+		    {"count", sparse},
+		    {"indices", {{"bufferView", add_view(std::move(indices))}, {"componentType", component_u32}}},
+		    {"values", {{"bufferView", add_view(std::move(packed))}}},
+		};
+	}
+
+	auto& accessors = _m_json["accessors"];
+	accessors.push_back(std::move(accessor));
+	return static_cast<std::uint32_t>(accessors.size() - 1);
+}
+
+std::uint32_t glb_writer::add_attribute(const std::vector<glm::vec2>& data) {
+	if constexpr (GLM_IS_PACKED) {
+		auto view = add_view(data.data(), data.size() * sizeof(glm::vec2));
+		return add_accessor(view, 0, component_f32, data.size(), "VEC2");
+	}
+
+	std::vector<float> packed {};
+	packed.reserve(data.size() * 2);
+	for (const auto& v : data) {
+		packed.insert(packed.end(), {v.x, v.y});
+	}
+
+	return add_accessor(add_view(std::move(packed)), 0, component_f32, data.size(), "VEC2");
+}
+
+std::uint32_t glb_writer::add_attribute(const std::vector<glm::vec3>& data) {
+	if constexpr (GLM_IS_PACKED) {
+		auto view = add_view(data.data(), data.size() * sizeof(glm::vec3));
+		return add_accessor(view, 0, component_f32, data.size(), "VEC3");
+	}
+
+	std::vector<float> packed {};
+	packed.reserve(data.size() * 3);
+	for (const auto& v : data) {
+		packed.insert(packed.end(), {v.x, v.y, v.z});
+	}
+
+	return add_accessor(add_view(std::move(packed)), 0, component_f32, data.size(), "VEC3");
+}
+
+std::uint32_t glb_writer::add_material(const px::material& mat) {
+	if (auto it = _m_materials.find(mat.name); it != _m_materials.end()) {
+		return it->second;
+	}
+
+	nlohmann::json pbr = {{"metallicFactor", 0.0}, {"roughnessFactor", 1.0}};
+	if (mat.texture.empty()) {
+		pbr["baseColorFactor"] = {
+		    mat.color.r / 255.f,
+		    mat.color.g / 255.f,
+		    mat.color.b / 255.f,
+		    mat.color.a / 255.f,
+		};
+	} else {
+		auto& images = _m_json["images"];
+		auto& textures = _m_json["textures"];
+		images.push_back({{"uri", mat.texture}});
+		textures.push_back({{"source", images.size() - 1}});
+		pbr["baseColorTexture"] = {{"index", textures.size() - 1}};
+	}
+
+	nlohmann::json material = {{"name", mat.name}, {"pbrMetallicRoughness", std::move(pbr)}};
+	if (mat.alpha_func == px::alpha_function::blend) {
+		material["alphaMode"] = "BLEND";
+	}
+
+	auto& materials = _m_json["materials"];
+	materials.push_back(std::move(material));
+
+	auto index = static_cast<std::uint32_t>(materials.size() - 1);
+	_m_materials.emplace(mat.name, index);
+	return index;
+}
+
+std::uint32_t glb_writer::add_mesh(std::string_view name, nlohmann::json&& primitives) {
+	auto& meshes = _m_json["meshes"];
+	meshes.push_back({{"name", name}, {"primitives", std::move(primitives)}});
+	return static_cast<std::uint32_t>(meshes.size() - 1);
+}
+
+std::uint32_t glb_writer::add_animation(nlohmann::json&& animation) {
+	auto& animations = _m_json["animations"];
+	animations.push_back(std::move(animation));
+	return static_cast<std::uint32_t>(animations.size() - 1);
+}
+
+std::uint32_t glb_writer::add_node(nlohmann::json&& node, bool root) {
+	auto& nodes = _m_json["nodes"];
+	nodes.push_back(std::move(node));
+
+	auto index = static_cast<std::uint32_t>(nodes.size() - 1);
+	if (root)
+		_m_json["scenes"][0]["nodes"].push_back(index);
+	return index;
+}
+
+std::uint32_t glb_writer::add_image(std::vector<std::uint8_t>&& data, std::string_view mime_type) {
+	auto view = add_view(std::move(data));
+
+	auto& images = _m_json["images"];
+	auto& textures = _m_json["textures"];
+	images.push_back({{"bufferView", view}, {"mimeType", mime_type}});
+	textures.push_back({{"source", images.size() - 1}});
+	return static_cast<std::uint32_t>(textures.size() - 1);
+}
+
+void glb_writer::use_extension(std::string_view name) {
+	auto& extensions = _m_json["extensionsUsed"];
+	if (std::find(extensions.begin(), extensions.end(), name) == extensions.end())
+		extensions.push_back(name);
+}
+
+nlohmann::json& glb_writer::node(std::uint32_t index) {
+	return _m_json["nodes"][index];
+}
+
+nlohmann::json& glb_writer::mesh(std::uint32_t index) {
+	return _m_json["meshes"][index];
+}
+
+nlohmann::json& glb_writer::accessor(std::uint32_t index) {
+	return _m_json["accessors"][index];
+}
+
+void glb_writer::write(std::ostream& out) const {
+	auto json = _m_json;
+	if (_m_size > 0)
+		json["buffers"] = {{{"byteLength", _m_size}}};
+
+	// glTF forbids empty top-level arrays
+	for (auto it = json.begin(); it != json.end();) {
+		if (it->is_array() && it->empty()) {
+			it = json.erase(it);
+		} else {
+			++it;
+		}
+	}
+
+	auto text = json.dump();
+	text.resize(align4(text.size()), ' ');
+
+	auto length = 12 + 8 + text.size();
+	if (_m_size > 0)
+		length += 8 + _m_size;
+
+	write_u32(out, GLB_MAGIC);
+	write_u32(out, GLB_VERSION);
+	write_u32(out, static_cast<std::uint32_t>(length));
+
+	write_u32(out, static_cast<std::uint32_t>(text.size()));
+	write_u32(out, GLB_CHUNK_JSON);
+	out.write(text.data(), static_cast<std::streamsize>(text.size()));
+
+	if (_m_size == 0)
+		return;
+
+	write_u32(out, static_cast<std::uint32_t>(_m_size));
+	write_u32(out, GLB_CHUNK_BIN);
+
+	static constexpr char padding[4] = {0, 0, 0, 0};
+	for (const auto& view : _m_views) {
+		out.write(static_cast<const char*>(view.data), static_cast<std::streamsize>(view.size));
+		out.write(padding, static_cast<std::streamsize>(align4(view.size) - view.size));
+	}
+}
+
+std::vector<std::vector<glm::vec3>> gather_wedge_positions(const px::proto_mesh& mesh) {
+	std::vector<std::vector<glm::vec3>> positions {};
+	positions.reserve(mesh.sub_meshes.size());
+
+	for (const auto& sub : mesh.sub_meshes) {
+		auto& sub_positions = positions.emplace_back();
+		sub_positions.reserve(sub.wedges.size());
+
+		for (const auto& wedge : sub.wedges) {
+			sub_positions.push_back(mesh.positions[wedge.index]);
+		}
+	}
+
+	return positions;
+}
+
+std::uint32_t add_gltf_mesh(glb_writer& glb, std::string_view name, const px::proto_mesh& mesh) {
+	return add_gltf_mesh(glb, name, mesh, gather_wedge_positions(mesh));
+}
+
+std::uint32_t add_gltf_mesh(glb_writer& glb,
+                            std::string_view name,
+                            const px::proto_mesh& mesh,
+                            std::vector<std::vector<glm::vec3>>&& positions) {
+	auto primitives = nlohmann::json::array();
+
+	for (std::size_t i = 0; i < mesh.sub_meshes.size(); ++i) {
+		const auto& sub = mesh.sub_meshes[i];
+		if (sub.triangles.empty())
+			continue;
+
+		// Every wedge becomes a glTF vertex. Normals and texture coordinates are read directly from the wedge
+		// array, only positions need to be gathered.
+		auto position = glb.add_positions(std::move(positions[i]));
+		std::uint32_t normal;
+		std::uint32_t texture;
+
+		if constexpr (WEDGES_ARE_PACKED) {
+			auto view = glb.add_view(sub.wedges.data(), sub.wedges.size() * sizeof(px::wedge), sizeof(px::wedge));
+			normal = glb.add_accessor(view,
+			                          offsetof(px::wedge, normal),
+			                          glb_writer::component_f32,
+			                          sub.wedges.size(),
+			                          "VEC3");
+			texture = glb.add_accessor(view,
+			                           offsetof(px::wedge, texture),
+			                           glb_writer::component_f32,
+			                           sub.wedges.size(),
+			                           "VEC2");
+		} else {
+			std::vector<float> normals {};
+			std::vector<float> textures {};
+			for (const auto& wedge : sub.wedges) {
+				normals.insert(normals.end(), {wedge.normal.x, wedge.normal.y, wedge.normal.z});
+				textures.insert(textures.end(), {wedge.texture.x, wedge.texture.y});
+			}
+
+			normal = glb.add_accessor(glb.add_view(std::move(normals)),
+			                          0,
+			                          glb_writer::component_f32,
+			                          sub.wedges.size(),
+			                          "VEC3");
+			texture = glb.add_accessor(glb.add_view(std::move(textures)),
+			                           0,
+			                           glb_writer::component_f32,
+			                           sub.wedges.size(),
+			                           "VEC2");
+		}
+
+		std::uint32_t indices;
+		if constexpr (TRIANGLES_ARE_PACKED) {
+			indices = glb.add_accessor(glb.add_view(sub.triangles.data(), sub.triangles.size() * sizeof(px::triangle)),
+			                           0,
+			                           glb_writer::component_u16,
+			                           sub.triangles.size() * 3,
+			                           "SCALAR");
+		} else {
+			std::vector<std::uint16_t> copy {};
+			for (const auto& triangle : sub.triangles) {
+				copy.insert(copy.end(), {triangle.wedges[0], triangle.wedges[1], triangle.wedges[2]});
+			}
+
+			indices = glb.add_accessor(glb.add_view(std::move(copy)),
+			                           0,
+			                           glb_writer::component_u16,
+			                           sub.triangles.size() * 3,
+			                           "SCALAR");
+		}
+
+		primitives.push_back({
+		    {"attributes", {{"POSITION", position}, {"NORMAL", normal}, {"TEXCOORD_0", texture}}},
+		    {"indices", indices},
+		    {"material", glb.add_material(sub.mat)},
+		});
+	}
+
+	return glb.add_mesh(name, std::move(primitives));
+}
+
+std::uint32_t add_gltf_mesh(glb_writer& glb, std::string_view name, const px::mesh& mesh) {
+	static constexpr auto unset = std::numeric_limits<std::uint32_t>::max();
+	const auto& polys = mesh.polygons;
+
+	// Every feature becomes a glTF vertex. A feature is normally only ever used together with one position in
+	// which case the feature array can be used as-is. Features shared between different positions are duplicated.
+	std::vector<std::uint32_t> feature_vertices(mesh.features.size(), unset);
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> duplicates {};
+	std::unordered_map<std::uint64_t, std::uint32_t> duplicate_indices {};
+	std::vector<std::vector<std::uint32_t>> indices(mesh.materials.size());
+
+	for (std::size_t i = 0; i < polys.vertex_indices.size(); ++i) {
+		auto feature = polys.feature_indices[i];
+		auto vertex = polys.vertex_indices[i];
+		auto index = feature;
+
+		if (feature_vertices[feature] == unset) {
+			feature_vertices[feature] = vertex;
+		} else if (feature_vertices[feature] != vertex) {
+			auto key = std::uint64_t {feature} << 32 | vertex;
+			auto duplicate = static_cast<std::uint32_t>(mesh.features.size() + duplicates.size());
+			auto [it, inserted] = duplicate_indices.try_emplace(key, duplicate);
+			index = it->second;
+
+			if (inserted)
+				duplicates.emplace_back(feature, vertex);
+		}
+
+		indices[polys.material_indices[i / 3]].push_back(index);
+	}
+
+	std::vector<glm::vec3> positions {};
+	positions.reserve(mesh.features.size() + duplicates.size());
+	for (auto vertex : feature_vertices) {
+		positions.push_back(vertex == unset ? glm::vec3 {} : mesh.vertices[vertex]);
+	}
+	for (auto [feature, vertex] : duplicates) {
+		positions.push_back(mesh.vertices[vertex]);
+	}
+
+	auto vertex_count = positions.size();
+	auto position = glb.add_positions(std::move(positions));
+
+	std::uint32_t features;
+	if (FEATURES_ARE_PACKED && duplicates.empty()) {
+		features =
+		    glb.add_view(mesh.features.data(), vertex_count * sizeof(px::vertex_feature), sizeof(px::vertex_feature));
+	} else {
+		auto copy = mesh.features;
+		for (auto [feature, vertex] : duplicates) {
+			copy.push_back(mesh.features[feature]);
+		}
+
+		features = glb.add_view(std::move(copy), sizeof(px::vertex_feature));
+	}
+
+	auto normal = glb.add_accessor(features,
+	                               offsetof(px::vertex_feature, normal),
+	                               glb_writer::component_f32,
+	                               vertex_count,
+	                               "VEC3");
+	auto texture = glb.add_accessor(features,
+	                                offsetof(px::vertex_feature, texture),
+	                                glb_writer::component_f32,
+	                                vertex_count,
+	                                "VEC2");
+
+	auto primitives = nlohmann::json::array();
+	for (std::size_t i = 0; i < indices.size(); ++i) {
+		if (indices[i].empty())
+			continue;
+
+		auto count = indices[i].size();
+		primitives.push_back({
+		    {"attributes", {{"POSITION", position}, {"NORMAL", normal}, {"TEXCOORD_0", texture}}},
+		    {"indices",
+		     glb.add_accessor(glb.add_view(std::move(indices[i])), 0, glb_writer::component_u32, count, "SCALAR")},
+		    {"material", glb.add_material(mesh.materials[i])},
+		});
+	}
+
+	return glb.add_mesh(name, std::move(primitives));
+}
+
+std::uint32_t
+add_gltf_mesh(glb_writer& glb, const indexed_mesh& mesh, const std::vector<std::uint32_t>& lightmap_textures) {
+	auto position = glb.add_positions(mesh.positions);
+	auto normal = glb.add_attribute(mesh.normals);
+	auto texture = glb.add_attribute(mesh.uvs);
+	auto indices = glb.add_view(mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t));
+
+	nlohmann::json attributes = {{"POSITION", position}, {"NORMAL", normal}, {"TEXCOORD_0", texture}};
+	if (!mesh.lightmap_uvs.empty())
+		attributes["TEXCOORD_1"] = glb.add_attribute(mesh.lightmap_uvs);
+
+	auto primitives = nlohmann::json::array();
+	for (const auto& primitive : mesh.primitives) {
+		if (primitive.count == 0)
+			continue;
+
+		nlohmann::json item = {
+		    {"attributes", attributes},
+		    {"indices",
+		     glb.add_accessor(indices,
+		                      primitive.offset * sizeof(std::uint32_t),
+		                      glb_writer::component_u32,
+		                      primitive.count,
+		                      "SCALAR")},
+		    {"material", glb.add_material(mesh.materials[primitive.material])},
+		};
+
+		// glTF has no notion of lightmaps, so they're referenced like a textureInfo in the primitive's extras
+		if (primitive.lightmap >= 0 && static_cast<std::size_t>(primitive.lightmap) < lightmap_textures.size()) {
+			auto lightmap = lightmap_textures[static_cast<std::size_t>(primitive.lightmap)];
+			item["extras"] = {{"lightmap", {{"index", lightmap}, {"texCoord", 1}}}};
+		}
+
+		primitives.push_back(std::move(item));
+	}
+
+	return glb.add_mesh(mesh.name, std::move(primitives));
+}
+
+std::uint32_t add_gltf_root(glb_writer& glb, nlohmann::json&& children) {
+	return glb.add_node(
+	    {
+	        {"name", "zengin"},
+	        {"matrix", {0, 0, 1, 0, 0, 1, 0, 0, 1, 0, 0, 0, 0, 0, 0, 1}},
+	        {"children", std::move(children)},
+	    },
+	    true);
+}
+
+void dump_gltf(std::ostream& out, const px::proto_mesh& mesh) {
+	glb_writer glb {};
+	auto node = glb.add_node({{"mesh", add_gltf_mesh(glb, "mesh", mesh)}});
+	add_gltf_root(glb, nlohmann::json::array({node}));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out, const px::mesh& mesh) {
+	glb_writer glb {};
+	auto node = glb.add_node({{"mesh", add_gltf_mesh(glb, mesh.name, mesh)}});
+	add_gltf_root(glb, nlohmann::json::array({node}));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out, const indexed_mesh& mesh, const lightmap_atlas* atlas) {
+	glb_writer glb {};
+
+	std::vector<std::uint32_t> lightmaps {};
+	if (atlas != nullptr) {
+		for (const auto& page : atlas->pages) {
+			lightmaps.push_back(glb.add_image(encode_png(page, atlas->size, atlas->size), "image/png"));
+		}
+	}
+
+	auto node = glb.add_node({{"mesh", add_gltf_mesh(glb, mesh, lightmaps)}});
+	add_gltf_root(glb, nlohmann::json::array({node}));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out, const std::vector<mesh_lod>& lods) {
+	glb_writer glb {};
+	auto base = glb.add_node({{"mesh", add_gltf_mesh(glb, lods[0].mesh)}});
+
+	if (lods.size() > 1) {
+		auto ids = nlohmann::json::array();
+		for (std::size_t i = 1; i < lods.size(); ++i) {
+			ids.push_back(glb.add_node({{"mesh", add_gltf_mesh(glb, lods[i].mesh)}}));
+		}
+
+		glb.use_extension("MSFT_lod");
+		glb.node(base)["extensions"] = {{"MSFT_lod", {{"ids", std::move(ids)}}}};
+	}
+
+	add_gltf_root(glb, nlohmann::json::array({base}));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out,
+               const std::vector<model_part>& parts,
+               const px::model_hierarchy* hierarchy,
+               pstudio::thread_pool& pool) {
+	std::vector<std::vector<std::vector<glm::vec3>>> positions(parts.size());
+	pstudio::parallel_for(pool, parts.size(), 1, [&](std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			positions[i] = gather_wedge_positions(*parts[i].mesh);
+		}
+	});
+
+	glb_writer glb {};
+	auto roots = nlohmann::json::array();
+	std::vector<std::uint32_t> nodes {};
+
+	if (hierarchy != nullptr) {
+		for (const auto& node : hierarchy->nodes) {
+			const auto* matrix = glm::value_ptr(node.transform);
+			nodes.push_back(glb.add_node({{"name", node.name}, {"matrix", std::vector<float>(matrix, matrix + 16)}}));
+		}
+
+		for (std::size_t i = 0; i < hierarchy->nodes.size(); ++i) {
+			auto parent = hierarchy->nodes[i].parent_index;
+
+			if (parent < 0) {
+				roots.push_back(nodes[i]);
+			} else {
+				glb.node(nodes[static_cast<std::size_t>(parent)])["children"].push_back(nodes[i]);
+			}
+		}
+	}
+
+	for (std::size_t i = 0; i < parts.size(); ++i) {
+		const auto& part = parts[i];
+		auto mesh = add_gltf_mesh(glb, part.name, *part.mesh, std::move(positions[i]));
+
+		if (part.node >= 0 && !nodes.empty()) {
+			glb.node(nodes[static_cast<std::size_t>(part.node)])["mesh"] = mesh;
+		} else {
+			roots.push_back(glb.add_node({{"name", part.name}, {"mesh", mesh}}));
+		}
+	}
+
+	add_gltf_root(glb, std::move(roots));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out,
+               const indexed_mesh& world,
+               const vob_scene& scene,
+               const std::vector<indexed_mesh>& visuals) {
+	glb_writer glb {};
+	auto roots = nlohmann::json::array();
+	roots.push_back(glb.add_node({{"name", world.name}, {"mesh", add_gltf_mesh(glb, world)}}));
+
+	std::vector<std::int64_t> meshes(visuals.size(), -1);
+	for (std::size_t i = 0; i < visuals.size(); ++i) {
+		if (!visuals[i].positions.empty())
+			meshes[i] = add_gltf_mesh(glb, visuals[i]);
+	}
+
+	for (const auto& instance : scene.instances) {
+		auto mesh = meshes[instance.visual];
+		if (mesh < 0)
+			continue;
+
+		const auto* matrix = glm::value_ptr(instance.transform);
+		roots.push_back(glb.add_node({
+		    {"name", instance.name.empty() ? scene.visuals[instance.visual] : instance.name},
+		    {"mesh", mesh},
+		    {"matrix", std::vector<float>(matrix, matrix + 16)},
+		}));
+	}
+
+	add_gltf_root(glb, std::move(roots));
+	glb.write(out);
+}
+
+void dump_gltf(std::ostream& out, const indexed_mesh& mesh, const morph_set& morphs) {
+	glb_writer glb {};
+	auto index = add_gltf_mesh(glb, mesh);
+	auto node = glb.add_node({{"name", mesh.name}, {"mesh", index}});
+
+	// all primitives share the same vertices, so they can share the targets as well
+	auto targets = nlohmann::json::array();
+	auto names = nlohmann::json::array();
+
+	for (const auto& target : morphs.targets) {
+		auto vertices = target.vertices;
+		auto position = glb.add_sparse_attribute(mesh.positions.size(), std::move(vertices), target.deltas);
+		targets.push_back({{"POSITION", position}});
+		names.push_back(target.name);
+	}
+
+	if (!morphs.targets.empty()) {
+		auto& object = glb.mesh(index);
+		for (auto& primitive : object["primitives"]) {
+			primitive["targets"] = targets;
+		}
+
+		object["weights"] = std::vector<float>(morphs.targets.size(), 0.f);
+		object["extras"] = {{"targetNames", std::move(names)}};
+	}
+
+	// every animation steps through its own targets by giving each frame's target full weight in turn
+	for (const auto& clip : morphs.clips) {
+		if (clip.frame_count == 0)
+			continue;
+
+		auto target_count = morphs.targets.size();
+		std::vector<float> times(clip.frame_count);
+		std::vector<float> weights(clip.frame_count * target_count, 0.f);
+
+		for (std::uint32_t frame = 0; frame < clip.frame_count; ++frame) {
+			times[frame] = static_cast<float>(frame) * clip.frame_time;
+			weights[frame * target_count + clip.first_target + frame] = 1.f;
+		}
+
+		auto end = times.back();
+		auto input =
+		    glb.add_accessor(glb.add_view(std::move(times)), 0, glb_writer::component_f32, clip.frame_count, "SCALAR");
+		auto output = glb.add_accessor(glb.add_view(std::move(weights)),
+		                               0,
+		                               glb_writer::component_f32,
+		                               clip.frame_count * target_count,
+		                               "SCALAR");
+
+		// animation inputs require bounds
+		auto& accessor = glb.accessor(input);
+		accessor["min"] = {0.f};
+		accessor["max"] = {end};
+
+		glb.add_animation({
+		    {"name", clip.name},
+		    {"samplers", {{{"input", input}, {"output", output}, {"interpolation", "LINEAR"}}}},
+		    {"channels", {{{"sampler", 0}, {"target", {{"node", node}, {"path", "weights"}}}}}},
+		});
+	}
+
+	add_gltf_root(glb, nlohmann::json::array({node}));
+	glb.write(out);
+}
@@ -0,0 +1,236 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/material.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <nlohmann/json.hpp>
+#include <pstudio/parallel.hh>
+
+#include "indexed_mesh.hh"
+#include "lightmap.hh"
+#include "lod.hh"
+#include "morph.hh"
+#include "parts.hh"
+#include "scene.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief Incrementally builds a binary glTF 2.0 (GLB) file.
+///
+/// Buffer views either own their data or reference memory owned by someone else. Referenced memory is appended
+/// to the binary chunk as-is when the file is written, so it must stay alive until write() returns.
+class glb_writer {
+public:
+	static constexpr std::uint32_t component_u8 = 5121;
+	static constexpr std::uint32_t component_u16 = 5123;
+	static constexpr std::uint32_t component_u32 = 5125;
+	static constexpr std::uint32_t component_f32 = 5126;
+
+	glb_writer();
+
+	/// \brief Adds a buffer view referencing the given memory without copying it.
+	/// \param data A pointer to the first byte of the view. Must outlive the writer.
+	/// \param size The size of the view in bytes.
+	/// \param stride The distance between two vertex attributes in bytes or 0 for tightly packed data.
+	/// \return The index of the new buffer view.
+	std::uint32_t add_view(const void* data, std::size_t size, std::uint32_t stride = 0);
+
+	/// \brief Adds a buffer view which takes ownership of the given data.
+	/// \param data The data to store in the view.
+	/// \param stride The distance between two vertex attributes in bytes or 0 for tightly packed data.
+	/// \return The index of the new buffer view.
+	template <typename T>
+	std::uint32_t add_view(std::vector<T>&& data, std::uint32_t stride = 0) {
+		auto owned = std::make_shared<std::vector<T>>(std::move(data));
+		_m_owned.push_back(owned);
+		return add_view(owned->data(), owned->size() * sizeof(T), stride);
+	}
+
+	/// \brief Adds an accessor into a buffer view.
+	/// \param view The index of the buffer view to read from.
+	/// \param offset The offset of the first element relative to the start of the view in bytes.
+	/// \param component The glTF component type of the elements.
+	/// \param count The number of elements.
+	/// \param type The glTF element type (i.e. "SCALAR" or "VEC3").
+	/// \return The index of the new accessor.
+	std::uint32_t
+	add_accessor(std::uint32_t view, std::size_t offset, std::uint32_t component, std::size_t count, const char* type);
+
+	/// \brief Adds a `VEC3` position accessor including the bounds required by the specification.
+	/// \param positions The positions to add. They are referenced, not copied, if their layout permits it.
+	/// \return The index of the new accessor.
+	std::uint32_t add_positions(const std::vector<glm::vec3>& positions);
+
+	/// \brief Adds a `VEC3` position accessor including the bounds required by the specification.
+	/// \param positions The positions to add.
+	/// \return The index of the new accessor.
+	std::uint32_t add_positions(std::vector<glm::vec3>&& positions);
+
+	/// \brief Adds a `VEC3` float accessor of which only the given elements are non-zero using sparse storage.
+	/// \param count The number of elements of the accessor.
+	/// \param indices The indices of the non-zero elements in ascending order.
+	/// \param values The value of each non-zero element.
+	/// \return The index of the new accessor.
+	std::uint32_t
+	add_sparse_attribute(std::size_t count, std::vector<std::uint32_t>&& indices, const std::vector<glm::vec3>& values);
+
+	/// \brief Adds a `VEC2` float accessor. The data is referenced, not copied, if its layout permits it.
+	/// \return The index of the new accessor.
+	std::uint32_t add_attribute(const std::vector<glm::vec2>& data);
+
+	/// \brief Adds a `VEC3` float accessor. The data is referenced, not copied, if its layout permits it.
+	/// \return The index of the new accessor.
+	std::uint32_t add_attribute(const std::vector<glm::vec3>& data);
+
+	/// \brief Adds a material referencing its texture by name. Materials are de-duplicated by name.
+	/// \param mat The material to add.
+	/// \return The index of the material.
+	std::uint32_t add_material(const px::material& mat);
+
+	/// \brief Adds a texture whose image is stored in the binary chunk.
+	/// \param data The encoded image.
+	/// \param mime_type The MIME type of the image, either `image/png` or `image/jpeg`.
+	/// \return The index of the new texture.
+	std::uint32_t add_image(std::vector<std::uint8_t>&& data, std::string_view mime_type);
+
+	/// \brief Adds a mesh made from the given primitives.
+	/// \return The index of the new mesh.
+	std::uint32_t add_mesh(std::string_view name, nlohmann::json&& primitives);
+
+	/// \brief Adds an animation to the file.
+	/// \param animation The glTF animation object.
+	/// \return The index of the new animation.
+	std::uint32_t add_animation(nlohmann::json&& animation);
+
+	/// \brief Adds a node to the file.
+	/// \param node The glTF node object.
+	/// \param root Whether to add the node to the default scene.
+	/// \return The index of the new node.
+	std::uint32_t add_node(nlohmann::json&& node, bool root = false);
+
+	/// \brief Lists the given extension as used by the file.
+	void use_extension(std::string_view name);
+
+	/// \return The node with the given index for modification.
+	nlohmann::json& node(std::uint32_t index);
+
+	/// \return The mesh with the given index for modification.
+	nlohmann::json& mesh(std::uint32_t index);
+
+	/// \return The accessor with the given index for modification.
+	nlohmann::json& accessor(std::uint32_t index);
+
+	/// \brief Writes the GLB file to the given stream.
+	void write(std::ostream& out) const;
+
+private:
+	std::uint32_t _add_position_accessor(std::uint32_t view, const std::vector<glm::vec3>& positions);
+
+	struct view {
+		const void* data;
+		std::size_t size;
+	};
+
+	nlohmann::json _m_json;
+	std::vector<view> _m_views;
+	std::vector<std::shared_ptr<const void>> _m_owned;
+	std::unordered_map<std::string, std::uint32_t> _m_materials;
+	std::size_t _m_size {0};
+};
+
+/// \brief Gathers the position of every wedge of every sub-mesh of the given MRM mesh.
+/// \return One list of positions per sub-mesh.
+std::vector<std::vector<glm::vec3>> gather_wedge_positions(const px::proto_mesh& mesh);
+
+/// \brief Adds the sub-meshes of the given MRM mesh to a GLB file as a single mesh.
+/// \return The index of the new glTF mesh.
+std::uint32_t add_gltf_mesh(glb_writer& glb, std::string_view name, const px::proto_mesh& mesh);
+
+/// \brief Adds the sub-meshes of the given MRM mesh to a GLB file as a single mesh.
+/// \param positions The wedge positions of the mesh as returned by gather_wedge_positions().
+/// \return The index of the new glTF mesh.
+std::uint32_t add_gltf_mesh(glb_writer& glb,
+                            std::string_view name,
+                            const px::proto_mesh& mesh,
+                            std::vector<std::vector<glm::vec3>>&& positions);
+
+/// \brief Adds the given MSH or world mesh to a GLB file as a single mesh with one primitive per material.
+/// \return The index of the new glTF mesh.
+std::uint32_t add_gltf_mesh(glb_writer& glb, std::string_view name, const px::mesh& mesh);
+
+/// \brief Adds the given indexed mesh to a GLB file with one primitive per mesh_primitive.
+///
+/// All vertex attributes and the index buffer are referenced, not copied, so the mesh must outlive the writer.
+/// Lightmap texture coordinates are added as `TEXCOORD_1` and the lightmap of each primitive is referenced in its
+/// `extras.lightmap` property.
+/// \param lightmap_textures The glTF texture of each lightmap atlas page.
+/// \return The index of the new glTF mesh.
+std::uint32_t
+add_gltf_mesh(glb_writer& glb, const indexed_mesh& mesh, const std::vector<std::uint32_t>& lightmap_textures = {});
+
+/// \brief Adds a node converting from the ZenGin's coordinate system to glTF's to the default scene.
+///
+/// The conversion swaps the X and Z axes, just like the Wavefront exporter does.
+/// \return The index of the new node.
+std::uint32_t add_gltf_root(glb_writer& glb, nlohmann::json&& children);
+
+/// \brief Writes the given MRM mesh as a binary glTF file.
+void dump_gltf(std::ostream& out, const px::proto_mesh& mesh);
+
+/// \brief Writes the given MSH or world mesh as a binary glTF file.
+void dump_gltf(std::ostream& out, const px::mesh& mesh);
+
+/// \brief Writes the given indexed mesh as a binary glTF file.
+/// \param atlas The lightmap atlas of the mesh to embed as PNG images or `nullptr` if there is none.
+void dump_gltf(std::ostream& out, const indexed_mesh& mesh, const lightmap_atlas* atlas = nullptr);
+
+/// \brief Writes the given levels of detail of a mesh as a binary glTF file.
+///
+/// The first level is added to the scene and the others are linked to it using the `MSFT_lod` extension.
+void dump_gltf(std::ostream& out, const std::vector<mesh_lod>& lods);
+
+/// \brief Writes all parts of a model as a binary glTF scene.
+///
+/// If a hierarchy is given, its nodes are reproduced in the scene and attachments are added to the node they
+/// are attached to. All other parts are added to the root of the scene. Materials are shared between all parts.
+/// \param out The stream to write the scene to.
+/// \param parts The parts to write.
+/// \param hierarchy The hierarchy of the model or `nullptr` if there is none.
+/// \param pool The threads to prepare the parts on.
+void dump_gltf(std::ostream& out,
+               const std::vector<model_part>& parts,
+               const px::model_hierarchy* hierarchy,
+               pstudio::thread_pool& pool);
+
+/// \brief Writes a world mesh and the visuals of its VOBs as a binary glTF scene.
+///
+/// Every visual is stored once and instanced by one node per VOB placing it. Visuals without any vertices are
+/// skipped together with their instances.
+/// \param out The stream to write the scene to.
+/// \param world The world mesh.
+/// \param scene The visuals and their placements.
+/// \param visuals The converted mesh of each visual, in the same order as vob_scene::visuals.
+void dump_gltf(std::ostream& out,
+               const indexed_mesh& world,
+               const vob_scene& scene,
+               const std::vector<indexed_mesh>& visuals);
+
+/// \brief Writes a morph mesh and its animations as a binary glTF file.
+///
+/// Every frame of every animation becomes a sparse `POSITION` morph target and every animation a glTF animation
+/// of the mesh's morph target weights.
+/// \param out The stream to write the mesh to.
+/// \param mesh The morph mesh's MRM mesh as converted by to_indexed_mesh().
+/// \param morphs The morph targets of the mesh.
+void dump_gltf(std::ostream& out, const indexed_mesh& mesh, const morph_set& morphs);
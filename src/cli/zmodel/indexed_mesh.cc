@@ -0,0 +1,204 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "indexed_mesh.hh"
+
+#include <unordered_map>
+
+std::vector<std::uint32_t> sort_polygons_by_material(const std::vector<std::uint32_t>& material_indices,
+                                                     std::size_t material_count) {
+	std::vector<std::uint32_t> offsets(material_count + 1, 0);
+	for (auto material : material_indices) {
+		++offsets[material + 1];
+	}
+
+	for (std::size_t i = 1; i < offsets.size(); ++i) {
+		offsets[i] += offsets[i - 1];
+	}
+
+	std::vector<std::uint32_t> order(material_indices.size());
+	for (std::size_t i = 0; i < material_indices.size(); ++i) {
+		order[offsets[material_indices[i]]++] = static_cast<std::uint32_t>(i);
+	}
+
+	return order;
+}
+
+namespace {
+	/// \brief Identifies a vertex of a world or MSH mesh.
+	struct vertex_key {
+		std::uint32_t position;
+		std::uint32_t feature;
+		std::int32_t lightmap;
+
+		bool operator==(const vertex_key& other) const noexcept {
+			return position == other.position && feature == other.feature && lightmap == other.lightmap;
+		}
+	};
+
+	struct vertex_key_hash {
+		std::size_t operator()(const vertex_key& key) const noexcept {
+			auto hash = (std::uint64_t {key.feature} << 32 | key.position) * 0x9E3779B97F4A7C15ull;
+			return static_cast<std::size_t>(hash ^ static_cast<std::uint32_t>(key.lightmap));
+		}
+	};
+
+	/// \return The lightmap of the given polygon or -1 if it is not part of the atlas.
+	std::int32_t polygon_lightmap(const px::mesh& mesh, std::uint32_t polygon, const lightmap_atlas* atlas) {
+		if (atlas == nullptr)
+			return -1;
+
+		auto lightmap = mesh.polygons.lightmap_indices[polygon];
+		if (lightmap < 0 || static_cast<std::size_t>(lightmap) >= atlas->placements.size() ||
+		    atlas->placements[static_cast<std::size_t>(lightmap)].page < 0)
+			return -1;
+		return lightmap;
+	}
+
+	/// \brief Sorts the given polygons by material and lightmap atlas page.
+	std::vector<std::uint32_t>
+	sort_polygons(const px::mesh& mesh, const std::vector<std::uint32_t>& polygons, const lightmap_atlas* atlas) {
+		auto pages = atlas != nullptr ? atlas->pages.size() : 0;
+
+		std::vector<std::uint32_t> keys(polygons.size());
+		for (std::size_t i = 0; i < polygons.size(); ++i) {
+			auto lightmap = polygon_lightmap(mesh, polygons[i], atlas);
+			auto page = lightmap < 0 ? 0 : atlas->placements[static_cast<std::size_t>(lightmap)].page + 1;
+
+			keys[i] = mesh.polygons.material_indices[polygons[i]] * static_cast<std::uint32_t>(pages + 1) +
+			    static_cast<std::uint32_t>(page);
+		}
+
+		auto order = sort_polygons_by_material(keys, mesh.materials.size() * (pages + 1));
+		for (auto& polygon : order) {
+			polygon = polygons[polygon];
+		}
+
+		return order;
+	}
+
+	/// \brief Converts the given polygons, which must be sorted by material, into an indexed mesh.
+	/// \param compact Whether to only keep the materials used by the polygons.
+	void convert_polygons(indexed_mesh& result,
+	                      const px::mesh& mesh,
+	                      const std::vector<std::uint32_t>& order,
+	                      bool compact,
+	                      const lightmap_atlas* atlas) {
+		const auto& polys = mesh.polygons;
+
+		std::unordered_map<vertex_key, std::uint32_t, vertex_key_hash> vertices {};
+		vertices.reserve(compact ? order.size() * 2 : mesh.features.size());
+		result.indices.reserve(order.size() * 3);
+
+		if (!compact)
+			result.materials = mesh.materials;
+
+		std::uint32_t last_material = 0;
+		std::int32_t last_page = -1;
+		for (auto polygon : order) {
+			auto material = polys.material_indices[polygon];
+			auto lightmap = polygon_lightmap(mesh, polygon, atlas);
+			auto page = lightmap < 0 ? -1 : atlas->placements[static_cast<std::size_t>(lightmap)].page;
+
+			if (result.primitives.empty() || last_material != material || last_page != page) {
+				auto offset = static_cast<std::uint32_t>(result.indices.size());
+				auto index = material;
+
+				if (compact) {
+					if (result.primitives.empty() || last_material != material)
+						result.materials.push_back(mesh.materials[material]);
+					index = static_cast<std::uint32_t>(result.materials.size() - 1);
+				}
+
+				result.primitives.push_back({index, offset, 0, page});
+				last_material = material;
+				last_page = page;
+			}
+
+			for (std::size_t v = polygon * 3; v < polygon * 3 + 3; ++v) {
+				auto position = polys.vertex_indices[v];
+				auto feature = polys.feature_indices[v];
+				vertex_key key {position, feature, lightmap};
+
+				auto [it, inserted] = vertices.try_emplace(key, static_cast<std::uint32_t>(result.positions.size()));
+				if (inserted) {
+					result.positions.push_back(mesh.vertices[position]);
+					result.normals.push_back(mesh.features[feature].normal);
+					result.uvs.push_back(mesh.features[feature].texture);
+
+					if (atlas != nullptr) {
+						glm::vec2 uv {0};
+						if (lightmap >= 0) {
+							const auto& placement = atlas->placements[static_cast<std::size_t>(lightmap)];
+							auto local = compute_lightmap_uv(mesh.lightmaps[static_cast<std::size_t>(lightmap)],
+							                                 mesh.vertices[position]);
+							uv = placement.offset + local * placement.scale;
+						}
+
+						result.lightmap_uvs.push_back(uv);
+					}
+				}
+
+				result.indices.push_back(it->second);
+			}
+
+			result.primitives.back().count += 3;
+		}
+	}
+} // namespace
+
+indexed_mesh to_indexed_mesh(const px::mesh& mesh, const lightmap_atlas* atlas) {
+	indexed_mesh result {};
+	result.name = mesh.name;
+
+	if (atlas == nullptr) {
+		auto order = sort_polygons_by_material(mesh.polygons.material_indices, mesh.materials.size());
+		convert_polygons(result, mesh, order, false, nullptr);
+	} else {
+		std::vector<std::uint32_t> polygons(mesh.polygons.material_indices.size());
+		for (std::size_t i = 0; i < polygons.size(); ++i) {
+			polygons[i] = static_cast<std::uint32_t>(i);
+		}
+
+		convert_polygons(result, mesh, sort_polygons(mesh, polygons, atlas), false, atlas);
+	}
+
+	return result;
+}
+
+indexed_mesh to_indexed_mesh(const px::mesh& mesh,
+                             const std::vector<std::uint32_t>& polygons,
+                             std::string name,
+                             const lightmap_atlas* atlas) {
+	indexed_mesh result {};
+	result.name = std::move(name);
+
+	convert_polygons(result, mesh, sort_polygons(mesh, polygons, atlas), true, atlas);
+	return result;
+}
+
+indexed_mesh to_indexed_mesh(const px::proto_mesh& mesh, std::string name) {
+	indexed_mesh result {};
+	result.name = std::move(name);
+
+	for (const auto& sub : mesh.sub_meshes) {
+		auto base = static_cast<std::uint32_t>(result.positions.size());
+		auto material = static_cast<std::uint32_t>(result.materials.size());
+		result.materials.push_back(sub.mat);
+
+		for (const auto& wedge : sub.wedges) {
+			result.positions.push_back(mesh.positions[wedge.index]);
+			result.normals.push_back(wedge.normal);
+			result.uvs.push_back(wedge.texture);
+		}
+
+		auto offset = static_cast<std::uint32_t>(result.indices.size());
+		for (const auto& triangle : sub.triangles) {
+			result.indices.insert(result.indices.end(),
+			                      {base + triangle.wedges[0], base + triangle.wedges[1], base + triangle.wedges[2]});
+		}
+
+		result.primitives.push_back({material, offset, static_cast<std::uint32_t>(sub.triangles.size() * 3)});
+	}
+
+	return result;
+}
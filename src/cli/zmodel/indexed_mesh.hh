@@ -0,0 +1,88 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/material.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include "lightmap.hh"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A consecutive range of triangles sharing one material.
+struct mesh_primitive {
+	/// \brief The index of the material in indexed_mesh::materials.
+	std::uint32_t material;
+
+	/// \brief The index of the first index of the range.
+	std::uint32_t offset;
+
+	/// \brief The number of indices in the range.
+	std::uint32_t count;
+
+	/// \brief The lightmap atlas page used by the range or -1 if it is not lightmapped.
+	std::int32_t lightmap {-1};
+};
+
+/// \brief A triangle mesh which uses a single index per vertex for its position, normal and texture coordinates.
+///
+/// Unlike phoenix' meshes, this representation maps directly onto GPU vertex and index buffers which makes it
+/// the common input for all processing stages of zmodel.
+struct indexed_mesh {
+	std::string name;
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> uvs;
+
+	/// \brief Texture coordinates into the pages of a lightmap_atlas. Either empty or one per vertex.
+	std::vector<glm::vec2> lightmap_uvs;
+
+	/// \brief Three indices into the vertex arrays per triangle.
+	std::vector<std::uint32_t> indices;
+
+	/// \brief The ranges of `indices` sharing one material. Every triangle is part of exactly one primitive.
+	std::vector<mesh_primitive> primitives;
+
+	std::vector<px::material> materials;
+};
+
+/// \brief Stably sorts the polygons of a mesh by their material index in linear time.
+/// \param material_indices The material index of each polygon.
+/// \param material_count The number of materials.
+/// \return The polygon indices, ordered by material.
+std::vector<std::uint32_t> sort_polygons_by_material(const std::vector<std::uint32_t>& material_indices,
+                                                     std::size_t material_count);
+
+/// \brief Converts an MSH or world mesh into an indexed mesh.
+///
+/// Every distinct pair of position and feature becomes one vertex. Polygons are grouped into one primitive per
+/// material while keeping their relative order.
+/// \param mesh The mesh to convert.
+/// \param atlas The lightmap atlas of the mesh or `nullptr` to ignore lightmaps. If given, primitives are split by
+///              atlas page as well and every vertex receives lightmap texture coordinates.
+indexed_mesh to_indexed_mesh(const px::mesh& mesh, const lightmap_atlas* atlas = nullptr);
+
+/// \brief Converts a subset of the polygons of an MSH or world mesh into an indexed mesh.
+///
+/// Only the materials used by the given polygons are kept.
+/// \param mesh The mesh to convert.
+/// \param polygons The indices of the polygons to convert.
+/// \param name The name of the new mesh.
+/// \param atlas The lightmap atlas of the polygons or `nullptr` to ignore lightmaps.
+indexed_mesh to_indexed_mesh(const px::mesh& mesh,
+                             const std::vector<std::uint32_t>& polygons,
+                             std::string name,
+                             const lightmap_atlas* atlas = nullptr);
+
+/// \brief Converts an MRM mesh into an indexed mesh.
+///
+/// Every wedge becomes one vertex and every sub-mesh one primitive.
+indexed_mesh to_indexed_mesh(const px::proto_mesh& mesh, std::string name);
@@ -0,0 +1,243 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "lightmap.hh"
+
+#include <glm/glm.hpp>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+/// \brief The number of pixels added around every lightmap texture in the atlas.
+static constexpr std::uint32_t LIGHTMAP_PADDING = 1;
+
+skyline_packer::skyline_packer(std::uint32_t size) : _m_size(size), _m_skyline({{0, 0, size}}) {}
+
+std::optional<glm::uvec2> skyline_packer::insert(std::uint32_t width, std::uint32_t height) {
+	if (width > _m_size || height > _m_size)
+		return std::nullopt;
+
+	auto best = _m_skyline.size();
+	auto best_y = std::numeric_limits<std::uint32_t>::max();
+
+	// place the rectangle as low as possible, then as far left as possible
+	for (std::size_t i = 0; i < _m_skyline.size(); ++i) {
+		auto x = _m_skyline[i].x;
+		if (x + width > _m_size)
+			break;
+
+		std::uint32_t y = 0;
+		std::uint32_t covered = 0;
+		for (auto j = i; covered < width; ++j) {
+			y = std::max(y, _m_skyline[j].y);
+			covered += _m_skyline[j].width;
+		}
+
+		if (y + height <= _m_size && y < best_y) {
+			best = i;
+			best_y = y;
+		}
+	}
+
+	if (best == _m_skyline.size())
+		return std::nullopt;
+
+	auto x = _m_skyline[best].x;
+	_m_skyline.insert(_m_skyline.begin() + static_cast<std::ptrdiff_t>(best), {x, best_y + height, width});
+
+	// shrink or remove the segments now lying below the new one
+	for (auto i = best + 1; i < _m_skyline.size();) {
+		auto& seg = _m_skyline[i];
+		auto end = x + width;
+
+		if (seg.x >= end)
+			break;
+
+		auto overlap = end - seg.x;
+		if (overlap >= seg.width) {
+			_m_skyline.erase(_m_skyline.begin() + static_cast<std::ptrdiff_t>(i));
+			continue;
+		}
+
+		seg.x += overlap;
+		seg.width -= overlap;
+		break;
+	}
+
+	// merge neighbouring segments of the same height
+	for (std::size_t i = 0; i + 1 < _m_skyline.size();) {
+		if (_m_skyline[i].y == _m_skyline[i + 1].y) {
+			_m_skyline[i].width += _m_skyline[i + 1].width;
+			_m_skyline.erase(_m_skyline.begin() + static_cast<std::ptrdiff_t>(i + 1));
+		} else {
+			++i;
+		}
+	}
+
+	return glm::uvec2 {x, best_y};
+}
+
+glm::vec2 compute_lightmap_uv(const px::light_map& lightmap, const glm::vec3& position) {
+	auto relative = position - lightmap.origin;
+	return {glm::dot(lightmap.normals[0], relative), glm::dot(lightmap.normals[1], relative)};
+}
+
+/// \brief Copies a texture into an atlas page and repeats its edge pixels into the surrounding padding.
+static void blit_padded(std::vector<std::uint8_t>& page,
+                        std::uint32_t page_size,
+                        const std::vector<std::uint8_t>& pixels,
+                        std::uint32_t width,
+                        std::uint32_t height,
+                        glm::uvec2 position) {
+	auto padded_width = width + 2 * LIGHTMAP_PADDING;
+	auto padded_height = height + 2 * LIGHTMAP_PADDING;
+
+	for (std::uint32_t y = 0; y < padded_height; ++y) {
+		auto source_y = std::min(y > LIGHTMAP_PADDING ? y - LIGHTMAP_PADDING : 0, height - 1);
+
+		for (std::uint32_t x = 0; x < padded_width; ++x) {
+			auto source_x = std::min(x > LIGHTMAP_PADDING ? x - LIGHTMAP_PADDING : 0, width - 1);
+
+			auto source = (static_cast<std::size_t>(source_y) * width + source_x) * 4;
+			auto target = (static_cast<std::size_t>(position.y + y) * page_size + position.x + x) * 4;
+			std::memcpy(&page[target], &pixels[source], 4);
+		}
+	}
+}
+
+lightmap_atlas build_lightmap_atlas(const px::mesh& mesh, std::uint32_t size, pstudio::thread_pool& pool) {
+	std::vector<std::uint32_t> polygons(mesh.polygons.lightmap_indices.size());
+	std::iota(polygons.begin(), polygons.end(), 0);
+	return build_lightmap_atlas(mesh, polygons, size, pool);
+}
+
+lightmap_atlas build_lightmap_atlas(const px::mesh& mesh,
+                                    const std::vector<std::uint32_t>& polygons,
+                                    std::uint32_t size,
+                                    pstudio::thread_pool& pool) {
+	lightmap_atlas atlas {};
+	atlas.placements.resize(mesh.lightmaps.size());
+
+	// find the distinct textures of all lightmaps used by the polygons
+	std::vector<bool> used(mesh.lightmaps.size(), false);
+	for (auto polygon : polygons) {
+		auto lightmap = mesh.polygons.lightmap_indices[polygon];
+		if (lightmap >= 0 && static_cast<std::size_t>(lightmap) < used.size())
+			used[static_cast<std::size_t>(lightmap)] = true;
+	}
+
+	std::unordered_map<const px::texture*, std::uint32_t> texture_indices {};
+	std::vector<const px::texture*> textures {};
+	std::vector<std::uint32_t> lightmap_textures(mesh.lightmaps.size(), 0);
+
+	for (std::size_t i = 0; i < mesh.lightmaps.size(); ++i) {
+		const auto* image = mesh.lightmaps[i].image.get();
+		if (!used[i] || image == nullptr)
+			continue;
+
+		auto [it, inserted] = texture_indices.try_emplace(image, static_cast<std::uint32_t>(textures.size()));
+		if (inserted)
+			textures.push_back(image);
+
+		lightmap_textures[i] = it->second;
+	}
+
+	atlas.textures = textures.size();
+	if (textures.empty())
+		return atlas;
+
+	std::vector<std::vector<std::uint8_t>> pixels(textures.size());
+	pstudio::parallel_for(pool, textures.size(), 1, [&](std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			pixels[i] = textures[i]->as_rgba8(0);
+		}
+	});
+
+	// grow the pages to fit the largest texture
+	atlas.size = std::max(size, 1u);
+	for (const auto* texture : textures) {
+		auto largest = std::max(texture->mipmap_width(0), texture->mipmap_height(0)) + 2 * LIGHTMAP_PADDING;
+		while (atlas.size < largest) {
+			atlas.size *= 2;
+		}
+	}
+
+	// pack the tallest textures first
+	std::vector<std::uint32_t> order(textures.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+		return textures[a]->mipmap_height(0) > textures[b]->mipmap_height(0);
+	});
+
+	std::vector<lightmap_placement> texture_placements(textures.size());
+	std::vector<skyline_packer> packers {};
+	std::uint64_t covered = 0;
+
+	for (auto index : order) {
+		auto width = textures[index]->mipmap_width(0);
+		auto height = textures[index]->mipmap_height(0);
+
+		std::optional<glm::uvec2> position {};
+		std::size_t page = 0;
+
+		for (; page < packers.size() && !position; ++page) {
+			position = packers[page].insert(width + 2 * LIGHTMAP_PADDING, height + 2 * LIGHTMAP_PADDING);
+		}
+
+		if (position) {
+			--page;
+		} else {
+			packers.emplace_back(atlas.size);
+			atlas.pages.emplace_back(static_cast<std::size_t>(atlas.size) * atlas.size * 4, 0);
+			position = packers.back().insert(width + 2 * LIGHTMAP_PADDING, height + 2 * LIGHTMAP_PADDING);
+		}
+
+		blit_padded(atlas.pages[page], atlas.size, pixels[index], width, height, *position);
+		covered += static_cast<std::uint64_t>(width) * height;
+
+		auto scale = 1.f / static_cast<float>(atlas.size);
+		texture_placements[index] = {
+		    static_cast<std::int32_t>(page),
+		    glm::vec2 {static_cast<float>(position->x + LIGHTMAP_PADDING) * scale,
+		               static_cast<float>(position->y + LIGHTMAP_PADDING) * scale},
+		    glm::vec2 {static_cast<float>(width) * scale, static_cast<float>(height) * scale},
+		};
+	}
+
+	for (std::size_t i = 0; i < mesh.lightmaps.size(); ++i) {
+		if (used[i] && mesh.lightmaps[i].image != nullptr)
+			atlas.placements[i] = texture_placements[lightmap_textures[i]];
+	}
+
+	auto area = static_cast<double>(atlas.size) * atlas.size * static_cast<double>(atlas.pages.size());
+	atlas.coverage = static_cast<float>(static_cast<double>(covered) / area);
+	return atlas;
+}
+
+std::vector<std::uint8_t>
+encode_png(const std::vector<std::uint8_t>& pixels, std::uint32_t width, std::uint32_t height) {
+	std::vector<std::uint8_t> png {};
+
+	auto success = stbi_write_png_to_func(
+	    [](void* context, void* data, int size) {
+		    auto* out = static_cast<std::vector<std::uint8_t>*>(context);
+		    auto* bytes = static_cast<std::uint8_t*>(data);
+		    out->insert(out->end(), bytes, bytes + size);
+	    },
+	    &png,
+	    static_cast<int>(width),
+	    static_cast<int>(height),
+	    4,
+	    pixels.data(),
+	    static_cast<int>(width * 4));
+
+	if (success == 0)
+		throw std::runtime_error("cannot encode PNG image");
+	return png;
+}
@@ -0,0 +1,88 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/mesh.hh>
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <pstudio/parallel.hh>
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief The location of a lightmap texture inside a lightmap atlas.
+struct lightmap_placement {
+	/// \brief The atlas page containing the lightmap or -1 if the lightmap is not part of the atlas.
+	std::int32_t page {-1};
+
+	/// \brief The position of the lightmap's top-left corner in the page, in texture coordinates.
+	glm::vec2 offset {0};
+
+	/// \brief The size of the lightmap in the page, in texture coordinates.
+	glm::vec2 scale {0};
+};
+
+/// \brief A set of square RGBA8 textures into which all lightmaps of a mesh have been packed.
+struct lightmap_atlas {
+	/// \brief The width and height of every page in pixels.
+	std::uint32_t size {0};
+
+	/// \brief The pixels of every page.
+	std::vector<std::vector<std::uint8_t>> pages;
+
+	/// \brief The placement of every lightmap of the mesh, in the same order as `px::mesh::lightmaps`.
+	std::vector<lightmap_placement> placements;
+
+	/// \brief The number of distinct lightmap textures packed into the pages.
+	std::size_t textures {0};
+
+	/// \brief The fraction of the pages' area covered by lightmap textures.
+	float coverage {0};
+};
+
+/// \brief Packs rectangles into a square area using the bottom-left skyline heuristic.
+class skyline_packer {
+public:
+	explicit skyline_packer(std::uint32_t size);
+
+	/// \brief Finds a free spot for a rectangle of the given size and marks it as used.
+	/// \return The position of the rectangle's top-left corner or std::nullopt if it does not fit.
+	std::optional<glm::uvec2> insert(std::uint32_t width, std::uint32_t height);
+
+private:
+	struct segment {
+		std::uint32_t x;
+		std::uint32_t y;
+		std::uint32_t width;
+	};
+
+	std::uint32_t _m_size;
+	std::vector<segment> _m_skyline;
+};
+
+/// \brief Calculates the texture coordinates of a position in a polygon's lightmap texture.
+glm::vec2 compute_lightmap_uv(const px::light_map& lightmap, const glm::vec3& position);
+
+/// \brief Decodes all lightmaps of a mesh and packs them into atlas pages.
+///
+/// Lightmap textures shared by multiple lightmaps are only packed once. They are decoded concurrently and every
+/// texture is surrounded by a one pixel border repeating its edge to avoid bleeding when filtering.
+/// \param mesh The mesh to pack the lightmaps of.
+/// \param size The minimum width and height of each page. Grown to fit the largest lightmap texture if necessary.
+/// \param pool The threads to decode the lightmap textures on.
+/// \return The atlas.
+lightmap_atlas build_lightmap_atlas(const px::mesh& mesh, std::uint32_t size, pstudio::thread_pool& pool);
+
+/// \brief Decodes the lightmaps used by the given polygons and packs them into atlas pages.
+/// \see build_lightmap_atlas(const px::mesh&, std::uint32_t, pstudio::thread_pool&)
+lightmap_atlas build_lightmap_atlas(const px::mesh& mesh,
+                                    const std::vector<std::uint32_t>& polygons,
+                                    std::uint32_t size,
+                                    pstudio::thread_pool& pool);
+
+/// \brief Encodes an RGBA8 image as PNG.
+std::vector<std::uint8_t>
+encode_png(const std::vector<std::uint8_t>& pixels, std::uint32_t width, std::uint32_t height);
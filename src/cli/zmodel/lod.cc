@@ -0,0 +1,496 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "lod.hh"
+#include "optimize.hh"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+	/// \brief A symmetric 4x4 matrix measuring the squared distance of a point to a set of planes.
+	struct quadric {
+		double a00 {0}, a01 {0}, a02 {0}, a03 {0};
+		double a11 {0}, a12 {0}, a13 {0};
+		double a22 {0}, a23 {0};
+		double a33 {0};
+
+		void add_plane(double a, double b, double c, double d, double weight) {
+			a00 += weight * a * a;
+			a01 += weight * a * b;
+			a02 += weight * a * c;
+			a03 += weight * a * d;
+			a11 += weight * b * b;
+			a12 += weight * b * c;
+			a13 += weight * b * d;
+			a22 += weight * c * c;
+			a23 += weight * c * d;
+			a33 += weight * d * d;
+		}
+
+		quadric& operator+=(const quadric& other) {
+			a00 += other.a00;
+			a01 += other.a01;
+			a02 += other.a02;
+			a03 += other.a03;
+			a11 += other.a11;
+			a12 += other.a12;
+			a13 += other.a13;
+			a22 += other.a22;
+			a23 += other.a23;
+			a33 += other.a33;
+			return *this;
+		}
+
+		[[nodiscard]] double evaluate(const glm::vec3& p) const {
+			double x = p.x, y = p.y, z = p.z;
+			return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x + a11 * y * y + 2 * a12 * y * z +
+			    2 * a13 * y + a22 * z * z + 2 * a23 * z + a33;
+		}
+	};
+
+	struct position_key {
+		std::uint32_t bits[3];
+
+		bool operator==(const position_key& other) const noexcept {
+			return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	struct position_key_hash {
+		std::size_t operator()(const position_key& key) const noexcept {
+			std::uint64_t hash = 14695981039346656037ull;
+			for (auto word : key.bits) {
+				hash = (hash ^ word) * 1099511628211ull;
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+
+	/// \brief A proposed collapse of all vertices at one position onto the vertices at another position.
+	struct collapse {
+		double cost;
+		std::uint32_t from;
+		std::uint32_t to;
+		std::uint32_t from_version;
+		std::uint32_t to_version;
+
+		bool operator>(const collapse& other) const noexcept {
+			return cost > other.cost;
+		}
+	};
+
+	/// \brief Simplifies a mesh by collapsing edges between positions in the order of their quadric error.
+	///
+	/// All vertices sharing a position form a group. Collapsing a group moves each of its vertices onto a
+	/// neighbouring vertex of the target group so that attribute seams are kept intact.
+	class quadric_simplifier {
+	public:
+		explicit quadric_simplifier(const indexed_mesh& mesh) : _m_mesh(mesh), _m_corners(mesh.indices) {
+			_build_groups();
+			_build_triangles();
+
+			for (std::uint32_t t = 0; t < _m_alive.size(); ++t) {
+				if (!_m_alive[t])
+					continue;
+
+				for (std::size_t k = 0; k < 3; ++k) {
+					auto a = _group(t, k);
+					auto b = _group(t, (k + 1) % 3);
+					_push(a, b);
+					_push(b, a);
+				}
+			}
+		}
+
+		/// \brief Collapses edges until at most \p target triangles remain or no more edges can be collapsed.
+		/// \return The square root of the largest quadric error of any collapse so far.
+		float simplify(std::size_t target) {
+			while (_m_alive_count > target && !_m_queue.empty()) {
+				auto next = _m_queue.top();
+				_m_queue.pop();
+
+				if (next.from_version != _m_version[next.from] || next.to_version != _m_version[next.to])
+					continue;
+				if (!_collapse(next.from, next.to))
+					continue;
+
+				_m_error = std::max(_m_error, next.cost);
+			}
+
+			return static_cast<float>(std::sqrt(std::max(_m_error, 0.0)));
+		}
+
+		/// \return The remaining triangles as a new mesh without any unused vertices.
+		[[nodiscard]] indexed_mesh extract() const {
+			indexed_mesh result {};
+			result.name = _m_mesh.name;
+			result.positions = _m_mesh.positions;
+			result.normals = _m_mesh.normals;
+			result.uvs = _m_mesh.uvs;
+			result.lightmap_uvs = _m_mesh.lightmap_uvs;
+			result.materials = _m_mesh.materials;
+
+			for (const auto& primitive : _m_mesh.primitives) {
+				auto offset = static_cast<std::uint32_t>(result.indices.size());
+
+				for (auto i = primitive.offset; i < primitive.offset + primitive.count; i += 3) {
+					if (!_m_alive[i / 3])
+						continue;
+
+					result.indices.insert(result.indices.end(), {_m_corners[i], _m_corners[i + 1], _m_corners[i + 2]});
+				}
+
+				auto count = static_cast<std::uint32_t>(result.indices.size()) - offset;
+				if (count > 0)
+					result.primitives.push_back({primitive.material, offset, count, primitive.lightmap});
+			}
+
+			optimize_vertex_fetch(result);
+			return result;
+		}
+
+	private:
+		[[nodiscard]] std::uint32_t _group(std::uint32_t triangle, std::size_t corner) const {
+			return _m_group[_m_corners[triangle * 3 + corner]];
+		}
+
+		[[nodiscard]] const glm::vec3& _position(std::uint32_t group) const {
+			return _m_mesh.positions[_m_members[group][0]];
+		}
+
+		void _build_groups() {
+			std::unordered_map<position_key, std::uint32_t, position_key_hash> groups {};
+			groups.reserve(_m_mesh.positions.size());
+			_m_group.resize(_m_mesh.positions.size());
+
+			for (std::size_t i = 0; i < _m_mesh.positions.size(); ++i) {
+				position_key key {};
+				std::memcpy(key.bits, &_m_mesh.positions[i], sizeof(key.bits));
+
+				auto [it, inserted] = groups.try_emplace(key, static_cast<std::uint32_t>(_m_members.size()));
+				if (inserted)
+					_m_members.emplace_back();
+
+				_m_group[i] = it->second;
+				_m_members[it->second].push_back(static_cast<std::uint32_t>(i));
+			}
+
+			_m_triangles.resize(_m_members.size());
+			_m_quadrics.resize(_m_members.size());
+			_m_locked.resize(_m_members.size(), false);
+			_m_version.resize(_m_members.size(), 0);
+		}
+
+		void _build_triangles() {
+			auto triangle_count = static_cast<std::uint32_t>(_m_corners.size() / 3);
+			_m_alive.resize(triangle_count, false);
+
+			// the number of triangles using each edge between two positions, used to find borders
+			std::unordered_map<std::uint64_t, std::uint32_t> edges {};
+			edges.reserve(_m_corners.size());
+
+			for (std::uint32_t t = 0; t < triangle_count; ++t) {
+				auto a = _group(t, 0), b = _group(t, 1), c = _group(t, 2);
+				if (a == b || b == c || a == c)
+					continue;
+
+				_m_alive[t] = true;
+				++_m_alive_count;
+
+				for (auto g : {a, b, c}) {
+					_m_triangles[g].push_back(t);
+				}
+
+				const auto& p0 = _position(a);
+				auto normal = glm::cross(_position(b) - p0, _position(c) - p0);
+				auto length = glm::length(normal);
+
+				if (length > 0) {
+					normal = normal / length;
+
+					quadric plane {};
+					plane.add_plane(normal.x, normal.y, normal.z, -glm::dot(normal, p0), length * 0.5);
+
+					_m_quadrics[a] += plane;
+					_m_quadrics[b] += plane;
+					_m_quadrics[c] += plane;
+				}
+
+				for (std::size_t k = 0; k < 3; ++k) {
+					auto u = _group(t, k), v = _group(t, (k + 1) % 3);
+					++edges[std::uint64_t {std::min(u, v)} << 32 | std::max(u, v)];
+				}
+			}
+
+			// positions on borders or non-manifold edges never move
+			for (auto [edge, count] : edges) {
+				if (count == 2)
+					continue;
+
+				_m_locked[edge >> 32] = true;
+				_m_locked[edge & 0xFFFFFFFF] = true;
+			}
+		}
+
+		void _push(std::uint32_t from, std::uint32_t to) {
+			if (_m_locked[from])
+				return;
+
+			auto combined = _m_quadrics[from];
+			combined += _m_quadrics[to];
+			_m_queue.push({combined.evaluate(_position(to)), from, to, _m_version[from], _m_version[to]});
+		}
+
+		bool _collapse(std::uint32_t from, std::uint32_t to) {
+			// find the target of every vertex at `from` among its neighbours at `to`
+			std::unordered_map<std::uint32_t, std::uint32_t> targets {};
+			for (auto t : _m_triangles[from]) {
+				if (!_m_alive[t])
+					continue;
+
+				for (std::size_t k = 0; k < 3; ++k) {
+					auto vertex = _m_corners[t * 3 + k];
+					if (_m_group[vertex] != from)
+						continue;
+
+					for (auto other : {_m_corners[t * 3 + (k + 1) % 3], _m_corners[t * 3 + (k + 2) % 3]}) {
+						if (_m_group[other] == to)
+							targets.try_emplace(vertex, other);
+					}
+				}
+			}
+
+			// reject the collapse if it would flip a triangle or tear a seam
+			const auto& destination = _position(to);
+			for (auto t : _m_triangles[from]) {
+				if (!_m_alive[t])
+					continue;
+
+				glm::vec3 before[3], after[3];
+				bool degenerate = false;
+
+				for (std::size_t k = 0; k < 3; ++k) {
+					auto vertex = _m_corners[t * 3 + k];
+					before[k] = after[k] = _m_mesh.positions[vertex];
+
+					if (_m_group[vertex] == to) {
+						degenerate = true;
+					} else if (_m_group[vertex] == from) {
+						if (targets.find(vertex) == targets.end())
+							return false;
+						after[k] = destination;
+					}
+				}
+
+				if (degenerate)
+					continue;
+
+				auto normal_before = glm::cross(before[1] - before[0], before[2] - before[0]);
+				auto normal_after = glm::cross(after[1] - after[0], after[2] - after[0]);
+				if (glm::dot(normal_before, normal_after) <= 0)
+					return false;
+			}
+
+			for (auto t : _m_triangles[from]) {
+				if (!_m_alive[t])
+					continue;
+
+				for (std::size_t k = 0; k < 3; ++k) {
+					auto& vertex = _m_corners[t * 3 + k];
+					if (_m_group[vertex] == from)
+						vertex = targets[vertex];
+				}
+
+				auto a = _group(t, 0), b = _group(t, 1), c = _group(t, 2);
+				if (a == b || b == c || a == c) {
+					_m_alive[t] = false;
+					--_m_alive_count;
+				} else {
+					_m_triangles[to].push_back(t);
+				}
+			}
+
+			_m_quadrics[to] += _m_quadrics[from];
+			_m_triangles[from].clear();
+			_m_triangles[from].shrink_to_fit();
+			++_m_version[from];
+			++_m_version[to];
+
+			auto& triangles = _m_triangles[to];
+			triangles.erase(std::remove_if(triangles.begin(), triangles.end(), [&](auto t) { return !_m_alive[t]; }),
+			                triangles.end());
+
+			std::vector<std::uint32_t> neighbours {};
+			for (auto t : triangles) {
+				for (std::size_t k = 0; k < 3; ++k) {
+					if (auto g = _group(t, k); g != to)
+						neighbours.push_back(g);
+				}
+			}
+
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+			for (auto g : neighbours) {
+				_push(g, to);
+				_push(to, g);
+			}
+
+			return true;
+		}
+
+		const indexed_mesh& _m_mesh;
+		std::vector<std::uint32_t> _m_corners;
+		std::vector<bool> _m_alive;
+		std::size_t _m_alive_count {0};
+
+		std::vector<std::uint32_t> _m_group;
+		std::vector<std::vector<std::uint32_t>> _m_members;
+		std::vector<std::vector<std::uint32_t>> _m_triangles;
+		std::vector<quadric> _m_quadrics;
+		std::vector<bool> _m_locked;
+		std::vector<std::uint32_t> _m_version;
+
+		std::priority_queue<collapse, std::vector<collapse>, std::greater<>> _m_queue;
+		double _m_error {0};
+	};
+} // namespace
+
+std::vector<mesh_lod> build_mrm_lods(const px::proto_mesh& mesh, const std::string& name, std::size_t count) {
+	// Wedges are stored in collapse order: the wedge with the highest index is removed first and replaced by
+	// the wedge its wedge map entry points to. Wedges mapping onto themselves or a later wedge can't be removed.
+	std::vector<std::size_t> minimum(mesh.sub_meshes.size(), 0);
+	bool reducible = false;
+
+	for (std::size_t s = 0; s < mesh.sub_meshes.size(); ++s) {
+		const auto& sub = mesh.sub_meshes[s];
+		if (sub.wedge_map.size() != sub.wedges.size())
+			return {};
+
+		for (std::size_t i = 0; i < sub.wedge_map.size(); ++i) {
+			if (sub.wedge_map[i] >= i)
+				minimum[s] = i + 1;
+		}
+
+		reducible |= minimum[s] < sub.wedges.size();
+	}
+
+	if (!reducible)
+		return {};
+
+	auto base = to_indexed_mesh(mesh, name);
+
+	std::vector<mesh_lod> levels {};
+	levels.push_back({base, 0});
+
+	auto resolve = [&](const px::sub_mesh& sub, std::uint32_t wedge, std::size_t limit) {
+		while (wedge >= limit) {
+			wedge = sub.wedge_map[wedge];
+		}
+		return wedge;
+	};
+
+	// the number of triangles remaining in a sub-mesh when only its first `limit` wedges are kept
+	auto count_triangles = [&](const px::sub_mesh& sub, std::size_t limit) {
+		std::size_t remaining = 0;
+		for (const auto& triangle : sub.triangles) {
+			auto a = resolve(sub, triangle.wedges[0], limit);
+			auto b = resolve(sub, triangle.wedges[1], limit);
+			auto c = resolve(sub, triangle.wedges[2], limit);
+
+			auto pa = sub.wedges[a].index, pb = sub.wedges[b].index, pc = sub.wedges[c].index;
+			remaining += (pa != pb && pb != pc && pa != pc) ? 1 : 0;
+		}
+		return remaining;
+	};
+
+	std::vector<std::size_t> limits(mesh.sub_meshes.size());
+	std::vector<std::size_t> triangles(mesh.sub_meshes.size());
+	for (std::size_t s = 0; s < mesh.sub_meshes.size(); ++s) {
+		limits[s] = mesh.sub_meshes[s].wedges.size();
+		triangles[s] = mesh.sub_meshes[s].triangles.size();
+	}
+
+	for (std::size_t level = 1; level <= count; ++level) {
+		mesh_lod lod {base, 0};
+		lod.mesh.indices.clear();
+		lod.mesh.primitives.clear();
+
+		std::uint32_t vertex_offset = 0;
+		for (std::size_t s = 0; s < mesh.sub_meshes.size(); ++s) {
+			const auto& sub = mesh.sub_meshes[s];
+			auto target = triangles[s] / 2;
+
+			// find the largest number of wedges which halves the triangle count
+			auto low = minimum[s], high = limits[s];
+			while (low < high) {
+				auto middle = (low + high + 1) / 2;
+				if (count_triangles(sub, middle) <= target) {
+					low = middle;
+				} else {
+					high = middle - 1;
+				}
+			}
+
+			limits[s] = low;
+
+			auto offset = static_cast<std::uint32_t>(lod.mesh.indices.size());
+			for (const auto& triangle : sub.triangles) {
+				auto a = resolve(sub, triangle.wedges[0], low);
+				auto b = resolve(sub, triangle.wedges[1], low);
+				auto c = resolve(sub, triangle.wedges[2], low);
+
+				auto pa = sub.wedges[a].index, pb = sub.wedges[b].index, pc = sub.wedges[c].index;
+				if (pa == pb || pb == pc || pa == pc)
+					continue;
+
+				lod.mesh.indices.insert(lod.mesh.indices.end(),
+				                        {vertex_offset + a, vertex_offset + b, vertex_offset + c});
+			}
+
+			for (std::uint32_t w = 0; w < sub.wedges.size(); ++w) {
+				const auto& original = mesh.positions[sub.wedges[w].index];
+				const auto& moved = mesh.positions[sub.wedges[resolve(sub, w, low)].index];
+				lod.error = std::max(lod.error, glm::length(moved - original));
+			}
+
+			auto index_count = static_cast<std::uint32_t>(lod.mesh.indices.size()) - offset;
+			triangles[s] = index_count / 3;
+
+			if (index_count > 0)
+				lod.mesh.primitives.push_back({static_cast<std::uint32_t>(s), offset, index_count});
+
+			vertex_offset += static_cast<std::uint32_t>(sub.wedges.size());
+		}
+
+		optimize_vertex_fetch(lod.mesh);
+		levels.push_back(std::move(lod));
+	}
+
+	return levels;
+}
+
+std::vector<mesh_lod> build_quadric_lods(const indexed_mesh& mesh, std::size_t count) {
+	auto welded = mesh;
+	weld_vertices(welded);
+
+	std::vector<mesh_lod> levels {};
+	levels.push_back({welded, 0});
+
+	quadric_simplifier simplifier {welded};
+	auto target = welded.indices.size() / 3;
+
+	for (std::size_t level = 1; level <= count; ++level) {
+		target /= 2;
+
+		auto error = simplifier.simplify(target);
+		levels.push_back({simplifier.extract(), error});
+	}
+
+	return levels;
+}
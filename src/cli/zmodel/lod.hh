@@ -0,0 +1,43 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/proto_mesh.hh>
+
+#include "indexed_mesh.hh"
+
+#include <cstddef>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A single level of detail of a mesh.
+struct mesh_lod {
+	/// \brief The simplified mesh.
+	indexed_mesh mesh;
+
+	/// \brief The largest distance any vertex was moved by the simplification, in world units. For levels created
+	///        using the quadric simplifier, this is the square root of the largest quadric error instead.
+	float error;
+};
+
+/// \brief Creates levels of detail from the progressive mesh data stored in an MRM mesh.
+///
+/// Every sub-mesh is reduced by collapsing its wedges along the sub-mesh's wedge map until at most half the
+/// triangles of the previous level remain. Level 0 is the full-resolution mesh.
+/// \param mesh The mesh to create levels of detail for.
+/// \param name The name of the resulting meshes.
+/// \param count The number of levels to create in addition to the full-resolution mesh.
+/// \return The levels of detail or an empty list if the mesh does not contain usable collapse data.
+std::vector<mesh_lod> build_mrm_lods(const px::proto_mesh& mesh, const std::string& name, std::size_t count);
+
+/// \brief Creates levels of detail using edge collapses ordered by their quadric error.
+///
+/// Border vertices are never moved and vertices along attribute seams are only collapsed together with all
+/// vertices sharing their position. Level 0 is the full-resolution mesh after welding identical vertices, and
+/// every following level has at most half the triangles of the previous one, if the mesh can be simplified
+/// that far.
+/// \param mesh The mesh to create levels of detail for.
+/// \param count The number of levels to create in addition to the full-resolution mesh.
+/// \return The levels of detail.
+/// \see M. Garland, P. S. Heckbert: Surface Simplification Using Quadric Error Metrics (1997)
+std::vector<mesh_lod> build_quadric_lods(const indexed_mesh& mesh, std::size_t count);
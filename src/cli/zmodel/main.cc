@@ -9,121 +9,49 @@
 #include <CLI/App.hpp>
 #include <fmt/format.h>
 
+#include <algorithm>
+#include <chrono>
 #include <fstream>
 #include <iostream>
+#include <memory>
+#include <optional>
 
+#include "batch.hh"
 #include "config.hh"
+#include "convert.hh"
 
-namespace px = phoenix;
-
-static void dump_material(std::ostream& mtl, std::string_view name, const std::vector<phoenix::material>& materials) {
-	for (const auto& mat : materials) {
-		if (!mat.texture.empty()) {
-			mtl << "newmtl " << mat.name << "\n";
-			mtl << "Kd 1.00 1.00 1.00\n";
-			mtl << "map_Kd " << mat.texture << "\n";
-		}
-	}
-}
-
-static void dump_wavefront(std::ostream& out,
-                           std::ostream* material_out,
-                           std::string_view mtllib_name,
-                           const phoenix::proto_mesh& mesh) {
-	out << "# zmodel exported mesh\n";
-	if (material_out != nullptr)
-		out << "mtllib " << mtllib_name << ".mtl\n\n";
-
-	out << "# vertices\n";
-
-	for (const auto& item : mesh.positions) {
-		out << "v " << item.z << " " << item.y << " " << item.x << "\n";
-	}
-
-	unsigned wedge_offset = 0;
-	int i = 0;
-	for (const auto& msh : mesh.sub_meshes) {
-		out << "g sub" << ++i << "\n"
-		    << "usemtl " << msh.mat.name << "\n";
-
-		for (const auto& item : msh.wedges) {
-			out << "vn " << item.normal.z << " " << item.normal.y << " " << item.normal.x << "\n";
-			out << "vt " << item.texture.x << " " << item.texture.y << "\n";
-		}
-
-		for (const auto& item : msh.triangles) {
-			auto wedge0 = msh.wedges[item.wedges[0]];
-			auto wedge1 = msh.wedges[item.wedges[1]];
-			auto wedge2 = msh.wedges[item.wedges[2]];
-
-			out << "f " << wedge0.index + 1 << "/" << wedge_offset + item.wedges[0] + 1 << "/"
-			    << wedge_offset + item.wedges[0] + 1 << " " << wedge1.index + 1 << "/"
-			    << wedge_offset + item.wedges[1] + 1 << "/" << wedge_offset + item.wedges[1] + 1 << " "
-			    << wedge2.index + 1 << "/" << wedge_offset + item.wedges[2] + 1 << "/"
-			    << wedge_offset + item.wedges[2] + 1 << "\n";
-		}
-
-		wedge_offset += msh.wedges.size();
-	}
-
-	if (material_out != nullptr) {
-		dump_material(*material_out, mtllib_name, mesh.materials);
-	}
-}
-
-static void
-dump_wavefront(std::ostream& out, std::ostream* material_out, std::string_view mtllib_name, const phoenix::mesh& mesh) {
-	out << "# zmodel exported mesh\n";
-	if (material_out != nullptr)
-		out << "mtllib " << mtllib_name << ".mtl\n\n";
-
-	out << "# vertices\n";
-
-	for (const auto& item : mesh.vertices) {
-		out << "v " << item.z << " " << item.y << " " << item.x << "\n";
-	}
-
-	auto& mats = mesh.materials;
-	auto& feats = mesh.features;
-
-	out << "\n# normals\n";
-	for (const auto& feat : feats) {
-		out << "vn " << feat.normal.z << " " << feat.normal.y << " " << feat.normal.x << "\n";
-	}
-
-	out << "\n# textures\n";
-	for (const auto& feat : feats) {
-		out << "vt " << feat.texture.x << " " << feat.texture.y << "\n";
-	}
-
-	long old_material = -1;
-	auto& polys = mesh.polygons;
-	for (unsigned i = 0; i < polys.vertex_indices.size() / 3; ++i) {
-		auto material = polys.material_indices[i];
-
-		if (old_material != material) {
-			auto& mat = mats[material];
-			out << "usemtl " << mat.name << "\n";
-			out << "g " << mat.name << "\n";
-			old_material = material;
-		}
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
 
-		out << "f ";
-		for (unsigned v = 0; v < 3; ++v) {
-			auto feature = polys.feature_indices[i * 3 + v] + 1;
-			out << polys.vertex_indices[i * 3 + v] + 1 << "/" << feature << "/" << feature;
-
-			if (v != 2) {
-				out << " ";
-			}
-		}
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
 
-		out << "\n";
-	}
+namespace px = phoenix;
 
-	if (material_out != nullptr) {
-		dump_material(*material_out, mtllib_name, mesh.materials);
-	}
+/// \brief Determines the peak resident memory usage of this process.
+/// \return The peak usage in bytes or 0 if it cannot be determined.
+static std::size_t peak_memory_usage() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters {};
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof counters) == 0)
+		return 0;
+	return counters.PeakWorkingSetSize;
+#else
+	rusage usage {};
+	if (getrusage(RUSAGE_SELF, &usage) != 0)
+		return 0;
+
+	#ifdef __APPLE__
+	return static_cast<std::size_t>(usage.ru_maxrss);
+	#else
+	return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+	#endif
+#endif
 }
 
 px::buffer open_buffer(const std::optional<std::string>& input, const std::optional<std::string>& vdf) {
@@ -177,62 +105,250 @@ int main(int argc, char** argv) {
 	std::optional<std::string> material {};
 	app.add_option("-m,--material", material, "Also write a material file to the given path");
 
+	std::string format {"obj"};
+	app.add_option("-t,--format",
+	               format,
+	               "Write the model in this format (obj, glb or zmc, a memory-mappable binary mesh cache described in "
+	               "src/pstudio/mesh_cache.hh)")
+	    ->check(CLI::IsMember({"obj", "glb", "zmc"}, CLI::ignore_case));
+
+	bool verify {false};
+	app.add_flag("--verify",
+	             verify,
+	             "Read the written mesh cache back and compare it with the converted mesh (zmc only)");
+
+	bool optimize {false};
+	app.add_flag("-O,--optimize",
+	             optimize,
+	             "Weld duplicate vertices and reorder triangles and vertices for GPU cache efficiency");
+
+	bool group_materials {false};
+	app.add_flag("-g,--group-materials",
+	             group_materials,
+	             "Sort the faces of world and MSH meshes by material so that each material is written as a single "
+	             "group (obj only, glb output always uses one primitive per material)");
+
+	std::optional<std::string> batch {};
+	app.add_option("--batch",
+	               batch,
+	               "Convert all models in the VDF given by -e whose names match this pattern (i.e. '*.MRM') into "
+	               "the directory given by -o. -m names the shared material library");
+
+	std::size_t lods {0};
+	app.add_option("--lods",
+	               lods,
+	               "Also create this many levels of detail, each with half the triangles of the previous one. For "
+	               "Wavefront output, every level is written to its own file next to --output");
+
+	std::string chunks {};
+	app.add_option("--chunks",
+	               chunks,
+	               "Split worlds into spatial chunks using their BSP tree (bsp) or a uniform grid (grid) and "
+	               "write one file per chunk next to a JSON manifest written to --output")
+	    ->check(CLI::IsMember({"bsp", "grid"}, CLI::ignore_case));
+
+	float chunk_size {5000.f};
+	app.add_option("--chunk-size", chunk_size, "The size of a grid chunk in world units (default: 5000)")
+	    ->check(CLI::PositiveNumber);
+
+	std::size_t chunk_polygons {20000};
+	app.add_option("--chunk-polygons",
+	               chunk_polygons,
+	               "The maximum number of polygons per BSP chunk unless it is a single leaf (default: 20000)");
+
+	bool morphs {false};
+	app.add_flag("--morphs",
+	             morphs,
+	             "Export the animations of MMB files as sparse morph targets animated by glTF animations (glb only)");
+
+	std::vector<std::string> vobs {};
+	app.add_option("--vobs",
+	               vobs,
+	               "Also export the visuals of a world's VOBs, looked up in these VDFs (i.e. Meshes.vdf and "
+	               "Anims.vdf). Every visual is converted once and instanced by the glTF scene or, for Wavefront "
+	               "output, written next to --output together with a JSON placement table");
+
+	bool lightmaps {false};
+	app.add_flag("--lightmaps",
+	             lightmaps,
+	             "Pack the lightmaps of world and MSH meshes into atlases and add them as a second texture "
+	             "coordinate channel (glb only)");
+
+	std::uint32_t lightmap_size {2048};
+	app.add_option("--lightmap-size", lightmap_size, "The width and height of lightmap atlas pages (default: 2048)")
+	    ->check(CLI::PositiveNumber);
+
+	bool low_memory {false};
+	app.add_flag("--low-memory",
+	             low_memory,
+	             "Export world and MSH meshes without creating any copies of them by streaming the faces straight "
+	             "from the parsed mesh through a fixed-size buffer on a single thread. This does not lower the peak "
+	             "memory usage below that of parsing, which holds the input and the whole parsed world, including "
+	             "its BSP tree and VOBs, at once; it only keeps exporting from adding to it. There is thus no fixed "
+	             "bound relative to the input size. Reports the peak memory usage and its ratio to the input size "
+	             "(obj only)");
+
+	unsigned threads {0};
+	app.add_option("-j,--threads", threads, "Use this many threads or one per CPU core if 0 (the default)");
+
 	CLI11_PARSE(app, argc, argv);
 
 	if (display_version) {
 		fmt::print("zmodel v{}\n", ZMODEL_VERSION);
 	} else {
 		try {
+			if (batch) {
+				if (!vdf || !output) {
+					fmt::print(stderr, "--batch requires --vdf and --output to be set\n");
+					return EXIT_FAILURE;
+				}
+
+				if (phoenix::iequals(format, "zmc")) {
+					fmt::print(stderr, "--batch supports obj and glb output only\n");
+					return EXIT_FAILURE;
+				}
+
+				pstudio::thread_pool pool {threads};
+				auto start = std::chrono::steady_clock::now();
+
+				auto binary = phoenix::iequals(format, "glb");
+				batch_options options {*batch, *output, material.value_or(""), binary, optimize};
+				auto stats = convert_batch(px::vdf_file::open(*vdf), options, pool);
+
+				auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+				print_batch_summary(stderr, stats, seconds);
+				auto failed = std::any_of(stats.begin(), stats.end(), [](const auto& type) {
+					return type.second.failed > 0;
+				});
+				return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+			}
+
 			if (!file) {
 				fmt::print(stderr, "no input file given\n");
 				return EXIT_FAILURE;
 			}
 
 			auto in = open_buffer(file, vdf);
+			auto input_size = in.limit();
 			auto extension = file->substr(file->find('.') + 1);
 
-			std::ostream* model_out = &std::cout;
-			if (output)
-				model_out = new std::ofstream {*output};
+			auto binary = phoenix::iequals(format, "glb");
+			auto cache = phoenix::iequals(format, "zmc");
+			if (lightmaps && !binary) {
+				fmt::print(stderr, "--lightmaps requires glb output\n");
+				return EXIT_FAILURE;
+			}
+
+			if (low_memory && (binary || cache)) {
+				fmt::print(stderr, "--low-memory requires obj output\n");
+				return EXIT_FAILURE;
+			}
+
+			if (morphs && !binary) {
+				fmt::print(stderr, "--morphs requires glb output\n");
+				return EXIT_FAILURE;
+			}
+
+			if (verify && !cache) {
+				fmt::print(stderr, "--verify requires zmc output\n");
+				return EXIT_FAILURE;
+			}
 
-			std::ostream* material_out = nullptr;
-			if (material)
-				material_out = new std::ofstream {*material};
+			convert_options options {};
+			options.output = output;
+			options.material_library = material.value_or("");
+			options.binary = binary;
+			options.cache = cache;
+			options.verify = verify;
+			options.optimize = optimize;
+			options.group_materials = group_materials;
+			options.lightmaps = lightmaps;
+			options.lightmap_size = lightmap_size;
+			options.lods = lods;
+			options.chunks = chunks;
+			options.chunk_size = chunk_size;
+			options.chunk_polygons = chunk_polygons;
+			options.vobs = vobs;
+
+			std::unique_ptr<std::ofstream> material_out {};
+			if (!binary && !cache)
+				material_out = open_output(material, std::ios::out);
+			options.material_out = material_out.get();
+
+			pstudio::thread_pool pool {threads};
 
 			if (phoenix::iequals(extension, "MRM")) {
 				auto mesh = phoenix::proto_mesh::parse(in);
-				dump_wavefront(*model_out, material_out, material.value_or(""), mesh);
+				if (!convert_mesh(mesh, options, pool))
+					return EXIT_FAILURE;
 			} else if (phoenix::iequals(extension, "ZEN")) {
 				auto wld = phoenix::world::parse(in);
-				dump_wavefront(*model_out, material_out, material.value_or(""), wld.world_mesh);
+
+				if (low_memory) {
+					// only the world mesh is exported, so everything else can be released right away. This
+					// does not lower the peak memory usage, which is reached while parsing, but leaves the
+					// export with just the mesh.
+					in = px::buffer::empty();
+					wld.world_vobs.clear();
+					wld.world_vobs.shrink_to_fit();
+					wld.world_bsp_tree = {};
+					wld.world_way_net = {};
+
+					convert_streaming(wld.world_mesh, options);
+				} else if (!vobs.empty()) {
+					if (!chunks.empty())
+						fmt::print(stderr, "--chunks is not supported together with --vobs and will be ignored\n");
+					if (!convert_scene(wld, options, pool))
+						return EXIT_FAILURE;
+				} else if (chunks.empty()) {
+					if (!convert_mesh(wld.world_mesh, options, pool))
+						return EXIT_FAILURE;
+				} else if (!convert_chunks(wld, options, pool)) {
+					return EXIT_FAILURE;
+				}
 			} else if (phoenix::iequals(extension, "MSH")) {
 				auto msh = phoenix::mesh::parse(in, {});
-				dump_wavefront(*model_out, material_out, material.value_or(""), msh);
+
+				if (low_memory) {
+					in = px::buffer::empty();
+					convert_streaming(msh, options);
+				} else if (!convert_mesh(msh, options, pool)) {
+					return EXIT_FAILURE;
+				}
 			} else if (phoenix::iequals(extension, "MMB")) {
 				auto msh = phoenix::morph_mesh::parse(in);
-				dump_wavefront(*model_out, material_out, material.value_or(""), msh.mesh);
+
+				if (morphs) {
+					convert_morphs(msh, options, pool);
+				} else if (!convert_mesh(msh.mesh, options, pool)) {
+					return EXIT_FAILURE;
+				}
 			} else if (phoenix::iequals(extension, "MDL")) {
-				auto msh = phoenix::model::parse(in);
-				dump_wavefront(*model_out,
-				               material_out,
-				               material.value_or(""),
-				               msh.mesh.meshes[0].mesh); // FIXME: support dumping multiple meshes
+				auto mdl = phoenix::model::parse(in);
+				if (!convert_model(mdl.mesh, &mdl.hierarchy, options, pool))
+					return EXIT_FAILURE;
 			} else if (phoenix::iequals(extension, "MDM")) {
 				auto msh = phoenix::model_mesh::parse(in);
-				dump_wavefront(*model_out,
-				               material_out,
-				               material.value_or(""),
-				               msh.meshes[0].mesh); // FIXME: support dumping multiple meshes
+				if (!convert_model(msh, nullptr, options, pool))
+					return EXIT_FAILURE;
 			} else {
 				fmt::print(stderr, "format not supported: {}", extension);
 				return EXIT_FAILURE;
 			}
 
-			model_out->flush();
-
-			if (material_out != nullptr) {
-				material_out->flush();
-				delete material_out;
+			if (low_memory) {
+				constexpr double mib = 1024.0 * 1024.0;
+				auto peak = peak_memory_usage();
+
+				if (peak == 0) {
+					fmt::print(stderr, "peak memory usage: unknown\n");
+				} else {
+					fmt::print(stderr,
+					           "peak memory usage: {:.1f} MiB ({:.2f}x the input size of {:.1f} MiB)\n",
+					           static_cast<double>(peak) / mib,
+					           input_size > 0 ? static_cast<double>(peak) / static_cast<double>(input_size) : 0.0,
+					           static_cast<double>(input_size) / mib);
+				}
 			}
 		} catch (const std::exception& e) {
 			fmt::print(stderr, "cannot convert model: {}", e.what());
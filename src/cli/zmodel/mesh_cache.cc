@@ -0,0 +1,268 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "mesh_cache.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string_view>
+
+namespace mc = pstudio::mesh_cache;
+
+namespace {
+	/// \brief Appends little-endian values to a byte buffer independent of the host's byte order.
+	class cache_writer {
+	public:
+		void u32(std::uint32_t value) {
+			for (unsigned i = 0; i < 4; ++i) {
+				_m_data.push_back(static_cast<std::uint8_t>(value >> (i * 8)));
+			}
+		}
+
+		void u64(std::uint64_t value) {
+			u32(static_cast<std::uint32_t>(value));
+			u32(static_cast<std::uint32_t>(value >> 32));
+		}
+
+		void f32(float value) {
+			std::uint32_t bits;
+			std::memcpy(&bits, &value, sizeof bits);
+			u32(bits);
+		}
+
+		void bytes(const void* data, std::size_t size) {
+			auto* begin = static_cast<const std::uint8_t*>(data);
+			_m_data.insert(_m_data.end(), begin, begin + size);
+		}
+
+		/// \brief Appends the given number of zero bytes.
+		void skip(std::size_t count) {
+			_m_data.resize(_m_data.size() + count, 0);
+		}
+
+		/// \brief Pads the buffer with zeroes up to the next section boundary and starts a new section there.
+		void begin_section(mc::section_id id) {
+			_m_data.resize((_m_data.size() + mc::ALIGNMENT - 1) / mc::ALIGNMENT * mc::ALIGNMENT, 0);
+			_m_sections[id].offset = _m_data.size();
+		}
+
+		void end_section(mc::section_id id) {
+			_m_sections[id].size = _m_data.size() - _m_sections[id].offset;
+		}
+
+		/// \brief Patches the location of every section into the header at the start of the buffer.
+		std::vector<std::uint8_t> finish() && {
+			cache_writer table {};
+			for (const auto& section : _m_sections) {
+				table.u64(section.offset);
+				table.u64(section.size);
+			}
+
+			std::copy(table._m_data.begin(), table._m_data.end(), _m_data.begin() + offsetof(mc::header, sections));
+			return std::move(_m_data);
+		}
+
+		[[nodiscard]] std::size_t size() const noexcept {
+			return _m_data.size();
+		}
+
+	private:
+		std::vector<std::uint8_t> _m_data {};
+		mc::section _m_sections[mc::section_count] {};
+	};
+
+	/// \brief Collects the strings of a mesh cache into one contiguous block.
+	class string_table {
+	public:
+		mc::string_ref add(std::string_view value) {
+			if (_m_data.size() + value.size() > std::numeric_limits<std::uint32_t>::max())
+				throw std::length_error("mesh cache: string table too large");
+
+			mc::string_ref ref {static_cast<std::uint32_t>(_m_data.size()), static_cast<std::uint32_t>(value.size())};
+			_m_data.append(value);
+			return ref;
+		}
+
+		[[nodiscard]] const std::string& data() const noexcept {
+			return _m_data;
+		}
+
+	private:
+		std::string _m_data {};
+	};
+
+	std::uint32_t checked_count(std::size_t count) {
+		if (count > std::numeric_limits<std::uint32_t>::max())
+			throw std::length_error("mesh cache: mesh too large");
+		return static_cast<std::uint32_t>(count);
+	}
+
+	bool same_bits(float a, float b) {
+		return std::memcmp(&a, &b, sizeof a) == 0;
+	}
+} // namespace
+
+std::vector<std::uint8_t> encode_mesh_cache(const indexed_mesh& mesh) {
+	string_table strings {};
+	auto name = strings.add(mesh.name);
+
+	std::vector<mc::material> materials {};
+	materials.reserve(mesh.materials.size());
+
+	for (const auto& material : mesh.materials) {
+		materials.push_back({strings.add(material.name), strings.add(material.texture)});
+	}
+
+	cache_writer out {};
+	out.bytes(mc::MAGIC, sizeof mc::MAGIC);
+	out.u32(mc::VERSION);
+	out.u32(mc::BYTE_ORDER_MARK);
+	out.u32(sizeof(mc::header));
+	out.u32(checked_count(mesh.positions.size()));
+	out.u32(checked_count(mesh.indices.size()));
+	out.u32(checked_count(mesh.primitives.size()));
+	out.u32(checked_count(mesh.materials.size()));
+	out.u32(name.offset);
+	out.u32(name.size);
+
+	// the section table is filled in by finish()
+	out.skip(sizeof(mc::header) - out.size());
+
+	out.begin_section(mc::positions);
+	for (const auto& position : mesh.positions) {
+		out.f32(position.x);
+		out.f32(position.y);
+		out.f32(position.z);
+	}
+	out.end_section(mc::positions);
+
+	out.begin_section(mc::normals);
+	for (const auto& normal : mesh.normals) {
+		out.f32(normal.x);
+		out.f32(normal.y);
+		out.f32(normal.z);
+	}
+	out.end_section(mc::normals);
+
+	out.begin_section(mc::uvs);
+	for (const auto& uv : mesh.uvs) {
+		out.f32(uv.x);
+		out.f32(uv.y);
+	}
+	out.end_section(mc::uvs);
+
+	out.begin_section(mc::lightmap_uvs);
+	for (const auto& uv : mesh.lightmap_uvs) {
+		out.f32(uv.x);
+		out.f32(uv.y);
+	}
+	out.end_section(mc::lightmap_uvs);
+
+	out.begin_section(mc::indices);
+	for (auto index : mesh.indices) {
+		out.u32(index);
+	}
+	out.end_section(mc::indices);
+
+	out.begin_section(mc::primitives);
+	for (const auto& primitive : mesh.primitives) {
+		out.u32(primitive.material);
+		out.u32(primitive.offset);
+		out.u32(primitive.count);
+		out.u32(static_cast<std::uint32_t>(primitive.lightmap));
+	}
+	out.end_section(mc::primitives);
+
+	out.begin_section(mc::materials);
+	for (const auto& material : materials) {
+		out.u32(material.name.offset);
+		out.u32(material.name.size);
+		out.u32(material.texture.offset);
+		out.u32(material.texture.size);
+	}
+	out.end_section(mc::materials);
+
+	out.begin_section(mc::strings);
+	out.bytes(strings.data().data(), strings.data().size());
+	out.end_section(mc::strings);
+
+	return std::move(out).finish();
+}
+
+std::optional<std::string> compare_mesh_cache(const mc::mesh_view& cache, const indexed_mesh& mesh) {
+	if (cache.name() != mesh.name)
+		return fmt::format("name differs: '{}' != '{}'", cache.name(), mesh.name);
+
+	auto compare_count =
+	    [](std::string_view what, std::size_t actual, std::size_t expected) -> std::optional<std::string> {
+		if (actual == expected)
+			return std::nullopt;
+		return fmt::format("{} count differs: {} != {}", what, actual, expected);
+	};
+
+	if (auto error = compare_count("vertex", cache.positions().size(), mesh.positions.size()))
+		return error;
+	if (auto error = compare_count("normal", cache.normals().size(), mesh.normals.size()))
+		return error;
+	if (auto error = compare_count("uv", cache.uvs().size(), mesh.uvs.size()))
+		return error;
+	if (auto error = compare_count("lightmap uv", cache.lightmap_uvs().size(), mesh.lightmap_uvs.size()))
+		return error;
+	if (auto error = compare_count("index", cache.indices().size(), mesh.indices.size()))
+		return error;
+	if (auto error = compare_count("primitive", cache.primitives().size(), mesh.primitives.size()))
+		return error;
+	if (auto error = compare_count("material", cache.materials().size(), mesh.materials.size()))
+		return error;
+
+	for (std::size_t i = 0; i < mesh.positions.size(); ++i) {
+		auto& a = cache.positions()[i];
+		auto& b = mesh.positions[i];
+		if (!same_bits(a.x, b.x) || !same_bits(a.y, b.y) || !same_bits(a.z, b.z))
+			return fmt::format("position {} differs", i);
+	}
+
+	for (std::size_t i = 0; i < mesh.normals.size(); ++i) {
+		auto& a = cache.normals()[i];
+		auto& b = mesh.normals[i];
+		if (!same_bits(a.x, b.x) || !same_bits(a.y, b.y) || !same_bits(a.z, b.z))
+			return fmt::format("normal {} differs", i);
+	}
+
+	for (std::size_t i = 0; i < mesh.uvs.size(); ++i) {
+		auto& a = cache.uvs()[i];
+		auto& b = mesh.uvs[i];
+		if (!same_bits(a.x, b.x) || !same_bits(a.y, b.y))
+			return fmt::format("uv {} differs", i);
+	}
+
+	for (std::size_t i = 0; i < mesh.lightmap_uvs.size(); ++i) {
+		auto& a = cache.lightmap_uvs()[i];
+		auto& b = mesh.lightmap_uvs[i];
+		if (!same_bits(a.x, b.x) || !same_bits(a.y, b.y))
+			return fmt::format("lightmap uv {} differs", i);
+	}
+
+	if (std::memcmp(cache.indices().data(), mesh.indices.data(), mesh.indices.size() * sizeof(std::uint32_t)) != 0)
+		return std::string {"indices differ"};
+
+	for (std::size_t i = 0; i < mesh.primitives.size(); ++i) {
+		auto& a = cache.primitives()[i];
+		auto& b = mesh.primitives[i];
+		if (a.material != b.material || a.offset != b.offset || a.count != b.count || a.lightmap != b.lightmap)
+			return fmt::format("primitive {} differs", i);
+	}
+
+	for (std::size_t i = 0; i < mesh.materials.size(); ++i) {
+		auto& a = cache.materials()[i];
+		auto& b = mesh.materials[i];
+		if (cache.string(a.name) != b.name || cache.string(a.texture) != b.texture)
+			return fmt::format("material {} differs", i);
+	}
+
+	return std::nullopt;
+}
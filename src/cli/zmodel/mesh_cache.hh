@@ -0,0 +1,23 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "indexed_mesh.hh"
+
+#include <pstudio/mesh_cache.hh>
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+/// \brief Encodes an indexed mesh in the binary mesh cache format.
+/// \see pstudio::mesh_cache for a description of the format.
+/// \param mesh The mesh to encode.
+/// \return The contents of the mesh cache file.
+std::vector<std::uint8_t> encode_mesh_cache(const indexed_mesh& mesh);
+
+/// \brief Compares the contents of a mesh cache file with the mesh it was encoded from.
+/// \param cache A view of the mesh cache file.
+/// \param mesh The original mesh.
+/// \return A description of the first difference found or std::nullopt if the cache matches the mesh exactly.
+std::optional<std::string> compare_mesh_cache(const pstudio::mesh_cache::mesh_view& cache, const indexed_mesh& mesh);
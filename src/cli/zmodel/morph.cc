@@ -0,0 +1,105 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "morph.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+morph_set build_morph_targets(const px::morph_mesh& mesh, pstudio::thread_pool& pool) {
+	// to_indexed_mesh() creates one vertex per wedge, so every position maps to all wedges referencing it
+	std::vector<std::uint32_t> offsets(mesh.mesh.positions.size() + 1, 0);
+	for (const auto& sub : mesh.mesh.sub_meshes) {
+		for (const auto& wedge : sub.wedges) {
+			if (wedge.index >= mesh.mesh.positions.size())
+				throw std::runtime_error(fmt::format("wedge references position {} of {}",
+				                                     wedge.index,
+				                                     mesh.mesh.positions.size()));
+
+			++offsets[wedge.index + 1u];
+		}
+	}
+
+	std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+	std::vector<std::uint32_t> position_vertices(offsets.back());
+	{
+		auto next = offsets;
+		std::uint32_t vertex = 0;
+
+		for (const auto& sub : mesh.mesh.sub_meshes) {
+			for (const auto& wedge : sub.wedges) {
+				position_vertices[next[wedge.index]++] = vertex++;
+			}
+		}
+	}
+
+	// samples are stored relative to the mesh's positions, frame after frame
+	morph_set result {};
+	std::vector<std::pair<const px::morph_animation*, std::uint32_t>> frames {};
+
+	for (const auto& animation : mesh.animations) {
+		auto first = static_cast<std::uint32_t>(frames.size());
+		auto frame_time = 0.f;
+		if (animation.frame_count > 0)
+			frame_time = animation.duration / static_cast<float>(animation.frame_count);
+
+		result.clips.push_back({animation.name, first, animation.frame_count, frame_time});
+
+		for (std::uint32_t frame = 0; frame < animation.frame_count; ++frame) {
+			frames.emplace_back(&animation, frame);
+		}
+	}
+
+	result.targets.resize(frames.size());
+	pstudio::parallel_for(pool, frames.size(), 8, [&](std::size_t begin, std::size_t end) {
+		std::vector<std::pair<std::uint32_t, glm::vec3>> moved {};
+
+		for (auto i = begin; i < end; ++i) {
+			auto [animation, frame] = frames[i];
+			auto& target = result.targets[i];
+			target.name = fmt::format("{}_{}", animation->name, frame);
+
+			auto count = animation->vertices.size();
+			auto first = static_cast<std::size_t>(frame) * count;
+			if (first + count > animation->samples.size())
+				continue;
+
+			moved.clear();
+			for (std::size_t j = 0; j < count; ++j) {
+				auto position = animation->vertices[j];
+				const auto& delta = animation->samples[first + j];
+
+				if ((delta.x == 0 && delta.y == 0 && delta.z == 0) || position + 1u >= offsets.size())
+					continue;
+
+				for (auto k = offsets[position]; k < offsets[position + 1]; ++k) {
+					moved.emplace_back(position_vertices[k], delta);
+				}
+			}
+
+			// sparse accessors require strictly increasing indices
+			std::stable_sort(moved.begin(), moved.end(), [](const auto& a, const auto& b) {
+				return a.first < b.first;
+			});
+
+			target.vertices.reserve(moved.size());
+			target.deltas.reserve(moved.size());
+
+			for (const auto& [vertex, delta] : moved) {
+				if (!target.vertices.empty() && target.vertices.back() == vertex) {
+					target.deltas.back() = delta;
+					continue;
+				}
+
+				target.vertices.push_back(vertex);
+				target.deltas.push_back(delta);
+			}
+		}
+	});
+
+	return result;
+}
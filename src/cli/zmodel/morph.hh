@@ -0,0 +1,55 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/morph_mesh.hh>
+
+#include <glm/vec3.hpp>
+#include <pstudio/parallel.hh>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A single frame of a morph animation stored as sparse per-vertex position offsets.
+struct morph_target {
+	/// \brief The name of the target, made up of the animation's name and the frame number.
+	std::string name;
+
+	/// \brief The vertices moved by the frame in ascending order.
+	std::vector<std::uint32_t> vertices;
+
+	/// \brief The offset of each vertex in `vertices` from its base position. Never zero.
+	std::vector<glm::vec3> deltas;
+};
+
+/// \brief A morph animation playing a consecutive range of morph targets.
+struct morph_clip {
+	std::string name;
+
+	/// \brief The index of the target of the animation's first frame.
+	std::uint32_t first_target;
+
+	/// \brief The number of frames and thus targets of the animation.
+	std::uint32_t frame_count;
+
+	/// \brief The time between two frames in seconds.
+	float frame_time;
+};
+
+/// \brief The morph targets of all animations of a morph mesh.
+struct morph_set {
+	std::vector<morph_target> targets;
+	std::vector<morph_clip> clips;
+};
+
+/// \brief Converts the animations of a morph mesh into one sparse morph target per frame.
+///
+/// The vertex indices refer to the vertices created by to_indexed_mesh() for the morph mesh's MRM mesh. Frames are
+/// processed concurrently and offsets of zero are skipped, so frames only store the vertices they actually move.
+/// \param mesh The morph mesh to convert the animations of.
+/// \param pool The threads to process the frames on.
+/// \return The morph targets and the animations playing them.
+/// \throws std::runtime_error if a wedge of the MRM mesh references a position which does not exist.
+morph_set build_morph_targets(const px::morph_mesh& mesh, pstudio::thread_pool& pool);
@@ -0,0 +1,325 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "optimize.hh"
+
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+static constexpr auto UNUSED = std::numeric_limits<std::uint32_t>::max();
+
+namespace {
+	/// \brief The bitwise contents of a vertex, used for welding.
+	struct vertex_key {
+		std::uint32_t bits[10];
+
+		bool operator==(const vertex_key& other) const noexcept {
+			return std::memcmp(bits, other.bits, sizeof(bits)) == 0;
+		}
+	};
+
+	struct vertex_key_hash {
+		std::size_t operator()(const vertex_key& key) const noexcept {
+			// FNV-1a over all 32-bit words
+			std::uint64_t hash = 14695981039346656037ull;
+			for (auto word : key.bits) {
+				hash = (hash ^ word) * 1099511628211ull;
+			}
+			return static_cast<std::size_t>(hash);
+		}
+	};
+
+	/// \brief Simulates a FIFO vertex cache of VERTEX_CACHE_SIZE entries for vertices with sparse identifiers.
+	class cache_simulation {
+	public:
+		void flush() noexcept {
+			_m_time += VERTEX_CACHE_SIZE;
+		}
+
+		void access(std::uint64_t vertex) {
+			auto& timestamp = _m_timestamps[vertex];
+			if (_m_time - timestamp > VERTEX_CACHE_SIZE) {
+				timestamp = _m_time++;
+				++_m_misses;
+			}
+		}
+
+		[[nodiscard]] float acmr(std::size_t triangles) const noexcept {
+			return triangles == 0 ? 0 : static_cast<float>(_m_misses) / static_cast<float>(triangles);
+		}
+
+	private:
+		std::unordered_map<std::uint64_t, std::size_t> _m_timestamps {};
+		std::size_t _m_time {VERTEX_CACHE_SIZE + 1};
+		std::size_t _m_misses {0};
+	};
+} // namespace
+
+static void remap_vertices(indexed_mesh& mesh, const std::vector<std::uint32_t>& remap, std::size_t count) {
+	std::vector<glm::vec3> positions(count);
+	std::vector<glm::vec3> normals(count);
+	std::vector<glm::vec2> uvs(count);
+	std::vector<glm::vec2> lightmap_uvs(mesh.lightmap_uvs.empty() ? 0 : count);
+
+	for (std::size_t i = 0; i < remap.size(); ++i) {
+		if (remap[i] == UNUSED)
+			continue;
+
+		positions[remap[i]] = mesh.positions[i];
+		normals[remap[i]] = mesh.normals[i];
+		uvs[remap[i]] = mesh.uvs[i];
+
+		if (!lightmap_uvs.empty())
+			lightmap_uvs[remap[i]] = mesh.lightmap_uvs[i];
+	}
+
+	for (auto& index : mesh.indices) {
+		index = remap[index];
+	}
+
+	mesh.positions = std::move(positions);
+	mesh.normals = std::move(normals);
+	mesh.uvs = std::move(uvs);
+	mesh.lightmap_uvs = std::move(lightmap_uvs);
+}
+
+float compute_acmr(const indexed_mesh& mesh) {
+	if (mesh.indices.empty())
+		return 0;
+
+	std::vector<std::size_t> timestamps(mesh.positions.size(), 0);
+	std::size_t time = VERTEX_CACHE_SIZE + 1;
+	std::size_t misses = 0;
+
+	for (const auto& primitive : mesh.primitives) {
+		// flush the cache
+		time += VERTEX_CACHE_SIZE;
+
+		for (auto i = primitive.offset; i < primitive.offset + primitive.count; ++i) {
+			auto vertex = mesh.indices[i];
+
+			if (time - timestamps[vertex] > VERTEX_CACHE_SIZE) {
+				timestamps[vertex] = time++;
+				++misses;
+			}
+		}
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(mesh.indices.size() / 3);
+}
+
+float compute_acmr(const px::mesh& mesh) {
+	const auto& polys = mesh.polygons;
+	cache_simulation cache {};
+
+	for (std::size_t polygon = 0; polygon < polys.material_indices.size(); ++polygon) {
+		if (polygon > 0 && polys.material_indices[polygon] != polys.material_indices[polygon - 1])
+			cache.flush();
+
+		for (auto v = polygon * 3; v < polygon * 3 + 3; ++v) {
+			cache.access(std::uint64_t {polys.feature_indices[v]} << 32 | polys.vertex_indices[v]);
+		}
+	}
+
+	return cache.acmr(polys.material_indices.size());
+}
+
+float compute_acmr(const px::proto_mesh& mesh) {
+	cache_simulation cache {};
+	std::size_t triangles = 0;
+	std::uint64_t base = 0;
+
+	for (const auto& sub : mesh.sub_meshes) {
+		cache.flush();
+
+		for (const auto& triangle : sub.triangles) {
+			for (auto wedge : triangle.wedges) {
+				cache.access(base + wedge);
+			}
+		}
+
+		base += sub.wedges.size();
+		triangles += sub.triangles.size();
+	}
+
+	return cache.acmr(triangles);
+}
+
+void weld_vertices(indexed_mesh& mesh) {
+	std::unordered_map<vertex_key, std::uint32_t, vertex_key_hash> unique {};
+	unique.reserve(mesh.positions.size());
+
+	std::vector<std::uint32_t> remap(mesh.positions.size());
+	for (std::size_t i = 0; i < mesh.positions.size(); ++i) {
+		vertex_key key {};
+		std::memcpy(&key.bits[0], &mesh.positions[i], sizeof(float) * 3);
+		std::memcpy(&key.bits[3], &mesh.normals[i], sizeof(float) * 3);
+		std::memcpy(&key.bits[6], &mesh.uvs[i], sizeof(float) * 2);
+
+		if (!mesh.lightmap_uvs.empty())
+			std::memcpy(&key.bits[8], &mesh.lightmap_uvs[i], sizeof(float) * 2);
+
+		remap[i] = unique.try_emplace(key, static_cast<std::uint32_t>(unique.size())).first->second;
+	}
+
+	remap_vertices(mesh, remap, unique.size());
+}
+
+/// \brief Reorders the given triangles using Tipsify.
+/// \param indices The triangle indices of one primitive, referencing vertices `[0, vertex_count)`.
+static void tipsify(std::uint32_t* indices, std::size_t index_count, std::size_t vertex_count) {
+	auto triangle_count = index_count / 3;
+
+	// build the vertex-triangle adjacency as a compressed array
+	std::vector<std::uint32_t> live(vertex_count, 0);
+	for (std::size_t i = 0; i < index_count; ++i) {
+		++live[indices[i]];
+	}
+
+	std::vector<std::uint32_t> offsets(vertex_count + 1, 0);
+	for (std::size_t v = 0; v < vertex_count; ++v) {
+		offsets[v + 1] = offsets[v] + live[v];
+	}
+
+	std::vector<std::uint32_t> adjacency(index_count);
+	{
+		auto cursor = offsets;
+		for (std::size_t i = 0; i < index_count; ++i) {
+			adjacency[cursor[indices[i]]++] = static_cast<std::uint32_t>(i / 3);
+		}
+	}
+
+	std::vector<std::size_t> timestamps(vertex_count, 0);
+	std::vector<bool> emitted(triangle_count, false);
+	std::vector<std::uint32_t> dead_ends {};
+	std::vector<std::uint32_t> candidates {};
+	std::vector<std::uint32_t> output {};
+	output.reserve(index_count);
+
+	std::size_t time = VERTEX_CACHE_SIZE + 1;
+	std::size_t cursor = 0;
+	std::int64_t fanning = vertex_count > 0 ? 0 : -1;
+
+	while (fanning >= 0) {
+		candidates.clear();
+
+		auto vertex = static_cast<std::size_t>(fanning);
+		for (auto i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+			auto triangle = adjacency[i];
+			if (emitted[triangle])
+				continue;
+
+			for (std::size_t k = 0; k < 3; ++k) {
+				auto v = indices[triangle * 3 + k];
+
+				output.push_back(v);
+				dead_ends.push_back(v);
+				candidates.push_back(v);
+				--live[v];
+
+				if (time - timestamps[v] > VERTEX_CACHE_SIZE) {
+					timestamps[v] = time++;
+				}
+			}
+
+			emitted[triangle] = true;
+		}
+
+		// pick the candidate which will still be in the cache after emitting all of its remaining triangles
+		fanning = -1;
+		std::int64_t best = -1;
+		for (auto v : candidates) {
+			if (live[v] == 0)
+				continue;
+
+			std::int64_t priority = 0;
+			if (time - timestamps[v] + 2 * live[v] <= VERTEX_CACHE_SIZE) {
+				priority = static_cast<std::int64_t>(time - timestamps[v]);
+			}
+
+			if (priority > best) {
+				best = priority;
+				fanning = v;
+			}
+		}
+
+		if (fanning >= 0)
+			continue;
+
+		// no suitable candidate, so fall back to recently used vertices and then to the input order
+		while (!dead_ends.empty() && fanning < 0) {
+			auto v = dead_ends.back();
+			dead_ends.pop_back();
+
+			if (live[v] > 0)
+				fanning = v;
+		}
+
+		while (cursor < vertex_count && fanning < 0) {
+			if (live[cursor] > 0)
+				fanning = static_cast<std::int64_t>(cursor);
+			++cursor;
+		}
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void optimize_vertex_cache(indexed_mesh& mesh) {
+	// Tipsify runs on each primitive separately using primitive-local vertex numbers to keep its
+	// per-vertex state proportional to the size of the primitive.
+	std::vector<std::uint32_t> local(mesh.positions.size(), UNUSED);
+	std::vector<std::uint32_t> global {};
+
+	for (const auto& primitive : mesh.primitives) {
+		auto* indices = mesh.indices.data() + primitive.offset;
+		global.clear();
+
+		for (std::size_t i = 0; i < primitive.count; ++i) {
+			auto& index = indices[i];
+
+			if (local[index] == UNUSED) {
+				local[index] = static_cast<std::uint32_t>(global.size());
+				global.push_back(index);
+			}
+
+			index = local[index];
+		}
+
+		tipsify(indices, primitive.count, global.size());
+
+		for (std::size_t i = 0; i < primitive.count; ++i) {
+			indices[i] = global[indices[i]];
+		}
+
+		for (auto index : global) {
+			local[index] = UNUSED;
+		}
+	}
+}
+
+void optimize_vertex_fetch(indexed_mesh& mesh) {
+	std::vector<std::uint32_t> remap(mesh.positions.size(), UNUSED);
+	std::uint32_t next = 0;
+
+	for (auto index : mesh.indices) {
+		if (remap[index] == UNUSED) {
+			remap[index] = next++;
+		}
+	}
+
+	remap_vertices(mesh, remap, next);
+}
+
+optimize_stats optimize_mesh(indexed_mesh& mesh) {
+	optimize_stats stats {};
+	stats.vertices_before = mesh.positions.size();
+
+	weld_vertices(mesh);
+	optimize_vertex_cache(mesh);
+	optimize_vertex_fetch(mesh);
+
+	stats.vertices_after = mesh.positions.size();
+	stats.acmr_after = compute_acmr(mesh);
+	return stats;
+}
@@ -0,0 +1,54 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include "indexed_mesh.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// \brief The size of the FIFO vertex cache assumed when optimizing and reporting ACMR.
+static constexpr std::size_t VERTEX_CACHE_SIZE = 32;
+
+/// \brief Statistics collected by optimize_mesh().
+///
+/// `vertices_before` is the vertex count of the indexed mesh passed to optimize_mesh(), whose identical face corners
+/// have already been merged by to_indexed_mesh(). Its index count is the number of face corners of the original
+/// mesh. Use the compute_acmr() overloads for phoenix' meshes to measure the ACMR of the original order.
+struct optimize_stats {
+	std::size_t vertices_before;
+	std::size_t vertices_after;
+	float acmr_after;
+};
+
+/// \brief Calculates the average cache miss ratio of a mesh.
+///
+/// The ACMR is the number of vertices transformed per triangle, simulating a FIFO cache of VERTEX_CACHE_SIZE
+/// entries which is flushed at the start of every primitive. It ranges from 0.5 (ideal) to 3 (no reuse at all).
+float compute_acmr(const indexed_mesh& mesh);
+
+/// \brief Calculates the average cache miss ratio of an MSH or world mesh drawn in its original polygon order.
+///
+/// Every distinct pair of position and feature counts as one vertex, like in to_indexed_mesh(). The cache is flushed
+/// whenever the material changes from one polygon to the next.
+float compute_acmr(const px::mesh& mesh);
+
+/// \brief Calculates the average cache miss ratio of an MRM mesh drawn in its original triangle order.
+///
+/// Every wedge counts as one vertex. The cache is flushed at the start of every sub-mesh.
+float compute_acmr(const px::proto_mesh& mesh);
+
+/// \brief Merges all vertices with identical position, normal and texture coordinates.
+void weld_vertices(indexed_mesh& mesh);
+
+/// \brief Reorders the triangles of every primitive for post-transform vertex cache locality using Tipsify.
+/// \see P. V. Sander, D. Nehab, J. Barczak: Fast Triangle Reordering for Vertex Locality and Reduced Overdraw (2007)
+void optimize_vertex_cache(indexed_mesh& mesh);
+
+/// \brief Reorders the vertices in the order they're first referenced by the index buffer. Unused vertices are
+///        removed.
+void optimize_vertex_fetch(indexed_mesh& mesh);
+
+/// \brief Runs weld_vertices(), optimize_vertex_cache() and optimize_vertex_fetch() on the given mesh.
+/// \return The vertex count and ACMR before and after optimizing.
+optimize_stats optimize_mesh(indexed_mesh& mesh);
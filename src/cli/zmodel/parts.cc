@@ -0,0 +1,83 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "parts.hh"
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <functional>
+#include <unordered_set>
+
+std::vector<model_part> collect_model_parts(const px::model_mesh& mesh, const px::model_hierarchy* hierarchy) {
+	std::vector<model_part> parts {};
+	parts.reserve(mesh.meshes.size() + mesh.attachments.size());
+
+	for (std::size_t i = 0; i < mesh.meshes.size(); ++i) {
+		parts.push_back({fmt::format("mesh{}", i), &mesh.meshes[i].mesh, -1, glm::mat4 {1.0f}});
+	}
+
+	std::vector<const std::pair<const std::string, px::proto_mesh>*> attachments {};
+	for (const auto& attachment : mesh.attachments) {
+		attachments.push_back(&attachment);
+	}
+
+	std::sort(attachments.begin(), attachments.end(), [](auto* a, auto* b) { return a->first < b->first; });
+
+	// Attachments are stored relative to the node they are attached to. Without a hierarchy they can't be placed
+	// so they are exported as-is.
+	std::vector<glm::mat4> transforms {};
+	if (hierarchy != nullptr) {
+		transforms.resize(hierarchy->nodes.size());
+		std::vector<bool> resolved(hierarchy->nodes.size(), false);
+
+		std::function<const glm::mat4&(std::size_t)> resolve = [&](std::size_t i) -> const glm::mat4& {
+			if (!resolved[i]) {
+				const auto& node = hierarchy->nodes[i];
+				resolved[i] = true;
+				transforms[i] = node.parent_index < 0
+				    ? node.transform
+				    : resolve(static_cast<std::size_t>(node.parent_index)) * node.transform;
+			}
+
+			return transforms[i];
+		};
+
+		for (std::size_t i = 0; i < transforms.size(); ++i) {
+			resolve(i);
+		}
+	}
+
+	for (const auto* attachment : attachments) {
+		model_part part {attachment->first, &attachment->second, -1, glm::mat4 {1.0f}};
+
+		if (hierarchy != nullptr) {
+			auto node = std::find_if(hierarchy->nodes.begin(), hierarchy->nodes.end(), [&](const auto& n) {
+				return n.name == attachment->first;
+			});
+
+			if (node != hierarchy->nodes.end()) {
+				part.node = static_cast<std::int32_t>(node - hierarchy->nodes.begin());
+				part.transform = transforms[static_cast<std::size_t>(part.node)];
+			}
+		}
+
+		parts.push_back(std::move(part));
+	}
+
+	return parts;
+}
+
+std::vector<px::material> collect_materials(const std::vector<model_part>& parts) {
+	std::vector<px::material> materials {};
+	std::unordered_set<std::string> seen {};
+
+	for (const auto& part : parts) {
+		for (const auto& material : part.mesh->materials) {
+			if (seen.insert(material.name).second) {
+				materials.push_back(material);
+			}
+		}
+	}
+
+	return materials;
+}
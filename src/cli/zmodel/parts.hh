@@ -0,0 +1,40 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/model_hierarchy.hh>
+#include <phoenix/model_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A single mesh of a model.
+struct model_part {
+	/// \brief The name of the part. For attachments, this is the name of the node they're attached to.
+	std::string name;
+
+	/// \brief The mesh of the part.
+	const px::proto_mesh* mesh;
+
+	/// \brief The index of the hierarchy node the mesh is attached to or -1 if it is not attached to a node.
+	std::int32_t node;
+
+	/// \brief The transformation from the mesh's space into model space.
+	glm::mat4 transform;
+};
+
+/// \brief Collects all soft-skin meshes and attachments of a model.
+///
+/// Attachments are sorted by name so that the output does not depend on hash map ordering.
+/// \param mesh The model mesh to collect the parts of.
+/// \param hierarchy The model hierarchy used to place attachments or `nullptr` if there is none.
+/// \return The soft-skin meshes followed by all attachments.
+std::vector<model_part> collect_model_parts(const px::model_mesh& mesh, const px::model_hierarchy* hierarchy);
+
+/// \brief Collects the materials of all given parts, keeping only the first material of any given name.
+std::vector<px::material> collect_materials(const std::vector<model_part>& parts);
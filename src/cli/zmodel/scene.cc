@@ -0,0 +1,213 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "scene.hh"
+#include "optimize.hh"
+#include "parts.hh"
+
+#include <phoenix/model.hh>
+#include <phoenix/morph_mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <fmt/format.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <nlohmann/json.hpp>
+
+#include <future>
+#include <unordered_map>
+
+/// \brief Adds the given VOB and all of its children to the scene.
+static void collect_vob(const px::vob& vob,
+                        vob_scene& scene,
+                        std::unordered_map<std::string, std::uint32_t>& visual_indices) {
+	if (vob.show_visual && !find_visual_files(vob.visual_name).empty()) {
+		auto [it, inserted] =
+		    visual_indices.try_emplace(vob.visual_name, static_cast<std::uint32_t>(scene.visuals.size()));
+		if (inserted)
+			scene.visuals.push_back(vob.visual_name);
+
+		// VOB positions and rotations are stored in world space, not relative to their parent
+		glm::mat4 transform {vob.rotation};
+		transform[3] = glm::vec4 {vob.position, 1.0f};
+
+		scene.instances.push_back({vob.vob_name, it->second, transform});
+	}
+
+	for (const auto& child : vob.children) {
+		collect_vob(*child, scene, visual_indices);
+	}
+}
+
+vob_scene collect_vob_instances(const std::vector<std::unique_ptr<px::vob>>& vobs) {
+	vob_scene scene {};
+	std::unordered_map<std::string, std::uint32_t> visual_indices {};
+
+	for (const auto& vob : vobs) {
+		collect_vob(*vob, scene, visual_indices);
+	}
+
+	return scene;
+}
+
+std::vector<std::string> find_visual_files(std::string_view visual) {
+	auto dot = visual.rfind('.');
+	if (dot == std::string_view::npos)
+		return {};
+
+	auto stem = std::string {visual.substr(0, dot)};
+	auto extension = visual.substr(dot + 1);
+
+	if (px::iequals(extension, "3DS"))
+		return {stem + ".MRM", stem + ".MSH"};
+	if (px::iequals(extension, "MMS"))
+		return {stem + ".MMB"};
+	if (px::iequals(extension, "MDS") || px::iequals(extension, "ASC"))
+		return {stem + ".MDL", stem + ".MDM"};
+	return {};
+}
+
+/// \brief Appends a mesh to another one, transforming its positions and normals.
+static void append_mesh(indexed_mesh& mesh, const indexed_mesh& part, const glm::mat4& transform) {
+	auto vertex_offset = static_cast<std::uint32_t>(mesh.positions.size());
+	auto index_offset = static_cast<std::uint32_t>(mesh.indices.size());
+	auto material_offset = static_cast<std::uint32_t>(mesh.materials.size());
+	auto normal_transform = glm::mat3 {transform};
+
+	for (const auto& position : part.positions) {
+		mesh.positions.emplace_back(transform * glm::vec4 {position, 1.0f});
+	}
+
+	for (const auto& normal : part.normals) {
+		mesh.normals.push_back(glm::normalize(normal_transform * normal));
+	}
+
+	mesh.uvs.insert(mesh.uvs.end(), part.uvs.begin(), part.uvs.end());
+
+	for (auto index : part.indices) {
+		mesh.indices.push_back(index + vertex_offset);
+	}
+
+	for (auto primitive : part.primitives) {
+		primitive.material += material_offset;
+		primitive.offset += index_offset;
+		mesh.primitives.push_back(primitive);
+	}
+
+	mesh.materials.insert(mesh.materials.end(), part.materials.begin(), part.materials.end());
+}
+
+/// \brief Converts all parts of a model into a single mesh.
+static indexed_mesh
+convert_model(const px::model_mesh& model, const px::model_hierarchy* hierarchy, const std::string& name) {
+	indexed_mesh mesh {};
+	mesh.name = name;
+
+	for (const auto& part : collect_model_parts(model, hierarchy)) {
+		append_mesh(mesh, to_indexed_mesh(*part.mesh, part.name), part.transform);
+	}
+
+	return mesh;
+}
+
+/// \brief Parses and converts a single compiled visual.
+static indexed_mesh convert_visual(const px::vdf_entry& entry, const std::string& name) {
+	auto in = entry.open();
+	auto extension = entry.name.substr(entry.name.rfind('.') + 1);
+
+	if (px::iequals(extension, "MRM"))
+		return to_indexed_mesh(px::proto_mesh::parse(in), name);
+	if (px::iequals(extension, "MMB"))
+		return to_indexed_mesh(px::morph_mesh::parse(in).mesh, name);
+
+	if (px::iequals(extension, "MDL")) {
+		auto mdl = px::model::parse(in);
+		return convert_model(mdl.mesh, &mdl.hierarchy, name);
+	}
+
+	if (px::iequals(extension, "MDM"))
+		return convert_model(px::model_mesh::parse(in), nullptr, name);
+
+	auto mesh = to_indexed_mesh(px::mesh::parse(in, {}));
+	mesh.name = name;
+	return mesh;
+}
+
+std::vector<indexed_mesh> convert_visuals(const std::vector<std::string>& visuals,
+                                          const std::vector<px::vdf_file>& vdfs,
+                                          bool optimize,
+                                          pstudio::thread_pool& pool) {
+	std::vector<std::future<indexed_mesh>> futures {};
+	futures.reserve(visuals.size());
+
+	for (const auto& visual : visuals) {
+		futures.push_back(pool.submit([&visual, &vdfs, optimize] {
+			const px::vdf_entry* entry = nullptr;
+
+			for (const auto& file : find_visual_files(visual)) {
+				for (const auto& vdf : vdfs) {
+					if ((entry = vdf.find_entry(file)) != nullptr)
+						break;
+				}
+
+				if (entry != nullptr)
+					break;
+			}
+
+			indexed_mesh mesh {};
+			mesh.name = visual;
+
+			if (entry == nullptr) {
+				fmt::print(stderr, "visual not found: {}\n", visual);
+				return mesh;
+			}
+
+			try {
+				mesh = convert_visual(*entry, visual);
+				if (optimize)
+					optimize_mesh(mesh);
+			} catch (const std::exception& e) {
+				fmt::print(stderr, "cannot convert visual {}: {}\n", visual, e.what());
+				mesh = indexed_mesh {};
+				mesh.name = visual;
+			}
+
+			return mesh;
+		}));
+	}
+
+	std::vector<indexed_mesh> meshes {};
+	meshes.reserve(futures.size());
+
+	for (auto& future : futures) {
+		meshes.push_back(future.get());
+	}
+
+	return meshes;
+}
+
+void dump_vob_manifest(std::ostream& out, const vob_scene& scene, const std::vector<std::string>& files) {
+	auto visuals = nlohmann::json::array();
+	for (std::size_t i = 0; i < scene.visuals.size(); ++i) {
+		visuals.push_back({{"name", scene.visuals[i]}, {"file", files[i]}});
+	}
+
+	// swapping the X and Z axes on both sides converts the transform into the exported coordinate system
+	glm::mat4 swap {glm::vec4 {0, 0, 1, 0}, glm::vec4 {0, 1, 0, 0}, glm::vec4 {1, 0, 0, 0}, glm::vec4 {0, 0, 0, 1}};
+
+	auto instances = nlohmann::json::array();
+	for (const auto& instance : scene.instances) {
+		if (files[instance.visual].empty())
+			continue;
+
+		auto transform = swap * instance.transform * swap;
+		const auto* matrix = glm::value_ptr(transform);
+
+		instances.push_back({
+		    {"name", instance.name},
+		    {"visual", instance.visual},
+		    {"matrix", std::vector<float>(matrix, matrix + 16)},
+		});
+	}
+
+	out << nlohmann::json {{"visuals", std::move(visuals)}, {"instances", std::move(instances)}}.dump(2) << "\n";
+}
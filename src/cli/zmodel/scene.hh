@@ -0,0 +1,78 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/vdfs.hh>
+#include <phoenix/world.hh>
+
+#include <glm/mat4x4.hpp>
+#include <pstudio/parallel.hh>
+
+#include "indexed_mesh.hh"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief A placement of a VOB's visual in the world.
+struct vob_instance {
+	/// \brief The name of the VOB. Might be empty.
+	std::string name;
+
+	/// \brief The index of the visual in vob_scene::visuals.
+	std::uint32_t visual;
+
+	/// \brief The transformation from the visual's space into world space.
+	glm::mat4 transform;
+};
+
+/// \brief All mesh visuals of a world's VOBs and their placements.
+struct vob_scene {
+	/// \brief The name of every distinct visual, in the order they are first used in.
+	std::vector<std::string> visuals;
+
+	/// \brief One placement per visible VOB with a mesh visual.
+	std::vector<vob_instance> instances;
+};
+
+/// \brief Walks the given VOB tree and collects every VOB with a visible mesh, morph mesh or model visual.
+///
+/// Every visual name is only listed once, no matter how many VOBs use it. Particle effects, decals and other
+/// visuals are ignored.
+/// \param vobs The root VOBs of a world.
+/// \return The visuals and their placements.
+vob_scene collect_vob_instances(const std::vector<std::unique_ptr<px::vob>>& vobs);
+
+/// \brief Returns the names of the compiled files a VOB visual is stored in, in the order they should be tried.
+///
+/// For example, `TREE.3DS` is stored as `TREE.MRM` or `TREE.MSH` and `HUMAN.MDS` as `HUMAN.MDL` or `HUMAN.MDM`.
+/// \return The candidate file names or an empty list if the visual is not a mesh, morph mesh or model.
+std::vector<std::string> find_visual_files(std::string_view visual);
+
+/// \brief Looks up and converts every visual concurrently.
+///
+/// Models are converted by placing all of their parts in a single mesh. Visuals which cannot be found in any of
+/// the VDFs or fail to convert are reported to stderr and returned as meshes without any vertices.
+/// \param visuals The names of the visuals to convert.
+/// \param vdfs The VDFs to look the compiled visuals up in, in order of precedence.
+/// \param optimize Whether to optimize the converted meshes.
+/// \param pool The threads to convert the visuals on.
+/// \return One mesh per visual.
+std::vector<indexed_mesh> convert_visuals(const std::vector<std::string>& visuals,
+                                          const std::vector<px::vdf_file>& vdfs,
+                                          bool optimize,
+                                          pstudio::thread_pool& pool);
+
+/// \brief Writes a JSON table placing the files every visual was written to.
+///
+/// Transformations are converted into the coordinate system of the exported files by swapping their X and Z axes
+/// and stored as column-major 4x4 matrices. Instances of visuals without a file are omitted.
+/// \param out The stream to write the table to.
+/// \param scene The scene to write.
+/// \param files The path of the file each visual was written to, relative to the table, or an empty string if
+///              the visual was not written.
+void dump_vob_manifest(std::ostream& out, const vob_scene& scene, const std::vector<std::string>& files);
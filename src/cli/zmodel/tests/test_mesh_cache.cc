@@ -0,0 +1,260 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include <phoenix/buffer.hh>
+#include <phoenix/mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <fmt/format.h>
+
+#include "indexed_mesh.hh"
+#include "mesh_cache.hh"
+#include "optimize.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#ifdef _WIN32
+	#include <process.h>
+#else
+	#include <unistd.h>
+#endif
+
+// Round-trip test of the mesh cache: every fixture given on the command line is parsed with phoenix, converted,
+// encoded and written to disk. The file is then memory-mapped and read through pstudio/mesh_cache.hh and every
+// triangle it contains is compared with the triangles of the mesh phoenix parsed.
+
+namespace px = phoenix;
+namespace cache = pstudio::mesh_cache;
+
+static long process_id() {
+#ifdef _WIN32
+	return _getpid();
+#else
+	return getpid();
+#endif
+}
+
+/// \brief Appends the bits of a float to a triangle key.
+static void append(std::string& key, float v) {
+	char bytes[sizeof v];
+	std::memcpy(bytes, &v, sizeof v);
+	key.append(bytes, sizeof v);
+}
+
+/// \brief Starts the key of a triangle using the given material.
+///
+/// A triangle's key holds the names of its material and texture followed by the position, normal and texture
+/// coordinates of its corners, bit by bit. Comparing the sorted keys of two meshes checks that they draw the same
+/// triangles with the same materials regardless of their order and of how the vertices are shared.
+static std::string make_key(std::string_view material, std::string_view texture) {
+	std::string key {material};
+	key.push_back('\0');
+	key.append(texture);
+	key.push_back('\0');
+	return key;
+}
+
+static std::vector<std::string> triangles_of(const px::mesh& mesh) {
+	const auto& polys = mesh.polygons;
+	std::vector<std::string> result {};
+
+	for (std::size_t i = 0; i < polys.material_indices.size(); ++i) {
+		const auto& material = mesh.materials[polys.material_indices[i]];
+		auto key = make_key(material.name, material.texture);
+
+		for (auto v = i * 3; v < i * 3 + 3; ++v) {
+			const auto& position = mesh.vertices[polys.vertex_indices[v]];
+			const auto& feature = mesh.features[polys.feature_indices[v]];
+
+			append(key, position.x);
+			append(key, position.y);
+			append(key, position.z);
+			append(key, feature.normal.x);
+			append(key, feature.normal.y);
+			append(key, feature.normal.z);
+			append(key, feature.texture.x);
+			append(key, feature.texture.y);
+		}
+
+		result.push_back(std::move(key));
+	}
+
+	return result;
+}
+
+static std::vector<std::string> triangles_of(const px::proto_mesh& mesh) {
+	std::vector<std::string> result {};
+
+	for (const auto& sub : mesh.sub_meshes) {
+		for (const auto& triangle : sub.triangles) {
+			auto key = make_key(sub.mat.name, sub.mat.texture);
+
+			for (auto index : triangle.wedges) {
+				const auto& wedge = sub.wedges[index];
+				const auto& position = mesh.positions[wedge.index];
+
+				append(key, position.x);
+				append(key, position.y);
+				append(key, position.z);
+				append(key, wedge.normal.x);
+				append(key, wedge.normal.y);
+				append(key, wedge.normal.z);
+				append(key, wedge.texture.x);
+				append(key, wedge.texture.y);
+			}
+
+			result.push_back(std::move(key));
+		}
+	}
+
+	return result;
+}
+
+/// \brief Checks the structure of a mesh cache and collects its triangles.
+/// \return An empty string if the cache is consistent or a description of the first problem.
+static std::string triangles_of(const cache::mesh_view& view, std::vector<std::string>& result) {
+	auto positions = view.positions();
+	auto normals = view.normals();
+	auto uvs = view.uvs();
+	auto indices = view.indices();
+	auto materials = view.materials();
+
+	if (normals.size() != positions.size() || uvs.size() != positions.size())
+		return "the vertex arrays differ in size";
+	if (indices.size() % 3 != 0)
+		return "the index count is not a multiple of three";
+
+	std::size_t next = 0;
+	for (const auto& primitive : view.primitives()) {
+		if (primitive.offset != next || primitive.count % 3 != 0)
+			return fmt::format("primitive at index {} does not follow the previous one", primitive.offset);
+		if (primitive.material >= materials.size())
+			return fmt::format("primitive at index {} has no material", primitive.offset);
+
+		next += primitive.count;
+		if (next > indices.size())
+			return fmt::format("primitive at index {} exceeds the indices", primitive.offset);
+
+		const auto& material = materials[primitive.material];
+		for (auto i = primitive.offset; i < primitive.offset + primitive.count; i += 3) {
+			auto key = make_key(view.string(material.name), view.string(material.texture));
+
+			for (auto c = i; c < i + 3; ++c) {
+				auto vertex = indices[c];
+				if (vertex >= positions.size())
+					return fmt::format("index {} is out of range", c);
+
+				append(key, positions[vertex].x);
+				append(key, positions[vertex].y);
+				append(key, positions[vertex].z);
+				append(key, normals[vertex].x);
+				append(key, normals[vertex].y);
+				append(key, normals[vertex].z);
+				append(key, uvs[vertex].x);
+				append(key, uvs[vertex].y);
+			}
+
+			result.push_back(std::move(key));
+		}
+	}
+
+	if (next != indices.size())
+		return "not every triangle is part of a primitive";
+	return "";
+}
+
+/// \brief Encodes a mesh, maps the written file and compares it with the phoenix mesh.
+/// \return Whether the test passed.
+template <typename T>
+static bool check_round_trip(const std::string& name, const T& source, indexed_mesh mesh, bool optimize) {
+	auto label = fmt::format("{}{}", name, optimize ? " (optimized)" : "");
+	if (optimize)
+		optimize_mesh(mesh);
+
+	auto data = encode_mesh_cache(mesh);
+
+	// tests running concurrently must not share the file
+	auto path = std::filesystem::temp_directory_path() /
+	    fmt::format("zmodel-test-mesh-cache-{}-{}{}.zmc", process_id(), name, optimize ? "-optimized" : "");
+	{
+		std::ofstream out {path, std::ios::binary};
+		out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+	}
+
+	std::string error {};
+	std::vector<std::string> actual {};
+	try {
+		auto mapped = px::buffer::mmap(path);
+		cache::mesh_view view {mapped.array(), static_cast<std::size_t>(mapped.limit())};
+
+		if (view.name() != mesh.name)
+			error = "the name differs";
+		if (error.empty())
+			error = triangles_of(view, actual);
+	} catch (const std::exception& e) {
+		error = e.what();
+	}
+
+	std::error_code ignored {};
+	std::filesystem::remove(path, ignored);
+
+	auto expected = triangles_of(source);
+	if (error.empty() && actual.size() != expected.size())
+		error = fmt::format("{} triangles instead of {}", actual.size(), expected.size());
+
+	if (error.empty()) {
+		std::sort(actual.begin(), actual.end());
+		std::sort(expected.begin(), expected.end());
+
+		auto mismatch = std::mismatch(actual.begin(), actual.end(), expected.begin());
+		if (mismatch.first != actual.end())
+			error = fmt::format("triangle {} differs from the source mesh", mismatch.first - actual.begin());
+	}
+
+	if (!error.empty()) {
+		fmt::print(stderr, "FAIL {}: {}\n", label, error);
+		return false;
+	}
+
+	fmt::print("ok   {}: {} triangles\n", label, actual.size());
+	return true;
+}
+
+int main(int argc, const char** argv) {
+	if (argc < 2) {
+		fmt::print(stderr, "usage: {} <MSH or MRM file>...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	bool passed = true;
+	for (int i = 1; i < argc; ++i) {
+		std::filesystem::path path {argv[i]};
+		auto name = path.filename().string();
+
+		try {
+			auto in = px::buffer::mmap(path);
+
+			if (px::iequals(path.extension().string(), ".MRM")) {
+				auto mesh = px::proto_mesh::parse(in);
+				passed &= check_round_trip(name, mesh, to_indexed_mesh(mesh, name), false);
+				passed &= check_round_trip(name, mesh, to_indexed_mesh(mesh, name), true);
+			} else {
+				auto mesh = px::mesh::parse(in, {});
+				passed &= check_round_trip(name, mesh, to_indexed_mesh(mesh), false);
+				passed &= check_round_trip(name, mesh, to_indexed_mesh(mesh), true);
+			}
+		} catch (const std::exception& e) {
+			fmt::print(stderr, "FAIL {}: {}\n", name, e.what());
+			passed = false;
+		}
+	}
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,429 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#include "wavefront.hh"
+#include "indexed_mesh.hh"
+
+#include <fmt/format.h>
+#include <glm/mat3x3.hpp>
+
+#include <cerrno>
+#include <chrono>
+#include <deque>
+#include <system_error>
+
+#ifndef _WIN32
+	#include <climits>
+	#include <sys/uio.h>
+	#include <unistd.h>
+#endif
+
+/// \brief The number of vertices, normals, texture coordinates or faces formatted by one task.
+static constexpr std::size_t OBJ_CHUNK_SIZE = 16384;
+
+static void write_chunks(std::FILE* out, const std::vector<fmt::memory_buffer>& chunks) {
+#ifdef _WIN32
+	for (const auto& chunk : chunks) {
+		if (std::fwrite(chunk.data(), 1, chunk.size(), out) != chunk.size())
+			throw std::system_error(errno, std::generic_category(), "failed to write model");
+	}
+#else
+	std::vector<iovec> vectors {};
+	vectors.reserve(chunks.size());
+	for (const auto& chunk : chunks) {
+		vectors.push_back({const_cast<char*>(chunk.data()), chunk.size()});
+	}
+
+	auto fd = fileno(out);
+	auto* it = vectors.data();
+	auto* end = vectors.data() + vectors.size();
+
+	while (it != end) {
+		auto count = static_cast<int>(std::min<std::ptrdiff_t>(end - it, IOV_MAX));
+		auto written = ::writev(fd, it, count);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			throw std::system_error(errno, std::generic_category(), "failed to write model");
+		}
+
+		// skip all buffers which have been written completely and adjust the first partially written one
+		auto remaining = static_cast<std::size_t>(written);
+		while (it != end && remaining >= it->iov_len) {
+			remaining -= it->iov_len;
+			++it;
+		}
+
+		if (it != end) {
+			it->iov_base = static_cast<char*>(it->iov_base) + remaining;
+			it->iov_len -= remaining;
+		}
+	}
+#endif
+}
+
+void dump_material(std::ostream& mtl, const std::vector<px::material>& materials) {
+	for (const auto& mat : materials) {
+		if (!mat.texture.empty()) {
+			mtl << "newmtl " << mat.name << "\n";
+			mtl << "Kd 1.00 1.00 1.00\n";
+			mtl << "map_Kd " << mat.texture << "\n";
+		}
+	}
+}
+
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::proto_mesh& mesh) {
+	out << "# zmodel exported mesh\n";
+	if (material_out != nullptr)
+		out << "mtllib " << mtllib_name << ".mtl\n\n";
+
+	out << "# vertices\n";
+
+	for (const auto& item : mesh.positions) {
+		out << "v " << item.z << " " << item.y << " " << item.x << "\n";
+	}
+
+	unsigned wedge_offset = 0;
+	int i = 0;
+	for (const auto& msh : mesh.sub_meshes) {
+		out << "g sub" << ++i << "\n"
+		    << "usemtl " << msh.mat.name << "\n";
+
+		for (const auto& item : msh.wedges) {
+			out << "vn " << item.normal.z << " " << item.normal.y << " " << item.normal.x << "\n";
+			out << "vt " << item.texture.x << " " << item.texture.y << "\n";
+		}
+
+		for (const auto& item : msh.triangles) {
+			auto wedge0 = msh.wedges[item.wedges[0]];
+			auto wedge1 = msh.wedges[item.wedges[1]];
+			auto wedge2 = msh.wedges[item.wedges[2]];
+
+			out << "f " << wedge0.index + 1 << "/" << wedge_offset + item.wedges[0] + 1 << "/"
+			    << wedge_offset + item.wedges[0] + 1 << " " << wedge1.index + 1 << "/"
+			    << wedge_offset + item.wedges[1] + 1 << "/" << wedge_offset + item.wedges[1] + 1 << " "
+			    << wedge2.index + 1 << "/" << wedge_offset + item.wedges[2] + 1 << "/"
+			    << wedge_offset + item.wedges[2] + 1 << "\n";
+		}
+
+		wedge_offset += msh.wedges.size();
+	}
+
+	if (material_out != nullptr) {
+		dump_material(*material_out, mesh.materials);
+	}
+}
+
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::mesh& mesh,
+                    bool group_materials) {
+	out << "# zmodel exported mesh\n";
+	if (material_out != nullptr)
+		out << "mtllib " << mtllib_name << ".mtl\n\n";
+
+	out << "# vertices\n";
+
+	for (const auto& item : mesh.vertices) {
+		out << "v " << item.z << " " << item.y << " " << item.x << "\n";
+	}
+
+	auto& mats = mesh.materials;
+	auto& feats = mesh.features;
+
+	out << "\n# normals\n";
+	for (const auto& feat : feats) {
+		out << "vn " << feat.normal.z << " " << feat.normal.y << " " << feat.normal.x << "\n";
+	}
+
+	out << "\n# textures\n";
+	for (const auto& feat : feats) {
+		out << "vt " << feat.texture.x << " " << feat.texture.y << "\n";
+	}
+
+	long old_material = -1;
+	auto& polys = mesh.polygons;
+
+	std::vector<std::uint32_t> order {};
+	if (group_materials)
+		order = sort_polygons_by_material(polys.material_indices, mats.size());
+
+	for (std::size_t p = 0; p < polys.vertex_indices.size() / 3; ++p) {
+		auto i = group_materials ? order[p] : p;
+		auto material = polys.material_indices[i];
+
+		if (old_material != material) {
+			auto& mat = mats[material];
+			out << "usemtl " << mat.name << "\n";
+			out << "g " << mat.name << "\n";
+			old_material = material;
+		}
+
+		out << "f ";
+		for (unsigned v = 0; v < 3; ++v) {
+			auto feature = polys.feature_indices[i * 3 + v] + 1;
+			out << polys.vertex_indices[i * 3 + v] + 1 << "/" << feature << "/" << feature;
+
+			if (v != 2) {
+				out << " ";
+			}
+		}
+
+		out << "\n";
+	}
+
+	if (material_out != nullptr) {
+		dump_material(*material_out, mesh.materials);
+	}
+}
+
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const indexed_mesh& mesh) {
+	out << "# zmodel exported mesh\n";
+	if (!mtllib_name.empty())
+		out << "mtllib " << mtllib_name << ".mtl\n\n";
+
+	out << "# vertices\n";
+	for (const auto& item : mesh.positions) {
+		out << "v " << item.z << " " << item.y << " " << item.x << "\n";
+	}
+
+	out << "\n# normals\n";
+	for (const auto& item : mesh.normals) {
+		out << "vn " << item.z << " " << item.y << " " << item.x << "\n";
+	}
+
+	out << "\n# textures\n";
+	for (const auto& item : mesh.uvs) {
+		out << "vt " << item.x << " " << item.y << "\n";
+	}
+
+	for (const auto& primitive : mesh.primitives) {
+		auto& mat = mesh.materials[primitive.material];
+		out << "usemtl " << mat.name << "\n";
+		out << "g " << mat.name << "\n";
+
+		for (auto i = primitive.offset; i < primitive.offset + primitive.count; i += 3) {
+			auto a = mesh.indices[i] + 1;
+			auto b = mesh.indices[i + 1] + 1;
+			auto c = mesh.indices[i + 2] + 1;
+			out << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " " << c << "/" << c << "/"
+			    << c << "\n";
+		}
+	}
+
+	if (material_out != nullptr) {
+		dump_material(*material_out, mesh.materials);
+	}
+}
+
+void dump_wavefront(std::FILE* out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::mesh& mesh,
+                    pstudio::thread_pool& pool,
+                    bool group_materials) {
+	using job = std::function<void(fmt::memory_buffer&)>;
+	std::vector<job> jobs {};
+
+	auto add_section = [&jobs](std::size_t count, auto&& fn) {
+		for (std::size_t begin = 0; begin < count; begin += OBJ_CHUNK_SIZE) {
+			jobs.emplace_back([fn, begin, end = std::min(begin + OBJ_CHUNK_SIZE, count)](fmt::memory_buffer& buf) {
+				fn(buf, begin, end);
+			});
+		}
+	};
+
+	auto add_text = [&jobs](std::string text) {
+		jobs.emplace_back([text = std::move(text)](fmt::memory_buffer& buf) { buf.append(text); });
+	};
+
+	auto header = std::string {"# zmodel exported mesh\n"};
+	if (material_out != nullptr)
+		header += fmt::format("mtllib {}.mtl\n\n", mtllib_name);
+	add_text(header + "# vertices\n");
+
+	// Floats are formatted using `{:g}` since it yields the same output as the default formatting of std::ostream.
+	add_section(mesh.vertices.size(), [&mesh](fmt::memory_buffer& buf, std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			const auto& item = mesh.vertices[i];
+			fmt::format_to(std::back_inserter(buf), "v {:g} {:g} {:g}\n", item.z, item.y, item.x);
+		}
+	});
+
+	add_text("\n# normals\n");
+	add_section(mesh.features.size(), [&mesh](fmt::memory_buffer& buf, std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			const auto& feat = mesh.features[i];
+			fmt::format_to(std::back_inserter(buf), "vn {:g} {:g} {:g}\n", feat.normal.z, feat.normal.y, feat.normal.x);
+		}
+	});
+
+	add_text("\n# textures\n");
+	add_section(mesh.features.size(), [&mesh](fmt::memory_buffer& buf, std::size_t begin, std::size_t end) {
+		for (auto i = begin; i < end; ++i) {
+			const auto& feat = mesh.features[i];
+			fmt::format_to(std::back_inserter(buf), "vt {:g} {:g}\n", feat.texture.x, feat.texture.y);
+		}
+	});
+
+	std::vector<std::uint32_t> order {};
+	if (group_materials)
+		order = sort_polygons_by_material(mesh.polygons.material_indices, mesh.materials.size());
+
+	auto polygon_count = mesh.polygons.vertex_indices.size() / 3;
+	add_section(polygon_count, [&mesh, &order](fmt::memory_buffer& buf, std::size_t begin, std::size_t end) {
+		const auto& polys = mesh.polygons;
+		auto polygon_at = [&order](std::size_t p) -> std::size_t { return order.empty() ? p : order[p]; };
+
+		for (auto p = begin; p < end; ++p) {
+			auto i = polygon_at(p);
+			auto material = polys.material_indices[i];
+
+			// the material switch only depends on the previous polygon, so ranges can be formatted independently
+			if (p == 0 || polys.material_indices[polygon_at(p - 1)] != material) {
+				const auto& mat = mesh.materials[material];
+				fmt::format_to(std::back_inserter(buf), "usemtl {}\ng {}\n", mat.name, mat.name);
+			}
+
+			const auto* vertices = &polys.vertex_indices[i * 3];
+			const auto* features = &polys.feature_indices[i * 3];
+			fmt::format_to(std::back_inserter(buf),
+			               "f {}/{}/{} {}/{}/{} {}/{}/{}\n",
+			               vertices[0] + 1,
+			               features[0] + 1,
+			               features[0] + 1,
+			               vertices[1] + 1,
+			               features[1] + 1,
+			               features[1] + 1,
+			               vertices[2] + 1,
+			               features[2] + 1,
+			               features[2] + 1);
+		}
+	});
+
+	// Only a limited number of chunks is kept in flight to bound memory usage. Whenever the oldest one is done,
+	// it is written out together with all consecutive chunks which are done as well.
+	std::deque<std::future<fmt::memory_buffer>> in_flight {};
+	std::size_t next = 0;
+	std::size_t window = pool.size() * 4;
+
+	// tasks reference `jobs`, so none of them may outlive this function, even if writing fails
+	struct drain {
+		std::deque<std::future<fmt::memory_buffer>>& futures;
+		~drain() {
+			for (auto& future : futures) {
+				future.wait();
+			}
+		}
+	} guard {in_flight};
+
+	while (next < jobs.size() || !in_flight.empty()) {
+		while (next < jobs.size() && in_flight.size() < window) {
+			in_flight.push_back(pool.submit([&fn = jobs[next]] {
+				fmt::memory_buffer buf {};
+				fn(buf);
+				return buf;
+			}));
+			++next;
+		}
+
+		std::vector<fmt::memory_buffer> ready {};
+		ready.push_back(in_flight.front().get());
+		in_flight.pop_front();
+
+		while (!in_flight.empty() &&
+		       in_flight.front().wait_for(std::chrono::seconds {0}) == std::future_status::ready) {
+			ready.push_back(in_flight.front().get());
+			in_flight.pop_front();
+		}
+
+		write_chunks(out, ready);
+	}
+
+	if (material_out != nullptr) {
+		dump_material(*material_out, mesh.materials);
+	}
+}
+
+void dump_wavefront(std::FILE* out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const std::vector<model_part>& parts,
+                    pstudio::thread_pool& pool) {
+	std::vector<fmt::memory_buffer> chunks(parts.size() + 1);
+
+	fmt::format_to(std::back_inserter(chunks[0]), "# zmodel exported mesh\n");
+	if (!mtllib_name.empty())
+		fmt::format_to(std::back_inserter(chunks[0]), "mtllib {}.mtl\n\n", mtllib_name);
+
+	// OBJ indices are global so every part needs to know how many positions and wedges precede it
+	std::vector<std::size_t> vertex_offsets(parts.size(), 0);
+	std::vector<std::size_t> wedge_offsets(parts.size(), 0);
+	for (std::size_t i = 1; i < parts.size(); ++i) {
+		vertex_offsets[i] = vertex_offsets[i - 1] + parts[i - 1].mesh->positions.size();
+		wedge_offsets[i] = wedge_offsets[i - 1];
+
+		for (const auto& sub : parts[i - 1].mesh->sub_meshes) {
+			wedge_offsets[i] += sub.wedges.size();
+		}
+	}
+
+	pstudio::parallel_for(pool, parts.size(), 1, [&](std::size_t begin, std::size_t end) {
+		for (auto p = begin; p < end; ++p) {
+			const auto& part = parts[p];
+			auto& buf = chunks[p + 1];
+			auto it = std::back_inserter(buf);
+
+			glm::mat3 rotation {part.transform};
+			fmt::format_to(it, "o {}\n", part.name);
+
+			for (const auto& position : part.mesh->positions) {
+				auto item = glm::vec3 {part.transform * glm::vec4 {position, 1.0f}};
+				fmt::format_to(it, "v {:g} {:g} {:g}\n", item.z, item.y, item.x);
+			}
+
+			auto wedge_offset = wedge_offsets[p] + 1;
+			auto vertex_offset = vertex_offsets[p] + 1;
+			int i = 0;
+
+			for (const auto& msh : part.mesh->sub_meshes) {
+				fmt::format_to(it, "g sub{}\nusemtl {}\n", ++i, msh.mat.name);
+
+				for (const auto& item : msh.wedges) {
+					auto normal = rotation * item.normal;
+					fmt::format_to(it, "vn {:g} {:g} {:g}\n", normal.z, normal.y, normal.x);
+					fmt::format_to(it, "vt {:g} {:g}\n", item.texture.x, item.texture.y);
+				}
+
+				for (const auto& item : msh.triangles) {
+					fmt::format_to(it, "f");
+
+					for (auto wedge : item.wedges) {
+						fmt::format_to(it,
+						               " {}/{}/{}",
+						               msh.wedges[wedge].index + vertex_offset,
+						               wedge + wedge_offset,
+						               wedge + wedge_offset);
+					}
+
+					fmt::format_to(it, "\n");
+				}
+
+				wedge_offset += msh.wedges.size();
+			}
+		}
+	});
+
+	write_chunks(out, chunks);
+
+	if (material_out != nullptr) {
+		dump_material(*material_out, collect_materials(parts));
+	}
+}
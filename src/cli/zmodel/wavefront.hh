@@ -0,0 +1,87 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <phoenix/mesh.hh>
+#include <phoenix/proto_mesh.hh>
+
+#include <pstudio/parallel.hh>
+
+#include "indexed_mesh.hh"
+#include "parts.hh"
+
+#include <cstdio>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+namespace px = phoenix;
+
+/// \brief Writes a Wavefront material library containing all textured materials.
+/// \param mtl The stream to write the material library to.
+/// \param materials The materials to write.
+void dump_material(std::ostream& mtl, const std::vector<px::material>& materials);
+
+/// \brief Writes the given MRM mesh as a Wavefront OBJ file.
+/// \param out The stream to write the model to.
+/// \param material_out The stream to write the material library to or `nullptr` to omit it.
+/// \param mtllib_name The name of the material library to reference in the model.
+/// \param mesh The mesh to write.
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::proto_mesh& mesh);
+
+/// \brief Writes the given MSH or world mesh as a Wavefront OBJ file.
+/// \param out The stream to write the model to.
+/// \param material_out The stream to write the material library to or `nullptr` to omit it.
+/// \param mtllib_name The name of the material library to reference in the model.
+/// \param mesh The mesh to write.
+/// \param group_materials Whether to write the faces sorted by material so that every material forms a single
+///                        group. Otherwise, a new group is started whenever the material changes.
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::mesh& mesh,
+                    bool group_materials = false);
+
+/// \brief Writes the given indexed mesh as a Wavefront OBJ file with one group per primitive.
+/// \param out The stream to write the model to.
+/// \param material_out The stream to write the material library to or `nullptr` to omit it.
+/// \param mtllib_name The name of the material library to reference in the model or an empty string to omit it.
+/// \param mesh The mesh to write.
+void dump_wavefront(std::ostream& out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const indexed_mesh& mesh);
+
+/// \brief Writes the given MSH or world mesh as a Wavefront OBJ file, formatting it on multiple threads.
+///
+/// The vertex, normal, texture and face sections are split into fixed-size ranges which are formatted
+/// concurrently and written to \p out in order. The output is identical to the one of the serial dump_wavefront().
+/// \param out The file to write the model to.
+/// \param material_out The stream to write the material library to or `nullptr` to omit it.
+/// \param mtllib_name The name of the material library to reference in the model.
+/// \param mesh The mesh to write.
+/// \param pool The threads to format the model on.
+/// \param group_materials Whether to write the faces sorted by material so that every material forms a single group.
+void dump_wavefront(std::FILE* out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const px::mesh& mesh,
+                    pstudio::thread_pool& pool,
+                    bool group_materials = false);
+
+/// \brief Writes all parts of a model into a single Wavefront OBJ file with one object per part.
+///
+/// The parts are transformed into model space and formatted concurrently. The material library contains
+/// every material only once, even if it is used by multiple parts.
+/// \param out The file to write the model to.
+/// \param material_out The stream to write the material library to or `nullptr` to omit it.
+/// \param mtllib_name The name of the material library to reference in the model or an empty string to omit it.
+/// \param parts The parts to write.
+/// \param pool The threads to format the model on.
+void dump_wavefront(std::FILE* out,
+                    std::ostream* material_out,
+                    std::string_view mtllib_name,
+                    const std::vector<model_part>& parts,
+                    pstudio::thread_pool& pool);
@@ -3,6 +3,8 @@
 #include <phoenix/texture.hh>
 #include <phoenix/vdfs.hh>
 
+#include <pstudio/daemon.hh>
+
 #include <CLI/App.hpp>
 #include <fmt/format.h>
 
@@ -90,6 +92,32 @@ px::buffer open_buffer(const std::optional<std::string>& input, const std::optio
 	}
 }
 
+/// \brief Asks a running pstudio-daemon to decode a mipmap of a texture in a VDF it has open.
+/// \return The exit code or `std::nullopt` if the texture has to be converted locally.
+static std::optional<int> convert_remote(const std::string& file,
+                                         const std::string& vdf,
+                                         const std::optional<std::string>& output,
+                                         std::uint32_t level) {
+	namespace proto = pstudio::daemon;
+
+	auto res = proto::forward({proto::request_type::texture, level, proto::archive_path(vdf), file});
+	if (!res || res->status == proto::status::not_found || res->status == proto::status::unsupported)
+		return std::nullopt;
+
+	if (res->status != proto::status::ok) {
+		fmt::print(stderr, "cannot convert texture: {}\n", res->payload);
+		return EXIT_FAILURE;
+	}
+
+	std::string_view payload {res->payload};
+	auto width = proto::get_u32(payload);
+	auto height = proto::get_u32(payload);
+
+	const auto* pixels = reinterpret_cast<const std::uint8_t*>(payload.data());
+	write_tga(output, {pixels, pixels + payload.size()}, width, height);
+	return EXIT_SUCCESS;
+}
+
 int main(int argc, char** argv) {
 	px::logging::use_default_logger();
 
@@ -115,11 +143,19 @@ int main(int argc, char** argv) {
 	             all_mipmaps,
 	             "Dump all mipmaps of the texture to the current working directory or -o");
 
+	bool no_daemon {false};
+	app.add_flag("--no-daemon", no_daemon, "Do not forward requests to a running pstudio-daemon");
+
 	CLI11_PARSE(app, argc, argv);
 
 	if (display_version) {
 		fmt::print("ztex v{}\n", ZTEX_VERSION);
 	} else {
+		if (vdf && !all_mipmaps && !no_daemon) {
+			if (auto result = convert_remote(file, *vdf, output, level.value_or(0)))
+				return *result;
+		}
+
 		try {
 			auto in = open_buffer(file, vdf);
 			if (in == px::buffer::empty())
@@ -2,6 +2,8 @@
 // SPDX-License-Identifier: MIT
 #include <phoenix/vdfs.hh>
 
+#include <pstudio/daemon.hh>
+
 #include <CLI/App.hpp>
 #include <fmt/format.h>
 
@@ -46,6 +48,38 @@ static void do_list(const fs::path& self, const std::set<phoenix::vdf_entry, pho
 	}
 }
 
+/// \brief Asks a running pstudio-daemon to list or extract the files of a VDF it has open.
+/// \return The exit code or `std::nullopt` if the request has to be handled locally.
+static std::optional<int> run_remote(const std::string& file,
+                                     bool list,
+                                     const std::optional<std::string>& extract,
+                                     const std::optional<std::string>& output) {
+	namespace proto = pstudio::daemon;
+
+	if (!list && !extract)
+		return std::nullopt;
+
+	// directories are not handled by the daemon, they are reported as not found
+	auto type = list ? proto::request_type::list : proto::request_type::extract;
+	auto res = proto::forward({type, 0, proto::archive_path(file), list ? std::string {} : *extract});
+	if (!res || res->status == proto::status::not_found || res->status == proto::status::unsupported)
+		return std::nullopt;
+
+	if (res->status != proto::status::ok) {
+		fmt::print(stderr, "failed to read from vdf: {}\n", res->payload);
+		return EXIT_FAILURE;
+	}
+
+	if (!list && output) {
+		std::ofstream out {*output, std::ios::binary};
+		out.write(res->payload.data(), static_cast<std::streamsize>(res->payload.size()));
+	} else {
+		std::cout.write(res->payload.data(), static_cast<std::streamsize>(res->payload.size()));
+	}
+
+	return EXIT_SUCCESS;
+}
+
 int main(int argc, char** argv) {
 	px::logging::use_default_logger();
 
@@ -66,12 +100,20 @@ int main(int argc, char** argv) {
 	std::optional<std::string> output {};
 	app.add_option("-o,--output", output, "Output extracted files to the given path");
 
+	bool no_daemon {false};
+	app.add_flag("--no-daemon", no_daemon, "Do not forward requests to a running pstudio-daemon.");
+
 	CLI11_PARSE(app, argc, argv);
 
 	try {
 		if (display_version) {
 			fmt::print("zvdfs v{}\n", ZVDFS_VERSION);
 		} else {
+			if (file && !no_daemon) {
+				if (auto result = run_remote(*file, action_list, extract, output))
+					return *result;
+			}
+
 			auto in = px::buffer::empty();
 			if (file) {
 				in = px::buffer::mmap(*file);
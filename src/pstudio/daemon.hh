@@ -0,0 +1,329 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/// \brief The protocol spoken between `pstudio-daemon` and the tools forwarding requests to it.
+///
+/// Clients connect to a Unix domain socket and send any number of requests, each answered by exactly one response
+/// before the next request is read. Every message is a frame consisting of its size in bytes as a little-endian
+/// 32-bit integer followed by the message itself:
+///
+/// | Message  | Layout                                                                                |
+/// |----------|---------------------------------------------------------------------------------------|
+/// | request  | `u8 type`, `u32 argument`, `u32 size`, archive path, `u32 size`, file path             |
+/// | response | `u8 status`, payload                                                                  |
+///
+/// Archive paths are absolute and refer to one of the VDFs mounted by the daemon. The argument and the payload
+/// depend on the request type, see pstudio::daemon::request_type. The payload of responses which are not
+/// status::ok is an error message.
+namespace pstudio::daemon {
+	enum class request_type : std::uint8_t {
+		/// \brief Lists all files and directories of the archive, one path per line. The file path is ignored.
+		list = 1,
+
+		/// \brief Returns the raw contents of a file.
+		extract = 2,
+
+		/// \brief Returns the document zdump writes for a file, as BSON if the argument is 1 and JSON otherwise.
+		dump = 3,
+
+		/// \brief Decodes the mipmap with the level given in the argument of a texture to RGBA8. The payload consists
+		///        of the width and height of the mipmap as little-endian 32-bit integers followed by the pixels.
+		texture = 4,
+	};
+
+	enum class status : std::uint8_t {
+		ok = 0,
+
+		/// \brief The archive is not mounted or the file does not exist in it.
+		not_found = 1,
+
+		/// \brief The request could not be completed, e.g. because the file could not be parsed.
+		error = 2,
+
+		/// \brief The daemon cannot answer the request, e.g. because the file is a nested VDF or of a format the
+		///        daemon does not parse. Clients handle the request themselves instead.
+		unsupported = 3,
+	};
+
+	/// \brief Frames larger than this are rejected to protect against corrupted streams.
+	constexpr std::uint32_t MAX_FRAME_SIZE = 1u << 30;
+
+	/// \brief The number of seconds clients wait for a response before doing the work themselves.
+	constexpr long CLIENT_TIMEOUT = 5;
+
+	struct request {
+		request_type type {request_type::list};
+		std::uint32_t argument {0};
+		std::string archive {};
+		std::string path {};
+	};
+
+	struct response {
+		daemon::status status {daemon::status::ok};
+		std::string payload {};
+	};
+
+	inline void put_u32(std::string& out, std::uint32_t value) {
+		for (int i = 0; i < 4; ++i) {
+			out.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+		}
+	}
+
+	/// \brief Reads a little-endian 32-bit integer from the start of \p in and removes it.
+	/// \throws std::runtime_error if \p in is too short.
+	inline std::uint32_t get_u32(std::string_view& in) {
+		if (in.size() < 4)
+			throw std::runtime_error {"truncated message"};
+
+		std::uint32_t value = 0;
+		for (int i = 0; i < 4; ++i) {
+			value |= static_cast<std::uint32_t>(static_cast<std::uint8_t>(in[static_cast<std::size_t>(i)])) << (i * 8);
+		}
+
+		in.remove_prefix(4);
+		return value;
+	}
+
+	inline std::string_view get_string(std::string_view& in) {
+		auto size = get_u32(in);
+		if (in.size() < size)
+			throw std::runtime_error {"truncated message"};
+
+		auto value = in.substr(0, size);
+		in.remove_prefix(size);
+		return value;
+	}
+
+	inline std::string encode(const request& req) {
+		std::string out {};
+		out.push_back(static_cast<char>(req.type));
+		put_u32(out, req.argument);
+		put_u32(out, static_cast<std::uint32_t>(req.archive.size()));
+		out += req.archive;
+		put_u32(out, static_cast<std::uint32_t>(req.path.size()));
+		out += req.path;
+		return out;
+	}
+
+	/// \throws std::runtime_error if the message is malformed.
+	inline request decode_request(std::string_view in) {
+		if (in.empty())
+			throw std::runtime_error {"empty request"};
+
+		request req {};
+		req.type = static_cast<request_type>(in[0]);
+		in.remove_prefix(1);
+
+		req.argument = get_u32(in);
+		req.archive = get_string(in);
+		req.path = get_string(in);
+		return req;
+	}
+
+	/// \brief Normalizes the path of an archive so that the daemon and its clients agree on it.
+	inline std::string archive_path(const std::string& path) {
+		std::error_code ec;
+		auto result = std::filesystem::weakly_canonical(std::filesystem::absolute(path, ec), ec);
+		return ec ? path : result.string();
+	}
+
+	/// \return The path of the daemon's socket, which is `$PSTUDIO_DAEMON_SOCKET` if set,
+	///         `$XDG_RUNTIME_DIR/pstudio-daemon.sock` if that is set and `/tmp/pstudio-daemon-<uid>.sock` otherwise.
+	inline std::string default_socket_path() {
+		if (const char* path = std::getenv("PSTUDIO_DAEMON_SOCKET"); path != nullptr)
+			return path;
+
+		if (const char* dir = std::getenv("XDG_RUNTIME_DIR"); dir != nullptr && *dir != '\0')
+			return std::string {dir} + "/pstudio-daemon.sock";
+
+#ifndef _WIN32
+		return "/tmp/pstudio-daemon-" + std::to_string(getuid()) + ".sock";
+#else
+		return {};
+#endif
+	}
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+	constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+	// where sending cannot suppress SIGPIPE, the process has to ignore it instead
+	constexpr int SEND_FLAGS = 0;
+#endif
+
+	/// \brief Writes a frame holding the given message to a socket.
+	/// \return `false` if the connection is broken.
+	inline bool write_frame(int fd, std::string_view message) {
+		std::string header {};
+		put_u32(header, static_cast<std::uint32_t>(message.size()));
+
+		for (auto data : {std::string_view {header}, message}) {
+			while (!data.empty()) {
+				auto written = ::send(fd, data.data(), data.size(), SEND_FLAGS);
+				if (written < 0 && errno == EINTR)
+					continue;
+				if (written <= 0)
+					return false;
+
+				data.remove_prefix(static_cast<std::size_t>(written));
+			}
+		}
+
+		return true;
+	}
+
+	/// \brief Reads exactly \p size bytes from a socket.
+	/// \return `false` if the connection was closed or broken first.
+	inline bool read_exact(int fd, char* data, std::size_t size) {
+		while (size > 0) {
+			auto count = ::recv(fd, data, size, 0);
+			if (count < 0 && errno == EINTR)
+				continue;
+			if (count <= 0)
+				return false;
+
+			data += count;
+			size -= static_cast<std::size_t>(count);
+		}
+
+		return true;
+	}
+
+	/// \brief Reads the next frame from a socket.
+	/// \return The message or `std::nullopt` if the connection was closed or the frame is too large.
+	inline std::optional<std::string> read_frame(int fd) {
+		char header[4];
+		if (!read_exact(fd, header, sizeof header))
+			return std::nullopt;
+
+		std::string_view view {header, sizeof header};
+		auto size = get_u32(view);
+		if (size > MAX_FRAME_SIZE)
+			return std::nullopt;
+
+		std::string message(size, '\0');
+		if (!read_exact(fd, message.data(), size))
+			return std::nullopt;
+
+		return message;
+	}
+
+	/// \brief Fills in the Unix domain socket address for the given path.
+	/// \return `false` if the path is too long to fit into the address.
+	inline bool make_address(const std::string& path, sockaddr_un& address) {
+		address = {};
+		address.sun_family = AF_UNIX;
+
+		if (path.empty() || path.size() >= sizeof address.sun_path)
+			return false;
+
+		std::memcpy(address.sun_path, path.data(), path.size());
+		return true;
+	}
+#endif
+
+	/// \brief A connection to a running daemon.
+	///
+	/// On platforms without Unix domain sockets, connecting always fails and tools do all work themselves.
+	class client {
+	public:
+		client(const client&) = delete;
+		client& operator=(const client&) = delete;
+
+		client(client&& other) noexcept : _m_fd(std::exchange(other._m_fd, -1)) {}
+
+		client& operator=(client&& other) noexcept {
+			std::swap(_m_fd, other._m_fd);
+			return *this;
+		}
+
+		~client() {
+#ifndef _WIN32
+			if (_m_fd >= 0)
+				::close(_m_fd);
+#endif
+		}
+
+		/// \brief Connects to the daemon listening on the given socket.
+		/// \return The connection or `std::nullopt` if no daemon is listening.
+		static std::optional<client> connect(const std::string& path = default_socket_path()) {
+#ifndef _WIN32
+			sockaddr_un address;
+			if (!make_address(path, address))
+				return std::nullopt;
+
+			client result {::socket(AF_UNIX, SOCK_STREAM, 0)};
+			if (result._m_fd < 0 ||
+			    ::connect(result._m_fd, reinterpret_cast<const sockaddr*>(&address), sizeof address) != 0)
+				return std::nullopt;
+
+			// a busy or stuck daemon makes send() fail instead of blocking the client
+			timeval timeout {CLIENT_TIMEOUT, 0};
+			::setsockopt(result._m_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+			::setsockopt(result._m_fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+			return result;
+#else
+			(void) path;
+			return std::nullopt;
+#endif
+		}
+
+		/// \brief Sends a request and waits for its response.
+		/// \return The response or `std::nullopt` if the connection broke or the daemon did not answer within
+		///         CLIENT_TIMEOUT seconds.
+		std::optional<response> send(const request& req) {
+#ifndef _WIN32
+			if (!write_frame(_m_fd, encode(req)))
+				return std::nullopt;
+
+			auto message = read_frame(_m_fd);
+			if (!message || message->empty())
+				return std::nullopt;
+
+			response result {};
+			result.status = static_cast<status>((*message)[0]);
+			result.payload = message->substr(1);
+			return result;
+#else
+			(void) req;
+			return std::nullopt;
+#endif
+		}
+
+	private:
+		explicit client(int fd) : _m_fd(fd) {}
+
+		int _m_fd;
+	};
+
+	/// \brief Sends a single request to the daemon if one is running.
+	///
+	/// This is the entry point of the tools' thin client mode. Tools fall back to doing the work themselves unless
+	/// the result holds a response other than status::not_found and status::unsupported.
+	/// \return The response or `std::nullopt` if no daemon is running or the connection broke.
+	inline std::optional<response> forward(const request& req) {
+		auto connection = client::connect();
+		if (!connection)
+			return std::nullopt;
+
+		return connection->send(req);
+	}
+} // namespace pstudio::daemon
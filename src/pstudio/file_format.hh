@@ -0,0 +1,217 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <string_view>
+#include <utility>
+
+namespace pstudio {
+	/// \brief The file formats which can be told apart by their contents.
+	enum class file_format {
+		mdh,
+		man,
+		csl,
+		fnt,
+		msh,
+		tex,
+		mds,
+		msb,
+		mrm,
+		mdm,
+		mmb,
+		vdf,
+		zen,
+		unknown,
+	};
+
+	/// \brief The number of bytes at the start of a file detect_file_format() looks at.
+	///
+	/// Passing fewer bytes is fine, passing more has no effect.
+	constexpr std::size_t FORMAT_HEADER_SIZE = 4096;
+
+	namespace detail {
+		/// \brief A sequence of bytes found at a fixed offset in every file of a format.
+		struct format_signature {
+			file_format format;
+			std::size_t offset;
+			std::string_view magic;
+		};
+
+		// binary formats start with their little-endian chunk type
+		constexpr format_signature FORMAT_SIGNATURES[] = {
+		    {file_format::tex, 0, {"ZTEX", 4}},
+		    {file_format::vdf, 256, {"PSVDSC_V2.00", 12}},
+		    {file_format::mdm, 0, {"\x00\xD0", 2}},
+		    {file_format::mmb, 0, {"\x00\xE0", 2}},
+		    {file_format::mdh, 0, {"\x00\xD1", 2}},
+		    {file_format::mrm, 0, {"\x00\xB1", 2}},
+		    {file_format::man, 0, {"\x00\xA0", 2}},
+		    {file_format::msh, 0, {"\x00\xB0", 2}},
+		    {file_format::msb, 0, {"\x00\xF0", 2}},
+		};
+
+		/// \brief The class names of the first object in ZenGin archives of a known format.
+		constexpr std::pair<std::string_view, file_format> ARCHIVE_CLASSES[] = {
+		    {"zCCSLib", file_format::csl},
+		    {"oCWorld:zCWorld", file_format::zen},
+		};
+
+		inline bool is_space(char c) noexcept {
+			return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+		}
+
+		inline bool is_word(char c) noexcept {
+			return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+		}
+
+		inline char to_lower(char c) noexcept {
+			return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+		}
+
+		/// \brief Splits off the first line of the given text without its surrounding whitespace.
+		inline std::string_view next_line(std::string_view& text) noexcept {
+			auto end = text.find('\n');
+			auto line = text.substr(0, end);
+			text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+			while (!line.empty() && is_space(line.front())) {
+				line.remove_prefix(1);
+			}
+
+			while (!line.empty() && is_space(line.back())) {
+				line.remove_suffix(1);
+			}
+
+			return line;
+		}
+
+		/// \brief Checks whether the line contains `Model("<name>")` in any case and with any spacing.
+		inline bool contains_model_declaration(std::string_view line) noexcept {
+			constexpr std::string_view keyword = "model";
+
+			for (std::size_t start = 0; start + keyword.size() <= line.size(); ++start) {
+				auto i = start;
+				while (i - start < keyword.size() && to_lower(line[i]) == keyword[i - start]) {
+					++i;
+				}
+
+				if (i - start != keyword.size())
+					continue;
+
+				auto skip_space = [&] {
+					while (i < line.size() && is_space(line[i])) {
+						++i;
+					}
+				};
+
+				auto expect = [&](char c) {
+					skip_space();
+					return i < line.size() && line[i++] == c;
+				};
+
+				if (!expect('(') || !expect('"'))
+					continue;
+
+				auto name = i;
+				while (i < line.size() && is_word(line[i])) {
+					++i;
+				}
+
+				if (i == name || i >= line.size() || line[i++] != '"' || !expect(')'))
+					continue;
+
+				return true;
+			}
+
+			return false;
+		}
+	} // namespace detail
+
+	/// \brief Guesses the format of a file from the bytes at its start.
+	///
+	/// Binary formats are recognized by the signatures in a static table. Text formats are recognized by scanning
+	/// the given bytes once, without allocating memory.
+	/// \param data The first bytes of the file.
+	/// \param size The number of bytes available, at most FORMAT_HEADER_SIZE of which are looked at.
+	/// \return The format of the file or file_format::unknown if it was not recognized.
+	inline file_format detect_file_format(const std::byte* data, std::size_t size) noexcept {
+		std::string_view header {reinterpret_cast<const char*>(data), std::min(size, FORMAT_HEADER_SIZE)};
+
+		for (const auto& signature : detail::FORMAT_SIGNATURES) {
+			if (header.size() >= signature.offset + signature.magic.size() &&
+			    header.substr(signature.offset, signature.magic.size()) == signature.magic)
+				return signature.format;
+		}
+
+		// model scripts may start with any number of comments and blank lines
+		auto text = header;
+		std::string_view line;
+		do {
+			line = detail::next_line(text);
+
+			if (detail::contains_model_declaration(line))
+				return file_format::mds;
+		} while (!text.empty() && (line.empty() || line[0] == '/'));
+
+		text = header;
+		line = detail::next_line(text);
+
+		if (line == "ZenGin Archive") {
+			// the first object's class name is stored as plain text in all archive formats
+			auto result = file_format::unknown;
+			auto first = std::string_view::npos;
+
+			for (const auto& [class_name, format] : detail::ARCHIVE_CLASSES) {
+				auto position = text.find(class_name);
+				if (position < first) {
+					first = position;
+					result = format;
+				}
+			}
+
+			return result;
+		}
+
+		if (line == "1")
+			return file_format::fnt;
+
+		return file_format::unknown;
+	}
+
+	/// \return The file extension commonly used for files of the given format in lowercase.
+	inline std::string_view format_name(file_format format) noexcept {
+		switch (format) {
+		case file_format::mdh:
+			return "mdh";
+		case file_format::man:
+			return "man";
+		case file_format::csl:
+			return "csl";
+		case file_format::fnt:
+			return "fnt";
+		case file_format::msh:
+			return "msh";
+		case file_format::tex:
+			return "tex";
+		case file_format::mds:
+			return "mds";
+		case file_format::msb:
+			return "msb";
+		case file_format::mrm:
+			return "mrm";
+		case file_format::mdm:
+			return "mdm";
+		case file_format::mmb:
+			return "mmb";
+		case file_format::vdf:
+			return "vdf";
+		case file_format::zen:
+			return "zen";
+		case file_format::unknown:
+			break;
+		}
+
+		return "unknown";
+	}
+} // namespace pstudio
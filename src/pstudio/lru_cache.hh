@@ -0,0 +1,75 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace pstudio {
+	/// \brief A thread-safe cache holding the most recently used values up to a fixed number of entries.
+	///
+	/// Values are handed out as shared pointers, so evicting an entry never invalidates a value still in use.
+	template <typename Key, typename Value, typename Hash = std::hash<Key>>
+	class lru_cache {
+	public:
+		/// \param capacity The maximum number of entries to keep. A capacity of 0 disables caching.
+		explicit lru_cache(std::size_t capacity) : _m_capacity(capacity) {}
+
+		/// \brief Looks up a value and marks it as the most recently used one.
+		/// \return The value or `nullptr` if it is not cached.
+		std::shared_ptr<const Value> find(const Key& key) {
+			std::lock_guard<std::mutex> lock {_m_mutex};
+
+			auto it = _m_index.find(key);
+			if (it == _m_index.end())
+				return nullptr;
+
+			_m_entries.splice(_m_entries.begin(), _m_entries, it->second);
+			return it->second->second;
+		}
+
+		/// \brief Adds a value as the most recently used one, evicting the least recently used value if necessary.
+		///
+		/// If another thread added a value for the same key in the meantime, that value is kept and returned instead.
+		/// \return The cached value.
+		std::shared_ptr<const Value> insert(const Key& key, std::shared_ptr<const Value> value) {
+			std::lock_guard<std::mutex> lock {_m_mutex};
+
+			if (auto it = _m_index.find(key); it != _m_index.end()) {
+				_m_entries.splice(_m_entries.begin(), _m_entries, it->second);
+				return it->second->second;
+			}
+
+			if (_m_capacity == 0)
+				return value;
+
+			if (_m_entries.size() >= _m_capacity) {
+				_m_index.erase(_m_entries.back().first);
+				_m_entries.pop_back();
+			}
+
+			_m_entries.emplace_front(key, std::move(value));
+			_m_index.emplace(key, _m_entries.begin());
+			return _m_entries.front().second;
+		}
+
+		/// \return The number of cached values.
+		[[nodiscard]] std::size_t size() const {
+			std::lock_guard<std::mutex> lock {_m_mutex};
+			return _m_entries.size();
+		}
+
+	private:
+		using entry = std::pair<Key, std::shared_ptr<const Value>>;
+
+		std::size_t _m_capacity;
+
+		/// \brief The entries, most recently used first.
+		std::list<entry> _m_entries {};
+		std::unordered_map<Key, typename std::list<entry>::iterator, Hash> _m_index {};
+		mutable std::mutex _m_mutex {};
+	};
+} // namespace pstudio
@@ -0,0 +1,266 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+
+/// \brief Reader for the binary mesh cache format written by `zmodel -t zmc`.
+///
+/// A mesh cache file stores a single indexed triangle mesh in a form which can be used directly after mapping it
+/// into memory. All values are stored little-endian. The file starts with a pstudio::mesh_cache::header followed by
+/// the sections listed in pstudio::mesh_cache::section_id. Every section starts at a multiple of
+/// pstudio::mesh_cache::ALIGNMENT bytes from the start of the file and contains a tightly packed array:
+///
+/// | Section        | Element type                   | Count                   |
+/// |----------------|--------------------------------|-------------------------|
+/// | `positions`    | pstudio::mesh_cache::float3    | `vertex_count`          |
+/// | `normals`      | pstudio::mesh_cache::float3    | `vertex_count`          |
+/// | `uvs`          | pstudio::mesh_cache::float2    | `vertex_count`          |
+/// | `lightmap_uvs` | pstudio::mesh_cache::float2    | `vertex_count` or 0     |
+/// | `indices`      | `std::uint32_t`                | `index_count`           |
+/// | `primitives`   | pstudio::mesh_cache::primitive | `primitive_count`       |
+/// | `materials`    | pstudio::mesh_cache::material  | `material_count`        |
+/// | `strings`      | `char`                         | the size of the section |
+///
+/// Every three indices form one triangle and every primitive is a consecutive range of indices sharing a material.
+/// Strings are not null-terminated and referenced by their offset and size in the `strings` section.
+///
+/// The version is incremented whenever the layout changes. Readers reject files of other versions.
+namespace pstudio::mesh_cache {
+	/// \brief The magic bytes at the start of every mesh cache file.
+	static constexpr char MAGIC[4] = {'P', 'S', 'M', 'C'};
+
+	/// \brief The version of the format described here.
+	static constexpr std::uint32_t VERSION = 1;
+
+	/// \brief The value of header::byte_order. Used to detect files read on hosts of a different byte order.
+	static constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	/// \brief The alignment of every section in bytes.
+	static constexpr std::uint64_t ALIGNMENT = 16;
+
+	/// \brief The sections of a mesh cache file, in the order they appear in.
+	enum section_id : std::uint32_t {
+		positions = 0,
+		normals,
+		uvs,
+		lightmap_uvs,
+		indices,
+		primitives,
+		materials,
+		strings,
+		section_count,
+	};
+
+	struct float2 {
+		float x;
+		float y;
+	};
+
+	struct float3 {
+		float x;
+		float y;
+		float z;
+	};
+
+	/// \brief A reference to a string in the `strings` section.
+	struct string_ref {
+		std::uint32_t offset;
+		std::uint32_t size;
+	};
+
+	/// \brief The location of a section relative to the start of the file, in bytes.
+	struct section {
+		std::uint64_t offset;
+		std::uint64_t size;
+	};
+
+	struct header {
+		char magic[4];
+		std::uint32_t version;
+		std::uint32_t byte_order;
+
+		/// \brief The size of this header in bytes.
+		std::uint32_t header_size;
+
+		std::uint32_t vertex_count;
+		std::uint32_t index_count;
+		std::uint32_t primitive_count;
+		std::uint32_t material_count;
+
+		/// \brief The name of the mesh.
+		string_ref name;
+
+		section sections[section_count];
+	};
+
+	/// \brief A consecutive range of triangles sharing one material.
+	struct primitive {
+		/// \brief The index of the material in the `materials` section.
+		std::uint32_t material;
+
+		/// \brief The index of the first index of the range.
+		std::uint32_t offset;
+
+		/// \brief The number of indices in the range.
+		std::uint32_t count;
+
+		/// \brief The lightmap atlas page used by the range or -1 if it is not lightmapped.
+		std::int32_t lightmap;
+	};
+
+	struct material {
+		string_ref name;
+
+		/// \brief The name of the material's texture or an empty string if it has none.
+		string_ref texture;
+	};
+
+	static_assert(sizeof(float2) == 8 && sizeof(float3) == 12 && sizeof(string_ref) == 8, "unexpected padding");
+	static_assert(sizeof(header) == 40 + section_count * sizeof(section), "unexpected padding");
+	static_assert(sizeof(primitive) == 16 && sizeof(material) == 16, "unexpected padding");
+
+	/// \brief A read-only view of a contiguous array inside a mesh cache file.
+	template <typename T>
+	class array_view {
+	public:
+		array_view() = default;
+		array_view(const T* data, std::size_t size) : _m_data(data), _m_size(size) {}
+
+		[[nodiscard]] const T* data() const noexcept {
+			return _m_data;
+		}
+
+		[[nodiscard]] std::size_t size() const noexcept {
+			return _m_size;
+		}
+
+		[[nodiscard]] bool empty() const noexcept {
+			return _m_size == 0;
+		}
+
+		[[nodiscard]] const T* begin() const noexcept {
+			return _m_data;
+		}
+
+		[[nodiscard]] const T* end() const noexcept {
+			return _m_data + _m_size;
+		}
+
+		const T& operator[](std::size_t i) const noexcept {
+			return _m_data[i];
+		}
+
+	private:
+		const T* _m_data {nullptr};
+		std::size_t _m_size {0};
+	};
+
+	/// \brief Provides typed access to a mesh cache file in memory without copying or converting it.
+	///
+	/// Only the header and the section bounds are checked when constructing the view, which takes constant time.
+	/// The contents of the arrays, like the indices and material references, are not validated.
+	class mesh_view {
+	public:
+		/// \brief Checks the header of a mesh cache file and creates a view of it.
+		/// \param data The contents of the file, i.e. a memory-mapping of it. Must be aligned to 8 bytes and
+		///             outlive the view.
+		/// \param size The size of the file in bytes.
+		/// \throws std::runtime_error if the data is not a valid mesh cache file of the supported version.
+		mesh_view(const void* data, std::size_t size) : _m_data(static_cast<const std::byte*>(data)) {
+			if (reinterpret_cast<std::uintptr_t>(data) % alignof(header) != 0)
+				throw std::runtime_error("mesh cache: data is not aligned");
+			if (size < sizeof(header))
+				throw std::runtime_error("mesh cache: file is too small");
+
+			_m_header = reinterpret_cast<const header*>(data);
+			if (std::memcmp(_m_header->magic, MAGIC, sizeof MAGIC) != 0)
+				throw std::runtime_error("mesh cache: invalid magic");
+			if (_m_header->byte_order != BYTE_ORDER_MARK)
+				throw std::runtime_error("mesh cache: byte order not supported");
+			if (_m_header->version != VERSION || _m_header->header_size != sizeof(header))
+				throw std::runtime_error("mesh cache: version not supported");
+
+			for (const auto& sec : _m_header->sections) {
+				if (sec.offset % ALIGNMENT != 0 || sec.offset > size || sec.size > size - sec.offset)
+					throw std::runtime_error("mesh cache: section out of bounds");
+			}
+
+			auto vertices = _m_header->vertex_count;
+			auto lightmapped = _m_header->sections[section_id::lightmap_uvs].size != 0;
+
+			if (!_has(section_id::positions, sizeof(float3), vertices) ||
+			    !_has(section_id::normals, sizeof(float3), vertices) ||
+			    !_has(section_id::uvs, sizeof(float2), vertices) ||
+			    (lightmapped && !_has(section_id::lightmap_uvs, sizeof(float2), vertices)) ||
+			    !_has(section_id::indices, sizeof(std::uint32_t), _m_header->index_count) ||
+			    !_has(section_id::primitives, sizeof(primitive), _m_header->primitive_count) ||
+			    !_has(section_id::materials, sizeof(material), _m_header->material_count))
+				throw std::runtime_error("mesh cache: section size mismatch");
+		}
+
+		[[nodiscard]] const header& file_header() const noexcept {
+			return *_m_header;
+		}
+
+		[[nodiscard]] std::string_view name() const {
+			return string(_m_header->name);
+		}
+
+		[[nodiscard]] array_view<float3> positions() const noexcept {
+			return _array<float3>(section_id::positions, _m_header->vertex_count);
+		}
+
+		[[nodiscard]] array_view<float3> normals() const noexcept {
+			return _array<float3>(section_id::normals, _m_header->vertex_count);
+		}
+
+		[[nodiscard]] array_view<float2> uvs() const noexcept {
+			return _array<float2>(section_id::uvs, _m_header->vertex_count);
+		}
+
+		/// \return The lightmap texture coordinates of every vertex or an empty view if the mesh has none.
+		[[nodiscard]] array_view<float2> lightmap_uvs() const noexcept {
+			auto count = _m_header->sections[section_id::lightmap_uvs].size / sizeof(float2);
+			return _array<float2>(section_id::lightmap_uvs, static_cast<std::size_t>(count));
+		}
+
+		[[nodiscard]] array_view<std::uint32_t> indices() const noexcept {
+			return _array<std::uint32_t>(section_id::indices, _m_header->index_count);
+		}
+
+		[[nodiscard]] array_view<primitive> primitives() const noexcept {
+			return _array<primitive>(section_id::primitives, _m_header->primitive_count);
+		}
+
+		[[nodiscard]] array_view<material> materials() const noexcept {
+			return _array<material>(section_id::materials, _m_header->material_count);
+		}
+
+		/// \brief Resolves a reference into the `strings` section.
+		/// \throws std::runtime_error if the reference points outside of the section.
+		[[nodiscard]] std::string_view string(string_ref ref) const {
+			const auto& sec = _m_header->sections[section_id::strings];
+			if (ref.offset > sec.size || ref.size > sec.size - ref.offset)
+				throw std::runtime_error("mesh cache: string out of bounds");
+
+			return {reinterpret_cast<const char*>(_m_data + sec.offset + ref.offset), ref.size};
+		}
+
+	private:
+		[[nodiscard]] bool _has(section_id id, std::size_t element_size, std::uint32_t count) const noexcept {
+			return _m_header->sections[id].size == static_cast<std::uint64_t>(element_size) * count;
+		}
+
+		template <typename T>
+		[[nodiscard]] array_view<T> _array(section_id id, std::size_t count) const noexcept {
+			return {reinterpret_cast<const T*>(_m_data + _m_header->sections[id].offset), count};
+		}
+
+		const std::byte* _m_data;
+		const header* _m_header {nullptr};
+	};
+} // namespace pstudio::mesh_cache
@@ -0,0 +1,139 @@
+// Copyright © 2022 Luis Michaelis <lmichaelis.all+dev@gmail.com>
+// SPDX-License-Identifier: MIT
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace pstudio {
+	/// \brief A fixed-size set of worker threads which execute tasks in the order they were submitted.
+	class thread_pool {
+	public:
+		/// \brief Starts the worker threads.
+		/// \param threads The number of threads to start or 0 to start one thread per hardware thread.
+		explicit thread_pool(unsigned threads = 0) {
+			if (threads == 0)
+				threads = std::max(std::thread::hardware_concurrency(), 1u);
+
+			for (unsigned i = 0; i < threads; ++i) {
+				_m_workers.emplace_back([this] { _run(); });
+			}
+		}
+
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+
+		/// \brief Waits for all queued tasks to complete and joins the worker threads.
+		~thread_pool() {
+			{
+				std::lock_guard<std::mutex> lock {_m_mutex};
+				_m_stopped = true;
+			}
+
+			_m_condition.notify_all();
+			for (auto& worker : _m_workers) {
+				worker.join();
+			}
+		}
+
+		/// \brief Queues a task for execution on one of the worker threads.
+		/// \param fn The task to execute.
+		/// \return A future holding the task's result or the exception it threw.
+		template <typename F>
+		std::future<std::invoke_result_t<F>> submit(F&& fn) {
+			auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(fn));
+			auto result = task->get_future();
+
+			{
+				std::lock_guard<std::mutex> lock {_m_mutex};
+				_m_tasks.emplace_back([task] { (*task)(); });
+			}
+
+			_m_condition.notify_one();
+			return result;
+		}
+
+		/// \return The number of worker threads.
+		[[nodiscard]] unsigned size() const noexcept {
+			return static_cast<unsigned>(_m_workers.size());
+		}
+
+		/// \return Whether the calling thread is one of this pool's worker threads.
+		[[nodiscard]] bool is_worker() const noexcept {
+			return _current() == this;
+		}
+
+	private:
+		static const thread_pool*& _current() noexcept {
+			thread_local const thread_pool* current = nullptr;
+			return current;
+		}
+
+		void _run() {
+			_current() = this;
+
+			for (;;) {
+				std::function<void()> task;
+
+				{
+					std::unique_lock<std::mutex> lock {_m_mutex};
+					_m_condition.wait(lock, [this] { return _m_stopped || !_m_tasks.empty(); });
+
+					if (_m_tasks.empty())
+						return;
+
+					task = std::move(_m_tasks.front());
+					_m_tasks.pop_front();
+				}
+
+				task();
+			}
+		}
+
+		std::vector<std::thread> _m_workers;
+		std::deque<std::function<void()>> _m_tasks;
+		std::mutex _m_mutex;
+		std::condition_variable _m_condition;
+		bool _m_stopped {false};
+	};
+
+	/// \brief Calls `fn(begin, end)` for consecutive ranges of at most \p grain indices covering `[0, count)`.
+	///
+	/// The ranges are processed concurrently on the given pool. This function blocks until all of them are
+	/// done and re-throws the first exception thrown by \p fn, if any. When called from one of the pool's own
+	/// workers, all ranges are processed on the calling thread instead since waiting for other tasks of the
+	/// same pool from within a task may deadlock.
+	template <typename F>
+	void parallel_for(thread_pool& pool, std::size_t count, std::size_t grain, F&& fn) {
+		if (pool.is_worker()) {
+			for (std::size_t begin = 0; begin < count; begin += grain) {
+				fn(begin, std::min(begin + grain, count));
+			}
+			return;
+		}
+
+		std::vector<std::future<void>> futures {};
+		futures.reserve((count + grain - 1) / grain);
+
+		for (std::size_t begin = 0; begin < count; begin += grain) {
+			auto end = std::min(begin + grain, count);
+			futures.push_back(pool.submit([&fn, begin, end] { fn(begin, end); }));
+		}
+
+		for (auto& future : futures) {
+			future.wait();
+		}
+
+		for (auto& future : futures) {
+			future.get();
+		}
+	}
+} // namespace pstudio